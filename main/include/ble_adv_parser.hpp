@@ -0,0 +1,80 @@
+#pragma once
+
+// NOTE: ESP-IDF Embedded Development Constraints
+// - No exception handling (-fno-exceptions)
+// - No RTTI (-fno-rtti)
+// - Use error codes and boolean returns instead of exceptions
+// - Memory management through ESP-IDF heap functions
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ble_serial {
+
+/**
+ * @brief Fields of one advertisement or scan response, decoded in a single pass
+ *
+ * Fixed layout with bounded lists so it can live on the NimBLE host task's
+ * stack. Fields that did not appear in the payload are marked absent in
+ * `present`; list entries beyond the bounds are dropped and flagged.
+ */
+struct AdvFields {
+    static constexpr size_t MAX_NAME_LEN = 29;       // Longest name that fits a legacy advertisement
+    static constexpr size_t MAX_UUIDS16 = 8;
+    static constexpr size_t MAX_UUIDS32 = 2;
+    static constexpr size_t MAX_UUIDS128 = 2;
+    static constexpr size_t MAX_MFG_DATA = 24;       // Manufacturer payload after the company ID
+
+    // Bits of `present`
+    static constexpr uint16_t HAS_FLAGS = 1 << 0;
+    static constexpr uint16_t HAS_NAME = 1 << 1;
+    static constexpr uint16_t NAME_COMPLETE = 1 << 2;  // AD type 0x09 rather than shortened 0x08
+    static constexpr uint16_t HAS_TX_POWER = 1 << 3;
+    static constexpr uint16_t HAS_APPEARANCE = 1 << 4;
+    static constexpr uint16_t HAS_MFG_DATA = 1 << 5;
+    static constexpr uint16_t TRUNCATED = 1 << 6;      // A list or the manufacturer data overflowed
+
+    uint16_t present;
+    uint8_t flags;                                   // LE discoverable mode and BR/EDR support bits
+    int8_t tx_power;                                 // dBm
+    uint16_t appearance;                             // GAP appearance category
+    uint16_t company_id;                             // Bluetooth SIG company identifier
+    uint8_t mfg_data_len;
+    uint8_t name_len;
+    uint8_t uuid16_count;
+    uint8_t uuid32_count;
+    uint8_t uuid128_count;
+    char name[MAX_NAME_LEN + 1];
+    uint16_t uuids16[MAX_UUIDS16];
+    uint32_t uuids32[MAX_UUIDS32];
+    uint8_t uuids128[MAX_UUIDS128][16];              // Little-endian, as on air
+    uint8_t mfg_data[MAX_MFG_DATA];
+
+    bool has(uint16_t bit) const {
+        return (present & bit) != 0;
+    }
+
+    bool has_uuid16(uint16_t uuid) const {
+        for (size_t i = 0; i < uuid16_count; i++) {
+            if (uuids16[i] == uuid) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief Decode raw AD structures into fields
+ *
+ * Walks the length-type-value records once and never allocates. A zero
+ * length ends the significant part early, as the Core spec allows; a record
+ * running past the end marks the payload malformed.
+ * @param data Raw advertising or scan response payload
+ * @param len Payload length
+ * @param fields Receives every field decoded before any error
+ * @return false if the payload is malformed
+ */
+bool parse_adv_fields(const uint8_t* data, size_t len, AdvFields& fields);
+
+} // namespace ble_serial
@@ -13,17 +13,37 @@
 // - Memory management through ESP-IDF heap functions
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <functional>
 #include <vector>
+#include <atomic>
+#include <array>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "nimble/nimble_npl.h"
+#include "ble_scan_table.hpp"
+#include "ble_observer.hpp"
+#include "hosted_link.hpp"
+#include "event_bus.hpp"
+#include "sdkconfig.h"
 
 // Forward declarations for NimBLE types (headers included in implementation)
 struct ble_gap_event;
 struct ble_gatt_access_ctxt;
+struct os_mbuf;
+struct ble_gatt_error;
 
 // Include necessary types for class definition
 #define BLE_HS_CONN_HANDLE_NONE (0xffff)
 
+namespace command_interface {
+    class ResponseWriter;
+}
+
 namespace ble_serial {
 
 // Forward declaration
@@ -34,10 +54,28 @@ class CommandInterpreter;
  * 
  * Implements Nordic UART Service (NUS) over ESP-Hosted BLE for wireless
  * command interface access. Uses NimBLE stack with Hosted HCI transport.
+ *
+ * Up to MAX_SESSIONS centrals can be connected at once. Each connection has
+ * its own session (RX reassembly, TX serialization, MTU, subscription and
+ * link parameters), replies go back to the connection the command came from,
+ * and advertising continues while a session slot is free.
  */
 class BLEManager {
 public:
     static constexpr size_t MAX_DATA_LEN = 512;
+    static constexpr size_t MAX_SESSIONS = CONFIG_BT_NIMBLE_MAX_CONNECTIONS;
+
+    // Streams part of a command response to the client; false once it can no longer be delivered
+    using ResponseSink = std::function<bool(const char* data, size_t len)>;
+    // Runs one received command, writing its response through the sink as it is produced
+    using CommandCallback = std::function<void(std::string_view command, const ResponseSink& sink)>;
+
+    // Connection parameter policy applied when a central connects
+    enum class LinkPolicy {
+        THROUGHPUT,  // 2M PHY, DLE and a short interval for the whole connection
+        ADAPTIVE,    // Throughput settings during bursts, low-power interval when idle
+        LOW_POWER    // 1M PHY and a long interval with slave latency
+    };
     
     // Nordic UART Service UUIDs (actual UUIDs defined in implementation)
     // Service:  6E400001-B5A3-F393-E0A9-E50E24DCCA9E
@@ -49,6 +87,8 @@ public:
 
     /**
      * @brief Initialize BLE stack and Nordic UART Service
+     *
+     * NVS and the ESP-Hosted transport must already be initialized.
      * @return true if initialization successful
      */
     bool initialize();
@@ -67,23 +107,75 @@ public:
     bool stop_advertising();
 
     /**
-     * @brief Check if a BLE client is connected
+     * @brief Check if at least one BLE client is connected
      * @return true if connected
      */
     bool is_connected() const;
 
     /**
-     * @brief Send response data to connected BLE client
+     * @brief Get the number of connected BLE clients
+     * @return Sessions in use (at most MAX_SESSIONS)
+     */
+    size_t connection_count() const;
+
+    /**
+     * @brief Send response data to every subscribed BLE client
      * @param data Response string to send
-     * @return true if data sent successfully
+     * @return true if at least one client received all of it
      */
     bool send_response(const std::string& data);
 
+    /**
+     * @brief Send raw response bytes to every subscribed BLE client
+     * @param data Bytes to send
+     * @param len Number of bytes
+     * @return true if at least one client received all of it
+     */
+    bool send_response(const char* data, size_t len);
+
+    /**
+     * @brief Send raw response bytes to one BLE connection
+     *
+     * Splits the buffer into notifications sized to the connection's ATT MTU.
+     * When the NimBLE mbuf pool is exhausted the calling task (never the
+     * NimBLE host task) backs off a tick at a time until the controller frees
+     * buffers, and gives up after CONFIG_BLE_NUS_TX_TIMEOUT_MS without
+     * progress; other connections are not held up.
+     * @param conn_handle Destination connection
+     * @param data Bytes to send
+     * @param len Number of bytes
+     * @return true if all bytes were queued for transmission
+     */
+    bool send_response(uint16_t conn_handle, const char* data, size_t len);
+
+    /**
+     * @brief Connection whose command the calling task is executing
+     * @return Connection handle, or BLE_HS_CONN_HANDLE_NONE outside the BLE command worker
+     */
+    uint16_t command_conn_handle() const;
+
+    /**
+     * @brief Turn push events on or off for the client whose command is running
+     *
+     * Subscribed clients get each event bus event as one text line, sent by
+     * the command worker between commands so it never splits a response.
+     * @param enable true to receive events
+     * @return false outside the BLE command worker
+     */
+    bool set_command_client_events(bool enable);
+
+    /**
+     * @brief Check whether the client whose command is running receives push events
+     * @param enabled Receives the subscription state
+     * @return false outside the BLE command worker
+     */
+    bool get_command_client_events(bool& enabled) const;
+
     /**
      * @brief Set callback for processing received commands
      * @param callback Function to call when command received from BLE
      */
-    void set_command_callback(std::function<std::string(const std::string&)> callback);
+    void set_command_callback(CommandCallback callback);
 
     /**
      * @brief Scan for nearby BLE devices
@@ -104,6 +196,19 @@ public:
      */
     bool is_scanning() const;
 
+    /**
+     * @brief Start continuous observer mode (see AdvertObserver)
+     *
+     * Cannot run at the same time as a one-shot scan.
+     * @param config Scan parameters, filter and output format
+     * @param sink Destination for streamed records
+     * @return true if the observer started
+     */
+    bool start_observer(const ObserverConfig& config, AdvertObserver::RecordSink sink);
+    bool stop_observer();
+    bool is_observing() const;
+    void write_observer_status(command_interface::ResponseWriter& out) const;
+
     /**
      * @brief Get number of devices found in last scan
      * @return Number of devices found
@@ -111,17 +216,77 @@ public:
     int get_scan_result_count() const;
 
     /**
-     * @brief Get scan result by index
-     * @param index Index of device (0 to get_scan_result_count()-1)
-     * @return Device info string or empty if invalid index
+     * @brief Write one line per scan result
+     * @param out Destination for the result list
+     */
+    void write_scan_results(command_interface::ResponseWriter& out) const;
+
+    /**
+     * @brief Write detailed BLE stack status for debugging
+     * @param out Destination for the report
      */
-    std::string get_scan_result(int index) const;
+    void write_debug_status(command_interface::ResponseWriter& out) const;
 
     /**
-     * @brief Get detailed BLE stack status for debugging
-     * @return Status information string
+     * @brief Select the connection parameter policy
+     *
+     * Applied to every current connection immediately and to future connections.
+     * @param policy Policy to use
+     * @return true if the policy was applied (or stored while disconnected)
      */
-    std::string get_debug_status() const;
+    bool set_link_policy(LinkPolicy policy);
+
+    /**
+     * @brief Get the active connection parameter policy
+     * @return Current policy
+     */
+    LinkPolicy get_link_policy() const;
+
+    /**
+     * @brief Write effective PHY, MTU and connection interval of every connection
+     * @param out Destination for the report
+     */
+    void write_link_status(command_interface::ResponseWriter& out) const;
+
+    /**
+     * @brief Get this manager's traffic over the ESP-Hosted HCI transport
+     *
+     * Counts NUS writes and notifications, which make up nearly all ACL data.
+     * @param counters Receives the counters
+     */
+    void get_hci_counters(hosted_link::InterfaceCounters& counters) const;
+
+    /**
+     * @brief Time one HCI command round trip to the controller (LE Rand)
+     * @param round_trip_us Receives the round trip
+     * @return true if the controller answered
+     */
+    bool probe_hci(int64_t& round_trip_us) const;
+
+    /**
+     * @brief Slow down advertising once it has run fast for a while
+     *
+     * When enabled, advertising starts at the fast interval and moves to
+     * CONFIG_POWER_ADV_SLOW_INTERVAL_MS after CONFIG_POWER_ADV_FAST_PERIOD_S
+     * without a central connecting. Every restart (disconnect, free slot) is fast again.
+     * @param enable true for low-power advertising, false to stay fast
+     */
+    void set_low_power_advertising(bool enable);
+
+    /**
+     * @brief Convert link policy to its command-line name
+     * @param policy Link policy
+     * @return Policy name ("throughput", "adaptive" or "low_power")
+     */
+    static const char* link_policy_to_string(LinkPolicy policy);
+
+    /**
+     * @brief Parse a link policy name
+     * @param name Policy name as accepted by the ble_link command
+     * @param policy Parsed policy on success
+     * @return true if the name is a known policy
+     */
+    static bool link_policy_from_string(std::string_view name, LinkPolicy& policy);
 
 private:
     // NimBLE event handlers
@@ -131,47 +296,156 @@ private:
     static void on_sync_callback(void);
     static void on_reset_callback(int reason);
     static void nimble_host_task(void *param);
+    static void command_worker_task(void *param);
+    static void link_idle_timer_callback(void *arg);
+    static void adv_interval_callout_handler(struct ble_npl_event *ev);
+    static void app_event_handler(void* arg, esp_event_base_t base, int32_t id, void* data);
+    static int mtu_exchange_callback(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                     uint16_t mtu, void *arg);
 
 public:
     // Internal methods (public for C callbacks)
-    void process_received_data(const uint8_t* data, uint16_t len);
+
+    /**
+     * @brief Reassemble a received NUS write and queue it for the command worker
+     *
+     * Called from the NimBLE host task; appends the write to the connection's
+     * RX buffer and, once the command is complete, copies it into the command
+     * queue and returns immediately.
+     * @param conn_handle Connection the write arrived on
+     * @param om Received GATT write payload
+     * @return true if the command was queued, false if it was rejected
+     */
+    bool process_received_data(uint16_t conn_handle, struct os_mbuf *om);
     void handle_connection_event(struct ble_gap_event *event);
     void handle_disconnection_event(struct ble_gap_event *event);
 
 private:
+    // One connected central
+    struct Session {
+        std::atomic<uint16_t> conn_handle{BLE_HS_CONN_HANDLE_NONE};  // NONE = free slot
+        bool subscribed = false;             // Client enabled TX notifications
+        bool events = false;                 // Client sent 'events on'
+        uint16_t att_mtu = 0;
+
+        // TX flow control
+        SemaphoreHandle_t tx_mutex = nullptr;  // One sender per connection at a time
+        TaskHandle_t tx_waiter = nullptr;
+
+        // Link parameters
+        std::atomic<bool> link_fast{false};
+        int64_t last_activity_us = 0;
+        uint16_t conn_itvl = 0;
+        uint16_t conn_latency = 0;
+        uint16_t supervision_timeout = 0;
+        uint8_t tx_phy = 0;
+        uint8_t rx_phy = 0;
+
+        // RX reassembly (host task only)
+        int64_t rx_started_us = 0;           // Arrival of the first part of rx_buf
+        uint16_t rx_len = 0;
+        char rx_buf[MAX_DATA_LEN];
+    };
+
     // Internal methods
     void setup_gatt_service();
     bool configure_advertising_data(const std::string& device_name);
     
     // NimBLE service setup
     bool register_nus_service();
-    void start_advertising_internal();
+    void start_advertising_internal(bool slow = false);
     
+    // Session table helpers
+    Session* find_session(uint16_t conn_handle);
+    const Session* find_session(uint16_t conn_handle) const;
+
     // BLE data transmission helpers
-    bool send_single_packet(const std::string& data);
+    static size_t max_notification_payload(const Session& session);
+    bool wait_for_tx_progress(TickType_t stall_start);
+    bool transmit_locked(Session& session, uint16_t conn_handle, const char* data, size_t len);
+    void handle_notify_tx_event(struct ble_gap_event *event);
+    void handle_subscribe_event(struct ble_gap_event *event);
+    static bool rx_complete(const Session& session, size_t write_len);
+
+    // Link parameter policy helpers
+    void apply_link_policy(Session& session);
+    void request_conn_interval(Session& session, bool fast);
+    void note_link_activity(Session& session);
+    void refresh_conn_params(Session& session);
+
+    // NUS write waiting for the command worker
+    struct PendingCommand {
+        int64_t received_us;   // esp_timer time of the write, for latency telemetry
+        uint16_t conn_handle;
+        uint16_t len;
+        char data[MAX_DATA_LEN];
+    };
+
+    // Event line waiting for the command worker
+    struct PendingEvent {
+        uint16_t len;
+        char data[event_bus::MAX_LINE_LEN];
+    };
+
+    // Command worker helpers
+    bool start_command_worker();
+    void execute_pending_command(const PendingCommand& pending);
+    void push_event(const PendingEvent& event);
 
     // State variables
     bool initialized_;
-    bool advertising_;
-    bool connected_;
+    std::atomic<bool> advertising_;
     bool scanning_;
-    uint16_t conn_handle_;
     uint16_t nus_service_handle_;
     uint16_t nus_rx_char_handle_;
     uint16_t nus_tx_char_handle_;
     std::string device_name_;
+
+    // Connected centrals
+    std::array<Session, MAX_SESSIONS> sessions_;
+    std::atomic<uint32_t> session_count_;
+    uint32_t connections_accepted_;
+    uint32_t rx_fragments_;               // Writes held back as part of a longer command
+    uint32_t rx_discarded_;               // Partial commands dropped (too long or abandoned)
+
+    // NUS TX statistics (all sessions)
+    std::atomic<uint32_t> tx_notifications_;
+    std::atomic<uint32_t> tx_bytes_;
+    std::atomic<uint32_t> tx_stalls_;
+    std::atomic<uint32_t> tx_failures_;
+
+    // NUS RX statistics (all sessions, host task only)
+    uint32_t rx_writes_;
+    uint32_t rx_bytes_;
+
+    // Link parameters
+    LinkPolicy link_policy_;
+    esp_timer_handle_t link_idle_timer_;  // Fires at the earliest idle deadline of a fast session
+
+    // Advertising intervals
+    std::atomic<bool> low_power_adv_;
+    std::atomic<bool> adv_slow_;          // Current advertising runs at the slow interval
+    struct ble_npl_callout adv_interval_callout_;  // Switches the interval on the host task
     
-    // Scan results storage
-    struct ScanResult {
-        std::string address;
-        std::string name;
-        int rssi;
-        std::string service_uuids;
-    };
-    std::vector<ScanResult> scan_results_;
+    // Discovered devices (fixed capacity, updated in place from the host task)
+    ScanTable scan_table_;
+    AdvertObserver observer_;
     
     // Command processing callback
-    std::function<std::string(const std::string&)> command_callback_;
+    CommandCallback command_callback_;
+
+    // Command worker (keeps command execution off the NimBLE host task)
+    QueueHandle_t command_queue_;
+    TaskHandle_t command_worker_handle_;
+    std::atomic<uint16_t> command_conn_handle_;  // Connection of the command being executed
+    uint32_t commands_dropped_;
+
+    // Push events, delivered by the command worker
+    QueueHandle_t event_queue_;
+    QueueSetHandle_t worker_queues_;      // Commands and events, so the worker waits on both
+    std::atomic<uint32_t> event_clients_;
+    std::atomic<uint32_t> events_pushed_;
+    std::atomic<uint32_t> events_dropped_;
     
 public:
     // Static instance for C callbacks (public for callback access)
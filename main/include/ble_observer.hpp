@@ -0,0 +1,130 @@
+#pragma once
+
+// NOTE: ESP-IDF Embedded Development Constraints
+// - No exception handling (-fno-exceptions)
+// - No RTTI (-fno-rtti)
+// - Use error codes and boolean returns instead of exceptions
+// - Memory management through ESP-IDF heap functions
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ble_scan_table.hpp"
+
+struct ble_gap_event;
+struct ble_gap_disc_desc;
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace ble_serial {
+
+/**
+ * @brief Advertisement filter; every set criterion must match
+ */
+struct ObserverFilter {
+    char name_prefix[ScanEntry::MAX_NAME_LEN + 1];  // Empty = any (needs a name in the advert)
+    uint16_t uuid16;                                // 0 = any
+    int32_t company_id;                             // Manufacturer data company ID, -1 = any
+    int8_t min_rssi;                                // -127 = any
+};
+
+struct ObserverConfig {
+    uint16_t interval_ms;   // Scan interval
+    uint16_t window_ms;     // Listening time per interval (duty cycle = window / interval)
+    bool active;            // Send scan requests (names often only arrive in scan responses)
+    bool binary;            // Binary records instead of text lines
+    ObserverFilter filter;
+
+    static ObserverConfig defaults();
+};
+
+/**
+ * @brief Binary record header streamed for each matching advertisement
+ *
+ * Followed by `length - (sizeof(ObserverRecordHeader) - 2)` bytes of raw AD
+ * payload. Multi-byte fields are little-endian.
+ */
+struct __attribute__((packed)) ObserverRecordHeader {
+    static constexpr uint8_t SYNC = 0xAD;
+
+    uint8_t sync;            // SYNC
+    uint8_t length;          // Bytes after this field
+    uint32_t timestamp_ms;   // esp_timer time of reception
+    uint8_t addr[6];
+    uint8_t addr_type;
+    int8_t rssi;
+    uint8_t event_type;      // BLE_HCI_ADV_RPT_EVTYPE_*
+};
+
+/**
+ * @brief Long-running BLE observer that streams filtered advertisements
+ *
+ * Scans indefinitely (passive by default, with a configurable duty cycle),
+ * filters in the NimBLE host task and hands matches to a small fixed queue.
+ * A streaming task formats them and writes them to the sink, so a slow sink
+ * drops records (counted) instead of stalling the host task.
+ */
+class AdvertObserver {
+public:
+    // Receives formatted records; false if the record could not be delivered
+    using RecordSink = std::function<bool(const char* data, size_t len)>;
+
+    AdvertObserver();
+    ~AdvertObserver();
+
+    /**
+     * @brief Start observing, replacing any previous configuration
+     * @param config Scan parameters, filter and output format
+     * @param sink Destination for records
+     * @return true if discovery started
+     */
+    bool start(const ObserverConfig& config, RecordSink sink);
+    bool stop();
+    bool is_active() const;
+
+    /**
+     * @brief Write configuration and counters
+     * @param out Destination for the report
+     */
+    void write_status(command_interface::ResponseWriter& out) const;
+
+private:
+    // One advertisement waiting for the streaming task
+    struct ObservedAdvert {
+        int64_t timestamp_us;
+        uint8_t addr[6];
+        uint8_t addr_type;
+        int8_t rssi;
+        uint8_t event_type;
+        uint8_t length;
+        uint8_t data[31];
+    };
+
+    static int gap_event_handler(struct ble_gap_event* event, void* arg);
+    static void stream_task(void* arg);
+    void on_advert(const struct ble_gap_disc_desc& desc);
+    bool matches(const struct ble_gap_disc_desc& desc) const;
+    size_t format_text(const ObservedAdvert& advert, char* buffer, size_t size) const;
+    size_t format_binary(const ObservedAdvert& advert, char* buffer, size_t size) const;
+
+    ObserverConfig config_;
+    RecordSink sink_;
+    SemaphoreHandle_t sink_mutex_;  // Held while the sink runs or is replaced
+    QueueHandle_t queue_;
+    TaskHandle_t task_;
+    std::atomic<bool> active_;
+
+    std::atomic<uint32_t> seen_;
+    std::atomic<uint32_t> matched_;
+    std::atomic<uint32_t> dropped_;     // Queue full or sink failed
+    std::atomic<uint32_t> streamed_;
+};
+
+} // namespace ble_serial
@@ -0,0 +1,166 @@
+#pragma once
+
+// NOTE: ESP-IDF Embedded Development Constraints
+// - No exception handling (-fno-exceptions)
+// - No RTTI (-fno-rtti)
+// - Use error codes and boolean returns instead of exceptions
+// - Memory management through ESP-IDF heap functions
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "ble_adv_parser.hpp"
+
+namespace ble_serial {
+
+/**
+ * @brief One discovered device, updated in place on every advertisement
+ */
+struct ScanEntry {
+    static constexpr size_t MAX_NAME_LEN = AdvFields::MAX_NAME_LEN;
+    static constexpr size_t MAX_UUIDS16 = 4;
+    static constexpr size_t MAX_UUIDS32 = 1;
+    static constexpr size_t MAX_UUIDS128 = 1;
+
+    uint8_t addr[6];
+    uint8_t addr_type;
+    uint8_t uuid16_count;
+    uint8_t uuid32_count;
+    uint8_t uuid128_count;
+    uint16_t present;                            // AdvFields::HAS_* bits seen from this device
+    uint8_t adv_flags;
+    int8_t tx_power;
+    uint16_t appearance;
+    uint16_t company_id;
+    char name[MAX_NAME_LEN + 1];                 // Empty until an AD name field is seen
+    uint16_t uuids16[MAX_UUIDS16];
+    uint32_t uuids32[MAX_UUIDS32];
+    uint8_t uuids128[MAX_UUIDS128][16];          // Little-endian, as on air
+    int8_t rssi_last;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    uint32_t adv_count;
+    int64_t rssi_sum;
+    int64_t first_seen_us;
+    int64_t last_seen_us;
+
+    int rssi_avg() const {
+        return adv_count ? static_cast<int>(rssi_sum / static_cast<int64_t>(adv_count)) : rssi_last;
+    }
+};
+
+/**
+ * @brief One received advertisement; pointers are only read during record()
+ *
+ * Fields absent from this payload leave what an earlier advertisement or
+ * scan response already filled in.
+ */
+struct AdvertReport {
+    const uint8_t* addr;          // 6 bytes, little-endian
+    uint8_t addr_type;
+    int8_t rssi;
+    const AdvFields* fields;      // Null if the payload was malformed
+};
+
+namespace detail {
+
+// Power of two at least twice the capacity keeps probe chains short
+constexpr size_t hash_slot_count(size_t capacity) {
+    size_t slots = 1;
+    while (slots < capacity * 2) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+} // namespace detail
+
+/**
+ * @brief Fixed-capacity BLE discovery table keyed by device address
+ *
+ * All storage is preallocated: devices live in a flat array indexed by a
+ * small open-addressing hash (linear probing, backward-shift deletion) and
+ * are threaded on an LRU list so the least recently seen device is evicted
+ * when the table is full. record() runs on the NimBLE host task for every
+ * advertisement and never touches the heap. Access is serialized by a
+ * spinlock held only for the duration of one update or one entry copy.
+ */
+class ScanTable {
+public:
+    static constexpr size_t CAPACITY = CONFIG_BLE_SCAN_TABLE_SIZE;
+
+    ScanTable();
+
+    void clear();
+
+    /**
+     * @brief Add or refresh a device from a received advertisement
+     * @param report Parsed advertisement
+     * @param now_us esp_timer time of reception
+     */
+    void record(const AdvertReport& report, int64_t now_us);
+
+    size_t size() const;
+    uint32_t evictions() const;
+
+    /**
+     * @brief Visit a copy of every device, most recently seen first
+     *
+     * Each entry is copied under the lock and fn runs outside it, so fn may
+     * block (e.g. write to a slow transport). Devices evicted meanwhile may be
+     * skipped or replaced by their successor.
+     */
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        std::array<uint16_t, CAPACITY> order;
+        size_t count = 0;
+
+        taskENTER_CRITICAL(&lock_);
+        for (uint16_t index = head_; index != NONE && count < CAPACITY; index = next_[index]) {
+            order[count++] = index;
+        }
+        taskEXIT_CRITICAL(&lock_);
+
+        for (size_t i = 0; i < count; i++) {
+            ScanEntry entry;
+            bool valid;
+            taskENTER_CRITICAL(&lock_);
+            valid = order[i] < count_;
+            if (valid) {
+                entry = entries_[order[i]];
+            }
+            taskEXIT_CRITICAL(&lock_);
+            if (valid) {
+                fn(entry);
+            }
+        }
+    }
+
+private:
+    static constexpr uint16_t NONE = 0xFFFF;
+
+    static constexpr size_t SLOT_COUNT = detail::hash_slot_count(CAPACITY);
+    static_assert(CAPACITY < NONE, "Scan table indexes must fit in uint16_t");
+
+    static void merge_fields(ScanEntry& entry, const AdvFields& fields);
+    static size_t hash_address(const uint8_t* addr, uint8_t addr_type);
+    bool matches(uint16_t index, const uint8_t* addr, uint8_t addr_type) const;
+    size_t find_slot(const uint8_t* addr, uint8_t addr_type) const;
+    void remove_slot(size_t slot);
+    void lru_unlink(uint16_t index);
+    void lru_push_front(uint16_t index);
+
+    std::array<ScanEntry, CAPACITY> entries_;
+    std::array<uint16_t, SLOT_COUNT> slots_;   // Entry index or NONE
+    std::array<uint16_t, CAPACITY> prev_;
+    std::array<uint16_t, CAPACITY> next_;
+    uint16_t head_;                            // Most recently seen
+    uint16_t tail_;                            // Eviction candidate
+    size_t count_;                             // Entries [0, count_) are in use
+    uint32_t evictions_;
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+} // namespace ble_serial
@@ -0,0 +1,40 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstdint>
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace telemetry {
+
+// Outcome of one boot stage
+enum class BootStageResult : uint8_t {
+    OK,
+    FAILED,
+    SKIPPED,   // A stage it depends on failed
+};
+
+/*
+ * Boot timeline. Each init stage records when it started and finished
+ * (esp_timer time, so 0 is early in the second-stage startup) and the core it
+ * ran on; mark_boot_ready() records when the command interfaces are up. The
+ * table is fixed size and written once per boot, from any task.
+ */
+
+void record_boot_stage(const char* name, int64_t start_us, int64_t end_us, int core, BootStageResult result);
+void mark_boot_ready();
+
+/**
+ * @brief Write every recorded stage and the boot-to-ready time
+ * @param out Destination for the report
+ */
+void write_boot_report(command_interface::ResponseWriter& out);
+
+} // namespace telemetry
@@ -0,0 +1,171 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+
+namespace command_interface {
+
+constexpr char ascii_tolower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// ASCII case-insensitive comparison (command names, relay ids, policy names)
+constexpr bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (ascii_tolower(a[i]) != ascii_tolower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Take the next command from a batch line
+ *
+ * Commands in a batch are separated by ';' or newlines; separators inside
+ * double quotes belong to the token ("a;b" stays one SSID).
+ * @param batch Remaining batch, advanced past the command and its separator
+ * @return The command with surrounding whitespace and CR removed (may be empty)
+ */
+constexpr std::string_view next_batch_command(std::string_view& batch) {
+    bool quoted = false;
+    size_t end = 0;
+    while (end < batch.size() && (quoted || (batch[end] != ';' && batch[end] != '\n'))) {
+        if (batch[end] == '"') {
+            quoted = !quoted;
+        }
+        ++end;
+    }
+
+    std::string_view command = batch.substr(0, end);
+    batch.remove_prefix(end < batch.size() ? end + 1 : end);
+
+    auto is_blank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    while (!command.empty() && is_blank(command.front())) {
+        command.remove_prefix(1);
+    }
+    while (!command.empty() && is_blank(command.back())) {
+        command.remove_suffix(1);
+    }
+    return command;
+}
+
+/**
+ * @brief Tokens of one command line, as views into the caller's line buffer
+ *
+ * Tokens are separated by spaces or tabs. A token may be wrapped in double
+ * quotes to include spaces ("My Network"); the quotes are not part of the
+ * token. No memory is allocated, so the line buffer must outlive the args.
+ * args[0] is the command name itself.
+ */
+class CommandArgs {
+public:
+    static constexpr size_t MAX_TOKENS = 12;
+
+    /**
+     * @brief Split a command line into tokens
+     * @param line Command line (not modified)
+     * @return true on success, false if the line has more than MAX_TOKENS
+     *         tokens or an unterminated quote
+     */
+    constexpr bool tokenize(std::string_view line) {
+        count_ = 0;
+        size_t pos = 0;
+
+        while (true) {
+            while (pos < line.size() && is_space(line[pos])) {
+                ++pos;
+            }
+            if (pos >= line.size()) {
+                return true;
+            }
+            if (count_ == MAX_TOKENS) {
+                return false;
+            }
+
+            size_t start = pos;
+            size_t end;
+            if (line[pos] == '"') {
+                start = ++pos;
+                while (pos < line.size() && line[pos] != '"') {
+                    ++pos;
+                }
+                if (pos >= line.size()) {
+                    return false;
+                }
+                end = pos++;
+            } else {
+                while (pos < line.size() && !is_space(line[pos])) {
+                    ++pos;
+                }
+                end = pos;
+            }
+            tokens_[count_++] = line.substr(start, end - start);
+        }
+    }
+
+    /**
+     * @brief Append one already-split token (binary frames carry no quoting)
+     * @return false if MAX_TOKENS tokens are already present
+     */
+    constexpr bool push(std::string_view token) {
+        if (count_ == MAX_TOKENS) {
+            return false;
+        }
+        tokens_[count_++] = token;
+        return true;
+    }
+
+    constexpr size_t size() const { return count_; }
+    constexpr bool empty() const { return count_ == 0; }
+    constexpr std::string_view operator[](size_t index) const { return tokens_[index]; }
+
+private:
+    static constexpr bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+    std::array<std::string_view, MAX_TOKENS> tokens_{};
+    size_t count_ = 0;
+};
+
+/**
+ * @brief Parse a whole token as an integer within [min_value, max_value]
+ * @param text Token to parse (hex tokens may carry a 0x prefix)
+ * @param value Receives the parsed value on success (unchanged on failure)
+ * @param base 10 or 16
+ * @return true if the entire token is a number in range
+ */
+template <typename T>
+bool parse_integer(std::string_view text, T& value, T min_value, T max_value, int base = 10) {
+    static_assert(std::is_integral_v<T>, "parse_integer requires an integral type");
+
+    if (base == 16 && text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+    }
+
+    T parsed{};
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(first, last, parsed, base);
+    if (text.empty() || ec != std::errc() || ptr != last) {
+        return false;
+    }
+    if (parsed < min_value || parsed > max_value) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+} // namespace command_interface
@@ -0,0 +1,87 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "response_writer.hpp"
+
+namespace command_interface {
+
+/*
+ * Helpers for the bench command. Every benchmark ends with one result line,
+ *
+ *   BENCH {"test":"notify","size":244,...}
+ *
+ * which the host harness (pytest_bench.py) picks out of the console or NUS
+ * stream. The benchmark payload never contains "BENCH ".
+ */
+
+/**
+ * @brief Response writer that counts and discards its output
+ */
+class CountingResponseWriter : public ResponseWriter {
+public:
+    using ResponseWriter::write;
+    void write(const char* data, size_t len) override { bytes_ += len; }
+
+    size_t bytes() const { return bytes_; }
+
+private:
+    size_t bytes_ = 0;
+};
+
+/**
+ * @brief Writes one BENCH result line field by field
+ */
+class BenchResult {
+public:
+    BenchResult(ResponseWriter& out, const char* test);
+
+    BenchResult& field(const char* key, int64_t value);
+    BenchResult& field(const char* key, std::string_view value);   // JSON-escaped
+
+    // Closes the object and ends the line
+    void finish();
+
+private:
+    ResponseWriter& out_;
+};
+
+/**
+ * @brief Heap use of the default heap over a measured section
+ *
+ * Uses the heap's local minimum monitor, so the low point is exact rather
+ * than sampled. The monitor is global: overlapping windows (two transports
+ * benchmarking at once) see each other's allocations.
+ */
+class HeapWindow {
+public:
+    void start();
+    void stop();
+
+    size_t free_before() const { return free_before_; }
+    size_t free_after() const { return free_after_; }
+    // Peak bytes in use during the window beyond what was in use at start()
+    size_t peak_bytes() const { return free_before_ > min_free_ ? free_before_ - min_free_ : 0; }
+
+private:
+    size_t free_before_ = 0;
+    size_t min_free_ = 0;
+    size_t free_after_ = 0;
+};
+
+static constexpr size_t BENCH_MAX_PAYLOAD = 512;
+
+/**
+ * @brief Lowercase filler for throughput tests, read from flash
+ * @param len Bytes wanted (clamped to BENCH_MAX_PAYLOAD)
+ */
+std::string_view bench_payload(size_t len);
+
+} // namespace command_interface
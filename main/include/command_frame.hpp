@@ -0,0 +1,120 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "command_args.hpp"
+#include "response_writer.hpp"
+#include "sdkconfig.h"
+
+namespace command_interface {
+
+/**
+ * @brief Binary command frames, an alternative to text command lines
+ *
+ * A write whose first byte is FRAME_MAGIC carries one or more frames instead
+ * of a text line (text commands are printable, so the two never collide).
+ * Every frame is a FrameHeader followed by `length` payload bytes:
+ *
+ *   Request payload:  [len u8][command name] then [len u8][argument] repeated
+ *   Response payload: command output, truncated to CONFIG_BLE_FRAME_MAX_REPLY
+ *
+ * Arguments are length-prefixed, so they need no quoting. The response echoes
+ * the request ID, which lets clients pipeline several requests in one write
+ * (or several writes) and match the replies as they arrive.
+ */
+static constexpr uint8_t FRAME_MAGIC = 0xA5;
+
+enum class FrameStatus : uint8_t {
+    OK = 0,               // Command ran; payload is its output
+    UNKNOWN_COMMAND = 1,
+    BAD_ARGUMENTS = 2,    // Too many arguments or a length running past the payload
+    MALFORMED = 3,        // Header or length invalid; rest of the write is ignored
+    TRUNCATED = 4         // Command ran but its output did not fit the reply
+};
+
+struct __attribute__((packed)) FrameHeader {
+    uint8_t magic;         // FRAME_MAGIC
+    uint8_t status;        // FrameStatus in responses, 0 in requests
+    uint16_t request_id;   // Chosen by the client, echoed in the response
+    uint16_t length;       // Payload bytes following the header (little-endian)
+};
+
+struct Frame {
+    uint16_t request_id;
+    std::string_view payload;
+};
+
+inline bool is_frame(std::string_view data) {
+    return !data.empty() && static_cast<uint8_t>(data[0]) == FRAME_MAGIC;
+}
+
+/**
+ * @brief Iterate over the frames packed into one write
+ */
+class FrameReader {
+public:
+    explicit FrameReader(std::string_view data) : data_(data), malformed_(false) {}
+
+    /**
+     * @brief Take the next frame
+     * @param frame Receives the frame (payload views into the write)
+     * @return false at the end of the data or on a malformed frame
+     */
+    bool next(Frame& frame);
+
+    bool malformed() const { return malformed_; }
+
+private:
+    std::string_view data_;
+    bool malformed_;
+};
+
+/**
+ * @brief Split a request payload into command arguments
+ * @return false if a length runs past the payload or there are too many
+ */
+bool decode_frame_arguments(std::string_view payload, CommandArgs& args);
+
+/**
+ * @brief Response writer that collects output into a single reply frame
+ *
+ * The reply is bounded to CONFIG_BLE_FRAME_MAX_REPLY payload bytes, the
+ * default of which fits one notification at the 247 byte MTU, so a reply
+ * never needs reassembly. Output beyond that is dropped and reported as
+ * FrameStatus::TRUNCATED.
+ */
+class FrameResponseWriter : public ResponseWriter {
+public:
+    static constexpr size_t MAX_PAYLOAD = CONFIG_BLE_FRAME_MAX_REPLY;
+
+    FrameResponseWriter() : used_(0), truncated_(false) {}
+
+    using ResponseWriter::write;
+    void write(const char* data, size_t len) override;
+
+    /**
+     * @brief Fill in the header and return the complete frame
+     * @param request_id Request being answered
+     * @param status Outcome; OK is reported as TRUNCATED if output was dropped
+     */
+    std::string_view finish(uint16_t request_id, FrameStatus status);
+
+    void reset() {
+        used_ = 0;
+        truncated_ = false;
+    }
+
+private:
+    char frame_[sizeof(FrameHeader) + MAX_PAYLOAD];
+    size_t used_;
+    bool truncated_;
+};
+
+} // namespace command_interface
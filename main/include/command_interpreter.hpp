@@ -7,22 +7,35 @@
 // - Prefer C-style error codes or boolean returns for error handling
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <functional>
 #include <memory>
+#include "command_args.hpp"
 #include "wifi_manager.hpp"
+#include "relay_manager.hpp"
+#include "relay_scheduler.hpp"
+#include "macro_store.hpp"
+#include "serial_console.hpp"
 
 // Forward declarations
 namespace ble_serial {
     class BLEManager;
 }
 
-namespace relay_control {
-    class RelayManager;
+namespace net_command {
+    class CommandServer;
+}
+
+namespace power {
+    class PowerManager;
 }
 
 namespace command_interface {
 
+class ResponseWriter;
+struct CommandTable;
+
 class CommandInterpreter {
 public:
     explicit CommandInterpreter(std::shared_ptr<wifi_config::WiFiManager> wifi_manager);
@@ -34,76 +47,127 @@ public:
     // Set relay manager for relay commands
     void set_relay_manager(std::shared_ptr<relay_control::RelayManager> relay_manager);
     
+    // Set saved network store for wifi_save/wifi_profiles/wifi_forget
+    void set_credential_store(std::shared_ptr<wifi_config::CredentialStore> credential_store);
+    
+    // Set command macro store for macro/run
+    void set_macro_store(std::shared_ptr<MacroStore> macro_store);
+    
+    // Set relay scheduler for relay_schedule/relay_cancel
+    void set_relay_scheduler(std::shared_ptr<relay_control::RelayScheduler> relay_scheduler);
+    
+    // Set network command server for net_status
+    void set_command_server(std::shared_ptr<net_command::CommandServer> command_server);
+    
+    // Set power manager for the power command
+    void set_power_manager(std::shared_ptr<power::PowerManager> power_manager);
+    
     // Core functionality
     bool initialize();
     void start_interactive_mode();
-    void process_command(const std::string& command);
+    void process_command(std::string_view command);
     
-    // BLE interface - process command and return response
-    std::string process_command_with_response(const std::string& command);
+    // BLE interface - process a command line (streaming the response to sink as it is
+    // produced) or a write of binary frames (one reply frame per request)
+    void process_command_streaming(std::string_view command,
+                                   const std::function<bool(const char* data, size_t len)>& sink);
+    
+    // Parse and dispatch one command line (or a ';'/newline separated batch),
+    // writing output to the given writer
+    void execute(std::string_view line, ResponseWriter& out);
+    
+private:
+    friend struct CommandTable;
+    using Handler = void (CommandInterpreter::*)(const CommandArgs& args, ResponseWriter& out);
+    
+    // Run already-tokenized args; false if the command is unknown
+    bool dispatch(const CommandArgs& args, ResponseWriter& out);
+    void execute_command(std::string_view command, ResponseWriter& out);
+    // Run every command of a batch in order, echoing each one before its output
+    void run_batch(std::string_view batch, ResponseWriter& out);
+    void process_frames(std::string_view data, const std::function<bool(const char* data, size_t len)>& sink);
+    
+    // General command handlers
+    void handle_help(const CommandArgs& args, ResponseWriter& out);
+    void handle_macro(const CommandArgs& args, ResponseWriter& out);
+    void handle_run(const CommandArgs& args, ResponseWriter& out);
+    void handle_console(const CommandArgs& args, ResponseWriter& out);
+    void handle_perf(const CommandArgs& args, ResponseWriter& out);
+    void handle_boot_stats(const CommandArgs& args, ResponseWriter& out);
+    void handle_sys_stats(const CommandArgs& args, ResponseWriter& out);
+    void handle_log(const CommandArgs& args, ResponseWriter& out);
+    void handle_hosted_stats(const CommandArgs& args, ResponseWriter& out);
+    void handle_power(const CommandArgs& args, ResponseWriter& out);
+    void handle_events(const CommandArgs& args, ResponseWriter& out);
+    void handle_bench(const CommandArgs& args, ResponseWriter& out);
+    
+    // Benchmarks behind the bench command
+    void bench_notify(const CommandArgs& args, ResponseWriter& out);
+    void bench_echo(const CommandArgs& args, ResponseWriter& out);
+    void bench_dispatch(const CommandArgs& args, ResponseWriter& out);
+    void bench_command(const CommandArgs& args, ResponseWriter& out);
     
     // WiFi command handlers
-    void handle_help();
-    void handle_scan();
-    void handle_list();
-    void handle_connect(const std::vector<std::string>& args);
-    void handle_status();
-    void handle_disconnect();
+    void handle_scan(const CommandArgs& args, ResponseWriter& out);
+    void handle_scan_bg(const CommandArgs& args, ResponseWriter& out);
+    void handle_list(const CommandArgs& args, ResponseWriter& out);
+    void handle_connect(const CommandArgs& args, ResponseWriter& out);
+    void handle_status(const CommandArgs& args, ResponseWriter& out);
+    void handle_disconnect(const CommandArgs& args, ResponseWriter& out);
+    void handle_wifi_save(const CommandArgs& args, ResponseWriter& out);
+    void handle_wifi_profiles(const CommandArgs& args, ResponseWriter& out);
+    void handle_wifi_forget(const CommandArgs& args, ResponseWriter& out);
+    void handle_net_status(const CommandArgs& args, ResponseWriter& out);
     
     // BLE command handlers
-    void handle_ble_start();
-    void handle_ble_stop(); 
-    void handle_ble_status();
-    void handle_ble_name(const std::vector<std::string>& args);
-    void handle_ble_scan(const std::vector<std::string>& args);
-    void handle_ble_debug();
+    void handle_ble_start(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_stop(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_status(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_name(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_scan(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_debug(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_link(const CommandArgs& args, ResponseWriter& out);
+    void handle_ble_observe(const CommandArgs& args, ResponseWriter& out);
     
     // Relay command handlers
-    void handle_relay_on(const std::vector<std::string>& args);
-    void handle_relay_off(const std::vector<std::string>& args);
-    void handle_relay_toggle(const std::vector<std::string>& args);
-    void handle_relay_status();
-    void handle_relay_debug();
+    void handle_relay_on(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_off(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_toggle(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_pulse(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_set(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_schedule(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_cancel(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_status(const CommandArgs& args, ResponseWriter& out);
+    void handle_relay_debug(const CommandArgs& args, ResponseWriter& out);
     
-    void handle_unknown_command(const std::string& command);
+    void handle_unknown_command(std::string_view command, ResponseWriter& out);
     
-private:
-    void setup_usb_serial();
     void print_welcome_message();
     void print_prompt();
-    std::string read_command_line();
-    std::vector<std::string> parse_command(const std::string& command);
-    void print_network_list(const std::vector<wifi_config::NetworkInfo>& networks);
+    // Returns false if the scan snapshot changed while the list was being written
+    bool write_network_list(const wifi_config::ScanResults& results, ResponseWriter& out);
     const char* auth_mode_to_string(wifi_auth_mode_t auth_mode);
-    
-    // BLE response generation methods
-    std::string generate_help_response();
-    std::string generate_scan_response();
-    std::string generate_list_response();
-    std::string generate_connect_response(const std::vector<std::string>& args);
-    std::string generate_status_response();
-    std::string generate_disconnect_response();
-    std::string generate_ble_start_response();
-    std::string generate_ble_stop_response();
-    std::string generate_ble_status_response();
-    std::string generate_ble_name_response(const std::vector<std::string>& args);
-    std::string generate_ble_scan_response(const std::vector<std::string>& args);
-    std::string generate_ble_debug_response();
-    std::string generate_relay_on_response(const std::vector<std::string>& args);
-    std::string generate_relay_off_response(const std::vector<std::string>& args);
-    std::string generate_relay_toggle_response(const std::vector<std::string>& args);
-    std::string generate_relay_status_response();
-    std::string generate_relay_debug_response();
-    std::string format_network_list(const std::vector<wifi_config::NetworkInfo>& networks);
+    bool require_ble_manager(ResponseWriter& out);
+    bool require_relay_manager(ResponseWriter& out);
+    bool require_credential_store(ResponseWriter& out);
+    bool require_macro_store(ResponseWriter& out);
+    bool require_relay_scheduler(ResponseWriter& out);
+    bool parse_relay_arg(const CommandArgs& args, const char* command,
+                         uint32_t& relay_mask, ResponseWriter& out);
     
     // Member variables
     std::shared_ptr<wifi_config::WiFiManager> wifi_manager_;
     std::shared_ptr<ble_serial::BLEManager> ble_manager_;
     std::shared_ptr<relay_control::RelayManager> relay_manager_;
+    std::shared_ptr<wifi_config::CredentialStore> credential_store_;
+    std::shared_ptr<MacroStore> macro_store_;
+    std::shared_ptr<relay_control::RelayScheduler> relay_scheduler_;
+    std::shared_ptr<net_command::CommandServer> command_server_;
+    std::shared_ptr<power::PowerManager> power_manager_;
     bool initialized_;
     
-    // Constants
-    static const size_t CMD_BUFFER_SIZE = 256;
+    // USB Serial JTAG input; command tokens are views into its line buffer
+    SerialConsole console_;
 };
 
 } // namespace command_interface
\ No newline at end of file
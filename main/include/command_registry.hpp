@@ -0,0 +1,135 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "command_args.hpp"
+
+namespace command_interface {
+
+/**
+ * @brief One command accepted by the interpreter
+ *
+ * @tparam Handler Callable invoked when the command (or its alias) is entered
+ */
+template <typename Handler>
+struct CommandSpec {
+    std::string_view name;     // Full command name, e.g. "relay_on"
+    std::string_view alias;    // Short alias, e.g. "ron" (may be empty)
+    std::string_view args;     // Argument synopsis shown in help
+    std::string_view help;     // One-line description shown in help
+    std::string_view section;  // Help section the command is listed under
+    Handler handler;
+};
+
+namespace detail {
+
+// FNV-1a over the lowercased name, so lookups are case-insensitive
+constexpr uint32_t hash_command_name(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(ascii_tolower(c));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr size_t next_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Intentionally not constexpr: reaching it while building a registry at
+// compile time (duplicate name or alias) turns into a compile error.
+void duplicate_command_name();
+
+} // namespace detail
+
+/**
+ * @brief Compile-time hash table mapping command names and aliases to specs
+ *
+ * Built entirely at compile time from a command table. Lookups hash the
+ * (case-folded) token once and probe an open-addressing table that is kept
+ * at most 50% full, so dispatch cost does not grow with the command count.
+ *
+ * @tparam Handler Command handler type
+ * @tparam N Number of commands
+ */
+template <typename Handler, size_t N>
+class CommandRegistry {
+public:
+    static_assert(N < 255, "Command index must fit in a slot byte");
+    static constexpr size_t TABLE_SIZE = detail::next_power_of_two(4 * N);
+
+    constexpr explicit CommandRegistry(const std::array<CommandSpec<Handler>, N>& commands)
+        : commands_(commands), slots_{} {
+        for (size_t i = 0; i < N; ++i) {
+            insert(commands_[i].name, i);
+            if (!commands_[i].alias.empty()) {
+                insert(commands_[i].alias, i);
+            }
+        }
+    }
+
+    /**
+     * @brief Look up a command by name or alias (case-insensitive)
+     * @param name Command token as entered
+     * @return Matching command spec, or nullptr if unknown
+     */
+    constexpr const CommandSpec<Handler>* find(std::string_view name) const {
+        if (name.empty()) {
+            return nullptr;
+        }
+
+        size_t slot = detail::hash_command_name(name) & (TABLE_SIZE - 1);
+        for (size_t probe = 0; probe < TABLE_SIZE; ++probe) {
+            uint8_t entry = slots_[slot];
+            if (entry == 0) {
+                return nullptr;
+            }
+
+            const CommandSpec<Handler>& spec = commands_[entry - 1];
+            if (equals_ignore_case(spec.name, name) ||
+                (!spec.alias.empty() && equals_ignore_case(spec.alias, name))) {
+                return &spec;
+            }
+            slot = (slot + 1) & (TABLE_SIZE - 1);
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief All registered commands in table order (used for help output)
+     */
+    constexpr const std::array<CommandSpec<Handler>, N>& commands() const {
+        return commands_;
+    }
+
+private:
+    constexpr void insert(std::string_view key, size_t index) {
+        if (find(key) != nullptr) {
+            detail::duplicate_command_name();
+        }
+
+        size_t slot = detail::hash_command_name(key) & (TABLE_SIZE - 1);
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & (TABLE_SIZE - 1);
+        }
+        slots_[slot] = static_cast<uint8_t>(index + 1);
+    }
+
+    std::array<CommandSpec<Handler>, N> commands_;
+    std::array<uint8_t, TABLE_SIZE> slots_;
+};
+
+} // namespace command_interface
@@ -0,0 +1,136 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_event.h"
+#include "sdkconfig.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace net_command {
+
+/**
+ * @brief Command interpreter access over the LAN
+ *
+ * One task multiplexes a TCP listener, its clients and an optional UDP
+ * socket with select(), so an idle server costs no CPU and several clients
+ * are served without a task each.
+ *
+ * TCP is a line protocol: every line (or ';'-separated batch) runs as one
+ * command and its output is streamed back as it is produced, followed by a
+ * "> " prompt that marks the end of the response. A UDP datagram holds one
+ * command line; the reply is a single datagram, truncated to
+ * MAX_UDP_REPLY bytes, sent back to the sender. A datagram longer than
+ * MAX_LINE_LEN is not run and is answered with "Line too long".
+ *
+ * Sockets bind to every interface, so the server comes up with the station
+ * and survives reconnects without being restarted. There is no
+ * authentication: only enable it on trusted networks.
+ *
+ * TCP clients that send `events on` also get event bus events as text
+ * lines. The bus task hands them over on a loopback UDP socket that the
+ * server task selects on, so they go out between commands, never inside a
+ * response.
+ */
+class CommandServer {
+public:
+    // Returns false when the client can no longer accept data
+    using ResponseSink = std::function<bool(const char* data, size_t len)>;
+    using CommandHandler = std::function<void(std::string_view command, const ResponseSink& sink)>;
+
+    static constexpr size_t MAX_CLIENTS = CONFIG_NET_CMD_MAX_CLIENTS;
+    static constexpr size_t MAX_LINE_LEN = CONFIG_CONSOLE_MAX_LINE_LEN;
+    static constexpr size_t MAX_UDP_REPLY = 1024;
+
+    explicit CommandServer(CommandHandler handler);
+    ~CommandServer();
+
+    /**
+     * @brief Open the configured sockets and start the server task
+     * @return true if at least one socket is listening
+     */
+    bool start();
+
+    /**
+     * @brief Write ports, connected clients and counters
+     * @param out Destination for the report
+     */
+    void write_status(command_interface::ResponseWriter& out) const;
+
+    /**
+     * @brief Turn push events on or off for the TCP client whose command is running
+     * @param enable true to receive events
+     * @return false outside a TCP command
+     */
+    bool set_command_client_events(bool enable);
+
+    /**
+     * @brief Check whether the TCP client whose command is running receives push events
+     * @param enabled Receives the subscription state
+     * @return false outside a TCP command
+     */
+    bool get_command_client_events(bool& enabled) const;
+
+private:
+    struct Client {
+        int fd;                              // -1 = free slot
+        uint32_t address;                    // IPv4, network byte order
+        size_t len;
+        bool overflow;                       // Current line exceeded MAX_LINE_LEN; discard to newline
+        bool events;                         // Client sent 'events on'
+        char line[MAX_LINE_LEN + 1];
+    };
+
+    static void server_task(void* arg);
+    static int open_socket(int type, uint16_t port);
+    static void app_event_handler(void* arg, esp_event_base_t base, int32_t id, void* data);
+    bool open_event_sockets();
+    void forward_events();
+    void run();
+    void accept_client();
+    void read_client(Client& client);
+    void run_line(Client& client, std::string_view line, int64_t received_us);
+    void close_client(Client& client);
+    void handle_datagram();
+    static bool send_all(int fd, const char* data, size_t len);
+
+    CommandHandler handler_;
+    TaskHandle_t task_;
+    int tcp_fd_;
+    int udp_fd_;
+    int event_rx_fd_;                        // Loopback socket the server task selects on
+    int event_tx_fd_;                        // Bus task side
+    uint16_t event_port_;
+    Client* current_client_;                 // Client whose line is running (server task only)
+    std::array<Client, MAX_CLIENTS> clients_;
+    char rx_[256];                           // One recv() worth of client data
+    char datagram_[MAX_LINE_LEN + 1];
+    char udp_reply_[MAX_UDP_REPLY];
+
+    // Statistics
+    std::atomic<uint32_t> client_count_;
+    std::atomic<uint32_t> clients_accepted_;
+    std::atomic<uint32_t> clients_rejected_;
+    std::atomic<uint32_t> commands_;
+    std::atomic<uint32_t> datagrams_;
+    std::atomic<uint32_t> datagrams_oversize_;   // Rejected, longer than MAX_LINE_LEN
+    std::atomic<uint32_t> event_clients_;
+    std::atomic<uint32_t> events_pushed_;
+    std::atomic<uint32_t> events_dropped_;
+};
+
+} // namespace net_command
@@ -0,0 +1,110 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+namespace wifi_config {
+
+/**
+ * @brief One saved network, stored verbatim in NVS
+ *
+ * Addresses are esp_ip4_addr_t values (network byte order). A zero channel
+ * means the network has not been joined yet.
+ */
+struct WiFiProfile {
+    char ssid[33];
+    char password[65];
+    uint8_t bssid[6];      // BSS of the last successful association
+    uint8_t channel;       // Channel of the last successful association
+    uint8_t auth_mode;     // wifi_auth_mode_t of the last successful association
+    bool static_ip;        // Use ip/netmask/gateway/dns instead of DHCP
+    uint32_t ip;           // Static address, or last DHCP lease when static_ip is false
+    uint32_t netmask;
+    uint32_t gateway;
+    uint32_t dns;
+};
+
+/**
+ * @brief Ranked list of saved WiFi networks persisted in NVS
+ *
+ * Rank 0 is tried first on boot. The whole table is stored as a single blob
+ * so every update is one NVS write; link parameters are only rewritten when
+ * they actually change.
+ */
+class CredentialStore {
+public:
+    static constexpr size_t MAX_PROFILES = CONFIG_WIFI_MAX_PROFILES;
+
+    CredentialStore();
+    ~CredentialStore();
+
+    /**
+     * @brief Load saved profiles from NVS (nvs_flash must already be initialized)
+     * @return true if the store is usable (an empty or missing table is not an error)
+     */
+    bool initialize();
+
+    size_t count() const;
+
+    /**
+     * @brief Get a profile by rank
+     * @param rank 0-based rank
+     * @param profile Receives the profile
+     * @return true if the rank exists
+     */
+    bool get(size_t rank, WiFiProfile& profile) const;
+
+    /**
+     * @brief Look up a profile by SSID
+     * @param ssid Network name
+     * @param profile Receives the profile
+     * @return true if the network is saved
+     */
+    bool find(const std::string& ssid, WiFiProfile& profile) const;
+
+    /**
+     * @brief Save a network, replacing any profile with the same SSID
+     * @param profile Network to save
+     * @param rank Position in the boot order (values past the end append)
+     * @return true if the profile was persisted (on failure nothing changes)
+     */
+    bool save(const WiFiProfile& profile, size_t rank);
+
+    /**
+     * @brief Record where a saved network was joined, for the next fast connect
+     *
+     * Does nothing if the SSID is not saved or nothing changed.
+     * @return true if the profile exists
+     */
+    bool update_link(const std::string& ssid, const uint8_t bssid[6], uint8_t channel,
+                     uint8_t auth_mode, uint32_t lease_ip);
+
+    bool remove(size_t rank);
+    bool clear();
+
+private:
+    int index_of(const char* ssid) const;
+    void stage();
+    bool commit();
+    bool persist();
+
+    mutable SemaphoreHandle_t mutex_;
+    std::array<WiFiProfile, MAX_PROFILES> profiles_;
+    size_t count_;
+    std::array<WiFiProfile, MAX_PROFILES> previous_;   // Staged by stage(), kept off the task stacks
+    size_t previous_count_;
+    bool initialized_;
+};
+
+} // namespace wifi_config
@@ -0,0 +1,112 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_event.h"
+#include "sdkconfig.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace event_bus {
+
+/*
+ * State changes of the managers, published on an esp_event loop of their
+ * own (APP_EVENT base) so a slow subscriber never holds up the default loop
+ * that WiFi and IP events run on. Posting never blocks: when the loop's
+ * queue is full the event is dropped and counted.
+ *
+ * BLE and TCP clients that send `events on` receive every event as one
+ * compact text line (see format()), instead of polling the status commands.
+ */
+
+ESP_EVENT_DECLARE_BASE(APP_EVENT);
+
+enum class EventId : int32_t {
+    WIFI_UP,            // WifiUpEvent
+    WIFI_DOWN,          // WifiDownEvent
+    BLE_CONNECTED,      // BleConnectionEvent
+    BLE_DISCONNECTED,   // BleConnectionEvent
+    BLE_SCAN_DONE,      // BleScanDoneEvent
+    RELAY_CHANGED,      // RelayChangedEvent
+};
+
+constexpr size_t EVENT_COUNT = static_cast<size_t>(EventId::RELAY_CHANGED) + 1;
+
+// Longest line format() produces
+constexpr size_t MAX_LINE_LEN = 96;
+
+struct WifiUpEvent {
+    char ssid[33];
+    uint32_t ip;        // IPv4, network byte order
+};
+
+struct WifiDownEvent {
+    uint8_t reason;     // wifi_err_reason_t
+};
+
+struct BleConnectionEvent {
+    uint16_t conn_handle;
+    uint8_t reason;     // HCI reason, disconnects only
+    uint8_t sessions;   // Connected centrals after the change
+};
+
+struct BleScanDoneEvent {
+    uint16_t devices;
+};
+
+struct RelayChangedEvent {
+    uint32_t states;    // Bit per relay, 1 = on
+    uint32_t changed;   // Relays this write switched
+};
+
+/**
+ * @brief Create the event loop and its task; call before any manager initializes
+ * @return true on success
+ */
+bool init();
+
+/**
+ * @brief Publish an event without blocking
+ * @return false if the bus is not running or its queue is full
+ */
+bool post(EventId id, const void* data, size_t size);
+
+template <typename T>
+bool post(EventId id, const T& event) {
+    return post(id, &event, sizeof(event));
+}
+
+/**
+ * @brief Register a handler for every event on the bus
+ *
+ * Handlers run on the bus task, one event at a time, and must not block
+ * for long: another subscriber's events wait behind them.
+ * @return true on success
+ */
+bool subscribe(esp_event_handler_t handler, void* arg);
+
+/**
+ * @brief Format an event as a push notification line
+ * @param id Event id as passed to the handler
+ * @param data Event data as passed to the handler
+ * @param buffer Receives the line, newline terminated
+ * @param size Size of buffer (MAX_LINE_LEN is always enough)
+ * @return Length of the line, 0 for an unknown event
+ */
+size_t format(int32_t id, const void* data, char* buffer, size_t size);
+
+/**
+ * @brief Write per-event post and drop counts
+ * @param out Destination for the report
+ */
+void write_status(command_interface::ResponseWriter& out);
+
+} // namespace event_bus
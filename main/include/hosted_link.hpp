@@ -0,0 +1,99 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace hosted_link {
+
+/*
+ * The ESP-Hosted SDIO link to the ESP32-C6 carries WiFi (RPC and data) and
+ * BLE (HCI over VHCI). ESP-Hosted keeps no transport counters of its own, so
+ * hosted_stats measures the link from the P4 side:
+ *
+ * - traffic per interface: IP packets and drops (lwIP statistics) for WiFi,
+ *   NUS writes and notifications (nearly all ACL data) for HCI;
+ * - backpressure: sends the host had to hold back and retry;
+ * - round trips: a cheap WiFi RPC and a cheap HCI command, timed on demand,
+ *   which separate a slow link from a slow radio.
+ */
+
+enum class Interface : uint8_t {
+    WIFI,
+    HCI,
+};
+
+// Traffic on one interface since boot, as seen from the P4
+struct InterfaceCounters {
+    bool available;        // false when the interface is not up or not counted
+    bool bytes_known;      // lwIP statistics count packets only
+    bool retries_known;    // lwIP statistics do not count TCP retransmits
+    uint64_t tx_frames;
+    uint64_t tx_bytes;
+    uint64_t rx_frames;
+    uint64_t rx_bytes;
+    uint64_t drops;
+    uint64_t retries;      // Sends held back and retried for lack of buffers
+};
+
+// SDIO settings chosen by the HOSTED_LINK_PROFILE Kconfig choice; 0 keeps the component's value
+struct LinkConfig {
+    const char* profile;
+    uint32_t sdio_clock_khz;
+    uint32_t tx_queue_size;
+    uint32_t rx_queue_size;
+};
+
+const LinkConfig& link_config();
+
+/**
+ * @brief Hand the profile's SDIO settings to ESP-Hosted; call before esp_hosted_init()
+ * @return false if ESP-Hosted rejected them
+ */
+bool apply_link_config();
+
+/**
+ * @brief Priority for a task whose work goes out over one interface
+ *
+ * With HOSTED_PRIORITY_HCI or HOSTED_PRIORITY_WIFI the preferred interface's
+ * task runs one level above its configured priority.
+ *
+ * @param iface Interface the task feeds
+ * @param configured Priority from the task's own Kconfig option
+ */
+UBaseType_t task_priority(Interface iface, UBaseType_t configured);
+
+/**
+ * @brief WiFi data counters from lwIP (needs HOSTED_STATS_WIFI_DATA)
+ * @param counters Receives the counters; available is false without lwIP statistics
+ */
+void get_wifi_data_counters(InterfaceCounters& counters);
+
+void record_round_trip(Interface iface, int64_t round_trip_us);
+
+/**
+ * @brief Write the link settings, per-interface traffic and round trips
+ *
+ * Rates cover the time since the previous report.
+ *
+ * @param out Destination for the report
+ * @param wifi WiFi data counters
+ * @param hci HCI counters
+ */
+void write_report(command_interface::ResponseWriter& out, const InterfaceCounters& wifi,
+                  const InterfaceCounters& hci);
+
+// Clear the round-trip histograms
+void reset();
+
+} // namespace hosted_link
@@ -0,0 +1,89 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+namespace system_init {
+
+/**
+ * @brief Dependency-ordered bring-up of independent subsystems
+ *
+ * Each stage is a function that returns false on failure, a set of stages it
+ * depends on and a core. run() starts one task per stage; a stage waits for
+ * its dependencies and then runs alongside every other stage that is ready,
+ * so subsystems that each wait on the coprocessor overlap instead of adding
+ * up. A stage whose dependency failed is skipped, and so are its dependents.
+ *
+ * Every stage is recorded in the boot timeline (see boot_stats.hpp).
+ */
+class InitGraph {
+public:
+    using StageFn = std::function<bool()>;
+    using StageId = size_t;
+
+    static constexpr size_t MAX_STAGES = 16;          // Event group bits available to stages
+    static constexpr uint32_t DEFAULT_STACK_SIZE = 4096;
+
+    InitGraph();
+    ~InitGraph();
+
+    /**
+     * @brief Add a stage
+     * @param name Label for logs and the boot timeline (must outlive the boot)
+     * @param fn Stage body
+     * @param depends_on Mask of stage_bit() values that must succeed first
+     * @param core Core to pin the stage task to, or tskNO_AFFINITY
+     * @param stack_size Stage task stack in bytes
+     * @return Stage ID for stage_bit() and succeeded()
+     */
+    StageId add_stage(const char* name, StageFn fn, uint32_t depends_on = 0, BaseType_t core = tskNO_AFFINITY,
+                      uint32_t stack_size = DEFAULT_STACK_SIZE);
+
+    static constexpr uint32_t stage_bit(StageId id) { return 1u << id; }
+
+    /**
+     * @brief Run every stage and wait for all of them to finish
+     * @return true if every stage succeeded
+     */
+    bool run();
+
+    bool succeeded(StageId id) const;
+
+private:
+    struct Stage {
+        const char* name;
+        StageFn fn;
+        uint32_t depends_on;
+        BaseType_t core;
+        uint32_t stack_size;
+    };
+
+    struct StageTask {
+        InitGraph* graph;
+        StageId id;
+    };
+
+    static void stage_task(void* arg);
+    void run_stage(StageId id);
+    void finish_stage(StageId id, bool ok);
+
+    std::array<Stage, MAX_STAGES> stages_;
+    std::array<StageTask, MAX_STAGES> tasks_;
+    size_t stage_count_;
+    EventGroupHandle_t done_;         // One bit per finished stage (ok, failed or skipped)
+    std::atomic<uint32_t> failed_;    // Stages that failed or were skipped
+};
+
+} // namespace system_init
@@ -0,0 +1,139 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace logging {
+
+// Where ESP_LOG output goes
+enum class LogOutput : uint8_t {
+    CONSOLE,   // stdout only (USB Serial JTAG), as without this module
+    RING,      // In-RAM ring only; nothing is written to the console
+    BOTH,
+};
+
+/*
+ * Log routing. init() installs a vprintf hook in front of the console so that
+ * every log line can also (or only) be kept in an in-RAM ring of
+ * CONFIG_LOG_RING_BUFFER_SIZE bytes, which `log dump` prints on demand. Ring
+ * mode keeps diagnostics in production builds without a blocking console
+ * write per relay switch. Lines longer than LOG_RING_LINE_MAX are cut short
+ * in the ring (never on the console).
+ */
+
+static constexpr size_t LOG_RING_LINE_MAX = 128;
+
+/**
+ * @brief Allocate the ring and install the log hook; call first thing at boot
+ * @return true if the ring is available (always true with console output only)
+ */
+bool init();
+
+/**
+ * @brief Route log output
+ * @return false if a ring output was asked for but there is no ring
+ */
+bool set_output(LogOutput output);
+LogOutput output();
+const char* output_to_string(LogOutput output);
+
+/**
+ * @brief Accept "none", "error", "warn", "info", "debug" or "verbose"
+ */
+bool parse_level(std::string_view text, esp_log_level_t& level);
+const char* level_to_string(esp_log_level_t level);
+
+/**
+ * @brief Write the output mode, ring use and the level of every project tag
+ * @param out Destination for the report
+ */
+void write_status(command_interface::ResponseWriter& out);
+
+/**
+ * @brief Write the ring contents, oldest line first
+ *
+ * Lines logged while dumping are not included, and lines overwritten while
+ * dumping are skipped rather than shown torn.
+ *
+ * @param out Destination for the lines
+ */
+void dump_ring(command_interface::ResponseWriter& out);
+void clear_ring();
+
+/**
+ * @brief Lets one message through per period; counts the ones it holds back
+ *
+ * Lock-free, so it is safe from any task. Use through LOG_RATE_LIMITED.
+ */
+class RateLimiter {
+public:
+    /**
+     * @param period_ms Minimum time between messages
+     * @param suppressed Messages held back since the last one let through
+     * @return true if the caller should log now
+     */
+    bool allow(uint32_t period_ms, uint32_t& suppressed);
+
+private:
+    std::atomic<int64_t> next_us_{0};
+    std::atomic<uint32_t> suppressed_{0};
+};
+
+/**
+ * @brief Lets the first message and then every Nth one through
+ */
+class Sampler {
+public:
+    bool allow(uint32_t every, uint32_t& skipped);
+
+private:
+    std::atomic<uint32_t> count_{0};
+};
+
+} // namespace logging
+
+/*
+ * Per-call-site limited logging for per-command messages on hot paths. The
+ * level is checked first, so a disabled tag costs one level lookup and does
+ * not use up the call site's budget. A line that follows held-back ones says
+ * how many were dropped.
+ *
+ *   LOG_RATE_LIMITED(ESP_LOG_INFO, TAG, CONFIG_LOG_RATE_LIMIT_MS, "Relay %d on", n);
+ *   LOG_SAMPLED(ESP_LOG_DEBUG, TAG, 32, "Sent %zu bytes", len);
+ */
+
+#define LOG_LIMITED_IMPL(limiter, arg, level, tag, format, note, ...) do {                          \
+        if (LOG_LOCAL_LEVEL >= (level) && esp_log_level_get(tag) >= (level)) {                      \
+            static limiter log_limiter_;                                                             \
+            uint32_t log_dropped_ = 0;                                                               \
+            if (log_limiter_.allow((arg), log_dropped_)) {                                           \
+                if (log_dropped_ == 0) {                                                             \
+                    ESP_LOG_LEVEL_LOCAL(level, tag, format, ##__VA_ARGS__);                          \
+                } else {                                                                             \
+                    ESP_LOG_LEVEL_LOCAL(level, tag, format " (%" PRIu32 " " note ")", ##__VA_ARGS__, \
+                                        log_dropped_);                                               \
+                }                                                                                    \
+            }                                                                                        \
+        }                                                                                            \
+    } while (0)
+
+#define LOG_RATE_LIMITED(level, tag, period_ms, format, ...) \
+    LOG_LIMITED_IMPL(logging::RateLimiter, period_ms, level, tag, format, "more suppressed", ##__VA_ARGS__)
+
+#define LOG_SAMPLED(level, tag, every, format, ...) \
+    LOG_LIMITED_IMPL(logging::Sampler, every, level, tag, format, "skipped", ##__VA_ARGS__)
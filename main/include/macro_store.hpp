@@ -0,0 +1,100 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+namespace command_interface {
+
+/**
+ * @brief A named command batch, e.g. "relay_on 1; relay_off 2"
+ */
+struct Macro {
+    static constexpr size_t MAX_NAME_LEN = 15;
+    static constexpr size_t MAX_BODY_LEN = CONFIG_CMD_MACRO_MAX_LEN;
+
+    char name[MAX_NAME_LEN + 1];
+    char body[MAX_BODY_LEN + 1];   // Commands separated by ';' or newlines
+};
+
+// Outcome of a change to the macro table
+enum class MacroResult : uint8_t {
+    OK,
+    INVALID,       // Name empty or too long, or body too long
+    FULL,
+    NOT_FOUND,
+    NVS_FAILED,    // Not written; the table is unchanged
+};
+
+/**
+ * @brief Named command macros persisted in NVS
+ *
+ * The table is kept in RAM in its stored layout and written as one blob, so
+ * saving needs no staging buffer on the caller's stack. A change is made to
+ * the RAM table, written, and rolled back if the write fails, so RAM never
+ * holds macros that would be gone after a reboot.
+ */
+class MacroStore {
+public:
+    static constexpr size_t MAX_MACROS = CONFIG_CMD_MAX_MACROS;
+
+    MacroStore();
+    ~MacroStore();
+
+    /**
+     * @brief Load saved macros from NVS (nvs_flash must already be initialized)
+     * @return true if the store is usable (a missing table is not an error)
+     */
+    bool initialize();
+
+    size_t count() const;
+
+    /**
+     * @brief Get a macro by position (for listing)
+     * @return true if the index exists
+     */
+    bool get(size_t index, Macro& macro) const;
+
+    /**
+     * @brief Look up a macro by name (case-sensitive)
+     * @return true if the macro exists
+     */
+    bool find(std::string_view name, Macro& macro) const;
+
+    /**
+     * @brief Save a macro, replacing any macro with the same name
+     */
+    MacroResult save(std::string_view name, std::string_view body);
+
+    MacroResult remove(std::string_view name);
+
+private:
+    // Bump when Macro changes layout; older tables are discarded
+    static constexpr uint16_t TABLE_VERSION = 1;
+
+    struct StoredTable {
+        uint16_t version;
+        uint16_t count;
+        std::array<Macro, MAX_MACROS> macros;
+    };
+
+    static size_t stored_size(size_t count);
+    int index_of(std::string_view name) const;
+    bool persist();
+
+    mutable SemaphoreHandle_t mutex_;
+    StoredTable table_;
+    bool initialized_;
+};
+
+} // namespace command_interface
@@ -0,0 +1,83 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace telemetry {
+
+/**
+ * @brief Latency histogram with power-of-two microsecond buckets
+ *
+ * Bucket 0 holds samples under 1 us and bucket i holds [2^(i-1), 2^i) us;
+ * the last bucket is open-ended. Recording is a few instructions under a
+ * spinlock, so it is safe from any task.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 24;   // Last bucket starts at ~4.2 s
+
+    void record(int64_t latency_us);
+    void reset();
+
+    /**
+     * @brief Write one summary line and the non-empty buckets
+     * @param out Destination for the report
+     * @param name Label for the summary line
+     */
+    void write(command_interface::ResponseWriter& out, const char* name) const;
+
+private:
+    // Upper bound of the bucket holding the given fraction of samples
+    static int64_t percentile_us(const std::array<uint32_t, BUCKETS>& buckets, uint32_t count, uint32_t per_mille);
+
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+    std::array<uint32_t, BUCKETS> buckets_{};
+    uint32_t count_ = 0;
+    uint64_t total_us_ = 0;
+    int64_t max_us_ = 0;
+};
+
+// Where a traced command came from
+enum class Source : uint8_t {
+    CONSOLE,
+    BLE,
+    NETWORK,
+};
+
+/*
+ * Command path tracing. A transport calls begin_command() with the time the
+ * command arrived and end_command() once the response is handed off; in
+ * between, the interpreter and RelayManager mark their stages. The trace is
+ * per task, so the console and the BLE worker never mix up their stages, and
+ * relay writes outside a command (timers, scheduler) are not counted.
+ */
+
+void begin_command(Source source, int64_t received_us);
+void mark_dispatch();
+// Returns true for the first edge of a traced command
+bool mark_gpio_edge(int64_t edge_us);
+void end_command();
+
+// Arrival time of the command the calling task is running, or 0 outside a trace
+int64_t command_received_us();
+
+/**
+ * @brief Write the histograms of every source and stage
+ * @param out Destination for the report
+ */
+void write_report(command_interface::ResponseWriter& out);
+void reset();
+
+} // namespace telemetry
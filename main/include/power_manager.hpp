@@ -0,0 +1,151 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "freertos/FreeRTOS.h"
+#include "perf_stats.hpp"
+#include "sdkconfig.h"
+
+#if CONFIG_POWER_ESP_PM
+#include "esp_pm.h"
+#endif
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace wifi_config {
+    class WiFiManager;
+}
+
+namespace ble_serial {
+    class BLEManager;
+}
+
+namespace power {
+
+enum class PowerMode : uint8_t {
+    PERFORMANCE,   // Both chips fully awake, fast advertising (the behaviour before power modes)
+    IDLE,          // Auto light sleep, WiFi modem sleep, slow advertising once nobody has connected
+};
+
+/**
+ * @brief Power modes for battery-backed relay nodes
+ *
+ * IDLE mode lets the P4 scale its clock down and enter light sleep between
+ * events (esp_pm), puts the C6's WiFi into WIFI_PS_MIN_MODEM and moves BLE
+ * advertising to slow intervals after a fast period.
+ *
+ * The mode promises that a relay command switches its relay within
+ * CONFIG_POWER_MAX_ACTUATION_LATENCY_US of the P4 waking for it (air time on
+ * the BLE or WiFi link is not included). The coprocessor's SDIO interrupt
+ * line (CONFIG_POWER_WAKEUP_GPIO) wakes the P4 from light sleep, and the time
+ * of that wake is where the measurement starts; a command that arrives while
+ * the P4 is awake is measured from its arrival. Every command holds the CPU
+ * at full speed and out of light sleep while it runs, and the first relay
+ * edge of each command is checked against the bound. If a command misses it,
+ * light sleep is turned off until IDLE mode is selected again, leaving
+ * frequency scaling and the radio power save in place.
+ *
+ * Sleep residency (time in light sleep, per-core idle share) is reported as
+ * a proxy for idle current.
+ */
+class PowerManager {
+public:
+    PowerManager(std::shared_ptr<wifi_config::WiFiManager> wifi_manager,
+                 std::shared_ptr<ble_serial::BLEManager> ble_manager);
+    ~PowerManager();
+
+    /**
+     * @brief Create the PM locks and enter the boot mode (CONFIG_POWER_BOOT_MODE_IDLE)
+     * @return true on success
+     */
+    bool initialize();
+
+    /**
+     * @brief Switch mode; entering IDLE again re-arms light sleep after a latency miss
+     * @return true if the CPU settings were applied (radio settings are best effort)
+     */
+    bool set_mode(PowerMode mode);
+    PowerMode get_mode() const;
+
+    static const char* mode_to_string(PowerMode mode);
+    static bool parse_mode(std::string_view text, PowerMode& mode);
+
+    /**
+     * @brief Write the mode, the actuation latency bound and sleep residency
+     * @param out Destination for the report
+     */
+    void write_status(command_interface::ResponseWriter& out) const;
+
+    // Restart the residency window and clear the latency samples
+    void reset_stats();
+
+    /**
+     * @brief Check a command's first relay edge against the latency bound
+     *
+     * Called by RelayManager; does nothing outside IDLE mode or a command.
+     * @param edge_us Time of the relay edge
+     * @param received_us Time the command reached the P4
+     */
+    static void note_actuation(int64_t edge_us, int64_t received_us);
+
+    /**
+     * @brief Keeps the CPU at full speed and out of light sleep while a command runs
+     */
+    class ActivityLock {
+    public:
+        ActivityLock();
+        ~ActivityLock();
+
+        ActivityLock(const ActivityLock&) = delete;
+        ActivityLock& operator=(const ActivityLock&) = delete;
+    };
+
+private:
+    bool apply_cpu_settings(PowerMode mode, bool light_sleep);
+    bool configure_wakeup();
+    void apply_radio_settings(PowerMode mode);
+    void handle_latency_miss(int64_t latency_us);
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    static esp_err_t light_sleep_exit(int64_t sleep_time_us, void* arg);
+#endif
+
+    static PowerManager* instance_;
+
+    std::shared_ptr<wifi_config::WiFiManager> wifi_manager_;
+    std::shared_ptr<ble_serial::BLEManager> ble_manager_;
+
+    std::atomic<PowerMode> mode_;
+    std::atomic<bool> light_sleep_active_;
+    std::atomic<bool> latency_tripped_;     // Light sleep turned off after a missed bound
+
+#if CONFIG_POWER_ESP_PM
+    esp_pm_lock_handle_t cpu_lock_;
+    esp_pm_lock_handle_t sleep_lock_;
+#endif
+
+    telemetry::LatencyHistogram actuation_latency_;
+
+    // Latency misses and residency window; the sleep callback updates them
+    // with interrupts off, so they sit behind a spinlock rather than 64-bit atomics
+    mutable portMUX_TYPE stats_lock_;
+    uint32_t latency_misses_;
+    int64_t worst_miss_us_;
+    int64_t window_start_us_;
+    uint64_t idle_start_[portNUM_PROCESSORS];   // Idle task run time at the window start
+    uint64_t sleep_us_;
+    uint32_t sleep_count_;
+    int64_t gpio_wake_us_;   // Last light sleep exit, if the wakeup GPIO ended it; 0 otherwise
+};
+
+} // namespace power
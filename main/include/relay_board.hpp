@@ -0,0 +1,181 @@
+#pragma once
+
+// NOTE: ESP-IDF Embedded Development Constraints
+// - No exception handling (-fno-exceptions)
+// - No RTTI (-fno-rtti)
+// - Use error codes and boolean returns instead of exceptions
+// - Memory management through ESP-IDF heap functions
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "driver/gpio.h"
+#include "sdkconfig.h"
+
+namespace relay_control {
+
+/**
+ * @brief Compile-time description of a relay board
+ *
+ * Relay i + 1 drives gpios[i] and is bit i of every relay mask. Relays in
+ * the same interlock group (e.g. the two directions of a motor) may never
+ * be on at the same time.
+ *
+ * @tparam RelayCount Number of relay channels (at most 32, one mask bit each)
+ * @tparam GroupCount Number of interlock groups
+ */
+template <size_t RelayCount, size_t GroupCount>
+struct BoardDescriptor {
+    static_assert(RelayCount >= 1 && RelayCount <= 32, "A relay board needs 1 to 32 channels");
+
+    static constexpr size_t RELAY_COUNT = RelayCount;
+    static constexpr uint32_t ALL_RELAYS_MASK = RelayCount == 32 ? UINT32_MAX : (1u << RelayCount) - 1;
+
+    std::string_view name;
+    std::array<gpio_num_t, RelayCount> gpios;
+    bool active_low;                                  // Relay energized by driving its pin low
+    std::array<uint32_t, GroupCount> interlock_groups;   // Relay masks
+
+    /**
+     * @brief Interlock groups that would have more than one relay on
+     * @return Union of the offending groups, 0 if the outputs are allowed
+     */
+    constexpr uint32_t interlock_conflicts(uint32_t outputs) const {
+        uint32_t conflicts = 0;
+        for (uint32_t group : interlock_groups) {
+            if (std::popcount(outputs & group) > 1) {
+                conflicts |= group;
+            }
+        }
+        return conflicts;
+    }
+
+    // Pin levels for logical relay states
+    constexpr uint32_t to_levels(uint32_t values, uint32_t mask) const {
+        return (active_low ? ~values : values) & mask;
+    }
+
+    constexpr bool valid() const {
+        for (size_t i = 0; i < RelayCount; i++) {
+            if (gpios[i] < 0) {
+                return false;
+            }
+            for (size_t j = i + 1; j < RelayCount; j++) {
+                if (gpios[i] == gpios[j]) {
+                    return false;
+                }
+            }
+        }
+        for (uint32_t group : interlock_groups) {
+            if (std::popcount(group) < 2 || (group & ~ALL_RELAYS_MASK) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+namespace detail {
+
+// Kconfig lists: items separated by `separator`, surrounding spaces ignored
+
+constexpr std::string_view trim_spaces(std::string_view text) {
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && text.back() == ' ') {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+constexpr size_t count_items(std::string_view list, char separator) {
+    if (trim_spaces(list).empty()) {
+        return 0;
+    }
+    size_t count = 1;
+    for (char c : list) {
+        count += c == separator;
+    }
+    return count;
+}
+
+constexpr std::string_view item_at(std::string_view list, char separator, size_t index) {
+    for (size_t i = 0; i < index; i++) {
+        list.remove_prefix(list.find(separator) + 1);
+    }
+    return trim_spaces(list.substr(0, list.find(separator)));
+}
+
+// Decimal number, or -1 if malformed
+constexpr int parse_number(std::string_view text) {
+    if (text.empty() || text.size() > 4) {
+        return -1;
+    }
+    int value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return -1;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+template <size_t RelayCount>
+constexpr std::array<gpio_num_t, RelayCount> parse_gpios(std::string_view list) {
+    std::array<gpio_num_t, RelayCount> gpios{};
+    for (size_t i = 0; i < RelayCount; i++) {
+        int pin = parse_number(item_at(list, ',', i));
+        gpios[i] = pin >= 0 && pin < GPIO_NUM_MAX ? static_cast<gpio_num_t>(pin) : GPIO_NUM_NC;
+    }
+    return gpios;
+}
+
+// Groups separated by ';', relay numbers (1-based) within a group by ','
+template <size_t GroupCount>
+constexpr std::array<uint32_t, GroupCount> parse_interlock_groups(std::string_view list) {
+    std::array<uint32_t, GroupCount> groups{};
+    for (size_t g = 0; g < GroupCount; g++) {
+        std::string_view group = item_at(list, ';', g);
+        for (size_t i = 0; i < count_items(group, ','); i++) {
+            int relay = parse_number(item_at(group, ',', i));
+            if (relay < 1 || relay > 32) {
+                // An emptied group fails valid()
+                groups[g] = 0;
+                break;
+            }
+            groups[g] |= 1u << (relay - 1);
+        }
+    }
+    return groups;
+}
+
+} // namespace detail
+
+/**
+ * @brief The board this firmware is built for, from the Kconfig "Relay Control" menu
+ */
+inline constexpr auto RELAY_BOARD = [] {
+    constexpr std::string_view gpios = CONFIG_RELAY_GPIOS;
+    constexpr std::string_view groups = CONFIG_RELAY_INTERLOCK_GROUPS;
+    constexpr size_t relay_count = detail::count_items(gpios, ',');
+    constexpr size_t group_count = detail::count_items(groups, ';');
+
+    BoardDescriptor<relay_count, group_count> board{};
+    board.name = CONFIG_RELAY_BOARD_NAME;
+    board.gpios = detail::parse_gpios<relay_count>(gpios);
+#if CONFIG_RELAY_ACTIVE_LOW
+    board.active_low = true;
+#endif
+    board.interlock_groups = detail::parse_interlock_groups<group_count>(groups);
+    return board;
+}();
+
+static_assert(RELAY_BOARD.valid(),
+              "CONFIG_RELAY_GPIOS needs distinct pin numbers and CONFIG_RELAY_INTERLOCK_GROUPS "
+              "groups of at least two relay numbers from that list");
+
+} // namespace relay_control
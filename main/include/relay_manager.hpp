@@ -6,84 +6,99 @@
 // - Use error codes and boolean returns instead of exceptions
 // - Memory management through ESP-IDF heap functions
 
-#include <string>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "driver/gpio.h"
+#include "driver/dedic_gpio.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "relay_board.hpp"
+
+namespace command_interface {
+    class ResponseWriter;
+}
 
 namespace relay_control {
 
 /**
- * @brief Relay Manager class for ESP32-P4 dual relay board control
+ * @brief Relay Manager for the relay board described by RELAY_BOARD
  * 
- * Controls two relays connected to GPIO pins:
- * - Relay 1: GPIO32
- * - Relay 2: GPIO46
+ * Pins, active level and interlock groups come from the Kconfig board
+ * description (relay_board.hpp), so 2-, 8- and 16-channel boards share one
+ * build. Relays are addressed by mask (bit i = relay i + 1) throughout.
  * 
- * Supports individual and simultaneous relay control with safety features.
+ * When the outputs fit in one dedicated-GPIO bundle, any combination of
+ * relays changes with a single CPU write (no skew between channels); larger
+ * boards fall back to per-pin writes inside one critical section. Timed
+ * pulses end from one esp_timer, so pulses that end together also switch
+ * together. Writes that would turn on two relays of an interlock group are
+ * refused as a whole.
  */
 class RelayManager {
 public:
-    // GPIO pin definitions for relay board variant
-    static constexpr gpio_num_t RELAY_1_GPIO = GPIO_NUM_32;
-    static constexpr gpio_num_t RELAY_2_GPIO = GPIO_NUM_46;
-    
-    // Relay identifiers
-    enum class RelayId {
-        RELAY_1 = 1,
-        RELAY_2 = 2,
-        ALL_RELAYS = 0
-    };
+    static constexpr size_t RELAY_COUNT = RELAY_BOARD.RELAY_COUNT;
     
-    // Relay states
-    enum class RelayState {
-        OFF = 0,
-        ON = 1
-    };
+    // Bit i of a relay mask is relay i + 1
+    static constexpr uint32_t ALL_RELAYS_MASK = RELAY_BOARD.ALL_RELAYS_MASK;
 
     RelayManager();
     ~RelayManager();
 
     /**
      * @brief Initialize GPIO pins for relay control
+     *
+     * Drives every relay OFF. Needs neither NVS nor the coprocessor, so it
+     * runs first at boot.
      * @return true if initialization successful
      */
     bool initialize();
 
     /**
-     * @brief Set state of a specific relay
-     * @param relay_id Which relay to control (RELAY_1, RELAY_2, or ALL_RELAYS)
-     * @param state Desired state (ON or OFF)
-     * @return true if operation successful
+     * @brief Restore lifetime switch counts from NVS and start saving them
+     *
+     * Call once NVS is initialized. Switches made since initialize() are
+     * added to the restored counts.
+     * @return true if the wear counter task is running
      */
-    bool set_relay_state(RelayId relay_id, RelayState state);
+    bool start_wear_tracking();
 
     /**
-     * @brief Get current state of a specific relay
-     * @param relay_id Which relay to query (RELAY_1 or RELAY_2)
-     * @return Current relay state
+     * @brief Set several relays at the same instant
+     *
+     * Cancels any pending pulse end on the relays in mask.
+     * @param mask Relays to change (bit i = relay i + 1)
+     * @param values New states for the relays in mask (1 = ON)
+     * @return true if the outputs were written (false on an interlock conflict)
      */
-    RelayState get_relay_state(RelayId relay_id) const;
+    bool set_relays(uint32_t mask, uint32_t values);
 
     /**
-     * @brief Turn on a specific relay
-     * @param relay_id Which relay to turn on (RELAY_1, RELAY_2, or ALL_RELAYS)
-     * @return true if operation successful
+     * @brief Turn relays on now and off again after a fixed time
+     *
+     * A relay already pulsing gets the new end time.
+     * @param mask Relays to pulse
+     * @param duration_us Pulse width
+     * @return true if the pulse started
      */
-    bool turn_on(RelayId relay_id);
+    bool pulse(uint32_t mask, uint64_t duration_us);
 
     /**
-     * @brief Turn off a specific relay
-     * @param relay_id Which relay to turn off (RELAY_1, RELAY_2, or ALL_RELAYS)
-     * @return true if operation successful
+     * @brief Current output states as a relay mask
      */
-    bool turn_off(RelayId relay_id);
+    uint32_t get_relays() const;
+
+    bool turn_on(uint32_t mask);
+    bool turn_off(uint32_t mask);
 
     /**
-     * @brief Toggle state of a specific relay
-     * @param relay_id Which relay to toggle (RELAY_1, RELAY_2, or ALL_RELAYS)
-     * @return true if operation successful
+     * @brief Flip each relay in mask to the opposite of its own state
      */
-    bool toggle(RelayId relay_id);
+    bool toggle(uint32_t mask);
 
     /**
      * @brief Turn off all relays (safety function)
@@ -92,16 +107,22 @@ public:
     bool turn_off_all();
 
     /**
-     * @brief Get status of both relays
-     * @return Formatted status string
+     * @brief Write status of every relay
+     * @param out Destination for the report
      */
-    std::string get_status() const;
+    void write_status(command_interface::ResponseWriter& out) const;
 
     /**
-     * @brief Get detailed debug information
-     * @return Debug status string
+     * @brief Write detailed debug information
+     * @param out Destination for the report
      */
-    std::string get_debug_status() const;
+    void write_debug_status(command_interface::ResponseWriter& out) const;
+
+    /**
+     * @brief Write lifetime switch counts (persisted in NVS) per relay
+     * @param out Destination for the report
+     */
+    void write_wear_status(command_interface::ResponseWriter& out) const;
 
     /**
      * @brief Check if relay manager is initialized
@@ -110,58 +131,76 @@ public:
     bool is_initialized() const;
 
 private:
-    /**
-     * @brief Configure GPIO pin for relay control
-     * @param gpio_pin GPIO pin number to configure
-     * @return true if configuration successful
-     */
-    bool configure_gpio_pin(gpio_num_t gpio_pin);
+    // Dedicated GPIO channels are per CPU; boards with more relays use plain GPIO writes
+    static constexpr bool USE_BUNDLE = RELAY_COUNT <= SOC_DEDIC_GPIO_OUT_CHANNELS_NUM;
 
     /**
-     * @brief Set GPIO pin state
-     * @param gpio_pin GPIO pin to control
-     * @param state Desired state (0=OFF, 1=ON)
-     * @return true if operation successful
+     * @brief Write outputs, hopping to the core that owns the bundle if needed
+     * @param pulse_us Non-zero to start a pulse of the relays in mask: they
+     *                 are switched off again this long after the write
+     * @param ended Non-null to end pulses instead: only relays in mask whose
+     *              pulse is due are switched off, and they are stored here
      */
-    bool set_gpio_state(gpio_num_t gpio_pin, int state);
+    bool write_outputs(uint32_t mask, uint32_t values, uint64_t pulse_us = 0, uint32_t* ended = nullptr);
 
     /**
-     * @brief Get GPIO pin state
-     * @param gpio_pin GPIO pin to read
-     * @return Current pin state (0 or 1)
+     * @brief Write outputs and update state; must run on bundle_core_
+     * @param pulse_us See write_outputs()
+     * @param ended See write_outputs()
+     * @param edge_us Set to the time of the write
+     * @param outputs Set to the relay states after the write
+     * @param changed Set to the relays the write switched
+     * @return false if the result would break an interlock (nothing written)
      */
-    int get_gpio_state(gpio_num_t gpio_pin) const;
+    bool apply_outputs(uint32_t mask, uint32_t values, uint64_t pulse_us, uint32_t* ended, int64_t& edge_us,
+                       uint32_t& outputs, uint32_t& changed);
 
-    /**
-     * @brief Convert RelayId to GPIO pin number
-     * @param relay_id Relay identifier
-     * @return Corresponding GPIO pin number
-     */
-    gpio_num_t relay_id_to_gpio(RelayId relay_id) const;
+    static void apply_outputs_on_core(void* arg);
+    static void pulse_timer_callback(void* arg);
+    void rearm_pulse_timer();
 
     /**
-     * @brief Convert RelayId to string
-     * @param relay_id Relay identifier
-     * @return String representation
+     * @brief Configure GPIO pin for relay control, driven to its OFF level
+     * @param gpio_pin GPIO pin number to configure
+     * @return true if configuration successful
      */
-    const char* relay_id_to_string(RelayId relay_id) const;
+    bool configure_gpio_pin(gpio_num_t gpio_pin);
 
-    /**
-     * @brief Convert RelayState to string
-     * @param state Relay state
-     * @return String representation
-     */
-    const char* relay_state_to_string(RelayState state) const;
+    // Lifetime switch counts: loaded at init, written back at most once per
+    // CONFIG_RELAY_WEAR_FLUSH_INTERVAL_S by a low-priority task
+    static void wear_task(void* arg);
+    void load_wear();
+    bool save_wear();
+
+    // Bump when WearTable changes layout; older tables are discarded
+    static constexpr uint16_t WEAR_TABLE_VERSION = 1;
+
+    struct WearTable {
+        uint16_t version;
+        uint16_t count;
+        std::array<uint32_t, RELAY_COUNT> switches;
+    };
 
     // Member variables
     bool initialized_;
-    RelayState relay_1_state_;
-    RelayState relay_2_state_;
+    dedic_gpio_bundle_handle_t bundle_;
+    BaseType_t bundle_core_;           // Dedicated GPIO is per-CPU; writes must run here
+    esp_timer_handle_t pulse_timer_;
+    SemaphoreHandle_t pulse_mutex_;    // Serializes re-arming pulse_timer_
+    mutable portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;  // Guards the fields below
+    uint32_t outputs_;                 // Current relay mask
+    uint32_t pulsing_;                 // Relays with a pending pulse end
+    std::array<int64_t, RELAY_COUNT> pulse_end_us_;  // Valid for relays in pulsing_
     
     // Statistics
-    uint32_t relay_1_switch_count_;
-    uint32_t relay_2_switch_count_;
+    std::array<uint32_t, RELAY_COUNT> switch_count_;
     uint32_t total_operations_;
+    uint32_t pulse_count_;
+    uint32_t interlock_rejects_;
+    std::array<uint32_t, RELAY_COUNT> lifetime_switches_;   // Includes switch_count_
+    bool wear_dirty_;                  // lifetime_switches_ changed since the last save
+    uint32_t wear_saves_;
+    TaskHandle_t wear_task_;
 };
 
 } // namespace relay_control
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+// NOTE: ESP-IDF Embedded Development Constraints
+// - No exception handling (-fno-exceptions)
+// - No RTTI (-fno-rtti)
+// - Use error codes and boolean returns instead of exceptions
+// - Memory management through ESP-IDF heap functions
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "relay_manager.hpp"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace relay_control {
+
+/**
+ * @brief One scheduled relay operation, stored verbatim in NVS
+ *
+ * The first trigger is either relative (delay_ms after scheduling) or a
+ * wall-clock time (wall_time, needs the system clock to be set, e.g. by
+ * SNTP). Periodic actions then repeat every period_ms from that first
+ * trigger without accumulating drift.
+ */
+struct RelayAction {
+    uint16_t id;           // Assigned by the scheduler
+    uint32_t mask;         // Relays affected (bit i = relay i + 1)
+    uint32_t values;       // New states when pulse_us is 0
+    uint32_t pulse_us;     // Non-zero: pulse the relays in mask for this long instead
+    uint32_t period_ms;    // 0 = one-shot
+    uint32_t delay_ms;     // Relative first trigger (wall_time == 0)
+    int64_t wall_time;     // Epoch seconds of the first trigger, 0 = relative
+};
+
+/**
+ * @brief On-device relay scheduler
+ *
+ * Pending actions sit in a fixed-capacity min-heap ordered by due time. A
+ * one-shot esp_timer fires at the earliest due time (microsecond
+ * resolution, unlike the 10 ms scheduler tick) and wakes a dedicated
+ * high-priority task that switches the relays, so the switching instant
+ * no longer depends on the client or the radio link.
+ *
+ * Action definitions are persisted in NVS by a low-priority task, so the
+ * scheduler task never waits on a flash write. After a reboot periodic actions
+ * resume (relative ones one period after boot, wall-clock ones on their
+ * next slot once the clock is set); relative one-shots from the previous
+ * boot are dropped and late wall-clock one-shots are skipped rather than
+ * fired long after their time.
+ */
+class RelayScheduler {
+public:
+    static constexpr size_t MAX_ACTIONS = CONFIG_RELAY_SCHEDULE_MAX_ACTIONS;
+
+    explicit RelayScheduler(std::shared_ptr<RelayManager> relays);
+    ~RelayScheduler();
+
+    /**
+     * @brief Load saved actions and start the scheduler task
+     * @return true if the scheduler is running
+     */
+    bool initialize();
+
+    /**
+     * @brief Schedule an action (its id field is ignored)
+     * @return Assigned id, or 0 if the table is full or the action is invalid
+     */
+    uint16_t add(const RelayAction& action);
+
+    bool cancel(uint16_t id);
+
+    /**
+     * @brief Cancel every action
+     * @return false if the scheduler is not running
+     */
+    bool cancel_all();
+
+    /**
+     * @brief Write pending actions and counters
+     * @param out Destination for the report
+     */
+    void write_status(command_interface::ResponseWriter& out) const;
+
+private:
+    struct Entry {
+        RelayAction action;
+        int64_t due_us;    // esp_timer time of the next run; INT64_MAX while waiting for the clock
+    };
+
+    // Bump when RelayAction changes layout; older tables are discarded
+    static constexpr uint16_t TABLE_VERSION = 1;
+
+    struct StoredTable {
+        uint16_t version;
+        uint16_t count;
+        std::array<RelayAction, MAX_ACTIONS> actions;
+    };
+
+    static void scheduler_task(void* arg);
+    static void flush_task(void* arg);
+    static void timer_callback(void* arg);
+    static bool clock_valid();
+    static bool later(const Entry& a, const Entry& b);
+
+    // Callers hold mutex_
+    bool first_due(const RelayAction& action, int64_t now_us, bool at_boot, int64_t& due_us) const;
+    bool resolve_wall_clock(int64_t now_us);
+    void run_due(int64_t now_us);
+    void execute(const RelayAction& action);
+    void arm_timer(int64_t now_us);
+    void remove_at(size_t index);
+    void mark_dirty();
+    void load();
+
+    // Writes the table to NVS if it changed; takes mutex_ only to copy it
+    bool flush();
+
+    std::shared_ptr<RelayManager> relays_;
+    mutable SemaphoreHandle_t mutex_;
+    mutable SemaphoreHandle_t status_mutex_; // Guards status_entries_
+    TaskHandle_t task_;
+    TaskHandle_t flush_task_;               // Low priority, owns the NVS writes
+    esp_timer_handle_t timer_;
+    std::array<Entry, MAX_ACTIONS> heap_;   // heap_[0] is due first
+    size_t count_;
+    uint16_t next_id_;
+    bool dirty_;                            // Table changed since the last NVS write
+    StoredTable stored_;                    // Staging for flush(), kept off the task stacks
+    mutable std::array<Entry, MAX_ACTIONS> status_entries_;  // Staging for write_status()
+    bool initialized_;
+
+    // Statistics
+    uint32_t runs_;
+    uint32_t skipped_;
+    int64_t max_lateness_us_;
+};
+
+} // namespace relay_control
@@ -0,0 +1,115 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace command_interface {
+
+/**
+ * @brief Destination for command output
+ *
+ * Command handlers and status reports write their replies through this
+ * interface, so one handler serves every transport. Output is streamed to the
+ * transport as it is produced rather than assembled into one string first.
+ */
+class ResponseWriter {
+public:
+    virtual ~ResponseWriter() = default;
+
+    /**
+     * @brief Append raw bytes to the response
+     * @param data Bytes to append
+     * @param len Number of bytes
+     */
+    virtual void write(const char* data, size_t len) = 0;
+
+    /**
+     * @brief Append text to the response
+     * @param text Text to append
+     */
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    /**
+     * @brief Append printf-style formatted text to the response
+     * @param format printf format string
+     */
+    void printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+/**
+ * @brief Response writer that prints straight to the USB Serial JTAG console
+ */
+class SerialResponseWriter : public ResponseWriter {
+public:
+    using ResponseWriter::write;
+    void write(const char* data, size_t len) override;
+};
+
+/**
+ * @brief Response writer that streams through a fixed-size buffer
+ *
+ * Output is staged in an internal buffer and handed to the sink whenever the
+ * buffer fills, so peak memory is bounded by BUFFER_SIZE regardless of the
+ * report length and the client starts receiving before the report is done.
+ * If the sink fails (e.g. the BLE client disconnected) the rest of the
+ * response is discarded.
+ */
+class BufferedResponseWriter : public ResponseWriter {
+public:
+    // Sink returns false when the transport can no longer accept data
+    using Sink = std::function<bool(const char* data, size_t len)>;
+
+    static constexpr size_t BUFFER_SIZE = 512;
+
+    explicit BufferedResponseWriter(Sink sink);
+    ~BufferedResponseWriter() override;
+
+    using ResponseWriter::write;
+    void write(const char* data, size_t len) override;
+
+    /**
+     * @brief Hand any buffered output to the sink
+     * @return true if all output so far was accepted by the sink
+     */
+    bool flush();
+
+    /**
+     * @brief Total bytes accepted by the sink (excluding buffered data)
+     */
+    size_t bytes_sent() const { return bytes_sent_; }
+
+private:
+    Sink sink_;
+    char buffer_[BUFFER_SIZE];
+    size_t used_;
+    size_t bytes_sent_;
+    bool failed_;
+};
+
+/**
+ * @brief Response writer that accumulates the reply in a string
+ */
+class StringResponseWriter : public ResponseWriter {
+public:
+    using ResponseWriter::write;
+    void write(const char* data, size_t len) override;
+
+    /**
+     * @brief Get the accumulated response
+     * @return Response text
+     */
+    std::string& str() { return buffer_; }
+
+private:
+    std::string buffer_;
+};
+
+} // namespace command_interface
@@ -0,0 +1,127 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "freertos/FreeRTOS.h"
+
+namespace wifi_config {
+
+/**
+ * @brief Versioned snapshot of a trivially copyable value (seqlock)
+ *
+ * Writers publish a complete new value; readers copy it out without taking a
+ * lock or allocating and retry if a write overlapped their copy. Each write
+ * runs inside a short critical section, which also serializes writers and
+ * guarantees a reader never spins behind a preempted writer on its own core.
+ * The payload is kept in relaxed atomic words, so an overlapping read is a
+ * detected retry rather than undefined behaviour.
+ */
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock payload must be trivially copyable");
+
+public:
+    Seqlock() : sequence_(0), words_{} {}
+
+    /**
+     * @brief Publish a new value
+     * @return Version of the published value (starts at 1, then increments)
+     */
+    uint32_t store(const T& value) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+
+        taskENTER_CRITICAL(&lock_);
+        uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);  // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            uint32_t word = 0;
+            memcpy(&word, bytes + i * sizeof(word), std::min(sizeof(word), sizeof(T) - i * sizeof(word)));
+            words_[i].store(word, std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+        taskEXIT_CRITICAL(&lock_);
+
+        return (sequence + 2) / 2;
+    }
+
+    /**
+     * @brief Copy out the current value
+     * @param value Receives a consistent copy
+     * @return Version of the copy (0 if nothing was stored yet; value is then all zero)
+     */
+    uint32_t load(T& value) const {
+        return load_bytes(0, &value, sizeof(T));
+    }
+
+    T load() const {
+        T value;
+        load(value);
+        return value;
+    }
+
+    /**
+     * @brief Copy out part of the current value (e.g. one element of a table)
+     *
+     * Two partial reads returning the same version come from the same value.
+     * @param offset Byte offset into T (use offsetof)
+     * @param dst Destination buffer
+     * @param size Number of bytes to copy
+     * @return Version the bytes belong to
+     */
+    uint32_t load_bytes(size_t offset, void* dst, size_t size) const {
+        unsigned char* out = static_cast<unsigned char*>(dst);
+        if (offset >= sizeof(T)) {
+            return version();
+        }
+        size = std::min(size, sizeof(T) - offset);
+
+        while (true) {
+            uint32_t before = sequence_.load(std::memory_order_acquire);
+            if (before & 1) {
+                // Writer is mid-copy on the other core; it finishes within microseconds
+                continue;
+            }
+
+            size_t copied = 0;
+            while (copied < size) {
+                size_t position = offset + copied;
+                size_t index = position / sizeof(uint32_t);
+                size_t skip = position % sizeof(uint32_t);
+                size_t chunk = std::min(sizeof(uint32_t) - skip, size - copied);
+                uint32_t word = words_[index].load(std::memory_order_relaxed);
+                memcpy(out + copied, reinterpret_cast<const unsigned char*>(&word) + skip, chunk);
+                copied += chunk;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) {
+                return before / 2;
+            }
+        }
+    }
+
+    uint32_t version() const {
+        return sequence_.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr size_t WORD_COUNT = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence_;
+    std::array<std::atomic<uint32_t>, WORD_COUNT> words_;
+    portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+} // namespace wifi_config
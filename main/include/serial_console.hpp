@@ -0,0 +1,73 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstddef>
+#include <string_view>
+#include "sdkconfig.h"
+
+namespace command_interface {
+
+/**
+ * @brief Line input for the USB Serial JTAG console
+ *
+ * Reads straight from the interrupt-driven USB Serial JTAG driver in bulk:
+ * the console task blocks in the driver until bytes arrive, then edits the
+ * line for the whole chunk at once and echoes it in a single write, so a
+ * pasted script costs one read per chunk rather than one per character.
+ * Bytes after the end of a line stay buffered for the next line.
+ *
+ * Output still goes through stdout so it stays in order with ESP_LOG.
+ */
+class SerialConsole {
+public:
+    static constexpr size_t MAX_LINE_LEN = CONFIG_CONSOLE_MAX_LINE_LEN;
+
+    SerialConsole();
+
+    /**
+     * @brief Install the USB Serial JTAG driver and route stdout through it
+     * @return true if the driver is ready
+     */
+    bool initialize();
+
+    /**
+     * @brief Block until a complete line arrives
+     * @return The line without its terminator; valid until the next call
+     */
+    std::string_view read_line();
+
+    /**
+     * @brief Echo input back and show prompts (off = raw mode for machine clients)
+     */
+    void set_echo(bool echo);
+    bool echo() const;
+
+private:
+    // Bytes taken from the driver per read
+    static constexpr size_t READ_CHUNK_SIZE = 128;
+
+    // Consume buffered input up to the end of a line; true if a line is complete
+    bool assemble_line();
+    void flush_echo();
+
+    char chunk_[READ_CHUNK_SIZE];
+    size_t chunk_len_;
+    size_t chunk_pos_;
+
+    char line_[MAX_LINE_LEN + 1];
+    size_t line_len_;
+
+    // Echo for one chunk; backspace needs 3 bytes per input byte at most
+    char echo_[READ_CHUNK_SIZE * 3];
+    size_t echo_len_;
+
+    bool echo_enabled_;
+    bool skip_lf_;   // Previous line ended with CR; a following LF belongs to it
+};
+
+} // namespace command_interface
@@ -0,0 +1,86 @@
+#pragma once
+
+// NOTE: This is an embedded project using ESP-IDF framework
+// - Exception handling is disabled (-fno-exceptions)
+// - RTTI is disabled (-fno-rtti)
+// - Use manual error checking instead of try/catch blocks
+// - Prefer C-style error codes or boolean returns for error handling
+
+#include <cstdint>
+#include <string_view>
+#include "sdkconfig.h"
+
+namespace command_interface {
+    class ResponseWriter;
+}
+
+namespace telemetry {
+
+/*
+ * Resource use for the sys_stats command: heap per capability, per-task stack
+ * high-water marks and CPU time, and (with CONFIG_CMD_ALLOC_STATS) how many
+ * allocations each command makes and leaves behind.
+ */
+
+/**
+ * @brief Write free, minimum free and largest block for internal RAM and PSRAM
+ * @param out Destination for the report
+ */
+void write_heap_report(command_interface::ResponseWriter& out);
+
+/**
+ * @brief Write every task's stack high-water mark and CPU share
+ *
+ * CPU shares cover the time since the previous task report (since boot for
+ * the first one), so the 32-bit run-time counter may wrap at most once in
+ * between: about 71 minutes with the default 1 MHz counter.
+ *
+ * @param out Destination for the report
+ */
+void write_task_report(command_interface::ResponseWriter& out);
+
+/**
+ * @brief Write the per-command allocation counts
+ * @param out Destination for the report
+ */
+void write_alloc_report(command_interface::ResponseWriter& out);
+void reset_alloc_stats();
+
+#if CONFIG_CMD_ALLOC_STATS
+
+/**
+ * @brief Counts the calling task's heap allocations while a command runs
+ *
+ * Scopes nest: a command run by another (run, bench cmd) is counted on its
+ * own and in the command that ran it. Allocations from other tasks and from
+ * ISRs are never counted.
+ */
+class AllocScope {
+public:
+    explicit AllocScope(std::string_view command);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+    struct Counts {
+        uint32_t allocs;
+        uint32_t frees;
+        uint64_t bytes;   // Requested, so allocator overhead is not included
+    };
+
+private:
+    std::string_view command_;
+    Counts outer_;
+};
+
+#else
+
+class AllocScope {
+public:
+    explicit AllocScope(std::string_view) {}
+};
+
+#endif
+
+} // namespace telemetry
@@ -1,45 +1,191 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <functional>
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_wifi_remote.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "credential_store.hpp"
+#include "seqlock.hpp"
 
 namespace wifi_config {
 
+// Fixed-size so scan results can be published as a lock-free snapshot
 struct NetworkInfo {
-    std::string ssid;
+    char ssid[33];
     int8_t rssi;
     wifi_auth_mode_t auth_mode;
+    uint8_t bssid[6];
+    uint8_t channel;
     
-    NetworkInfo(const std::string& ssid, int8_t rssi, wifi_auth_mode_t auth_mode)
-        : ssid(ssid), rssi(rssi), auth_mode(auth_mode) {}
+    NetworkInfo() = default;
+    NetworkInfo(std::string_view ssid, int8_t rssi, wifi_auth_mode_t auth_mode,
+                const uint8_t* bssid = nullptr, uint8_t channel = 0)
+        : ssid{}, rssi(rssi), auth_mode(auth_mode), bssid{}, channel(channel) {
+        memcpy(this->ssid, ssid.data(), std::min(ssid.size(), sizeof(this->ssid) - 1));
+        if (bssid) {
+            memcpy(this->bssid, bssid, sizeof(this->bssid));
+        }
+    }
+};
+
+// Summary of the most recent completed scan; entries are read with get_scanned_network()
+struct ScanResults {
+    size_t count;          // Networks in the scan, sorted by RSSI, strongest first
+    int64_t timestamp_us;  // esp_timer time of completion, 0 if never scanned
+    uint32_t version;      // Changes whenever a new result set is published
+    bool in_progress;      // A newer scan is currently running
+};
+
+// Connection state as seen by readers; published by the event handler and connect paths
+struct LinkStatus {
+    bool connected;
+    char ssid[33];
 };
 
 class WiFiManager {
 public:
+    // Invoked from the event loop task when a scan finishes
+    using ScanCallback = std::function<void(bool success, size_t network_count)>;
+
+    // Station link state driven by connect requests, driver events and the reconnect timer
+    enum class LinkState : uint8_t {
+        IDLE,          // Not connected and not trying (never connected, or user disconnect)
+        CONNECTING,    // Explicit connect_to_network() attempt in progress
+        CONNECTED,     // Associated with an IP address
+        RECONNECTING,  // Link lost; retrying with backoff and failing over between saved networks
+        STOPPED        // Gave up (credentials rejected and no other saved network)
+    };
+
+    struct ReconnectStats {
+        LinkState state;
+        uint32_t disconnects;         // Established links that dropped
+        uint32_t reconnect_attempts;  // Background reconnect attempts started
+        uint32_t reconnects;          // Background reconnects that succeeded
+        uint32_t failovers;           // Switches to another saved network
+        uint8_t last_reason;          // wifi_err_reason_t of the last disconnect
+        uint32_t backoff_ms;          // Delay before the pending reconnect attempt
+    };
+
     WiFiManager();
     ~WiFiManager();
     
-    // Core initialization
+    // Core initialization; NVS and ESP-Hosted must already be initialized
     bool initialize();
     
+    // Saved networks used for auto-connect and updated after each successful connect
+    void set_credential_store(std::shared_ptr<CredentialStore> store);
+    
+    /**
+     * @brief Join the best saved network from a background task
+     *
+     * Saved networks are tried in rank order; returns immediately.
+     * @return true if the auto-connect task was started
+     */
+    bool start_auto_connect();
+    bool is_auto_connecting() const;
+    
     // WiFi operations
-    bool scan_networks();
+    /**
+     * @brief Start a scan without waiting for it to finish
+     *
+     * Results replace the cached set atomically when the scan completes;
+     * until then readers keep seeing the previous scan.
+     * @param on_done Optional callback run when the scan completes
+     * @return true if the scan was started
+     */
+    bool start_scan(ScanCallback on_done = nullptr);
+    
+    /**
+     * @brief Start a scan for one SSID, optionally restricted to one channel
+     *
+     * Matching results are merged into the cached set; other cached networks
+     * are kept.
+     * @param ssid Network name to probe for
+     * @param channel Channel to scan (0 = all channels)
+     * @param on_done Optional callback run when the scan completes
+     * @return true if the scan was started
+     */
+    bool start_targeted_scan(const std::string& ssid, uint8_t channel, ScanCallback on_done = nullptr);
+    bool is_scanning() const;
+    
+    /**
+     * @brief Scan periodically in the background
+     * @param interval_s Seconds between scan starts
+     * @param dwell_ms Maximum active dwell time per channel (0 = Kconfig default)
+     * @return true if the periodic scan was started
+     */
+    bool start_background_scan(uint32_t interval_s, uint32_t dwell_ms = 0);
+    void stop_background_scan();
+    bool is_background_scan_active() const;
+    uint32_t get_background_scan_interval() const;
+    
     bool connect_to_network(const std::string& ssid, const std::string& password);
     bool disconnect();
     
-    // Network information
-    const std::vector<NetworkInfo>& get_scanned_networks() const;
+    // Network information (safe from any task; never blocks or allocates unless noted)
+    ScanResults get_scan_results() const;
+    
+    /**
+     * @brief Copy one network from the current scan snapshot
+     * @param index Position in the RSSI-sorted list
+     * @param network Receives the entry
+     * @param version Optional; receives the snapshot version the entry came from
+     * @return true if the index exists in the current snapshot
+     */
+    bool get_scanned_network(size_t index, NetworkInfo& network, uint32_t* version = nullptr) const;
+    LinkStatus get_link_status() const;
     bool is_connected() const;
-    std::string get_connected_ssid() const;
+    std::string get_connected_ssid() const;  // Allocates; prefer get_link_status()
+    bool get_current_credentials(std::string& ssid, std::string& password) const;
     std::string get_ip_address() const;
     int8_t get_rssi() const;
     
+    // Reconnect state machine
+    LinkState get_link_state() const;
+    ReconnectStats get_reconnect_stats() const;
+    static const char* link_state_to_string(LinkState state);
+    
+    // Duration of the last successful connect and whether the cached BSSID/channel was used
+    uint32_t get_last_connect_time_ms() const;
+    bool was_last_connect_fast() const;
+    
+    /**
+     * @brief Time one WiFi RPC round trip to the ESP32-C6 (esp_wifi_get_mode)
+     * @param round_trip_us Receives the round trip
+     * @return true if the coprocessor answered
+     */
+    bool probe_rpc(int64_t& round_trip_us) const;
+
+    /**
+     * @brief Switch the station between no power save and WIFI_PS_MIN_MODEM
+     *
+     * Min modem sleep wakes for every DTIM beacon, so the AP delays traffic
+     * to the station by at most one DTIM period.
+     * @param enable true for modem sleep
+     * @return true if the coprocessor accepted it
+     */
+    bool set_power_save(bool enable);
+
+    /**
+     * @brief Read the power save mode the coprocessor is running
+     * @param type Receives the mode
+     * @return true if the coprocessor answered
+     */
+    bool get_power_save(wifi_ps_type_t& type) const;
+
     // Static callback for ESP-IDF event system
     static void event_handler(void* arg, esp_event_base_t event_base, 
                              int32_t event_id, void* event_data);
@@ -47,24 +193,95 @@ public:
 private:
     void setup_wifi_stack();
     void register_event_handlers();
+    bool begin_scan(const std::string& ssid, uint8_t channel, uint32_t dwell_max_ms, ScanCallback on_done);
+    void handle_scan_done(bool success);
+    static void background_scan_timer_callback(void* arg);
     const char* auth_mode_to_string(wifi_auth_mode_t auth_mode) const;
     
+    // Where a network was last seen, used for a directed single-channel connect
+    struct ApHint {
+        uint8_t bssid[6];
+        uint8_t channel;
+        wifi_auth_mode_t auth_mode;
+    };
+    bool find_ap_hint(const std::string& ssid, ApHint& hint) const;
+    bool attempt_connect(const std::string& ssid, const std::string& password,
+                         const ApHint* hint, TickType_t timeout);
+    bool connect_locked(const std::string& ssid, const std::string& password);
+    esp_err_t configure_station(const std::string& ssid, const std::string& password, const ApHint* hint);
+    void handle_disconnected(uint8_t reason);
+    void handle_link_up();
+    bool select_failover_profile();
+    void begin_recovery();
+    void schedule_reconnect(uint32_t delay_ms);
+    static uint32_t backoff_delay_ms(uint32_t attempt);
+    static bool is_auth_failure(uint8_t reason);
+    static void reconnect_timer_callback(void* arg);
+    void apply_ip_config(const WiFiProfile* profile);
+    static void auto_connect_task(void* arg);
+    void publish_link(bool connected, const std::string& ssid);
+    // Start SNTP and apply the timezone on the first link up (wall-clock relay schedules)
+    void start_time_sync();
+    
+    static constexpr size_t MAX_NETWORKS = 20;
+    
+    // Published scan result set
+    struct ScanTable {
+        size_t count;
+        int64_t timestamp_us;
+        std::array<NetworkInfo, MAX_NETWORKS> networks;
+    };
+    
     // Member variables
-    std::vector<NetworkInfo> scanned_networks_;
+    Seqlock<ScanTable> scan_table_;  // Read by any task, written only by the event task
+    ScanTable scan_staging_;         // Event task's working copy of the last published table
+    SemaphoreHandle_t scan_mutex_;  // Guards scan callback/filter, last_ap_ and reconnect target
+    ScanCallback scan_callback_;
+    std::string scan_filter_ssid_;  // Non-empty while a targeted scan runs
+    std::atomic<bool> scanning_;
+    int64_t scan_started_us_;
+    
+    // Background scanning
+    esp_timer_handle_t background_scan_timer_;
+    uint32_t background_interval_s_;
+    uint32_t background_dwell_ms_;
+    
     EventGroupHandle_t wifi_event_group_;
     bool initialized_;
-    bool connected_;
-    std::string connected_ssid_;
-    int retry_count_;
+    Seqlock<LinkStatus> link_status_;
+    
+    // Reconnect state machine (event handler decides, reconnect timer acts)
+    std::atomic<LinkState> link_state_;
+    esp_timer_handle_t reconnect_timer_;
+    std::string reconnect_ssid_;
+    std::string reconnect_password_;
+    size_t failover_rank_;            // Rank of the saved network being retried
+    uint32_t attempt_retries_;        // Retries within the current explicit connect attempt
+    uint32_t backoff_attempt_;        // Consecutive failed reconnects to the current network
+    std::atomic<bool> reconfigure_pending_;
+    std::atomic<uint32_t> backoff_ms_;
+    std::atomic<uint32_t> disconnects_;
+    std::atomic<uint32_t> reconnect_attempts_;
+    std::atomic<uint32_t> reconnects_;
+    std::atomic<uint32_t> failovers_;
+    uint8_t last_disconnect_reason_;
+    
+    // Last successfully associated AP, for fast reconnects
+    std::string last_ap_ssid_;
+    ApHint last_ap_;
+    uint32_t last_connect_time_ms_;
+    bool last_connect_fast_;
+    
+    // Saved networks and auto-connect
+    std::shared_ptr<CredentialStore> credentials_;
+    SemaphoreHandle_t connect_mutex_;  // Serializes connect attempts (console, BLE, auto-connect)
+    std::atomic<bool> auto_connecting_;
+    bool static_ip_active_;
+    bool time_sync_started_;
     
     // Event bits
     static const int WIFI_CONNECTED_BIT = BIT0;
     static const int WIFI_FAIL_BIT = BIT1;
-    static const int WIFI_SCAN_DONE_BIT = BIT2;
-    
-    // Constants
-    static const int MAX_RETRY_COUNT = 5;
-    static const int MAX_NETWORKS = 20;
 };
 
 } // namespace wifi_config
\ No newline at end of file
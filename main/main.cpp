@@ -1,75 +1,220 @@
 #include <memory>
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_hosted.h"
+#include "nvs_flash.h"
 #include "wifi_manager.hpp"
+#include "credential_store.hpp"
+#include "macro_store.hpp"
 #include "command_interpreter.hpp"
 #include "ble_manager.hpp"
 #include "relay_manager.hpp"
+#include "relay_scheduler.hpp"
+#include "command_server.hpp"
+#include "init_graph.hpp"
+#include "boot_stats.hpp"
+#include "log_control.hpp"
+#include "hosted_link.hpp"
+#include "power_manager.hpp"
+#include "event_bus.hpp"
 
 static const char* TAG = "main";
 
+// Shared by WiFi, BLE bonds and every store
+static bool init_nvs()
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+// SDIO link to the ESP32-C6, which carries both WiFi and BLE
+static bool init_hosted()
+{
+    if (!hosted_link::apply_link_config()) {
+        ESP_LOGW(TAG, "SDIO link profile rejected, using the ESP-Hosted defaults");
+    }
+    esp_err_t ret = esp_hosted_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize ESP-Hosted: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
 extern "C" void app_main(void)
 {
+    // Before the first log line, so the ring holds the whole boot
+    logging::init();
     ESP_LOGI(TAG, "Starting ESP32-P4 Foundational Firmware");
     
-    // Create WiFi manager
-    auto wifi_manager = std::make_shared<wifi_config::WiFiManager>();
-    if (!wifi_manager->initialize()) {
-        ESP_LOGE(TAG, "Failed to initialize WiFi Manager");
-        return;
-    }
-    
-    // Create BLE manager for wireless command access
-    auto ble_manager = std::make_shared<ble_serial::BLEManager>();
-    if (!ble_manager->initialize()) {
-        ESP_LOGE(TAG, "Failed to initialize BLE Manager");
-        ESP_LOGE(TAG, "BLE functionality will not be available");
-        return;
+    // Managers publish and subscribe from their initialize(), so the bus comes first
+    if (!event_bus::init()) {
+        ESP_LOGW(TAG, "Event bus unavailable, push events disabled");
     }
     
-    // Create relay manager for dual relay board variant (optional)
+    // Relays are forced OFF before anything that waits on flash or the coprocessor.
+    // This stays on the main task: the relay GPIO bundle belongs to the core that creates it
+    int64_t relays_start_us = esp_timer_get_time();
     auto relay_manager = std::make_shared<relay_control::RelayManager>();
     bool relay_available = relay_manager->initialize();
+    telemetry::record_boot_stage("relays", relays_start_us, esp_timer_get_time(), xPortGetCoreID(),
+                                 relay_available ? telemetry::BootStageResult::OK
+                                                 : telemetry::BootStageResult::FAILED);
     if (relay_available) {
         ESP_LOGI(TAG, "Relay Manager initialized successfully");
-        ESP_LOGI(TAG, "Dual relay board variant detected");
     } else {
         ESP_LOGI(TAG, "Relay Manager initialization failed or not available");
         ESP_LOGI(TAG, "Single board variant (no relay control)");
         relay_manager = nullptr; // Clear pointer for single board variant
     }
     
-    // Create command interpreter
+    auto wifi_manager = std::make_shared<wifi_config::WiFiManager>();
+    auto credential_store = std::make_shared<wifi_config::CredentialStore>();
+    auto macro_store = std::make_shared<command_interface::MacroStore>();
+    auto ble_manager = std::make_shared<ble_serial::BLEManager>();
+    std::shared_ptr<relay_control::RelayScheduler> relay_scheduler;
     auto command_interpreter = std::make_unique<command_interface::CommandInterpreter>(wifi_manager);
-    if (!command_interpreter->initialize()) {
+    
+    // Everything else comes up as its dependencies allow. WiFi and BLE each wait on
+    // ESP-Hosted round trips, so they run side by side on separate cores
+    using system_init::InitGraph;
+    InitGraph graph;
+    auto nvs = graph.add_stage("nvs", init_nvs);
+    auto hosted = graph.add_stage("hosted", init_hosted);
+    auto wifi = graph.add_stage("wifi", [&] { return wifi_manager->initialize(); },
+                                InitGraph::stage_bit(nvs) | InitGraph::stage_bit(hosted), 0);
+    auto ble = graph.add_stage("ble", [&] { return ble_manager->initialize(); },
+                               InitGraph::stage_bit(nvs) | InitGraph::stage_bit(hosted), 1);
+    auto credentials = graph.add_stage("credentials", [&] { return credential_store->initialize(); },
+                                       InitGraph::stage_bit(nvs));
+    auto macros = graph.add_stage("macros", [&] { return macro_store->initialize(); },
+                                  InitGraph::stage_bit(nvs));
+    graph.add_stage("wifi_profiles", [&] {
+        wifi_manager->set_credential_store(credential_store);
+#if CONFIG_WIFI_AUTO_CONNECT
+        // Join a saved network in the background while the rest of the system comes up
+        wifi_manager->start_auto_connect();
+#endif
+        return true;
+    }, InitGraph::stage_bit(wifi) | InitGraph::stage_bit(credentials));
+    auto console = graph.add_stage("console", [&] { return command_interpreter->initialize(); });
+    InitGraph::StageId schedule = InitGraph::MAX_STAGES;
+    if (relay_available) {
+        graph.add_stage("relay_wear", [&] { return relay_manager->start_wear_tracking(); },
+                        InitGraph::stage_bit(nvs));
+        // On-device timed relay actions, restored from NVS
+        schedule = graph.add_stage("relay_schedule", [&] {
+            relay_scheduler = std::make_shared<relay_control::RelayScheduler>(relay_manager);
+            return relay_scheduler->initialize();
+        }, InitGraph::stage_bit(nvs));
+    }
+    graph.run();
+    
+    if (!graph.succeeded(wifi)) {
+        ESP_LOGE(TAG, "Failed to initialize WiFi Manager");
+        return;
+    }
+    
+    if (!graph.succeeded(console)) {
         ESP_LOGE(TAG, "Failed to initialize Command Interpreter");
         return;
     }
     
+    if (!graph.succeeded(ble)) {
+        ESP_LOGE(TAG, "Failed to initialize BLE Manager");
+        ESP_LOGE(TAG, "BLE functionality will not be available");
+        ble_manager = nullptr;
+    }
+    
+    if (!graph.succeeded(credentials)) {
+        ESP_LOGW(TAG, "Saved networks unavailable");
+        credential_store = nullptr;
+    }
+    
+    if (!graph.succeeded(macros)) {
+        ESP_LOGW(TAG, "Command macros unavailable");
+        macro_store = nullptr;
+    }
+    
+    if (relay_scheduler && !graph.succeeded(schedule)) {
+        ESP_LOGW(TAG, "Relay scheduler unavailable");
+        relay_scheduler = nullptr;
+    }
+    
     // Connect BLE manager to command interpreter
-    command_interpreter->set_ble_manager(ble_manager);
+    if (ble_manager) {
+        command_interpreter->set_ble_manager(ble_manager);
+    }
+    
+    if (credential_store) {
+        command_interpreter->set_credential_store(credential_store);
+    }
+    
+    if (macro_store) {
+        command_interpreter->set_macro_store(macro_store);
+    }
     
     // Connect relay manager to command interpreter (if available)
     if (relay_available && relay_manager) {
         command_interpreter->set_relay_manager(relay_manager);
     }
     
+    if (relay_scheduler) {
+        command_interpreter->set_relay_scheduler(relay_scheduler);
+    }
+    
     // Connect BLE to command interpreter for wireless access
-    ble_manager->set_command_callback([&command_interpreter](const std::string& command) -> std::string {
-        return command_interpreter->process_command_with_response(command);
-    });
+    if (ble_manager) {
+        ble_manager->set_command_callback([&command_interpreter](std::string_view command,
+                                                                 const ble_serial::BLEManager::ResponseSink& sink) {
+            command_interpreter->process_command_streaming(command, sink);
+        });
+    }
+    
+#if CONFIG_NET_CMD_SERVER
+    // LAN access to the same commands; sockets bind to any address, so this
+    // starts now and serves once WiFi has an IP
+    auto command_server = std::make_shared<net_command::CommandServer>(
+        [&command_interpreter](std::string_view command, const net_command::CommandServer::ResponseSink& sink) {
+            command_interpreter->process_command_streaming(command, sink);
+        });
+    if (command_server->start()) {
+        command_interpreter->set_command_server(command_server);
+    }
+#endif
+    
+    // Power modes apply to the radios, so they start once both managers are settled
+    auto power_manager = std::make_shared<power::PowerManager>(wifi_manager, ble_manager);
+    if (power_manager->initialize()) {
+        command_interpreter->set_power_manager(power_manager);
+    } else {
+        ESP_LOGW(TAG, "Power modes unavailable");
+    }
     
     ESP_LOGI(TAG, "System initialized successfully");
     ESP_LOGI(TAG, "WiFi + BLE commands available via USB Serial JTAG");
     ESP_LOGI(TAG, "BLE commands: ble_start, ble_stop, ble_status, ble_name, ble_scan, ble_debug");
     if (relay_available) {
-        ESP_LOGI(TAG, "Relay commands: relay_on, relay_off, relay_toggle, relay_status, relay_debug");
-        ESP_LOGI(TAG, "Board variant: Dual Relay Board (GPIO32, GPIO46)");
+        ESP_LOGI(TAG, "Relay commands: relay_on, relay_off, relay_toggle, relay_pulse, relay_set, relay_schedule, relay_cancel, relay_status, relay_debug");
+        ESP_LOGI(TAG, "Board variant: %.*s (%u relays)",
+                 static_cast<int>(relay_control::RELAY_BOARD.name.size()), relay_control::RELAY_BOARD.name.data(),
+                 static_cast<unsigned>(relay_control::RelayManager::RELAY_COUNT));
     } else {
         ESP_LOGI(TAG, "Board variant: Single Board (no relay control)");
     }
     ESP_LOGI(TAG, "BLE implementation: ESP-Hosted NimBLE with Nordic UART Service");
     ESP_LOGI(TAG, "Architecture: ESP32-P4 (host) + ESP32-C6 (controller) via VHCI/SDIO");
     
+    telemetry::mark_boot_ready();
+    
     // Start interactive command mode (USB Serial JTAG)
     command_interpreter->start_interactive_mode();
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "ble_adv_parser.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace ble_serial {
+
+// Assigned numbers, Core Specification Supplement part A
+static constexpr uint8_t AD_FLAGS = 0x01;
+static constexpr uint8_t AD_UUID16_INCOMPLETE = 0x02;
+static constexpr uint8_t AD_UUID16_COMPLETE = 0x03;
+static constexpr uint8_t AD_UUID32_INCOMPLETE = 0x04;
+static constexpr uint8_t AD_UUID32_COMPLETE = 0x05;
+static constexpr uint8_t AD_UUID128_INCOMPLETE = 0x06;
+static constexpr uint8_t AD_UUID128_COMPLETE = 0x07;
+static constexpr uint8_t AD_NAME_SHORT = 0x08;
+static constexpr uint8_t AD_NAME_COMPLETE = 0x09;
+static constexpr uint8_t AD_TX_POWER = 0x0A;
+static constexpr uint8_t AD_APPEARANCE = 0x19;
+static constexpr uint8_t AD_MFG_DATA = 0xFF;
+
+static uint16_t read_le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool parse_adv_fields(const uint8_t* data, size_t len, AdvFields& fields) {
+    fields = AdvFields{};
+
+    size_t offset = 0;
+    while (offset < len) {
+        uint8_t record_len = data[offset];
+        if (record_len == 0) {
+            break;  // Zero padding after the last record
+        }
+        if (offset + 1 + record_len > len) {
+            return false;
+        }
+
+        uint8_t type = data[offset + 1];
+        const uint8_t* value = data + offset + 2;
+        size_t value_len = record_len - 1;
+        offset += 1 + record_len;
+
+        switch (type) {
+            case AD_FLAGS:
+                if (value_len >= 1) {
+                    fields.flags = value[0];
+                    fields.present |= AdvFields::HAS_FLAGS;
+                }
+                break;
+
+            case AD_UUID16_INCOMPLETE:
+            case AD_UUID16_COMPLETE:
+                for (size_t i = 0; i + 2 <= value_len; i += 2) {
+                    if (fields.uuid16_count == AdvFields::MAX_UUIDS16) {
+                        fields.present |= AdvFields::TRUNCATED;
+                        break;
+                    }
+                    fields.uuids16[fields.uuid16_count++] = read_le16(value + i);
+                }
+                break;
+
+            case AD_UUID32_INCOMPLETE:
+            case AD_UUID32_COMPLETE:
+                for (size_t i = 0; i + 4 <= value_len; i += 4) {
+                    if (fields.uuid32_count == AdvFields::MAX_UUIDS32) {
+                        fields.present |= AdvFields::TRUNCATED;
+                        break;
+                    }
+                    fields.uuids32[fields.uuid32_count++] = read_le32(value + i);
+                }
+                break;
+
+            case AD_UUID128_INCOMPLETE:
+            case AD_UUID128_COMPLETE:
+                for (size_t i = 0; i + 16 <= value_len; i += 16) {
+                    if (fields.uuid128_count == AdvFields::MAX_UUIDS128) {
+                        fields.present |= AdvFields::TRUNCATED;
+                        break;
+                    }
+                    memcpy(fields.uuids128[fields.uuid128_count++], value + i, 16);
+                }
+                break;
+
+            case AD_NAME_SHORT:
+            case AD_NAME_COMPLETE:
+                // A complete name wins over a shortened one, whatever the order
+                if (type == AD_NAME_COMPLETE || !fields.has(AdvFields::NAME_COMPLETE)) {
+                    fields.name_len = static_cast<uint8_t>(std::min(value_len, AdvFields::MAX_NAME_LEN));
+                    memcpy(fields.name, value, fields.name_len);
+                    fields.name[fields.name_len] = '\0';
+                    fields.present |= AdvFields::HAS_NAME;
+                    if (type == AD_NAME_COMPLETE) {
+                        fields.present |= AdvFields::NAME_COMPLETE;
+                    }
+                }
+                break;
+
+            case AD_TX_POWER:
+                if (value_len >= 1) {
+                    fields.tx_power = static_cast<int8_t>(value[0]);
+                    fields.present |= AdvFields::HAS_TX_POWER;
+                }
+                break;
+
+            case AD_APPEARANCE:
+                if (value_len >= 2) {
+                    fields.appearance = read_le16(value);
+                    fields.present |= AdvFields::HAS_APPEARANCE;
+                }
+                break;
+
+            case AD_MFG_DATA:
+                if (value_len >= 2) {
+                    size_t payload_len = value_len - 2;
+                    fields.company_id = read_le16(value);
+                    fields.mfg_data_len = static_cast<uint8_t>(std::min(payload_len, AdvFields::MAX_MFG_DATA));
+                    memcpy(fields.mfg_data, value + 2, fields.mfg_data_len);
+                    fields.present |= AdvFields::HAS_MFG_DATA;
+                    if (payload_len > AdvFields::MAX_MFG_DATA) {
+                        fields.present |= AdvFields::TRUNCATED;
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+} // namespace ble_serial
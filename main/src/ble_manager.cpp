@@ -5,9 +5,13 @@
  */
 
 #include "ble_manager.hpp"
+#include "response_writer.hpp"
+#include "command_frame.hpp"
+#include "perf_stats.hpp"
+#include "log_control.hpp"
+#include "command_args.hpp"
 #include "esp_log.h"
 #include "esp_err.h"
-#include "nvs_flash.h"
 
 // ESP-Hosted NimBLE headers
 #include "nimble/nimble_port.h"
@@ -23,6 +27,7 @@
 #include "host/ble_hs_mbuf.h"
 #include "os/os_mbuf.h"
 
+#include <cinttypes>
 #include <cstring>
 #include <algorithm>
 
@@ -30,6 +35,30 @@ namespace ble_serial {
 
 static const char* TAG = "BLEManager";
 
+#if CONFIG_BLE_LINK_POLICY_THROUGHPUT
+static constexpr BLEManager::LinkPolicy DEFAULT_LINK_POLICY = BLEManager::LinkPolicy::THROUGHPUT;
+#elif CONFIG_BLE_LINK_POLICY_LOW_POWER
+static constexpr BLEManager::LinkPolicy DEFAULT_LINK_POLICY = BLEManager::LinkPolicy::LOW_POWER;
+#else
+static constexpr BLEManager::LinkPolicy DEFAULT_LINK_POLICY = BLEManager::LinkPolicy::ADAPTIVE;
+#endif
+
+// Data Length Extension: maximum LL payload and the matching 1M PHY air time
+static constexpr uint16_t LINK_DLE_TX_OCTETS = 251;
+static constexpr uint16_t LINK_DLE_TX_TIME_US = 2120;
+
+// A partial command left waiting this long is dropped when the next write arrives
+static constexpr int64_t RX_FRAGMENT_TIMEOUT_US = 2000000;
+
+static const char* phy_to_string(uint8_t phy) {
+    switch (phy) {
+        case BLE_GAP_LE_PHY_1M: return "1M";
+        case BLE_GAP_LE_PHY_2M: return "2M";
+        case BLE_GAP_LE_PHY_CODED: return "Coded";
+        default: return "Unknown";
+    }
+}
+
 // Static instance for C callbacks
 BLEManager* BLEManager::instance_ = nullptr;
 
@@ -94,13 +123,9 @@ static int nus_access_cb(uint16_t conn_handle, uint16_t attr_handle,
     if (ble_uuid_cmp(uuid, &NUS_RX_CHAR_UUID.u) == 0) {
         // RX Characteristic - handle writes from client
         if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
-            uint16_t data_len = OS_MBUF_PKTLEN(ctxt->om);
-            if (data_len > 0 && data_len <= BLEManager::MAX_DATA_LEN) {
-                uint8_t data[BLEManager::MAX_DATA_LEN];
-                int rc = ble_hs_mbuf_to_flat(ctxt->om, data, sizeof(data), &data_len);
-                if (rc == 0) {
-                    BLEManager::instance_->process_received_data(data, data_len);
-                }
+            // Only queue the command here; execution happens on the command worker
+            if (!BLEManager::instance_->process_received_data(conn_handle, ctxt->om)) {
+                return BLE_ATT_ERR_INSUFFICIENT_RES;
             }
             return 0;
         }
@@ -116,17 +141,52 @@ static int nus_access_cb(uint16_t conn_handle, uint16_t attr_handle,
 }
 
 BLEManager::BLEManager()
-    : initialized_(false), advertising_(false), connected_(false), scanning_(false),
-      conn_handle_(BLE_HS_CONN_HANDLE_NONE), nus_service_handle_(0), 
-      nus_rx_char_handle_(0), nus_tx_char_handle_(0), device_name_("ESP32-P4-WiFi") {
+    : initialized_(false), advertising_(false), scanning_(false),
+      nus_service_handle_(0), nus_rx_char_handle_(0), nus_tx_char_handle_(0),
+      device_name_("ESP32-P4-WiFi"), session_count_(0), connections_accepted_(0),
+      rx_fragments_(0), rx_discarded_(0), tx_notifications_(0), tx_bytes_(0), tx_stalls_(0), tx_failures_(0),
+      rx_writes_(0), rx_bytes_(0),
+      link_policy_(DEFAULT_LINK_POLICY), link_idle_timer_(nullptr),
+      low_power_adv_(false), adv_slow_(false), adv_interval_callout_{},
+      command_queue_(nullptr), command_worker_handle_(nullptr),
+      command_conn_handle_(BLE_HS_CONN_HANDLE_NONE), commands_dropped_(0),
+      event_queue_(nullptr), worker_queues_(nullptr), event_clients_(0), events_pushed_(0), events_dropped_(0) {
+    for (Session& session : sessions_) {
+        session.tx_mutex = xSemaphoreCreateMutex();
+    }
     instance_ = this;
 }
 
 BLEManager::~BLEManager() {
     if (initialized_) {
+        ble_npl_callout_stop(&adv_interval_callout_);
+        ble_npl_callout_deinit(&adv_interval_callout_);
         nimble_port_stop();
         nimble_port_deinit();
     }
+    if (link_idle_timer_) {
+        esp_timer_stop(link_idle_timer_);
+        esp_timer_delete(link_idle_timer_);
+    }
+    if (command_worker_handle_) {
+        vTaskDelete(command_worker_handle_);
+    }
+    if (worker_queues_) {
+        xQueueRemoveFromSet(command_queue_, worker_queues_);
+        xQueueRemoveFromSet(event_queue_, worker_queues_);
+        vQueueDelete(worker_queues_);
+    }
+    if (command_queue_) {
+        vQueueDelete(command_queue_);
+    }
+    if (event_queue_) {
+        vQueueDelete(event_queue_);
+    }
+    for (Session& session : sessions_) {
+        if (session.tx_mutex) {
+            vSemaphoreDelete(session.tx_mutex);
+        }
+    }
     instance_ = nullptr;
 }
 
@@ -139,16 +199,8 @@ bool BLEManager::initialize() {
     ESP_LOGI(TAG, "Initializing ESP-Hosted NimBLE stack...");
     ESP_LOGI(TAG, "Architecture: ESP32-P4 (host) + ESP32-C6 (BLE controller) via SDIO");
 
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-
-    // Initialize NimBLE port
-    ret = nimble_port_init();
+    // NVS (bond storage) and the ESP-Hosted transport are brought up at boot
+    esp_err_t ret = nimble_port_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize NimBLE port: %s", esp_err_to_name(ret));
         return false;
@@ -183,7 +235,34 @@ bool BLEManager::initialize() {
     // TX characteristic handle will be discovered after sync callback
 
     // Clear scan results
-    scan_results_.clear();
+    scan_table_.clear();
+
+    // Idle timer drops adaptive links back to the low-power interval
+    const esp_timer_create_args_t idle_timer_args = {
+        .callback = link_idle_timer_callback,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ble_link_idle",
+        .skip_unhandled_events = true,
+    };
+    ret = esp_timer_create(&idle_timer_args, &link_idle_timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create link idle timer: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    // Interval switches run on the host task, serialized with the GAP events
+    ble_npl_callout_init(&adv_interval_callout_, nimble_port_get_dflt_eventq(), adv_interval_callout_handler, this);
+
+    // Command worker must exist before the host task can deliver writes
+    if (!start_command_worker()) {
+        return false;
+    }
+
+    // Connection, scan and relay changes for clients that asked for them
+    if (!event_bus::subscribe(app_event_handler, this)) {
+        ESP_LOGW(TAG, "Push events unavailable over BLE");
+    }
 
     // Start NimBLE host task
     nimble_port_freertos_init(nimble_host_task);
@@ -237,12 +316,84 @@ bool BLEManager::stop_advertising() {
 }
 
 bool BLEManager::is_connected() const {
-    return connected_ && conn_handle_ != BLE_HS_CONN_HANDLE_NONE;
+    return session_count_.load() > 0;
+}
+
+size_t BLEManager::connection_count() const {
+    return session_count_.load();
+}
+
+BLEManager::Session* BLEManager::find_session(uint16_t conn_handle) {
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+        return nullptr;
+    }
+    for (Session& session : sessions_) {
+        if (session.conn_handle.load() == conn_handle) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+const BLEManager::Session* BLEManager::find_session(uint16_t conn_handle) const {
+    return const_cast<BLEManager*>(this)->find_session(conn_handle);
+}
+
+uint16_t BLEManager::command_conn_handle() const {
+    if (xTaskGetCurrentTaskHandle() != command_worker_handle_) {
+        return BLE_HS_CONN_HANDLE_NONE;
+    }
+    return command_conn_handle_.load();
+}
+
+bool BLEManager::set_command_client_events(bool enable) {
+    Session* session = find_session(command_conn_handle());
+    if (!session) {
+        return false;
+    }
+    // Only the worker changes the flag while the session is open
+    if (session->events != enable) {
+        session->events = enable;
+        if (enable) {
+            event_clients_++;
+        } else {
+            event_clients_--;
+        }
+    }
+    return true;
+}
+
+bool BLEManager::get_command_client_events(bool& enabled) const {
+    const Session* session = find_session(command_conn_handle());
+    if (!session) {
+        return false;
+    }
+    enabled = session->events;
+    return true;
 }
 
 bool BLEManager::send_response(const std::string& data) {
-    if (!is_connected()) {
+    return send_response(data.data(), data.length());
+}
+
+bool BLEManager::send_response(const char* data, size_t len) {
+    bool delivered = false;
+    for (Session& session : sessions_) {
+        uint16_t conn_handle = session.conn_handle.load();
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE && session.subscribed) {
+            delivered |= send_response(conn_handle, data, len);
+        }
+    }
+    if (!delivered && !is_connected()) {
         ESP_LOGW(TAG, "No BLE client connected");
+    }
+    return delivered;
+}
+
+bool BLEManager::send_response(uint16_t conn_handle, const char* data, size_t len) {
+    Session* session = find_session(conn_handle);
+    if (!session) {
+        ESP_LOGW(TAG, "BLE connection %u is not open", conn_handle);
         return false;
     }
 
@@ -251,65 +402,131 @@ bool BLEManager::send_response(const std::string& data) {
         return false;
     }
 
-    // BLE characteristic MTU is typically 20-244 bytes
-    // Use conservative chunk size of 200 bytes for reliable transmission
-    const size_t CHUNK_SIZE = 200;
-    
-    if (data.length() <= CHUNK_SIZE) {
-        // Send data in single packet
-        return send_single_packet(data);
-    } else {
-        // Send data in chunks
-        ESP_LOGI(TAG, "Chunking response: %zu bytes into %zu-byte packets", 
-                data.length(), CHUNK_SIZE);
-        
-        size_t offset = 0;
-        size_t chunk_num = 0;
-        
-        while (offset < data.length()) {
-            size_t chunk_len = std::min(CHUNK_SIZE, data.length() - offset);
-            std::string chunk = data.substr(offset, chunk_len);
-            
-            if (!send_single_packet(chunk)) {
-                ESP_LOGE(TAG, "Failed to send chunk %zu", chunk_num);
-                return false;
+    note_link_activity(*session);
+
+    // Keep one response's notifications contiguous when several tasks send to this client
+    xSemaphoreTake(session->tx_mutex, portMAX_DELAY);
+    bool sent = transmit_locked(*session, conn_handle, data, len);
+    xSemaphoreGive(session->tx_mutex);
+    return sent;
+}
+
+bool BLEManager::transmit_locked(Session& session, uint16_t conn_handle, const char* data, size_t len) {
+    session.tx_waiter = xTaskGetCurrentTaskHandle();
+
+    size_t offset = 0;
+    size_t chunk_num = 0;
+    TickType_t stall_start = 0;
+    bool stalled = false;
+    bool sent = true;
+
+    while (offset < len) {
+        // The slot is reused if the client disconnects mid-response
+        if (session.conn_handle.load() != conn_handle) {
+            ESP_LOGW(TAG, "BLE client %u disconnected during transmission", conn_handle);
+            sent = false;
+            break;
+        }
+
+        // Notification payload follows the negotiated MTU; ble_hs_mbuf_from_flat copies the chunk into mbufs
+        size_t chunk_len = std::min(max_notification_payload(session), len - offset);
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(data + offset, chunk_len);
+        if (om == nullptr) {
+            // mbuf pool exhausted: the controller has not drained earlier packets yet
+            tx_stalls_++;
+            if (!stalled) {
+                stalled = true;
+                stall_start = xTaskGetTickCount();
+            }
+            if (!wait_for_tx_progress(stall_start)) {
+                sent = false;
+                break;
             }
-            
-            offset += chunk_len;
-            chunk_num++;
-            
-            // Small delay between chunks to prevent overwhelming the client
-            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
         }
-        
-        ESP_LOGI(TAG, "Sent %zu bytes in %zu chunks via BLE NUS", data.length(), chunk_num);
-        return true;
+
+        int rc = ble_gatts_notify_custom(conn_handle, nus_tx_char_handle_, om);
+        if (rc == BLE_HS_ENOMEM) {
+            tx_stalls_++;
+            if (!stalled) {
+                stalled = true;
+                stall_start = xTaskGetTickCount();
+            }
+            if (!wait_for_tx_progress(stall_start)) {
+                sent = false;
+                break;
+            }
+            continue;
+        }
+        if (rc != 0) {
+            tx_failures_++;
+            ESP_LOGE(TAG, "Failed to send notification %zu to %u: %d", chunk_num, conn_handle, rc);
+            sent = false;
+            break;
+        }
+
+        offset += chunk_len;
+        chunk_num++;
+        tx_notifications_++;
+        tx_bytes_ += chunk_len;
+        stalled = false;
     }
+
+    session.tx_waiter = nullptr;
+    if (sent) {
+        LOG_SAMPLED(ESP_LOG_DEBUG, TAG, 32, "Sent %zu bytes in %zu notifications to %u (MTU %u)",
+                    len, chunk_num, conn_handle, session.att_mtu);
+    }
+    return sent;
 }
 
-bool BLEManager::send_single_packet(const std::string& data) {
-    if (data.length() > MAX_DATA_LEN) {
-        ESP_LOGW(TAG, "Single packet too long: %zu bytes", data.length());
+size_t BLEManager::max_notification_payload(const Session& session) {
+    // ATT notification header takes 3 bytes of the MTU
+    size_t payload = (session.att_mtu > 3) ? session.att_mtu - 3 : 20;
+    return std::min(payload, MAX_DATA_LEN);
+}
+
+bool BLEManager::wait_for_tx_progress(TickType_t stall_start) {
+    // Nothing signals freed mbufs, so poll once per tick; a disconnect wakes the sender early
+    ulTaskNotifyTake(pdTRUE, 1);
+    if (xTaskGetTickCount() - stall_start > pdMS_TO_TICKS(CONFIG_BLE_NUS_TX_TIMEOUT_MS)) {
+        ESP_LOGE(TAG, "BLE TX stalled for %d ms, aborting response", CONFIG_BLE_NUS_TX_TIMEOUT_MS);
         return false;
     }
+    return true;
+}
 
-    struct os_mbuf *om = ble_hs_mbuf_from_flat(data.c_str(), data.length());
-    if (om == nullptr) {
-        ESP_LOGE(TAG, "Failed to allocate mbuf");
-        return false;
+void BLEManager::handle_notify_tx_event(struct ble_gap_event *event) {
+    if (event->notify_tx.attr_handle != nus_tx_char_handle_ || event->notify_tx.indication) {
+        return;
     }
 
-    int rc = ble_gatts_notify_custom(conn_handle_, nus_tx_char_handle_, om);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Failed to send notification: %d", rc);
-        return false;
+    Session* session = find_session(event->notify_tx.conn_handle);
+    if (!session) {
+        return;
     }
 
-    ESP_LOGD(TAG, "Sent %zu bytes via BLE NUS", data.length());
-    return true;
+    // Reported from inside ble_gatts_notify_custom() on the sending task, before the
+    // controller has sent anything, so it carries no flow control information
+    if (event->notify_tx.status != 0) {
+        ESP_LOGD(TAG, "NUS notification status: %d", event->notify_tx.status);
+    }
 }
 
-void BLEManager::set_command_callback(std::function<std::string(const std::string&)> callback) {
+void BLEManager::handle_subscribe_event(struct ble_gap_event *event) {
+    if (event->subscribe.attr_handle != nus_tx_char_handle_) {
+        return;
+    }
+
+    Session* session = find_session(event->subscribe.conn_handle);
+    if (session) {
+        session->subscribed = event->subscribe.cur_notify;
+        ESP_LOGI(TAG, "BLE client %u %s NUS notifications", event->subscribe.conn_handle,
+                 session->subscribed ? "enabled" : "disabled");
+    }
+}
+
+void BLEManager::set_command_callback(CommandCallback callback) {
     command_callback_ = callback;
     ESP_LOGI(TAG, "BLE command callback registered");
 }
@@ -326,13 +543,19 @@ bool BLEManager::start_scan(int scan_duration_seconds) {
         return false;
     }
     
+    if (observer_.is_active()) {
+        ESP_LOGW(TAG, "BLE observer is running; stop it before a one-shot scan");
+        return false;
+    }
+    
     ESP_LOGI(TAG, "Starting BLE scan for %d seconds via ESP32-C6", scan_duration_seconds);
     
     // Clear previous results
-    scan_results_.clear();
+    scan_table_.clear();
     
+    // Duplicates are merged by the scan table, so let them through for RSSI statistics
     struct ble_gap_disc_params disc_params = {0};
-    disc_params.filter_duplicates = 1;
+    disc_params.filter_duplicates = 0;
     disc_params.passive = 0;
     disc_params.itvl = 0;
     disc_params.window = 0;
@@ -371,56 +594,118 @@ bool BLEManager::is_scanning() const {
     return scanning_;
 }
 
-int BLEManager::get_scan_result_count() const {
-    return scan_results_.size();
-}
-
-std::string BLEManager::get_scan_result(int index) const {
-    if (index < 0 || index >= static_cast<int>(scan_results_.size())) {
-        return "";
+bool BLEManager::start_observer(const ObserverConfig& config, AdvertObserver::RecordSink sink) {
+    if (!initialized_) {
+        ESP_LOGE(TAG, "BLE Manager not initialized");
+        return false;
     }
     
-    const auto& result = scan_results_[index];
-    std::string info = "[" + std::to_string(index) + "] " + result.address;
-    
-    if (!result.name.empty()) {
-        info += " (" + result.name + ")";
-    } else {
-        info += " (Unknown)";
+    if (scanning_) {
+        ESP_LOGW(TAG, "BLE scan in progress; observer not started");
+        return false;
     }
     
-    info += " RSSI: " + std::to_string(result.rssi) + " dBm";
-    
-    if (!result.service_uuids.empty()) {
-        info += " Services: " + result.service_uuids;
+    return observer_.start(config, std::move(sink));
+}
+
+bool BLEManager::stop_observer() {
+    return observer_.stop();
+}
+
+bool BLEManager::is_observing() const {
+    return observer_.is_active();
+}
+
+void BLEManager::write_observer_status(command_interface::ResponseWriter& out) const {
+    observer_.write_status(out);
+}
+
+int BLEManager::get_scan_result_count() const {
+    return scan_table_.size();
+}
+
+void BLEManager::write_scan_results(command_interface::ResponseWriter& out) const {
+    int64_t now_us = esp_timer_get_time();
+    size_t i = 0;
+    scan_table_.for_each([&](const ScanEntry& entry) {
+        out.printf("  [%zu] %02x:%02x:%02x:%02x:%02x:%02x (%s) RSSI: %d dBm (min %d, avg %d, max %d), "
+                   "%" PRIu32 " adv, %lld s ago",
+                   i++, entry.addr[5], entry.addr[4], entry.addr[3], entry.addr[2], entry.addr[1], entry.addr[0],
+                   entry.name[0] ? entry.name : "Unknown", entry.rssi_last, entry.rssi_min,
+                   entry.rssi_avg(), entry.rssi_max, entry.adv_count,
+                   static_cast<long long>((now_us - entry.last_seen_us) / 1000000));
+        if (entry.present & AdvFields::HAS_MFG_DATA) {
+            out.printf(" Mfg: 0x%04x", entry.company_id);
+        }
+        if (entry.present & AdvFields::HAS_TX_POWER) {
+            out.printf(" TX: %d dBm", entry.tx_power);
+        }
+        if (entry.present & AdvFields::HAS_APPEARANCE) {
+            out.printf(" Appearance: 0x%04x", entry.appearance);
+        }
+        if (entry.uuid16_count > 0 || entry.uuid32_count > 0 || entry.uuid128_count > 0) {
+            out.write(" Services:");
+            for (size_t u = 0; u < entry.uuid16_count; u++) {
+                out.printf(" 0x%04x", entry.uuids16[u]);
+            }
+            for (size_t u = 0; u < entry.uuid32_count; u++) {
+                out.printf(" 0x%08" PRIx32, entry.uuids32[u]);
+            }
+            for (size_t u = 0; u < entry.uuid128_count; u++) {
+                // Stored little-endian; print in canonical 8-4-4-4-12 order
+                const uint8_t* v = entry.uuids128[u];
+                out.printf(" %02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                           v[15], v[14], v[13], v[12], v[11], v[10], v[9], v[8],
+                           v[7], v[6], v[5], v[4], v[3], v[2], v[1], v[0]);
+            }
+        }
+        out.write("\n");
+    });
+}
+
+void BLEManager::write_debug_status(command_interface::ResponseWriter& out) const {
+    out.write("=== BLE Debug Status ===\n");
+    out.write("Implementation: ESP-Hosted NimBLE via ESP32-C6\n");
+    out.write("Transport: VHCI over SDIO\n");
+    out.printf("Initialized: %s\n", initialized_ ? "Yes" : "No");
+    out.printf("Advertising: %s\n", advertising_ ? "Active" : "Stopped");
+    out.printf("Connections: %" PRIu32 "/%u (%" PRIu32 " accepted)\n",
+               session_count_.load(), static_cast<unsigned>(MAX_SESSIONS), connections_accepted_);
+    out.printf("Scanning: %s\n", scanning_ ? "Active" : "Stopped");
+    out.printf("Device Name: %s\n", device_name_.c_str());
+    out.printf("Scan Results: %zu devices (%zu max, %" PRIu32 " evicted)\n",
+               scan_table_.size(), ScanTable::CAPACITY, scan_table_.evictions());
+    out.printf("Pending Commands: %u\n",
+               static_cast<unsigned>(command_queue_ ? uxQueueMessagesWaiting(command_queue_) : 0));
+    out.printf("Dropped Commands: %" PRIu32 "\n", commands_dropped_);
+    out.printf("Push Events: %" PRIu32 " client(s), %" PRIu32 " sent, %" PRIu32 " dropped\n",
+               event_clients_.load(), events_pushed_.load(), events_dropped_.load());
+    out.printf("RX Fragments: %" PRIu32 " (%" PRIu32 " partial commands discarded)\n",
+               rx_fragments_, rx_discarded_);
+    out.write("\nNordic UART Service:\n");
+    out.write("- Service UUID: 6E400001-B5A3-F393-E0A9-E50E24DCCA9E\n");
+    out.write("- RX Char UUID: 6E400002-B5A3-F393-E0A9-E50E24DCCA9E (Write)\n");
+    out.write("- TX Char UUID: 6E400003-B5A3-F393-E0A9-E50E24DCCA9E (Notify)\n");
+    out.printf("- TX Handle: %u\n", nus_tx_char_handle_);
+    out.printf("- TX Notifications: %" PRIu32 " (%" PRIu32 " bytes, %" PRIu32 " stalls)\n",
+               tx_notifications_.load(), tx_bytes_.load(), tx_stalls_.load());
+    out.write("\nSessions:\n");
+    for (const Session& session : sessions_) {
+        uint16_t conn_handle = session.conn_handle.load();
+        if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            continue;
+        }
+        out.printf("- Handle %u: MTU %u (payload %zu bytes), %s, RX pending %u bytes\n",
+                   conn_handle, session.att_mtu, max_notification_payload(session),
+                   session.subscribed ? "subscribed" : "not subscribed", session.rx_len);
     }
-    
-    return info;
-}
-
-std::string BLEManager::get_debug_status() const {
-    std::string status = "=== BLE Debug Status ===\n";
-    status += "Implementation: ESP-Hosted NimBLE via ESP32-C6\n";
-    status += "Transport: VHCI over SDIO\n";
-    status += "Initialized: " + std::string(initialized_ ? "Yes" : "No") + "\n";
-    status += "Advertising: " + std::string(advertising_ ? "Active" : "Stopped") + "\n";
-    status += "Connected: " + std::string(connected_ ? "Yes" : "No") + "\n";
-    status += "Scanning: " + std::string(scanning_ ? "Active" : "Stopped") + "\n";
-    status += "Connection Handle: " + std::to_string(conn_handle_) + "\n";
-    status += "Device Name: " + device_name_ + "\n";
-    status += "Scan Results: " + std::to_string(scan_results_.size()) + " devices\n";
-    status += "\nNordic UART Service:\n";
-    status += "- Service UUID: 6E400001-B5A3-F393-E0A9-E50E24DCCA9E\n";
-    status += "- RX Char UUID: 6E400002-B5A3-F393-E0A9-E50E24DCCA9E (Write)\n";
-    status += "- TX Char UUID: 6E400003-B5A3-F393-E0A9-E50E24DCCA9E (Notify)\n";
-    status += "- TX Handle: " + std::to_string(nus_tx_char_handle_) + "\n";
-    status += "\nESP-Hosted Configuration:\n";
-    status += "- NimBLE Stack: Active\n";
-    status += "- ESP32-C6 Controller: Connected via SDIO\n";
-    status += "- VHCI Transport: Enabled\n";
-    status += "- Service Registration: Complete\n";
-    
-    return status;
+    out.write("\nLink Parameters:\n");
+    write_link_status(out);
+    out.write("\nESP-Hosted Configuration:\n");
+    out.write("- NimBLE Stack: Active\n");
+    out.write("- ESP32-C6 Controller: Connected via SDIO\n");
+    out.write("- VHCI Transport: Enabled\n");
+    out.write("- Service Registration: Complete\n");
 }
 
 // Static callback handlers
@@ -432,25 +717,68 @@ int BLEManager::gap_event_handler(struct ble_gap_event *event, void *arg) {
     switch (event->type) {
         case BLE_GAP_EVENT_CONNECT:
             ESP_LOGI(TAG, "BLE connection event: status=%d", event->connect.status);
+            // A connection ends undirected advertising
+            instance_->advertising_ = false;
             if (event->connect.status == 0) {
-                instance_->conn_handle_ = event->connect.conn_handle;
-                instance_->connected_ = true;
                 instance_->handle_connection_event(event);
-            } else {
-                // Connection failed, restart advertising
+            }
+            // Keep accepting centrals while a session slot is free
+            if (instance_->session_count_.load() < MAX_SESSIONS) {
                 instance_->start_advertising_internal();
             }
             break;
 
         case BLE_GAP_EVENT_DISCONNECT:
             ESP_LOGI(TAG, "BLE disconnect event: reason=%d", event->disconnect.reason);
-            instance_->conn_handle_ = BLE_HS_CONN_HANDLE_NONE;
-            instance_->connected_ = false;
             instance_->handle_disconnection_event(event);
-            // Restart advertising
-            instance_->start_advertising_internal();
+            // A slot is free again
+            if (!instance_->advertising_) {
+                instance_->start_advertising_internal();
+            }
+            break;
+
+        case BLE_GAP_EVENT_MTU:
+            ESP_LOGI(TAG, "ATT MTU updated: handle=%d mtu=%d",
+                    event->mtu.conn_handle, event->mtu.value);
+            if (Session* session = instance_->find_session(event->mtu.conn_handle)) {
+                session->att_mtu = event->mtu.value;
+            }
             break;
 
+        case BLE_GAP_EVENT_NOTIFY_TX:
+            instance_->handle_notify_tx_event(event);
+            break;
+
+        case BLE_GAP_EVENT_SUBSCRIBE:
+            instance_->handle_subscribe_event(event);
+            break;
+
+        case BLE_GAP_EVENT_CONN_UPDATE:
+            if (event->conn_update.status == 0) {
+                if (Session* session = instance_->find_session(event->conn_update.conn_handle)) {
+                    instance_->refresh_conn_params(*session);
+                    ESP_LOGI(TAG, "Connection %u updated: interval=%u latency=%u timeout=%u",
+                            event->conn_update.conn_handle, session->conn_itvl,
+                            session->conn_latency, session->supervision_timeout);
+                }
+            } else {
+                ESP_LOGW(TAG, "Connection update failed: %d", event->conn_update.status);
+            }
+            break;
+
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            if (event->phy_updated.status == 0) {
+                if (Session* session = instance_->find_session(event->phy_updated.conn_handle)) {
+                    session->tx_phy = event->phy_updated.tx_phy;
+                    session->rx_phy = event->phy_updated.rx_phy;
+                }
+                ESP_LOGI(TAG, "PHY updated: handle=%u TX %s, RX %s", event->phy_updated.conn_handle,
+                        phy_to_string(event->phy_updated.tx_phy), phy_to_string(event->phy_updated.rx_phy));
+            }
+            break;
+#endif
+
         case BLE_GAP_EVENT_ADV_COMPLETE:
             ESP_LOGI(TAG, "BLE advertising complete");
             instance_->advertising_ = false;
@@ -458,36 +786,30 @@ int BLEManager::gap_event_handler(struct ble_gap_event *event, void *arg) {
 
         case BLE_GAP_EVENT_DISC:
             {
-                // Handle scan results
-                char addr_str[18];
-                snprintf(addr_str, sizeof(addr_str), "%02x:%02x:%02x:%02x:%02x:%02x",
-                        event->disc.addr.val[5], event->disc.addr.val[4],
-                        event->disc.addr.val[3], event->disc.addr.val[2], 
-                        event->disc.addr.val[1], event->disc.addr.val[0]);
-                
-                ScanResult result;
-                result.address = std::string(addr_str);
-                result.rssi = event->disc.rssi;
-                result.name = "";
-                result.service_uuids = "";
+                // Merge into the scan table; runs per advertisement, so nothing here allocates
+                AdvertReport report = {};
+                report.addr = event->disc.addr.val;
+                report.addr_type = event->disc.addr.type;
+                report.rssi = event->disc.rssi;
                 
-                // Extract device name from advertising data
-                struct ble_hs_adv_fields fields;
-                int rc = ble_hs_adv_parse_fields(&fields, event->disc.data, 
-                                               event->disc.length_data);
-                if (rc == 0 && fields.name != nullptr) {
-                    result.name = std::string((char*)fields.name, fields.name_len);
+                AdvFields fields;
+                if (parse_adv_fields(event->disc.data, event->disc.length_data, fields)) {
+                    report.fields = &fields;
                 }
                 
-                instance_->scan_results_.push_back(result);
-                ESP_LOGD(TAG, "Discovered device: %s, RSSI: %d", addr_str, event->disc.rssi);
+                instance_->scan_table_.record(report, esp_timer_get_time());
+                ESP_LOGD(TAG, "Discovered device: %02x:%02x:%02x:%02x:%02x:%02x, RSSI: %d",
+                         report.addr[5], report.addr[4], report.addr[3],
+                         report.addr[2], report.addr[1], report.addr[0], report.rssi);
             }
             break;
 
         case BLE_GAP_EVENT_DISC_COMPLETE:
-            ESP_LOGI(TAG, "BLE scan complete, found %d devices", 
-                    instance_->scan_results_.size());
+            ESP_LOGI(TAG, "BLE scan complete, found %u devices", 
+                    static_cast<unsigned>(instance_->scan_table_.size()));
             instance_->scanning_ = false;
+            event_bus::post(event_bus::EventId::BLE_SCAN_DONE,
+                            event_bus::BleScanDoneEvent{static_cast<uint16_t>(instance_->scan_table_.size())});
             break;
 
         default:
@@ -552,34 +874,555 @@ bool BLEManager::configure_advertising_data(const std::string& device_name) {
 }
 
 void BLEManager::handle_connection_event(struct ble_gap_event *event) {
-    ESP_LOGI(TAG, "BLE client connected, handle: %d", event->connect.conn_handle);
+    uint16_t conn_handle = event->connect.conn_handle;
+    auto slot = std::find_if(sessions_.begin(), sessions_.end(), [](const Session& session) {
+        return session.conn_handle.load() == BLE_HS_CONN_HANDLE_NONE;
+    });
+    if (slot == sessions_.end()) {
+        // NimBLE never admits more than CONFIG_BT_NIMBLE_MAX_CONNECTIONS links
+        ESP_LOGE(TAG, "No free session for BLE connection %u", conn_handle);
+        ble_gap_terminate(conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+        return;
+    }
+
+    Session& session = *slot;
+    session.subscribed = false;
+    session.events = false;
+    session.att_mtu = BLE_ATT_MTU_DFLT;
+    session.tx_waiter = nullptr;
+    session.link_fast = false;
+    session.last_activity_us = esp_timer_get_time();
+    session.conn_itvl = 0;
+    session.conn_latency = 0;
+    session.supervision_timeout = 0;
+    session.tx_phy = BLE_GAP_LE_PHY_1M;
+    session.rx_phy = BLE_GAP_LE_PHY_1M;
+    session.rx_len = 0;
+    session.conn_handle = conn_handle;
+    session_count_++;
+    connections_accepted_++;
+    ESP_LOGI(TAG, "BLE client connected, handle: %d (%" PRIu32 "/%u sessions)",
+             conn_handle, session_count_.load(), static_cast<unsigned>(MAX_SESSIONS));
+    event_bus::post(event_bus::EventId::BLE_CONNECTED,
+                    event_bus::BleConnectionEvent{conn_handle, 0, static_cast<uint8_t>(session_count_.load())});
+
+    // A larger MTU benefits every policy: fewer notifications per response
+    int rc = ble_gattc_exchange_mtu(conn_handle, mtu_exchange_callback, nullptr);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to start MTU exchange: %d", rc);
+    }
+
+    apply_link_policy(session);
 }
 
 void BLEManager::handle_disconnection_event(struct ble_gap_event *event) {
     ESP_LOGI(TAG, "BLE client disconnected, reason: %d", event->disconnect.reason);
+
+    Session* session = find_session(event->disconnect.conn.conn_handle);
+    if (!session) {
+        return;
+    }
+
+    session->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    session->subscribed = false;
+    if (session->events) {
+        session->events = false;
+        event_clients_--;
+    }
+    session->rx_len = 0;
+    session_count_--;
+    TaskHandle_t waiter = session->tx_waiter;
+    if (waiter) {
+        // Wake a sender waiting for mbufs so it notices the disconnect
+        xTaskNotifyGive(waiter);
+    }
+    event_bus::post(event_bus::EventId::BLE_DISCONNECTED,
+                    event_bus::BleConnectionEvent{event->disconnect.conn.conn_handle,
+                                                  static_cast<uint8_t>(event->disconnect.reason),
+                                                  static_cast<uint8_t>(session_count_.load())});
+}
+
+// True once every frame in the buffer has its whole payload; a malformed
+// header also counts as complete so the frame parser can report it
+static bool frames_complete(std::string_view data) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        if (static_cast<uint8_t>(data[offset]) != command_interface::FRAME_MAGIC) {
+            return true;
+        }
+        command_interface::FrameHeader header;
+        if (data.size() - offset < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, data.data() + offset, sizeof(header));
+        offset += sizeof(header) + header.length;
+        if (offset > BLEManager::MAX_DATA_LEN) {
+            return true;
+        }
+    }
+    return offset == data.size();
 }
 
-void BLEManager::process_received_data(const uint8_t* data, uint16_t len) {
+bool BLEManager::rx_complete(const Session& session, size_t write_len) {
+    std::string_view data(session.rx_buf, session.rx_len);
+    if (command_interface::is_frame(data)) {
+        return frames_complete(data);
+    }
+
+    // A text write that fills a whole ATT payload without ending the line continues in the next write
+    char last = data.back();
+    return last == '\n' || last == '\r' || last == ';' || write_len < max_notification_payload(session);
+}
+
+bool BLEManager::process_received_data(uint16_t conn_handle, struct os_mbuf *om) {
+    if (!command_queue_) {
+        ESP_LOGW(TAG, "Command worker not running");
+        return false;
+    }
+
+    Session* session = find_session(conn_handle);
+    if (!session) {
+        ESP_LOGW(TAG, "Ignoring BLE write from unknown connection %u", conn_handle);
+        return true;
+    }
+
+    note_link_activity(*session);
+
+    uint16_t data_len = OS_MBUF_PKTLEN(om);
+    if (data_len == 0) {
+        return true;
+    }
+    rx_writes_++;
+    rx_bytes_ += data_len;
+
+    int64_t now_us = esp_timer_get_time();
+    if (session->rx_len > 0 && now_us - session->rx_started_us > RX_FRAGMENT_TIMEOUT_US) {
+        rx_discarded_++;
+        ESP_LOGW(TAG, "Dropping %u bytes of an unfinished BLE command", session->rx_len);
+        session->rx_len = 0;
+    }
+    if (session->rx_len + data_len > MAX_DATA_LEN) {
+        rx_discarded_++;
+        ESP_LOGW(TAG, "Ignoring BLE command longer than %zu bytes", MAX_DATA_LEN);
+        session->rx_len = 0;
+        return true;
+    }
+
+    uint16_t copied = 0;
+    int rc = ble_hs_mbuf_to_flat(om, session->rx_buf + session->rx_len,
+                                 MAX_DATA_LEN - session->rx_len, &copied);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to read BLE write: %d", rc);
+        return true;
+    }
+    if (session->rx_len == 0) {
+        session->rx_started_us = now_us;
+    }
+    session->rx_len += copied;
+
+    if (!rx_complete(*session, data_len)) {
+        rx_fragments_++;
+        return true;
+    }
+
+    PendingCommand pending;
+    pending.received_us = session->rx_started_us;
+    pending.conn_handle = conn_handle;
+    pending.len = session->rx_len;
+    memcpy(pending.data, session->rx_buf, session->rx_len);
+    session->rx_len = 0;
+
+    // Never block the host task; a full queue rejects the write instead
+    if (xQueueSend(command_queue_, &pending, 0) != pdTRUE) {
+        commands_dropped_++;
+        ESP_LOGW(TAG, "BLE command queue full, rejecting command");
+        return false;
+    }
+
+    return true;
+}
+
+bool BLEManager::start_command_worker() {
+    command_queue_ = xQueueCreate(CONFIG_BLE_CMD_QUEUE_LENGTH, sizeof(PendingCommand));
+    event_queue_ = xQueueCreate(CONFIG_EVENT_BUS_PUSH_QUEUE_LENGTH, sizeof(PendingEvent));
+    worker_queues_ = xQueueCreateSet(CONFIG_BLE_CMD_QUEUE_LENGTH + CONFIG_EVENT_BUS_PUSH_QUEUE_LENGTH);
+    if (command_queue_ == nullptr || event_queue_ == nullptr || worker_queues_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create BLE command queue");
+        return false;
+    }
+    // Both queues are still empty, which adding to a set requires
+    xQueueAddToSet(command_queue_, worker_queues_);
+    xQueueAddToSet(event_queue_, worker_queues_);
+
+    BaseType_t core = (CONFIG_BLE_CMD_WORKER_CORE < 0) ? tskNO_AFFINITY : CONFIG_BLE_CMD_WORKER_CORE;
+    BaseType_t rc = xTaskCreatePinnedToCore(command_worker_task, "ble_cmd",
+                                            CONFIG_BLE_CMD_WORKER_STACK_SIZE, this,
+                                            hosted_link::task_priority(hosted_link::Interface::HCI,
+                                                                       CONFIG_BLE_CMD_WORKER_PRIORITY),
+                                            &command_worker_handle_, core);
+    if (rc != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create BLE command worker task");
+        xQueueRemoveFromSet(command_queue_, worker_queues_);
+        xQueueRemoveFromSet(event_queue_, worker_queues_);
+        vQueueDelete(worker_queues_);
+        vQueueDelete(command_queue_);
+        vQueueDelete(event_queue_);
+        worker_queues_ = nullptr;
+        command_queue_ = nullptr;
+        event_queue_ = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "BLE command worker started (queue: %d, priority: %d, core: %d)",
+             CONFIG_BLE_CMD_QUEUE_LENGTH, CONFIG_BLE_CMD_WORKER_PRIORITY, CONFIG_BLE_CMD_WORKER_CORE);
+    return true;
+}
+
+void BLEManager::command_worker_task(void *param) {
+    BLEManager* manager = static_cast<BLEManager*>(param);
+    PendingCommand pending;
+    PendingEvent event;
+
+    while (true) {
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(manager->worker_queues_, portMAX_DELAY);
+        if (ready == manager->command_queue_ && xQueueReceive(manager->command_queue_, &pending, 0) == pdTRUE) {
+            manager->execute_pending_command(pending);
+        } else if (ready == manager->event_queue_ && xQueueReceive(manager->event_queue_, &event, 0) == pdTRUE) {
+            manager->push_event(event);
+        }
+    }
+}
+
+void BLEManager::app_event_handler(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    BLEManager* manager = static_cast<BLEManager*>(arg);
+    if (manager->event_clients_.load() == 0) {
+        return;
+    }
+    PendingEvent event;
+    event.len = static_cast<uint16_t>(event_bus::format(id, data, event.data, sizeof(event.data)));
+    if (event.len == 0) {
+        return;
+    }
+    // The bus task must not wait on a busy worker
+    if (xQueueSend(manager->event_queue_, &event, 0) != pdTRUE) {
+        manager->events_dropped_++;
+    }
+}
+
+void BLEManager::push_event(const PendingEvent& event) {
+    for (Session& session : sessions_) {
+        uint16_t conn_handle = session.conn_handle.load();
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE && session.events && session.subscribed &&
+            send_response(conn_handle, event.data, event.len)) {
+            events_pushed_++;
+        }
+    }
+}
+
+void BLEManager::execute_pending_command(const PendingCommand& pending) {
     if (!command_callback_) {
         ESP_LOGW(TAG, "No command callback registered");
         return;
     }
-    
-    std::string command(reinterpret_cast<const char*>(data), len);
-    ESP_LOGI(TAG, "Received BLE command: %s", command.c_str());
-    
-    std::string response = command_callback_(command);
-    if (!response.empty()) {
-        send_response(response);
+
+    std::string_view command(pending.data, pending.len);
+    if (command_interface::is_frame(command)) {
+        ESP_LOGD(TAG, "Received %u bytes of BLE command frames from %u", pending.len, pending.conn_handle);
+    } else {
+        LOG_RATE_LIMITED(ESP_LOG_INFO, TAG, CONFIG_LOG_RATE_LIMIT_MS, "Received BLE command from %u: %.*s",
+                         pending.conn_handle, static_cast<int>(command.size()), command.data());
+    }
+
+    // Response chunks go out to the requesting client as they are produced; stop once it is gone
+    ResponseSink sink = [this, &pending](const char* data, size_t len) {
+        if (!find_session(pending.conn_handle)) {
+            ESP_LOGW(TAG, "BLE client %u disconnected before response was sent", pending.conn_handle);
+            return false;
+        }
+        return send_response(pending.conn_handle, data, len);
+    };
+    command_conn_handle_ = pending.conn_handle;
+    telemetry::begin_command(telemetry::Source::BLE, pending.received_us);
+    command_callback_(command, sink);
+    telemetry::end_command();
+    command_conn_handle_ = BLE_HS_CONN_HANDLE_NONE;
+}
+
+// Link parameter policy
+bool BLEManager::set_link_policy(LinkPolicy policy) {
+    link_policy_ = policy;
+    ESP_LOGI(TAG, "BLE link policy set to %s", link_policy_to_string(policy));
+
+    if (policy != LinkPolicy::ADAPTIVE && link_idle_timer_) {
+        esp_timer_stop(link_idle_timer_);
+    }
+
+    for (Session& session : sessions_) {
+        if (session.conn_handle.load() != BLE_HS_CONN_HANDLE_NONE) {
+            apply_link_policy(session);
+        }
+    }
+    return true;
+}
+
+BLEManager::LinkPolicy BLEManager::get_link_policy() const {
+    return link_policy_;
+}
+
+const char* BLEManager::link_policy_to_string(LinkPolicy policy) {
+    switch (policy) {
+        case LinkPolicy::THROUGHPUT: return "throughput";
+        case LinkPolicy::ADAPTIVE: return "adaptive";
+        case LinkPolicy::LOW_POWER: return "low_power";
+        default: return "unknown";
+    }
+}
+
+bool BLEManager::link_policy_from_string(std::string_view name, LinkPolicy& policy) {
+    using command_interface::equals_ignore_case;
+    if (equals_ignore_case(name, "throughput") || equals_ignore_case(name, "fast")) {
+        policy = LinkPolicy::THROUGHPUT;
+    } else if (equals_ignore_case(name, "adaptive") || equals_ignore_case(name, "auto")) {
+        policy = LinkPolicy::ADAPTIVE;
+    } else if (equals_ignore_case(name, "low_power") || equals_ignore_case(name, "lowpower") ||
+               equals_ignore_case(name, "lp")) {
+        policy = LinkPolicy::LOW_POWER;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void BLEManager::get_hci_counters(hosted_link::InterfaceCounters& counters) const {
+    counters = hosted_link::InterfaceCounters{};
+    counters.available = initialized_;
+    counters.bytes_known = true;
+    counters.retries_known = true;
+    counters.tx_frames = tx_notifications_.load();
+    counters.tx_bytes = tx_bytes_.load();
+    counters.rx_frames = rx_writes_;
+    counters.rx_bytes = rx_bytes_;
+    counters.drops = tx_failures_.load() + rx_discarded_ + commands_dropped_;
+    counters.retries = tx_stalls_.load();
+}
+
+bool BLEManager::probe_hci(int64_t& round_trip_us) const {
+    if (!initialized_) {
+        return false;
+    }
+    // Generating a throwaway address issues one LE Rand command and waits for its completion
+    ble_addr_t addr;
+    int64_t start_us = esp_timer_get_time();
+    int rc = ble_hs_id_gen_rnd(1, &addr);
+    round_trip_us = esp_timer_get_time() - start_us;
+    if (rc != 0) {
+        ESP_LOGW(TAG, "HCI probe failed: %d", rc);
+        return false;
+    }
+    return true;
+}
+
+void BLEManager::write_link_status(command_interface::ResponseWriter& out) const {
+    out.printf("- Policy: %s\n", link_policy_to_string(link_policy_));
+    if (!is_connected()) {
+        out.write("- Link: Not connected\n");
+        return;
+    }
+
+    for (const Session& session : sessions_) {
+        uint16_t conn_handle = session.conn_handle.load();
+        if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+            continue;
+        }
+        // Connection interval is reported in 1.25 ms units
+        unsigned itvl_x100 = session.conn_itvl * 125u;
+        out.printf("- Handle %u:\n", conn_handle);
+        out.printf("  PHY: TX %s, RX %s\n", phy_to_string(session.tx_phy), phy_to_string(session.rx_phy));
+        out.printf("  ATT MTU: %u\n", session.att_mtu);
+        out.printf("  Interval: %u.%02u ms (latency %u, timeout %u ms)\n",
+                   itvl_x100 / 100, itvl_x100 % 100, session.conn_latency, session.supervision_timeout * 10u);
+        out.printf("  Interval Mode: %s\n", session.link_fast ? "Fast" : "Low power");
+    }
+}
+
+void BLEManager::apply_link_policy(Session& session) {
+    uint16_t conn_handle = session.conn_handle.load();
+    refresh_conn_params(session);
+
+    int rc;
+    if (link_policy_ == LinkPolicy::LOW_POWER) {
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+        rc = ble_gap_set_prefered_le_phy(conn_handle, BLE_GAP_LE_PHY_1M_MASK,
+                                         BLE_GAP_LE_PHY_1M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Failed to request 1M PHY: %d", rc);
+        }
+#endif
+        request_conn_interval(session, false);
+        return;
+    }
+
+    rc = ble_gap_set_data_len(conn_handle, LINK_DLE_TX_OCTETS, LINK_DLE_TX_TIME_US);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to request data length extension: %d", rc);
+    }
+
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    rc = ble_gap_set_prefered_le_phy(conn_handle, BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to request 2M PHY: %d", rc);
+    }
+#endif
+
+    request_conn_interval(session, true);
+    if (link_policy_ == LinkPolicy::ADAPTIVE) {
+        session.last_activity_us = esp_timer_get_time();
+        if (!esp_timer_is_active(link_idle_timer_)) {
+            esp_timer_start_once(link_idle_timer_, CONFIG_BLE_LINK_IDLE_TIMEOUT_MS * 1000ULL);
+        }
+    }
+}
+
+void BLEManager::request_conn_interval(Session& session, bool fast) {
+    uint16_t conn_handle = session.conn_handle.load();
+    if (conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+        return;
+    }
+
+    struct ble_gap_upd_params params = {};
+    if (fast) {
+        params.itvl_min = BLE_GAP_CONN_ITVL_MS(CONFIG_BLE_LINK_FAST_ITVL_MS);
+        params.itvl_max = BLE_GAP_CONN_ITVL_MS(CONFIG_BLE_LINK_FAST_ITVL_MS * 2);
+        params.latency = 0;
+    } else {
+        params.itvl_min = BLE_GAP_CONN_ITVL_MS(CONFIG_BLE_LINK_IDLE_ITVL_MS);
+        params.itvl_max = BLE_GAP_CONN_ITVL_MS(CONFIG_BLE_LINK_IDLE_ITVL_MS * 3 / 2);
+        params.latency = CONFIG_BLE_LINK_IDLE_LATENCY;
+    }
+    params.supervision_timeout = BLE_GAP_SUPERVISION_TIMEOUT_MS(CONFIG_BLE_LINK_SUPERVISION_TIMEOUT_MS);
+    params.min_ce_len = 0;
+    params.max_ce_len = 0;
+
+    int rc = ble_gap_update_params(conn_handle, &params);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to request %s connection interval for %u: %d",
+                 fast ? "fast" : "low-power", conn_handle, rc);
+        return;
+    }
+
+    session.link_fast = fast;
+    ESP_LOGD(TAG, "Requested %s connection interval for %u", fast ? "fast" : "low-power", conn_handle);
+}
+
+void BLEManager::note_link_activity(Session& session) {
+    if (link_policy_ != LinkPolicy::ADAPTIVE) {
+        return;
+    }
+
+    session.last_activity_us = esp_timer_get_time();
+    if (!session.link_fast.load()) {
+        request_conn_interval(session, true);
+    }
+
+    // The timer tracks the earliest deadline; a busy link never delays another one going idle
+    if (!esp_timer_is_active(link_idle_timer_)) {
+        esp_timer_start_once(link_idle_timer_, CONFIG_BLE_LINK_IDLE_TIMEOUT_MS * 1000ULL);
+    }
+}
+
+void BLEManager::refresh_conn_params(Session& session) {
+    uint16_t conn_handle = session.conn_handle.load();
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+        session.conn_itvl = desc.conn_itvl;
+        session.conn_latency = desc.conn_latency;
+        session.supervision_timeout = desc.supervision_timeout;
+    }
+
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    if (ble_gap_read_le_phy(conn_handle, &tx_phy, &rx_phy) == 0) {
+        session.tx_phy = tx_phy;
+        session.rx_phy = rx_phy;
+    }
+#endif
+}
+
+void BLEManager::link_idle_timer_callback(void *arg) {
+    BLEManager* manager = static_cast<BLEManager*>(arg);
+    if (manager->link_policy_ != LinkPolicy::ADAPTIVE) {
+        return;
+    }
+
+    // Drop every link idle for the full timeout and rearm for the next one due
+    static constexpr int64_t IDLE_TIMEOUT_US = CONFIG_BLE_LINK_IDLE_TIMEOUT_MS * 1000LL;
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = INT64_MAX;
+    for (Session& session : manager->sessions_) {
+        if (session.conn_handle.load() == BLE_HS_CONN_HANDLE_NONE || !session.link_fast.load()) {
+            continue;
+        }
+        int64_t idle_us = now_us - session.last_activity_us;
+        if (idle_us >= IDLE_TIMEOUT_US) {
+            ESP_LOGD(TAG, "BLE link %u idle, switching to low-power interval", session.conn_handle.load());
+            manager->request_conn_interval(session, false);
+        } else {
+            next_us = std::min(next_us, IDLE_TIMEOUT_US - idle_us);
+        }
+    }
+    if (next_us != INT64_MAX) {
+        esp_timer_start_once(manager->link_idle_timer_, static_cast<uint64_t>(next_us));
     }
 }
 
+void BLEManager::set_low_power_advertising(bool enable) {
+    low_power_adv_ = enable;
+    if (!initialized_) {
+        return;
+    }
+    // Fast advertising gets its full period before dropping to slow; going back to fast is immediate
+    ble_npl_callout_reset(&adv_interval_callout_,
+                          enable ? ble_npl_time_ms_to_ticks32(CONFIG_POWER_ADV_FAST_PERIOD_S * 1000) : 0);
+}
+
+void BLEManager::adv_interval_callout_handler(struct ble_npl_event *ev) {
+    BLEManager* manager = static_cast<BLEManager*>(ble_npl_event_get_arg(ev));
+    bool slow = manager->low_power_adv_.load();
+    if (!manager->advertising_ || manager->adv_slow_ == slow) {
+        return;
+    }
+    int rc = ble_gap_adv_stop();
+    if (rc == BLE_HS_EALREADY) {
+        // Advertising already ended; the connect handler restarts it if a slot is free
+        manager->advertising_ = false;
+        return;
+    }
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Failed to stop advertising: %d", rc);
+        return;
+    }
+    ESP_LOGD(TAG, "Advertising at the %s interval", slow ? "slow" : "fast");
+    manager->start_advertising_internal(slow);
+}
+
+int BLEManager::mtu_exchange_callback(uint16_t conn_handle, const struct ble_gatt_error *error,
+                                      uint16_t mtu, void *arg) {
+    if (error->status == 0) {
+        ESP_LOGI(TAG, "MTU exchange complete: handle=%d mtu=%d", conn_handle, mtu);
+    } else {
+        ESP_LOGW(TAG, "MTU exchange failed: handle=%d status=%d", conn_handle, error->status);
+    }
+    return 0;
+}
+
 bool BLEManager::register_nus_service() {
     ESP_LOGD(TAG, "Nordic UART Service registered via static definition");
     return true;
 }
 
-void BLEManager::start_advertising_internal() {
+void BLEManager::start_advertising_internal(bool slow) {
     if (!initialized_) {
         ESP_LOGE(TAG, "Cannot start advertising - not initialized");
         return;
@@ -588,8 +1431,14 @@ void BLEManager::start_advertising_internal() {
     struct ble_gap_adv_params adv_params = {0};
     adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
     adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    adv_params.itvl_min = BLE_GAP_ADV_FAST_INTERVAL1_MIN;
-    adv_params.itvl_max = BLE_GAP_ADV_FAST_INTERVAL1_MAX;
+    if (slow) {
+        adv_params.itvl_min = BLE_GAP_ADV_ITVL_MS(CONFIG_POWER_ADV_SLOW_INTERVAL_MS);
+        adv_params.itvl_max = std::min<uint32_t>(BLE_GAP_ADV_ITVL_MS(CONFIG_POWER_ADV_SLOW_INTERVAL_MS * 5 / 4),
+                                                 BLE_HCI_ADV_ITVL_MAX);
+    } else {
+        adv_params.itvl_min = BLE_GAP_ADV_FAST_INTERVAL1_MIN;
+        adv_params.itvl_max = BLE_GAP_ADV_FAST_INTERVAL1_MAX;
+    }
     
     struct ble_hs_adv_fields fields = {0};
     fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
@@ -611,8 +1460,13 @@ void BLEManager::start_advertising_internal() {
     if (rc != 0) {
         ESP_LOGE(TAG, "Failed to start advertising: %d", rc);
     } else {
-        ESP_LOGI(TAG, "BLE advertising started via ESP32-C6");
+        ESP_LOGI(TAG, "BLE advertising started via ESP32-C6 (%s interval)", slow ? "slow" : "fast");
         advertising_ = true;
+        adv_slow_ = slow;
+        if (!slow && low_power_adv_.load()) {
+            ble_npl_callout_reset(&adv_interval_callout_,
+                                  ble_npl_time_ms_to_ticks32(CONFIG_POWER_ADV_FAST_PERIOD_S * 1000));
+        }
     }
 }
 
@@ -0,0 +1,292 @@
+#include "ble_observer.hpp"
+#include "response_writer.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "host/ble_gap.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace ble_serial {
+
+static const char* TAG = "BLEObserver";
+
+// Scan timing is expressed in 0.625 ms units
+static uint16_t ms_to_scan_units(uint16_t ms) {
+    return static_cast<uint16_t>(std::clamp<uint32_t>(ms * 8u / 5u, 0x0004, 0x4000));
+}
+
+ObserverConfig ObserverConfig::defaults() {
+    ObserverConfig config = {};
+    config.interval_ms = CONFIG_BLE_OBSERVER_INTERVAL_MS;
+    config.window_ms = CONFIG_BLE_OBSERVER_WINDOW_MS;
+    config.active = false;
+    config.binary = false;
+    config.filter.uuid16 = 0;
+    config.filter.company_id = -1;
+    config.filter.min_rssi = -127;
+    return config;
+}
+
+AdvertObserver::AdvertObserver()
+    : config_(ObserverConfig::defaults()), queue_(nullptr), task_(nullptr), active_(false),
+      seen_(0), matched_(0), dropped_(0), streamed_(0) {
+    sink_mutex_ = xSemaphoreCreateMutex();
+}
+
+AdvertObserver::~AdvertObserver() {
+    stop();
+    if (task_) {
+        vTaskDelete(task_);
+    }
+    if (queue_) {
+        vQueueDelete(queue_);
+    }
+    if (sink_mutex_) {
+        vSemaphoreDelete(sink_mutex_);
+    }
+}
+
+bool AdvertObserver::start(const ObserverConfig& config, RecordSink sink) {
+    if (!queue_) {
+        queue_ = xQueueCreate(CONFIG_BLE_OBSERVER_QUEUE_LENGTH, sizeof(ObservedAdvert));
+        if (!queue_) {
+            ESP_LOGE(TAG, "Failed to create observer queue");
+            return false;
+        }
+    }
+    if (!task_) {
+        BaseType_t ret = xTaskCreate(stream_task, "ble_observer", CONFIG_BLE_OBSERVER_STACK_SIZE,
+                                     this, CONFIG_BLE_OBSERVER_PRIORITY, &task_);
+        if (ret != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create observer task");
+            task_ = nullptr;
+            return false;
+        }
+    }
+
+    if (active_) {
+        ble_gap_disc_cancel();
+        active_ = false;
+    }
+
+    xSemaphoreTake(sink_mutex_, portMAX_DELAY);
+    config_ = config;
+    config_.window_ms = std::min(config_.window_ms, config_.interval_ms);
+    sink_ = std::move(sink);
+    xQueueReset(queue_);
+    xSemaphoreGive(sink_mutex_);
+
+    seen_ = 0;
+    matched_ = 0;
+    dropped_ = 0;
+    streamed_ = 0;
+
+    // Repeated adverts are the point of presence detection, so keep duplicates
+    struct ble_gap_disc_params disc_params = {};
+    disc_params.itvl = ms_to_scan_units(config_.interval_ms);
+    disc_params.window = ms_to_scan_units(config_.window_ms);
+    disc_params.filter_policy = 0;
+    disc_params.limited = 0;
+    disc_params.passive = config_.active ? 0 : 1;
+    disc_params.filter_duplicates = 0;
+
+    active_ = true;
+    int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, BLE_HS_FOREVER, &disc_params, gap_event_handler, this);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Failed to start observer scan: %d", rc);
+        active_ = false;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Observing (%s, %u/%u ms)", config_.active ? "active" : "passive",
+             config_.window_ms, config_.interval_ms);
+    return true;
+}
+
+bool AdvertObserver::stop() {
+    if (!active_) {
+        return false;
+    }
+    active_ = false;
+    int rc = ble_gap_disc_cancel();
+    if (rc != 0 && rc != BLE_HS_EALREADY) {
+        ESP_LOGW(TAG, "Failed to cancel observer scan: %d", rc);
+    }
+    ESP_LOGI(TAG, "Observer stopped");
+    return true;
+}
+
+bool AdvertObserver::is_active() const {
+    return active_;
+}
+
+int AdvertObserver::gap_event_handler(struct ble_gap_event* event, void* arg) {
+    AdvertObserver* observer = static_cast<AdvertObserver*>(arg);
+
+    switch (event->type) {
+        case BLE_GAP_EVENT_DISC:
+            observer->on_advert(event->disc);
+            break;
+
+        case BLE_GAP_EVENT_DISC_COMPLETE:
+            // Only ends early if the controller or host gave up
+            if (observer->active_) {
+                ESP_LOGW(TAG, "Observer scan ended (reason %d)", event->disc_complete.reason);
+                observer->active_ = false;
+            }
+            break;
+
+        default:
+            break;
+    }
+    return 0;
+}
+
+// Runs on the NimBLE host task for every advertisement: filter, copy, never block
+void AdvertObserver::on_advert(const struct ble_gap_disc_desc& desc) {
+    if (!active_) {
+        return;
+    }
+    seen_++;
+    if (!matches(desc)) {
+        return;
+    }
+    matched_++;
+
+    ObservedAdvert advert;
+    advert.timestamp_us = esp_timer_get_time();
+    memcpy(advert.addr, desc.addr.val, sizeof(advert.addr));
+    advert.addr_type = desc.addr.type;
+    advert.rssi = desc.rssi;
+    advert.event_type = desc.event_type;
+    advert.length = std::min<uint8_t>(desc.length_data, sizeof(advert.data));
+    memcpy(advert.data, desc.data, advert.length);
+
+    if (xQueueSend(queue_, &advert, 0) != pdTRUE) {
+        dropped_++;
+    }
+}
+
+bool AdvertObserver::matches(const struct ble_gap_disc_desc& desc) const {
+    const ObserverFilter& filter = config_.filter;
+    if (desc.rssi < filter.min_rssi) {
+        return false;
+    }
+
+    bool need_fields = filter.name_prefix[0] != '\0' || filter.uuid16 != 0 || filter.company_id >= 0;
+    if (!need_fields) {
+        return true;
+    }
+
+    AdvFields fields;
+    if (!parse_adv_fields(desc.data, desc.length_data, fields)) {
+        return false;
+    }
+
+    if (filter.name_prefix[0] != '\0') {
+        size_t prefix_len = strnlen(filter.name_prefix, sizeof(filter.name_prefix));
+        if (fields.name_len < prefix_len || memcmp(fields.name, filter.name_prefix, prefix_len) != 0) {
+            return false;
+        }
+    }
+
+    if (filter.uuid16 != 0 && !fields.has_uuid16(filter.uuid16)) {
+        return false;
+    }
+
+    if (filter.company_id >= 0) {
+        if (!fields.has(AdvFields::HAS_MFG_DATA) || fields.company_id != filter.company_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AdvertObserver::stream_task(void* arg) {
+    AdvertObserver* observer = static_cast<AdvertObserver*>(arg);
+    // Text line: ~45 byte header plus up to 62 hex digits of AD payload
+    char buffer[160];
+
+    while (true) {
+        ObservedAdvert advert;
+        if (xQueueReceive(observer->queue_, &advert, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        xSemaphoreTake(observer->sink_mutex_, portMAX_DELAY);
+        size_t len = observer->config_.binary
+                         ? observer->format_binary(advert, buffer, sizeof(buffer))
+                         : observer->format_text(advert, buffer, sizeof(buffer));
+        bool sent = observer->active_ && observer->sink_ && observer->sink_(buffer, len);
+        xSemaphoreGive(observer->sink_mutex_);
+
+        if (sent) {
+            observer->streamed_++;
+        } else {
+            observer->dropped_++;
+        }
+    }
+}
+
+size_t AdvertObserver::format_text(const ObservedAdvert& advert, char* buffer, size_t size) const {
+    // ADV <ms> <addr> <pub|rnd> <rssi> <hex AD payload>
+    int written = snprintf(buffer, size, "ADV %" PRIu32 " %02x:%02x:%02x:%02x:%02x:%02x %s %d ",
+                           static_cast<uint32_t>(advert.timestamp_us / 1000),
+                           advert.addr[5], advert.addr[4], advert.addr[3],
+                           advert.addr[2], advert.addr[1], advert.addr[0],
+                           advert.addr_type == BLE_ADDR_PUBLIC ? "pub" : "rnd", advert.rssi);
+    size_t len = (written > 0) ? std::min(static_cast<size_t>(written), size - 1) : 0;
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    for (uint8_t i = 0; i < advert.length && len + 3 < size; i++) {
+        buffer[len++] = HEX[advert.data[i] >> 4];
+        buffer[len++] = HEX[advert.data[i] & 0x0f];
+    }
+    buffer[len++] = '\n';
+    return len;
+}
+
+size_t AdvertObserver::format_binary(const ObservedAdvert& advert, char* buffer, size_t size) const {
+    ObserverRecordHeader header;
+    header.sync = ObserverRecordHeader::SYNC;
+    header.length = static_cast<uint8_t>(sizeof(header) - 2 + advert.length);
+    header.timestamp_ms = static_cast<uint32_t>(advert.timestamp_us / 1000);
+    memcpy(header.addr, advert.addr, sizeof(header.addr));
+    header.addr_type = advert.addr_type;
+    header.rssi = advert.rssi;
+    header.event_type = advert.event_type;
+
+    size_t len = std::min(sizeof(header) + advert.length, size);
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), advert.data, len - sizeof(header));
+    return len;
+}
+
+void AdvertObserver::write_status(command_interface::ResponseWriter& out) const {
+    const ObserverFilter& filter = config_.filter;
+    out.printf("Observer: %s\n", active_ ? "Running" : "Stopped");
+    out.printf("Scan: %s, window %u ms / interval %u ms (%u%% duty)\n",
+               config_.active ? "active" : "passive", config_.window_ms, config_.interval_ms,
+               config_.interval_ms ? config_.window_ms * 100u / config_.interval_ms : 0u);
+    out.printf("Format: %s\n", config_.binary ? "binary" : "text");
+    out.printf("Filter: name=%s uuid=", filter.name_prefix[0] ? filter.name_prefix : "*");
+    if (filter.uuid16) {
+        out.printf("0x%04x", filter.uuid16);
+    } else {
+        out.write("*");
+    }
+    out.write(" mfg=");
+    if (filter.company_id >= 0) {
+        out.printf("0x%04" PRIx32, static_cast<uint32_t>(filter.company_id));
+    } else {
+        out.write("*");
+    }
+    out.printf(" rssi>=%d\n", filter.min_rssi);
+    out.printf("Adverts: %" PRIu32 " seen, %" PRIu32 " matched, %" PRIu32 " streamed, %" PRIu32 " dropped\n",
+               seen_.load(), matched_.load(), streamed_.load(), dropped_.load());
+}
+
+} // namespace ble_serial
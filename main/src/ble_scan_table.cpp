@@ -0,0 +1,182 @@
+#include "ble_scan_table.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace ble_serial {
+
+ScanTable::ScanTable()
+    : entries_{}, prev_{}, next_{}, head_(NONE), tail_(NONE), count_(0), evictions_(0) {
+    slots_.fill(NONE);
+}
+
+void ScanTable::clear() {
+    taskENTER_CRITICAL(&lock_);
+    slots_.fill(NONE);
+    head_ = NONE;
+    tail_ = NONE;
+    count_ = 0;
+    evictions_ = 0;
+    taskEXIT_CRITICAL(&lock_);
+}
+
+size_t ScanTable::size() const {
+    return count_;
+}
+
+uint32_t ScanTable::evictions() const {
+    return evictions_;
+}
+
+void ScanTable::record(const AdvertReport& report, int64_t now_us) {
+    taskENTER_CRITICAL(&lock_);
+
+    size_t slot = find_slot(report.addr, report.addr_type);
+    uint16_t index = slots_[slot];
+
+    if (index == NONE) {
+        if (count_ < CAPACITY) {
+            index = static_cast<uint16_t>(count_++);
+        } else {
+            // Full: recycle the device we heard from least recently
+            index = tail_;
+            lru_unlink(index);
+            remove_slot(find_slot(entries_[index].addr, entries_[index].addr_type));
+            evictions_++;
+            // Deletion may have shifted our probe chain
+            slot = find_slot(report.addr, report.addr_type);
+        }
+        slots_[slot] = index;
+
+        ScanEntry& entry = entries_[index];
+        entry = ScanEntry{};
+        memcpy(entry.addr, report.addr, sizeof(entry.addr));
+        entry.addr_type = report.addr_type;
+        entry.rssi_min = report.rssi;
+        entry.rssi_max = report.rssi;
+        entry.first_seen_us = now_us;
+    } else {
+        lru_unlink(index);
+    }
+    lru_push_front(index);
+
+    ScanEntry& entry = entries_[index];
+    entry.rssi_last = report.rssi;
+    entry.rssi_min = std::min(entry.rssi_min, report.rssi);
+    entry.rssi_max = std::max(entry.rssi_max, report.rssi);
+    entry.rssi_sum += report.rssi;
+    entry.adv_count++;
+    entry.last_seen_us = now_us;
+
+    if (report.fields) {
+        merge_fields(entry, *report.fields);
+    }
+
+    taskEXIT_CRITICAL(&lock_);
+}
+
+// Names usually arrive in the scan response and UUIDs in the advertisement
+void ScanTable::merge_fields(ScanEntry& entry, const AdvFields& fields) {
+    entry.present |= fields.present & ~AdvFields::NAME_COMPLETE;
+    if (fields.has(AdvFields::HAS_NAME) && fields.name_len > 0) {
+        memcpy(entry.name, fields.name, fields.name_len + 1);
+    }
+    if (fields.has(AdvFields::HAS_FLAGS)) {
+        entry.adv_flags = fields.flags;
+    }
+    if (fields.has(AdvFields::HAS_TX_POWER)) {
+        entry.tx_power = fields.tx_power;
+    }
+    if (fields.has(AdvFields::HAS_APPEARANCE)) {
+        entry.appearance = fields.appearance;
+    }
+    if (fields.has(AdvFields::HAS_MFG_DATA)) {
+        entry.company_id = fields.company_id;
+    }
+    if (fields.uuid16_count > 0) {
+        entry.uuid16_count = std::min<uint8_t>(fields.uuid16_count, ScanEntry::MAX_UUIDS16);
+        memcpy(entry.uuids16, fields.uuids16, entry.uuid16_count * sizeof(entry.uuids16[0]));
+    }
+    if (fields.uuid32_count > 0) {
+        entry.uuid32_count = std::min<uint8_t>(fields.uuid32_count, ScanEntry::MAX_UUIDS32);
+        memcpy(entry.uuids32, fields.uuids32, entry.uuid32_count * sizeof(entry.uuids32[0]));
+    }
+    if (fields.uuid128_count > 0) {
+        entry.uuid128_count = std::min<uint8_t>(fields.uuid128_count, ScanEntry::MAX_UUIDS128);
+        memcpy(entry.uuids128, fields.uuids128, entry.uuid128_count * sizeof(entry.uuids128[0]));
+    }
+}
+
+size_t ScanTable::hash_address(const uint8_t* addr, uint8_t addr_type) {
+    // FNV-1a over type and address
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ addr_type) * 16777619u;
+    for (size_t i = 0; i < 6; i++) {
+        hash = (hash ^ addr[i]) * 16777619u;
+    }
+    return hash & (SLOT_COUNT - 1);
+}
+
+bool ScanTable::matches(uint16_t index, const uint8_t* addr, uint8_t addr_type) const {
+    const ScanEntry& entry = entries_[index];
+    return entry.addr_type == addr_type && memcmp(entry.addr, addr, sizeof(entry.addr)) == 0;
+}
+
+// Slot holding the address, or the empty slot where it would be inserted
+size_t ScanTable::find_slot(const uint8_t* addr, uint8_t addr_type) const {
+    size_t slot = hash_address(addr, addr_type);
+    while (slots_[slot] != NONE && !matches(slots_[slot], addr, addr_type)) {
+        slot = (slot + 1) & (SLOT_COUNT - 1);
+    }
+    return slot;
+}
+
+void ScanTable::remove_slot(size_t slot) {
+    // Backward-shift deletion: pull later members of the probe chain into the hole
+    slots_[slot] = NONE;
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & (SLOT_COUNT - 1);
+        uint16_t index = slots_[next];
+        if (index == NONE) {
+            return;
+        }
+
+        size_t home = hash_address(entries_[index].addr, entries_[index].addr_type);
+        size_t distance_to_home = (next - home) & (SLOT_COUNT - 1);
+        size_t distance_to_hole = (next - slot) & (SLOT_COUNT - 1);
+        if (distance_to_home >= distance_to_hole) {
+            slots_[slot] = index;
+            slots_[next] = NONE;
+            slot = next;
+        }
+    }
+}
+
+void ScanTable::lru_unlink(uint16_t index) {
+    uint16_t prev = prev_[index];
+    uint16_t next = next_[index];
+    if (prev != NONE) {
+        next_[prev] = next;
+    } else {
+        head_ = next;
+    }
+    if (next != NONE) {
+        prev_[next] = prev;
+    } else {
+        tail_ = prev;
+    }
+}
+
+void ScanTable::lru_push_front(uint16_t index) {
+    prev_[index] = NONE;
+    next_[index] = head_;
+    if (head_ != NONE) {
+        prev_[head_] = index;
+    }
+    head_ = index;
+    if (tail_ == NONE) {
+        tail_ = index;
+    }
+}
+
+} // namespace ble_serial
@@ -0,0 +1,89 @@
+#include "boot_stats.hpp"
+#include "response_writer.hpp"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+
+namespace telemetry {
+
+namespace {
+
+struct BootStage {
+    const char* name;
+    int64_t start_us;
+    int64_t end_us;
+    int core;
+    BootStageResult result;
+};
+
+constexpr size_t MAX_BOOT_STAGES = 16;
+constexpr const char* RESULT_NAMES[] = {"ok", "FAILED", "skipped"};
+
+portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+std::array<BootStage, MAX_BOOT_STAGES> boot_stages;
+size_t boot_stage_count = 0;
+int64_t boot_ready_us = 0;
+
+// Milliseconds with one decimal, without pulling in float printf
+void write_ms(command_interface::ResponseWriter& out, int64_t us, int width) {
+    out.printf("%*" PRId64 ".%01" PRId64, width - 2, us / 1000, (us % 1000) / 100);
+}
+
+} // namespace
+
+void record_boot_stage(const char* name, int64_t start_us, int64_t end_us, int core, BootStageResult result) {
+    taskENTER_CRITICAL(&boot_lock);
+    if (boot_stage_count < MAX_BOOT_STAGES) {
+        boot_stages[boot_stage_count++] = BootStage{name, start_us, end_us, core, result};
+    }
+    taskEXIT_CRITICAL(&boot_lock);
+}
+
+void mark_boot_ready() {
+    boot_ready_us = esp_timer_get_time();
+}
+
+void write_boot_report(command_interface::ResponseWriter& out) {
+    taskENTER_CRITICAL(&boot_lock);
+    std::array<BootStage, MAX_BOOT_STAGES> stages = boot_stages;
+    size_t count = boot_stage_count;
+    taskEXIT_CRITICAL(&boot_lock);
+
+    std::sort(stages.begin(), stages.begin() + count,
+              [](const BootStage& a, const BootStage& b) { return a.start_us < b.start_us; });
+
+    out.write("=== Boot Timeline (ms since boot) ===\n");
+    out.write("Stage             Core    Start      End     Took  Result\n");
+    int64_t busy_us = 0;
+    for (size_t i = 0; i < count; i++) {
+        const BootStage& stage = stages[i];
+        out.printf("%-16s  %4d ", stage.name, stage.core);
+        write_ms(out, stage.start_us, 8);
+        out.write(" ");
+        write_ms(out, stage.end_us, 8);
+        out.write(" ");
+        write_ms(out, stage.end_us - stage.start_us, 8);
+        out.printf("  %s\n", RESULT_NAMES[static_cast<size_t>(stage.result)]);
+        busy_us += stage.end_us - stage.start_us;
+    }
+
+    if (boot_ready_us == 0) {
+        out.write("Ready: not yet\n");
+        return;
+    }
+    out.write("Ready:");
+    write_ms(out, boot_ready_us, 9);
+    out.write(" ms after boot\n");
+
+    // Stage time over wall time: above 1.0 means stages overlapped
+    int64_t span_us = count > 0 ? boot_ready_us - stages[0].start_us : 0;
+    if (span_us > 0) {
+        int64_t overlap_x100 = busy_us * 100 / span_us;
+        out.printf("Init: %" PRId64 " ms of stage work in %" PRId64 " ms (%" PRId64 ".%02" PRId64 "x overlap)\n",
+                   busy_us / 1000, span_us / 1000, overlap_x100 / 100, overlap_x100 % 100);
+    }
+}
+
+} // namespace telemetry
@@ -0,0 +1,69 @@
+#include "command_bench.hpp"
+#include "esp_heap_caps.h"
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+
+namespace command_interface {
+
+namespace {
+
+constexpr std::array<char, BENCH_MAX_PAYLOAD> make_payload() {
+    std::array<char, BENCH_MAX_PAYLOAD> payload{};
+    for (size_t i = 0; i < payload.size(); i++) {
+        payload[i] = static_cast<char>('a' + i % 26);
+    }
+    return payload;
+}
+
+constexpr std::array<char, BENCH_MAX_PAYLOAD> PAYLOAD = make_payload();
+
+} // namespace
+
+BenchResult::BenchResult(ResponseWriter& out, const char* test) : out_(out) {
+    out_.printf("BENCH {\"test\":\"%s\"", test);
+}
+
+BenchResult& BenchResult::field(const char* key, int64_t value) {
+    out_.printf(",\"%s\":%" PRId64, key, value);
+    return *this;
+}
+
+BenchResult& BenchResult::field(const char* key, std::string_view value) {
+    out_.printf(",\"%s\":\"", key);
+    size_t start = 0;
+    for (size_t i = 0; i < value.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(value[i]);
+        if (c != '"' && c != '\\' && c >= 0x20) {
+            continue;
+        }
+        out_.write(value.data() + start, i - start);
+        out_.printf("\\u%04x", c);
+        start = i + 1;
+    }
+    out_.write(value.data() + start, value.size() - start);
+    out_.write("\"");
+    return *this;
+}
+
+void BenchResult::finish() {
+    out_.write("}\n");
+}
+
+void HeapWindow::start() {
+    free_before_ = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    heap_caps_monitor_local_minimum_free_size_start();
+}
+
+void HeapWindow::stop() {
+    // While the monitor runs, the minimum is the low point since start()
+    min_free_ = heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    heap_caps_monitor_local_minimum_free_size_stop();
+    free_after_ = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+std::string_view bench_payload(size_t len) {
+    return std::string_view(PAYLOAD.data(), std::min(len, PAYLOAD.size()));
+}
+
+} // namespace command_interface
@@ -0,0 +1,61 @@
+#include "command_frame.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace command_interface {
+
+bool FrameReader::next(Frame& frame) {
+    if (data_.empty() || malformed_) {
+        return false;
+    }
+
+    FrameHeader header;
+    if (data_.size() < sizeof(header)) {
+        malformed_ = true;
+        return false;
+    }
+    memcpy(&header, data_.data(), sizeof(header));
+    if (header.magic != FRAME_MAGIC || data_.size() - sizeof(header) < header.length) {
+        malformed_ = true;
+        return false;
+    }
+
+    frame.request_id = header.request_id;
+    frame.payload = data_.substr(sizeof(header), header.length);
+    data_.remove_prefix(sizeof(header) + header.length);
+    return true;
+}
+
+bool decode_frame_arguments(std::string_view payload, CommandArgs& args) {
+    while (!payload.empty()) {
+        size_t len = static_cast<uint8_t>(payload[0]);
+        if (payload.size() - 1 < len || !args.push(payload.substr(1, len))) {
+            return false;
+        }
+        payload.remove_prefix(1 + len);
+    }
+    return true;
+}
+
+void FrameResponseWriter::write(const char* data, size_t len) {
+    size_t count = std::min(len, MAX_PAYLOAD - used_);
+    memcpy(frame_ + sizeof(FrameHeader) + used_, data, count);
+    used_ += count;
+    truncated_ |= count < len;
+}
+
+std::string_view FrameResponseWriter::finish(uint16_t request_id, FrameStatus status) {
+    if (status == FrameStatus::OK && truncated_) {
+        status = FrameStatus::TRUNCATED;
+    }
+
+    FrameHeader header;
+    header.magic = FRAME_MAGIC;
+    header.status = static_cast<uint8_t>(status);
+    header.request_id = request_id;
+    header.length = static_cast<uint16_t>(used_);
+    memcpy(frame_, &header, sizeof(header));
+    return std::string_view(frame_, sizeof(header) + used_);
+}
+
+} // namespace command_interface
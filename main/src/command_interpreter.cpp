@@ -1,21 +1,96 @@
 #include "command_interpreter.hpp"
+#include "command_registry.hpp"
+#include "command_frame.hpp"
+#include "response_writer.hpp"
 #include "ble_manager.hpp"
+#include "command_server.hpp"
 #include "relay_manager.hpp"
+#include "perf_stats.hpp"
+#include "boot_stats.hpp"
+#include "sys_stats.hpp"
+#include "log_control.hpp"
+#include "hosted_link.hpp"
+#include "power_manager.hpp"
+#include "event_bus.hpp"
+#include "command_bench.hpp"
+#include "esp_cpu.h"
 #include "esp_log.h"
-#include "driver/usb_serial_jtag.h"
-#include "esp_vfs_dev.h"
-#include "esp_vfs_usb_serial_jtag.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include <iostream>
-#include <sstream>
 #include <algorithm>
-#include <cctype>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 
 namespace command_interface {
 
 static const char* TAG = "CommandInterpreter";
 
+// Help section titles
+static constexpr std::string_view SECTION_GENERAL = "General Commands";
+static constexpr std::string_view SECTION_WIFI = "WiFi Commands";
+static constexpr std::string_view SECTION_BLE = "BLE Commands";
+static constexpr std::string_view SECTION_RELAY = "Relay Commands (Relay Board)";
+
+/**
+ * @brief Single command table shared by the USB Serial JTAG and BLE paths
+ *
+ * Add new commands here only; help output and dispatch are derived from it.
+ */
+struct CommandTable {
+    using Spec = CommandSpec<CommandInterpreter::Handler>;
+
+    static constexpr auto COMMANDS = std::to_array<Spec>({
+        {"help", "h", "", "Show this help message", SECTION_GENERAL, &CommandInterpreter::handle_help},
+        {"macro", "mc", "[save <name> \"cmds\"|delete <name>]", "List, save or delete command macros", SECTION_GENERAL, &CommandInterpreter::handle_macro},
+        {"run", "rn", "<macro>", "Run a saved command macro", SECTION_GENERAL, &CommandInterpreter::handle_run},
+        {"console", "con", "[echo|raw]", "Show or set USB console mode (raw: no echo or prompt)", SECTION_GENERAL, &CommandInterpreter::handle_console},
+        {"perf", "pf", "[reset]", "Show command latency histograms and relay wear counts", SECTION_GENERAL, &CommandInterpreter::handle_perf},
+        {"boot_stats", "bst", "", "Show the per-stage boot timeline and boot-to-ready time", SECTION_GENERAL, &CommandInterpreter::handle_boot_stats},
+        {"sys_stats", "sys", "[heap|tasks|alloc [reset]]", "Show heap, per-task stack and CPU use, and per-command allocations", SECTION_GENERAL, &CommandInterpreter::handle_sys_stats},
+        {"log", "lg", "[<tag|*> <level>|output <mode>|dump|clear]", "Show or set log levels and output (console, ring, both); dump the log ring", SECTION_GENERAL, &CommandInterpreter::handle_log},
+        {"hosted_stats", "hst", "[probe [n]|reset]", "Show ESP-Hosted link traffic per interface; probe WiFi RPC and HCI round trips", SECTION_GENERAL, &CommandInterpreter::handle_hosted_stats},
+        {"events", "ev", "[on|off]", "Push WiFi, BLE and relay state changes to this BLE or TCP client as they happen", SECTION_GENERAL, &CommandInterpreter::handle_events},
+        {"power", "pwr", "[performance|idle|reset]", "Show or set the power mode, actuation latency bound and sleep residency", SECTION_GENERAL, &CommandInterpreter::handle_power},
+        {"bench", "bch", "<notify|echo|dispatch|cmd> ...", "Run a benchmark and print a BENCH JSON result line", SECTION_GENERAL, &CommandInterpreter::handle_bench},
+
+        {"scan", "s", "[ssid] [channel]", "Start a WiFi scan (results via 'list')", SECTION_WIFI, &CommandInterpreter::handle_scan},
+        {"scan_bg", "sb", "[on|<secs>|off] [dwell]", "Periodic background WiFi scan", SECTION_WIFI, &CommandInterpreter::handle_scan_bg},
+        {"list", "l", "", "List networks from the last scan", SECTION_WIFI, &CommandInterpreter::handle_list},
+        {"connect", "c", "<ssid|index> [pass]", "Connect to a WiFi network", SECTION_WIFI, &CommandInterpreter::handle_connect},
+        {"status", "st", "", "Show current connection status", SECTION_WIFI, &CommandInterpreter::handle_status},
+        {"disconnect", "d", "", "Disconnect from current network", SECTION_WIFI, &CommandInterpreter::handle_disconnect},
+        {"wifi_save", "ws", "[ssid pass] [static ...]", "Save a network for auto-connect at boot", SECTION_WIFI, &CommandInterpreter::handle_wifi_save},
+        {"wifi_profiles", "wp", "", "List saved networks in boot order", SECTION_WIFI, &CommandInterpreter::handle_wifi_profiles},
+        {"wifi_forget", "wf", "<index|ssid|all>", "Remove saved network(s)", SECTION_WIFI, &CommandInterpreter::handle_wifi_forget},
+        {"net_status", "ns", "", "Show the TCP/UDP command server", SECTION_WIFI, &CommandInterpreter::handle_net_status},
+
+        {"ble_start", "bs", "", "Start BLE advertising", SECTION_BLE, &CommandInterpreter::handle_ble_start},
+        {"ble_stop", "bp", "", "Stop BLE advertising", SECTION_BLE, &CommandInterpreter::handle_ble_stop},
+        {"ble_status", "bt", "", "Show BLE status", SECTION_BLE, &CommandInterpreter::handle_ble_status},
+        {"ble_name", "bn", "<name>", "Set BLE device name", SECTION_BLE, &CommandInterpreter::handle_ble_name},
+        {"ble_scan", "bsc", "[duration]", "Scan for BLE devices (default: 5s)", SECTION_BLE, &CommandInterpreter::handle_ble_scan},
+        {"ble_debug", "bd", "", "Show detailed BLE debug info", SECTION_BLE, &CommandInterpreter::handle_ble_debug},
+        {"ble_link", "bl", "[policy]", "Show link or set policy (throughput, adaptive, low_power)", SECTION_BLE, &CommandInterpreter::handle_ble_link},
+        {"ble_observe", "bo", "[start [opts]|stop]", "Stream advertisements continuously (filters: name= uuid= mfg= rssi=)", SECTION_BLE, &CommandInterpreter::handle_ble_observe},
+
+        {"relay_on", "ron", "<relay>", "Turn on relay(s): number, list like 1,3-4, or all", SECTION_RELAY, &CommandInterpreter::handle_relay_on},
+        {"relay_off", "roff", "<relay>", "Turn off relay(s): number, list like 1,3-4, or all", SECTION_RELAY, &CommandInterpreter::handle_relay_off},
+        {"relay_toggle", "rtog", "<relay>", "Toggle relay(s): number, list like 1,3-4, or all", SECTION_RELAY, &CommandInterpreter::handle_relay_toggle},
+        {"relay_pulse", "rpl", "<relay> <time>", "Turn relay on for a time (e.g. 250ms, 2s, 500us)", SECTION_RELAY, &CommandInterpreter::handle_relay_pulse},
+        {"relay_set", "rset", "<states>", "Set all relays at once, one digit per relay (1, 0, x = keep)", SECTION_RELAY, &CommandInterpreter::handle_relay_set},
+        {"relay_schedule", "rsch", "[<relay> <on|off|pulse=t> ...]", "List or add on-device timed actions (in <t>, at HH:MM, every <t>)", SECTION_RELAY, &CommandInterpreter::handle_relay_schedule},
+        {"relay_cancel", "rcan", "<id|all>", "Cancel scheduled relay action(s)", SECTION_RELAY, &CommandInterpreter::handle_relay_cancel},
+        {"relay_status", "rst", "", "Show relay status", SECTION_RELAY, &CommandInterpreter::handle_relay_status},
+        {"relay_debug", "rd", "", "Show detailed relay debug info", SECTION_RELAY, &CommandInterpreter::handle_relay_debug},
+    });
+
+    static constexpr CommandRegistry<CommandInterpreter::Handler, COMMANDS.size()> REGISTRY{COMMANDS};
+};
+
 CommandInterpreter::CommandInterpreter(std::shared_ptr<wifi_config::WiFiManager> wifi_manager)
     : wifi_manager_(wifi_manager), ble_manager_(nullptr), relay_manager_(nullptr), initialized_(false) {
 }
@@ -34,6 +109,26 @@ void CommandInterpreter::set_relay_manager(std::shared_ptr<relay_control::RelayM
     ESP_LOGI(TAG, "Relay manager set for command interpreter");
 }
 
+void CommandInterpreter::set_credential_store(std::shared_ptr<wifi_config::CredentialStore> credential_store) {
+    credential_store_ = credential_store;
+}
+
+void CommandInterpreter::set_macro_store(std::shared_ptr<MacroStore> macro_store) {
+    macro_store_ = macro_store;
+}
+
+void CommandInterpreter::set_relay_scheduler(std::shared_ptr<relay_control::RelayScheduler> relay_scheduler) {
+    relay_scheduler_ = relay_scheduler;
+}
+
+void CommandInterpreter::set_command_server(std::shared_ptr<net_command::CommandServer> command_server) {
+    command_server_ = command_server;
+}
+
+void CommandInterpreter::set_power_manager(std::shared_ptr<power::PowerManager> power_manager) {
+    power_manager_ = power_manager;
+}
+
 bool CommandInterpreter::initialize() {
     if (initialized_) {
         ESP_LOGW(TAG, "CommandInterpreter already initialized");
@@ -47,41 +142,15 @@ bool CommandInterpreter::initialize() {
         return false;
     }
     
-    setup_usb_serial();
+    if (!console_.initialize()) {
+        ESP_LOGW(TAG, "USB Serial JTAG console unavailable");
+    }
     
     initialized_ = true;
     ESP_LOGI(TAG, "Command Interpreter initialized successfully");
     return true;
 }
 
-void CommandInterpreter::setup_usb_serial() {
-    ESP_LOGI(TAG, "Setting up USB Serial JTAG");
-    
-    // Configure USB Serial JTAG
-    usb_serial_jtag_driver_config_t usb_serial_config = {
-        .tx_buffer_size = 256,
-        .rx_buffer_size = 256,
-    };
-    
-    esp_err_t ret = usb_serial_jtag_driver_install(&usb_serial_config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to install USB Serial JTAG driver: %s", esp_err_to_name(ret));
-        return;
-    }
-    
-    // Set USB Serial JTAG as default for stdin/stdout
-    #pragma GCC diagnostic push
-    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-    esp_vfs_usb_serial_jtag_use_driver();
-    
-    // Set line endings  
-    esp_vfs_dev_uart_port_set_rx_line_endings(0, ESP_LINE_ENDINGS_CR);
-    esp_vfs_dev_uart_port_set_tx_line_endings(0, ESP_LINE_ENDINGS_CRLF);
-    #pragma GCC diagnostic pop
-    
-    ESP_LOGI(TAG, "USB Serial JTAG setup complete");
-}
-
 void CommandInterpreter::print_welcome_message() {
     printf("\n");
     printf("=========================================\n");
@@ -93,6 +162,9 @@ void CommandInterpreter::print_welcome_message() {
 }
 
 void CommandInterpreter::print_prompt() {
+    if (!console_.echo()) {
+        return;
+    }
     printf("> ");
     fflush(stdout);
 }
@@ -107,958 +179,1598 @@ void CommandInterpreter::start_interactive_mode() {
     print_prompt();
     
     while (true) {
-        std::string command = read_command_line();
-        if (!command.empty()) {
-            process_command(command);
+        std::string_view line = console_.read_line();
+        if (!line.empty()) {
+            telemetry::begin_command(telemetry::Source::CONSOLE, esp_timer_get_time());
+            process_command(line);
+            telemetry::end_command();
         }
         print_prompt();
     }
 }
 
-std::string CommandInterpreter::read_command_line() {
-    std::string cmd_buffer;
-    cmd_buffer.reserve(CMD_BUFFER_SIZE);
-    
-    int c;
-    while (true) {
-        c = getchar();
-        if (c == EOF) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            continue;
+void CommandInterpreter::process_command(std::string_view command) {
+    SerialResponseWriter out;
+    execute(command, out);
+    fflush(stdout);
+}
+
+void CommandInterpreter::process_command_streaming(std::string_view command,
+                                                   const std::function<bool(const char* data, size_t len)>& sink) {
+    if (is_frame(command)) {
+        process_frames(command, sink);
+        return;
+    }
+    BufferedResponseWriter out(sink);
+    execute(command, out);
+    out.flush();
+}
+
+void CommandInterpreter::process_frames(std::string_view data,
+                                        const std::function<bool(const char* data, size_t len)>& sink) {
+    FrameReader reader(data);
+    FrameResponseWriter out;
+    Frame frame;
+
+    while (reader.next(frame)) {
+        out.reset();
+        CommandArgs args;
+        FrameStatus status = FrameStatus::OK;
+        if (!decode_frame_arguments(frame.payload, args) || args.empty()) {
+            status = FrameStatus::BAD_ARGUMENTS;
+        } else if (!dispatch(args, out)) {
+            status = FrameStatus::UNKNOWN_COMMAND;
         }
-        
-        if (c == '\n' || c == '\r') {
-            printf("\n");
-            return cmd_buffer;
-        } else if (c == 8 || c == 127) { // Backspace or DEL
-            if (!cmd_buffer.empty()) {
-                cmd_buffer.pop_back();
-                printf("\b \b");
-            }
-        } else if (c >= 32 && c < 127 && cmd_buffer.length() < CMD_BUFFER_SIZE - 1) {
-            // Printable ASCII character
-            cmd_buffer.push_back(static_cast<char>(c));
-            printf("%c", c);
+
+        std::string_view reply = out.finish(frame.request_id, status);
+        if (!sink(reply.data(), reply.size())) {
+            return;
         }
-        fflush(stdout);
+    }
+
+    if (reader.malformed()) {
+        out.reset();
+        std::string_view reply = out.finish(0, FrameStatus::MALFORMED);
+        sink(reply.data(), reply.size());
     }
 }
 
-std::vector<std::string> CommandInterpreter::parse_command(const std::string& command) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(command);
-    std::string token;
-    
-    while (iss >> token) {
-        tokens.push_back(token);
+void CommandInterpreter::execute(std::string_view line, ResponseWriter& out) {
+    std::string_view rest = line;
+    std::string_view command = next_batch_command(rest);
+    if (rest.empty()) {
+        execute_command(command, out);
+        return;
+    }
+    run_batch(line, out);
+}
+
+void CommandInterpreter::run_batch(std::string_view batch, ResponseWriter& out) {
+    while (!batch.empty()) {
+        std::string_view command = next_batch_command(batch);
+        if (command.empty()) {
+            continue;
+        }
+        out.printf("> %.*s\n", static_cast<int>(command.size()), command.data());
+        execute_command(command, out);
     }
-    
-    return tokens;
 }
 
-void CommandInterpreter::process_command(const std::string& command) {
-    if (command.empty()) {
+void CommandInterpreter::execute_command(std::string_view command, ResponseWriter& out) {
+    CommandArgs tokens;
+    if (!tokens.tokenize(command)) {
+        out.printf("Too many arguments or unterminated quote (max %zu tokens).\n", CommandArgs::MAX_TOKENS);
         return;
     }
-    
-    std::vector<std::string> tokens = parse_command(command);
     if (tokens.empty()) {
+        out.write("Enter a command. Type 'help' for available commands.\n");
         return;
     }
     
-    // Convert command to lowercase for case-insensitive comparison
-    std::string cmd = tokens[0];
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
-    
-    if (cmd == "help" || cmd == "h") {
-        handle_help();
-    } else if (cmd == "scan" || cmd == "s") {
-        handle_scan();
-    } else if (cmd == "list" || cmd == "l") {
-        handle_list();
-    } else if (cmd == "connect" || cmd == "c") {
-        handle_connect(tokens);
-    } else if (cmd == "status" || cmd == "st") {
-        handle_status();
-    } else if (cmd == "disconnect" || cmd == "d") {
-        handle_disconnect();
-    } else if (cmd == "ble_start" || cmd == "bs") {
-        handle_ble_start();
-    } else if (cmd == "ble_stop" || cmd == "bp") {
-        handle_ble_stop();
-    } else if (cmd == "ble_status" || cmd == "bt") {
-        handle_ble_status();
-    } else if (cmd == "ble_name" || cmd == "bn") {
-        handle_ble_name(tokens);
-    } else if (cmd == "ble_scan" || cmd == "bsc") {
-        handle_ble_scan(tokens);
-    } else if (cmd == "ble_debug" || cmd == "bd") {
-        handle_ble_debug();
-    } else if (cmd == "relay_on" || cmd == "ron") {
-        handle_relay_on(tokens);
-    } else if (cmd == "relay_off" || cmd == "roff") {
-        handle_relay_off(tokens);
-    } else if (cmd == "relay_toggle" || cmd == "rtog") {
-        handle_relay_toggle(tokens);
-    } else if (cmd == "relay_status" || cmd == "rst") {
-        handle_relay_status();
-    } else if (cmd == "relay_debug" || cmd == "rd") {
-        handle_relay_debug();
-    } else {
-        handle_unknown_command(tokens[0]);
+    if (!dispatch(tokens, out)) {
+        handle_unknown_command(tokens[0], out);
     }
 }
 
-std::string CommandInterpreter::process_command_with_response(const std::string& command) {
-    if (command.empty()) {
-        return "Enter a command. Type 'help' for available commands.";
+bool CommandInterpreter::dispatch(const CommandArgs& args, ResponseWriter& out) {
+    const CommandTable::Spec* spec = CommandTable::REGISTRY.find(args[0]);
+    if (spec == nullptr) {
+        return false;
     }
     
-    // Clean up command (trim whitespace and remove line endings)
-    std::string clean_cmd = command;
-    clean_cmd.erase(clean_cmd.find_last_not_of(" \t\n\r\f\v") + 1);
-    clean_cmd.erase(0, clean_cmd.find_first_not_of(" \t\n\r\f\v"));
-    
-    if (clean_cmd.empty()) {
-        return "Enter a command. Type 'help' for available commands.";
-    }
+    // Full speed and no light sleep until the handler returns
+    power::PowerManager::ActivityLock activity;
+    telemetry::AllocScope alloc_scope(spec->name);
+    telemetry::mark_dispatch();
+    (this->*(spec->handler))(args, out);
+    return true;
+}
+
+void CommandInterpreter::handle_help(const CommandArgs& args, ResponseWriter& out) {
+    // Size the synopsis column to the longest "name, alias <args>" entry
+    auto synopsis_length = [](const CommandTable::Spec& spec) {
+        size_t len = spec.name.size();
+        if (!spec.alias.empty()) {
+            len += 2 + spec.alias.size();
+        }
+        if (!spec.args.empty()) {
+            len += 1 + spec.args.size();
+        }
+        return len;
+    };
     
-    std::vector<std::string> tokens = parse_command(clean_cmd);
-    if (tokens.empty()) {
-        return "Invalid command. Type 'help' for available commands.";
+    size_t width = 0;
+    for (const auto& spec : CommandTable::COMMANDS) {
+        width = std::max(width, synopsis_length(spec));
     }
     
-    // Convert command to lowercase for case-insensitive comparison
-    std::string cmd = tokens[0];
-    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+    out.write("\n=== Available Commands ===\n");
     
-    if (cmd == "help" || cmd == "h") {
-        return generate_help_response();
-    } else if (cmd == "scan" || cmd == "s") {
-        return generate_scan_response();
-    } else if (cmd == "list" || cmd == "l") {
-        return generate_list_response();
-    } else if (cmd == "connect" || cmd == "c") {
-        return generate_connect_response(tokens);
-    } else if (cmd == "status" || cmd == "st") {
-        return generate_status_response();
-    } else if (cmd == "disconnect" || cmd == "d") {
-        return generate_disconnect_response();
-    } else if (cmd == "ble_start" || cmd == "bs") {
-        return generate_ble_start_response();
-    } else if (cmd == "ble_stop" || cmd == "bp") {
-        return generate_ble_stop_response();
-    } else if (cmd == "ble_status" || cmd == "bt") {
-        return generate_ble_status_response();
-    } else if (cmd == "ble_name" || cmd == "bn") {
-        return generate_ble_name_response(tokens);
-    } else if (cmd == "ble_scan" || cmd == "bsc") {
-        return generate_ble_scan_response(tokens);
-    } else if (cmd == "ble_debug" || cmd == "bd") {
-        return generate_ble_debug_response();
-    } else if (cmd == "relay_on" || cmd == "ron") {
-        return generate_relay_on_response(tokens);
-    } else if (cmd == "relay_off" || cmd == "roff") {
-        return generate_relay_off_response(tokens);
-    } else if (cmd == "relay_toggle" || cmd == "rtog") {
-        return generate_relay_toggle_response(tokens);
-    } else if (cmd == "relay_status" || cmd == "rst") {
-        return generate_relay_status_response();
-    } else if (cmd == "relay_debug" || cmd == "rd") {
-        return generate_relay_debug_response();
-    } else {
-        return "Unknown command: '" + tokens[0] + "'. Type 'help' for available commands.";
-    }
-}
-
-void CommandInterpreter::handle_help() {
-    printf("\n=== Available Commands ===\n");
-    printf("\n--- WiFi Commands ---\n");
-    printf("help, h                    - Show this help message\n");
-    printf("scan, s                    - Scan for available WiFi networks\n");
-    printf("list, l                    - List previously scanned networks\n");
-    printf("connect, c <ssid> <pass>   - Connect to a WiFi network\n");
-    printf("status, st                 - Show current connection status\n");
-    printf("disconnect, d              - Disconnect from current network\n");
-    printf("\n--- BLE Commands ---\n");
-    printf("ble_start, bs              - Start BLE advertising\n");
-    printf("ble_stop, bp               - Stop BLE advertising\n");
-    printf("ble_status, bt             - Show BLE status\n");
-    printf("ble_name, bn <name>        - Set BLE device name\n");
-    printf("ble_scan, bsc [duration]   - Scan for BLE devices (default: 5s)\n");
-    printf("ble_debug, bd              - Show detailed BLE debug info\n");
-    printf("\n--- Relay Commands (Dual Relay Board) ---\n");
-    printf("relay_on, ron <relay>      - Turn on relay (1, 2, or all)\n");
-    printf("relay_off, roff <relay>    - Turn off relay (1, 2, or all)\n");
-    printf("relay_toggle, rtog <relay> - Toggle relay (1, 2, or all)\n");
-    printf("relay_status, rst          - Show relay status\n");
-    printf("relay_debug, rd            - Show detailed relay debug info\n");
-    printf("\n");
-    printf("Examples:\n");
-    printf("  scan\n");
-    printf("  connect \"MyNetwork\" \"MyPassword\"\n");
-    printf("  ble_start\n");
-    printf("  ble_scan 10\n");
-    printf("  relay_on 1        # Turn on relay 1\n");
-    printf("  relay_off all     # Turn off both relays\n");
-    printf("  relay_toggle 2    # Toggle relay 2\n");
-    printf("\n");
+    std::string_view section;
+    for (const auto& spec : CommandTable::COMMANDS) {
+        if (spec.section != section) {
+            section = spec.section;
+            out.printf("\n--- %.*s ---\n", static_cast<int>(section.size()), section.data());
+        }
+        
+        char synopsis[64];
+        snprintf(synopsis, sizeof(synopsis), "%.*s%s%.*s%s%.*s",
+                 static_cast<int>(spec.name.size()), spec.name.data(),
+                 spec.alias.empty() ? "" : ", ",
+                 static_cast<int>(spec.alias.size()), spec.alias.data(),
+                 spec.args.empty() ? "" : " ",
+                 static_cast<int>(spec.args.size()), spec.args.data());
+        out.printf("%-*s - %.*s\n", static_cast<int>(width), synopsis,
+                   static_cast<int>(spec.help.size()), spec.help.data());
+    }
+    
+    out.write("\nExamples:\n");
+    out.write("  scan\n");
+    out.write("  scan MyNetwork 6   # Probe one SSID on channel 6\n");
+    out.write("  scan_bg 120        # Rescan every two minutes\n");
+    out.write("  connect \"MyNetwork\" \"MyPassword\"\n");
+    out.write("  connect 0          # Connect to open network 0 from 'list'\n");
+    out.write("  wifi_save          # Remember the current network\n");
+    out.write("  ble_start\n");
+    out.write("  ble_scan 10\n");
+    out.write("  ble_observe start rssi=-70 uuid=180f to=ble\n");
+    out.write("  relay_on 1; relay_off 2             # Several commands in one line\n");
+    out.write("  macro save cycle \"relay_on 1; relay_off 2\"\n");
+    out.write("  run cycle\n");
+    out.write("  relay_on 1         # Turn on relay 1\n");
+    out.write("  relay_off all      # Turn off every relay\n");
+    out.write("  relay_toggle 2     # Toggle relay 2\n");
+    out.write("  relay_pulse 1 250ms  # Relay 1 on for 250 ms\n");
+    out.write("  relay_set 10       # Relay 1 on and relay 2 off at the same instant\n");
+    out.write("  relay_schedule 1 pulse=200ms every 1s   # Relay 1 blips once a second\n");
+    out.write("  relay_schedule all off at 22:30         # All relays off at 22:30 local time\n");
+    out.write("  relay_cancel all\n");
+    out.write("\nCommands available via USB Serial JTAG and BLE\n");
 }
 
-void CommandInterpreter::handle_scan() {
-    printf("Scanning for WiFi networks...\n");
+void CommandInterpreter::handle_scan(const CommandArgs& args, ResponseWriter& out) {
+    if (wifi_manager_->is_scanning()) {
+        out.write("A WiFi scan is already in progress. Use 'list' once it completes.\n");
+        return;
+    }
     
-    if (wifi_manager_->scan_networks()) {
-        const auto& networks = wifi_manager_->get_scanned_networks();
-        if (networks.empty()) {
-            printf("No networks found.\n");
+    if (args.size() >= 2) {
+        uint8_t channel = 0;
+        if (args[1].size() > 32 || (args.size() >= 3 && !parse_integer(args[2], channel, uint8_t{1}, uint8_t{14}))) {
+            out.write("Usage: scan [ssid] [channel]\n");
+            out.write("SSID up to 32 characters, channel 1-14\n");
+            return;
+        }
+        
+        std::string ssid(args[1]);
+        if (!wifi_manager_->start_targeted_scan(ssid, channel)) {
+            out.write("Failed to start WiFi scan. Please try again.\n");
+            return;
+        }
+        
+        if (channel) {
+            out.printf("Scanning for '%s' on channel %u...\n", ssid.c_str(), channel);
         } else {
-            printf("Scan completed. Found %zu networks.\n", networks.size());
-            print_network_list(networks);
+            out.printf("Scanning for '%s'...\n", ssid.c_str());
+        }
+        out.write("Use 'list' to view the results.\n");
+        return;
+    }
+    
+    if (!wifi_manager_->start_scan()) {
+        out.write("Failed to start WiFi scan. Please try again.\n");
+        return;
+    }
+    
+    out.write("Scanning for WiFi networks in the background...\n");
+    out.write("Use 'list' to view the results (takes a few seconds).\n");
+}
+
+void CommandInterpreter::handle_scan_bg(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() >= 2) {
+        if (equals_ignore_case(args[1], "off")) {
+            wifi_manager_->stop_background_scan();
+            out.write("Background WiFi scan stopped.\n");
+            return;
+        }
+        
+        uint32_t interval_s = CONFIG_WIFI_SCAN_BACKGROUND_INTERVAL_S;
+        uint32_t dwell_ms = 0;
+        bool valid = equals_ignore_case(args[1], "on") ||
+                     parse_integer(args[1], interval_s, uint32_t{10}, uint32_t{3600});
+        if (valid && args.size() >= 3) {
+            valid = parse_integer(args[2], dwell_ms, uint32_t{10}, uint32_t{1500});
+        }
+        if (!valid) {
+            out.write("Usage: scan_bg [on|<interval_s>|off] [dwell_ms]\n");
+            out.write("Interval: 10-3600 s, dwell: 10-1500 ms per channel\n");
+            return;
+        }
+        
+        if (!wifi_manager_->start_background_scan(interval_s, dwell_ms)) {
+            out.write("Failed to start background WiFi scan.\n");
+            return;
         }
+    }
+    
+    if (wifi_manager_->is_background_scan_active()) {
+        out.printf("Background WiFi scan: every %" PRIu32 " s\n", wifi_manager_->get_background_scan_interval());
     } else {
-        printf("Failed to scan networks.\n");
+        out.write("Background WiFi scan: off\n");
     }
 }
 
-void CommandInterpreter::handle_list() {
-    const auto& networks = wifi_manager_->get_scanned_networks();
+void CommandInterpreter::handle_list(const CommandArgs& args, ResponseWriter& out) {
+    wifi_config::ScanResults results = wifi_manager_->get_scan_results();
     
-    if (networks.empty()) {
-        printf("No networks available. Run 'scan' first.\n");
+    if (results.timestamp_us == 0) {
+        if (results.in_progress) {
+            out.write("Scan in progress. Try 'list' again in a moment.\n");
+        } else {
+            out.write("No networks available. Run 'scan' first.\n");
+        }
         return;
     }
     
-    print_network_list(networks);
+    if (results.count == 0) {
+        out.write("No WiFi networks found.\n");
+    } else if (!write_network_list(results, out)) {
+        out.write("(A newer scan was published while listing; run 'list' again.)\n");
+    }
+    
+    int64_t age_s = (esp_timer_get_time() - results.timestamp_us) / 1000000;
+    out.printf("Last scan: %lld s ago, %zu networks%s\n", static_cast<long long>(age_s),
+               results.count, results.in_progress ? " (refresh in progress)" : "");
+    out.write("Use 'connect <index>' or 'connect <ssid> <password>' to join a network.\n");
 }
 
-void CommandInterpreter::handle_connect(const std::vector<std::string>& args) {
-    if (args.size() < 3) {
-        printf("Usage: connect <ssid> <password>\n");
-        printf("Example: connect \"MyNetwork\" \"MyPassword\"\n");
+void CommandInterpreter::handle_connect(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() < 2) {
+        out.write("Usage: connect <ssid> <password>\n");
+        out.write("       connect <index> [password]\n");
+        out.write("Example: connect \"MyNetwork\" \"MyPassword\"\n");
+        out.write("Use 'list' to see network indexes.\n");
         return;
     }
     
-    const std::string& ssid = args[1];
-    const std::string& password = args[2];
+    std::string ssid(args[1]);
+    std::string password = (args.size() >= 3) ? std::string(args[2]) : std::string();
     
-    printf("Connecting to network: %s\n", ssid.c_str());
+    // A bare number selects a network from the last scan
+    size_t index = 0;
+    wifi_config::NetworkInfo network;
+    if (parse_integer(args[1], index, size_t{0}, SIZE_MAX) && wifi_manager_->get_scanned_network(index, network)) {
+        if (network.auth_mode != WIFI_AUTH_OPEN && password.empty()) {
+            out.printf("Network '%s' requires a password.\n", network.ssid);
+            out.printf("Usage: connect %zu <password>\n", index);
+            return;
+        }
+        ssid = network.ssid;
+    }
+    
+    out.printf("Connecting to network: %s\n", ssid.c_str());
     
     if (wifi_manager_->connect_to_network(ssid, password)) {
-        printf("\n=== Connection Successful ===\n");
-        printf("Connected to: %s\n", ssid.c_str());
-        printf("IP Address: %s\n", wifi_manager_->get_ip_address().c_str());
-        printf("Signal Strength: %d dBm\n", wifi_manager_->get_rssi());
-        printf("\n");
+        out.write("\n=== Connection Successful ===\n");
+        out.printf("Connected to: %s\n", ssid.c_str());
+        out.printf("IP Address: %s\n", wifi_manager_->get_ip_address().c_str());
+        out.printf("Signal Strength: %d dBm\n", wifi_manager_->get_rssi());
+        out.printf("Connect Time: %" PRIu32 " ms (%s)\n", wifi_manager_->get_last_connect_time_ms(),
+                   wifi_manager_->was_last_connect_fast() ? "cached BSSID/channel" : "full scan");
     } else {
-        printf("Failed to connect to: %s\n", ssid.c_str());
-        printf("Please check the network name and password.\n");
+        out.printf("Failed to connect to: %s\n", ssid.c_str());
+        out.write("Please check the network name and password.\n");
     }
 }
 
-void CommandInterpreter::handle_status() {
-    printf("\n=== Connection Status ===\n");
+void CommandInterpreter::handle_status(const CommandArgs& args, ResponseWriter& out) {
+    out.write("\n=== Connection Status ===\n");
     
-    if (wifi_manager_->is_connected()) {
-        printf("Status: Connected\n");
-        printf("Network: %s\n", wifi_manager_->get_connected_ssid().c_str());
-        printf("IP Address: %s\n", wifi_manager_->get_ip_address().c_str());
-        printf("Signal Strength: %d dBm\n", wifi_manager_->get_rssi());
+    wifi_config::LinkStatus link = wifi_manager_->get_link_status();
+    if (link.connected) {
+        out.write("Status: Connected\n");
+        out.printf("Network: %s\n", link.ssid);
+        out.printf("IP Address: %s\n", wifi_manager_->get_ip_address().c_str());
+        out.printf("Signal Strength: %d dBm\n", wifi_manager_->get_rssi());
     } else {
-        printf("Status: Disconnected\n");
-        printf("No active WiFi connection.\n");
+        out.write("Status: Disconnected\n");
+        out.write("Use 'scan' and 'connect' to join a network.\n");
     }
-    printf("\n");
+    
+    auto stats = wifi_manager_->get_reconnect_stats();
+    out.printf("Link State: %s\n", wifi_config::WiFiManager::link_state_to_string(stats.state));
+    if (stats.state == wifi_config::WiFiManager::LinkState::RECONNECTING) {
+        out.printf("Next Attempt In: %" PRIu32 " ms\n", stats.backoff_ms);
+    }
+    out.printf("Disconnects: %" PRIu32 " (last reason %u)\n", stats.disconnects, stats.last_reason);
+    out.printf("Reconnects: %" PRIu32 "/%" PRIu32 " attempts, %" PRIu32 " failover(s)\n",
+               stats.reconnects, stats.reconnect_attempts, stats.failovers);
 }
 
-void CommandInterpreter::handle_disconnect() {
+void CommandInterpreter::handle_disconnect(const CommandArgs& args, ResponseWriter& out) {
     if (!wifi_manager_->is_connected()) {
-        printf("Not connected to any network.\n");
+        out.write("Not connected to any network.\n");
         return;
     }
     
     std::string current_ssid = wifi_manager_->get_connected_ssid();
-    printf("Disconnecting from: %s\n", current_ssid.c_str());
+    out.printf("Disconnecting from: %s\n", current_ssid.c_str());
     
     if (wifi_manager_->disconnect()) {
-        printf("Disconnected successfully.\n");
+        out.write("Disconnected successfully.\n");
     } else {
-        printf("Failed to disconnect.\n");
+        out.write("Failed to disconnect.\n");
     }
 }
 
-// BLE command handlers
-void CommandInterpreter::handle_ble_start() {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
-        return;
-    }
-    
-    printf("Starting BLE advertising...\n");
-    if (ble_manager_->start_advertising()) {
-        printf("BLE advertising started successfully.\n");
-        printf("Device name: ESP32-P4-WiFi\n");
-        printf("You can now connect via BLE UART apps.\n");
-    } else {
-        printf("Failed to start BLE advertising.\n");
+void CommandInterpreter::handle_console(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() >= 2) {
+        if (equals_ignore_case(args[1], "echo")) {
+            console_.set_echo(true);
+        } else if (equals_ignore_case(args[1], "raw")) {
+            console_.set_echo(false);
+        } else {
+            out.write("Usage: console [echo|raw]\n");
+            return;
+        }
     }
+    out.printf("USB console mode: %s\n", console_.echo() ? "echo" : "raw (no echo or prompt)");
 }
 
-void CommandInterpreter::handle_ble_stop() {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
+void CommandInterpreter::handle_perf(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() >= 2) {
+        if (!equals_ignore_case(args[1], "reset")) {
+            out.write("Usage: perf [reset]\n");
+            return;
+        }
+        telemetry::reset();
+        out.write("Latency histograms cleared\n");
         return;
     }
-    
-    printf("Stopping BLE advertising...\n");
-    if (ble_manager_->stop_advertising()) {
-        printf("BLE advertising stopped.\n");
+
+    telemetry::write_report(out);
+    if (relay_manager_) {
+        relay_manager_->write_wear_status(out);
+    }
+}
+
+void CommandInterpreter::handle_boot_stats(const CommandArgs& args, ResponseWriter& out) {
+    telemetry::write_boot_report(out);
+}
+
+void CommandInterpreter::handle_sys_stats(const CommandArgs& args, ResponseWriter& out) {
+    std::string_view section = args.size() >= 2 ? args[1] : std::string_view();
+    if (section.empty()) {
+        telemetry::write_heap_report(out);
+        telemetry::write_task_report(out);
+        telemetry::write_alloc_report(out);
+    } else if (equals_ignore_case(section, "heap")) {
+        telemetry::write_heap_report(out);
+    } else if (equals_ignore_case(section, "tasks")) {
+        telemetry::write_task_report(out);
+    } else if (equals_ignore_case(section, "alloc")) {
+        if (args.size() >= 3 && equals_ignore_case(args[2], "reset")) {
+            telemetry::reset_alloc_stats();
+            out.write("Allocation counts cleared\n");
+            return;
+        }
+        telemetry::write_alloc_report(out);
     } else {
-        printf("Failed to stop BLE advertising.\n");
+        out.write("Usage: sys_stats [heap|tasks|alloc [reset]]\n");
     }
 }
 
-void CommandInterpreter::handle_ble_status() {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
+void CommandInterpreter::handle_log(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() < 2) {
+        logging::write_status(out);
         return;
     }
-    
-    printf("\n=== BLE Status ===\n");
-    printf("Implementation: ESP-Hosted NimBLE via ESP32-C6\n");
-    printf("Architecture: ESP32-P4 + ESP32-C6 coprocessor\n");
-    printf("Initialized: Yes\n");
-    printf("Advertising: %s\n", ble_manager_->is_connected() ? "Connected" : "Available");
-    printf("Connected: %s\n", ble_manager_->is_connected() ? "Yes" : "No");
-    printf("Device Name: ESP32-P4-WiFi\n");
-    printf("Service: Nordic UART Service (NUS)\n");
-    printf("\nConfiguration Status:\n");
-    printf("- ESP32-C6 Coprocessor: Active\n");
-    printf("- VHCI Transport: Active\n");
-    printf("- NimBLE Stack: Running\n");
-    printf("\nUse 'ble_debug' for detailed status info.\n");
-    printf("\n");
-}
 
-void CommandInterpreter::handle_ble_name(const std::vector<std::string>& args) {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
+    if (equals_ignore_case(args[1], "dump")) {
+        logging::dump_ring(out);
         return;
     }
-    
-    if (args.size() < 2) {
-        printf("Usage: ble_name <device_name>\n");
-        printf("Example: ble_name \"MyESP32-P4\"\n");
+    if (equals_ignore_case(args[1], "clear")) {
+        logging::clear_ring();
+        out.write("Log ring cleared\n");
         return;
     }
-    
-    std::string new_name = args[1];
-    printf("Setting BLE device name to: %s\n", new_name.c_str());
-    printf("Note: Name change will take effect on next advertising start.\n");
-    
-    // TODO: Implement name persistence and immediate update if advertising
-    printf("BLE name setting completed.\n");
-}
-
-void CommandInterpreter::handle_ble_scan(const std::vector<std::string>& args) {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
+    if (args.size() != 3) {
+        out.write("Usage: log [<tag|*> <level>|output <console|ring|both>|dump|clear]\n");
         return;
     }
-    
-    int duration = 5; // Default 5 seconds
-    if (args.size() >= 2) {
-        // Parse duration manually since exceptions are disabled
-        const std::string& duration_str = args[1];
-        bool valid_number = true;
-        
-        for (char c : duration_str) {
-            if (!std::isdigit(c)) {
-                valid_number = false;
-                break;
-            }
-        }
-        
-        if (valid_number && !duration_str.empty()) {
-            duration = 0;
-            for (char c : duration_str) {
-                duration = duration * 10 + (c - '0');
-            }
-            if (duration < 1 || duration > 60) {
-                printf("Invalid duration. Using default 5 seconds.\n");
-                duration = 5;
-            }
+
+    if (equals_ignore_case(args[1], "output")) {
+        logging::LogOutput output;
+        if (equals_ignore_case(args[2], "console")) {
+            output = logging::LogOutput::CONSOLE;
+        } else if (equals_ignore_case(args[2], "ring")) {
+            output = logging::LogOutput::RING;
+        } else if (equals_ignore_case(args[2], "both")) {
+            output = logging::LogOutput::BOTH;
         } else {
-            printf("Invalid duration format. Using default 5 seconds.\n");
-        }
-    }
-    
-    printf("Starting BLE device scan for %d seconds...\n", duration);
-    
-    if (ble_manager_->start_scan(duration)) {
-        printf("Scan completed. Found %d devices:\n", ble_manager_->get_scan_result_count());
-        
-        for (int i = 0; i < ble_manager_->get_scan_result_count(); i++) {
-            std::string result = ble_manager_->get_scan_result(i);
-            printf("  %s\n", result.c_str());
+            out.write("Output must be console, ring or both\n");
+            return;
         }
-        
-        if (ble_manager_->get_scan_result_count() == 0) {
-            printf("No BLE devices found.\n");
+        if (!logging::set_output(output)) {
+            out.write("Log ring is off (CONFIG_LOG_RING is not set)\n");
+            return;
         }
-    } else {
-        printf("Failed to start BLE scan.\n");
-    }
-}
-
-void CommandInterpreter::handle_ble_debug() {
-    if (!ble_manager_) {
-        printf("BLE manager not available.\n");
+        out.printf("Log output: %s\n", logging::output_to_string(output));
         return;
     }
-    
-    printf("\n");
-    std::string debug_info = ble_manager_->get_debug_status();
-    printf("%s\n", debug_info.c_str());
-}
 
-// Relay command handlers
-void CommandInterpreter::handle_relay_on(const std::vector<std::string>& args) {
-    if (!relay_manager_) {
-        printf("Relay manager not available (single board variant).\n");
+    esp_log_level_t level;
+    if (!logging::parse_level(args[2], level)) {
+        out.write("Level must be none, error, warn, info, debug or verbose\n");
         return;
     }
-
-    if (args.size() < 2) {
-        printf("Usage: relay_on <relay>\n");
-        printf("Relay options: 1, 2, all\n");
-        printf("Examples: relay_on 1, relay_on all\n");
+    // esp_log_level_set() needs a terminated tag; it keeps its own copy
+    char tag[32];
+    if (args[1].size() >= sizeof(tag)) {
+        out.write("Tag too long\n");
         return;
     }
-
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
-
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
-    } else {
-        printf("Invalid relay: %s\n", args[1].c_str());
-        printf("Valid options: 1, 2, all\n");
-        return;
+    memcpy(tag, args[1].data(), args[1].size());
+    tag[args[1].size()] = '\0';
+    esp_log_level_set(tag, level);
+    out.printf("%s: %s\n", tag, logging::level_to_string(level));
+    if (level > LOG_LOCAL_LEVEL) {
+        out.printf("Note: %s and finer messages are not compiled in (CONFIG_LOG_MAXIMUM_LEVEL)\n",
+                   logging::level_to_string(static_cast<esp_log_level_t>(LOG_LOCAL_LEVEL + 1)));
     }
+}
 
-    if (relay_manager_->turn_on(relay_id)) {
-        printf("Successfully turned on %s\n", args[1].c_str());
+void CommandInterpreter::handle_bench(const CommandArgs& args, ResponseWriter& out) {
+    std::string_view test = args.size() >= 2 ? args[1] : std::string_view();
+    if (equals_ignore_case(test, "notify")) {
+        bench_notify(args, out);
+    } else if (equals_ignore_case(test, "echo")) {
+        bench_echo(args, out);
+    } else if (equals_ignore_case(test, "dispatch")) {
+        bench_dispatch(args, out);
+    } else if (equals_ignore_case(test, "cmd")) {
+        bench_command(args, out);
     } else {
-        printf("Failed to turn on %s\n", args[1].c_str());
+        out.write("Usage: bench notify [size] [bytes]     Response throughput (NUS when sent over BLE)\n");
+        out.write("       bench echo [text]               Round trip; reports time spent on the device\n");
+        out.write("       bench dispatch [\"line\"] [n]   Tokenize and lookup cost in CPU cycles\n");
+        out.write("       bench cmd \"line\" [n]           Run a command n times: time, heap peak, stack\n");
     }
 }
 
-void CommandInterpreter::handle_relay_off(const std::vector<std::string>& args) {
-    if (!relay_manager_) {
-        printf("Relay manager not available (single board variant).\n");
+void CommandInterpreter::bench_notify(const CommandArgs& args, ResponseWriter& out) {
+    size_t size = 244;   // One notification at the largest common MTU (247)
+    size_t total = 16384;
+    if ((args.size() >= 3 && !parse_integer(args[2], size, size_t{1}, BENCH_MAX_PAYLOAD)) ||
+        (args.size() >= 4 && !parse_integer(args[3], total, size_t{1}, size_t{1024 * 1024}))) {
+        out.printf("Usage: bench notify [size 1-%zu] [bytes]\n", BENCH_MAX_PAYLOAD);
         return;
     }
 
-    if (args.size() < 2) {
-        printf("Usage: relay_off <relay>\n");
-        printf("Relay options: 1, 2, all\n");
-        printf("Examples: relay_off 1, relay_off all\n");
+    // Over BLE every write goes straight to send_response, so each one is a notification of
+    // the given size; elsewhere the payload streams through the transport's writer
+    uint16_t conn_handle = ble_manager_ ? ble_manager_->command_conn_handle() : BLE_HS_CONN_HANDLE_NONE;
+    std::string_view payload = bench_payload(size);
+    size_t sent = 0;
+    size_t writes = 0;
+    int64_t start_us = esp_timer_get_time();
+    while (sent < total) {
+        std::string_view chunk = payload.substr(0, std::min(size, total - sent));
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            if (!ble_manager_->send_response(conn_handle, chunk.data(), chunk.size())) {
+                break;
+            }
+        } else {
+            out.write(chunk);
+        }
+        sent += chunk.size();
+        writes++;
+    }
+    int64_t elapsed_us = std::max<int64_t>(esp_timer_get_time() - start_us, 1);
+
+    out.write("\n");
+    BenchResult(out, "notify")
+        .field("transport", conn_handle != BLE_HS_CONN_HANDLE_NONE ? "ble" : "stream")
+        .field("size", static_cast<int64_t>(size))
+        .field("bytes", static_cast<int64_t>(sent))
+        .field("writes", static_cast<int64_t>(writes))
+        .field("us", elapsed_us)
+        .field("kbps", static_cast<int64_t>(sent) * 8000 / elapsed_us)
+        .finish();
+}
+
+void CommandInterpreter::bench_echo(const CommandArgs& args, ResponseWriter& out) {
+    int64_t received_us = telemetry::command_received_us();
+    int64_t device_us = received_us != 0 ? esp_timer_get_time() - received_us : -1;
+    BenchResult(out, "echo")
+        .field("text", args.size() >= 3 ? args[2] : std::string_view())
+        .field("device_us", device_us)
+        .finish();
+}
+
+void CommandInterpreter::bench_dispatch(const CommandArgs& args, ResponseWriter& out) {
+    std::string_view line = args.size() >= 3 ? args[2] : std::string_view("relay_on 1");
+    uint32_t iterations = 1000;
+    if (args.size() >= 4 && !parse_integer(args[3], iterations, uint32_t{1}, uint32_t{100000})) {
+        out.write("Usage: bench dispatch [\"line\"] [iterations 1-100000]\n");
         return;
     }
 
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
+    // Only the parse and the table lookup are timed; the handler is never run
+    uint64_t tokenize_total = 0;
+    uint64_t lookup_total = 0;
+    uint32_t tokenize_min = UINT32_MAX;
+    uint32_t lookup_min = UINT32_MAX;
+    const CommandTable::Spec* spec = nullptr;
+    for (uint32_t i = 0; i < iterations; i++) {
+        CommandArgs tokens;
+        esp_cpu_cycle_count_t t0 = esp_cpu_get_cycle_count();
+        bool tokenized = tokens.tokenize(line);
+        esp_cpu_cycle_count_t t1 = esp_cpu_get_cycle_count();
+        if (!tokenized || tokens.empty()) {
+            out.write("Line does not tokenize.\n");
+            return;
+        }
+        spec = CommandTable::REGISTRY.find(tokens[0]);
+        esp_cpu_cycle_count_t t2 = esp_cpu_get_cycle_count();
+
+        tokenize_total += t1 - t0;
+        lookup_total += t2 - t1;
+        tokenize_min = std::min<uint32_t>(tokenize_min, t1 - t0);
+        lookup_min = std::min<uint32_t>(lookup_min, t2 - t1);
+    }
+
+    BenchResult(out, "dispatch")
+        .field("line", line)
+        .field("found", spec != nullptr)
+        .field("iterations", iterations)
+        .field("cpu_mhz", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ)
+        .field("tokenize_cycles_avg", static_cast<int64_t>(tokenize_total / iterations))
+        .field("tokenize_cycles_min", tokenize_min)
+        .field("lookup_cycles_avg", static_cast<int64_t>(lookup_total / iterations))
+        .field("lookup_cycles_min", lookup_min)
+        .finish();
+}
 
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
-    } else {
-        printf("Invalid relay: %s\n", args[1].c_str());
-        printf("Valid options: 1, 2, all\n");
+void CommandInterpreter::bench_command(const CommandArgs& args, ResponseWriter& out) {
+    uint32_t repeat = 1;
+    if (args.size() < 3 || (args.size() >= 4 && !parse_integer(args[3], repeat, uint32_t{1}, uint32_t{100}))) {
+        out.write("Usage: bench cmd \"line\" [repeat 1-100]\n");
         return;
     }
+    std::string_view line = args[2];
+
+    // Output is counted, not sent, so only the command itself is measured
+    CountingResponseWriter sink;
+    HeapWindow heap;
+    heap.start();
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t i = 0; i < repeat; i++) {
+        execute(line, sink);
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    heap.stop();
+
+    BenchResult(out, "cmd")
+        .field("line", line)
+        .field("repeat", repeat)
+        .field("us_avg", elapsed_us / repeat)
+        .field("output_bytes", static_cast<int64_t>(sink.bytes() / repeat))
+        .field("heap_free", static_cast<int64_t>(heap.free_before()))
+        .field("heap_peak", static_cast<int64_t>(heap.peak_bytes()))
+        .field("heap_leaked", static_cast<int64_t>(heap.free_before()) - static_cast<int64_t>(heap.free_after()))
+        .field("stack_free_min", static_cast<int64_t>(uxTaskGetStackHighWaterMark(nullptr)))
+        .finish();
+}
 
-    if (relay_manager_->turn_off(relay_id)) {
-        printf("Successfully turned off %s\n", args[1].c_str());
-    } else {
-        printf("Failed to turn off %s\n", args[1].c_str());
+bool CommandInterpreter::require_macro_store(ResponseWriter& out) {
+    if (!macro_store_) {
+        out.write("Macro store not available.\n");
+        return false;
     }
+    return true;
 }
 
-void CommandInterpreter::handle_relay_toggle(const std::vector<std::string>& args) {
-    if (!relay_manager_) {
-        printf("Relay manager not available (single board variant).\n");
+void CommandInterpreter::handle_macro(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_macro_store(out)) {
         return;
     }
 
-    if (args.size() < 2) {
-        printf("Usage: relay_toggle <relay>\n");
-        printf("Relay options: 1, 2, all\n");
-        printf("Examples: relay_toggle 1, relay_toggle all\n");
+    if (args.size() >= 3 && equals_ignore_case(args[1], "delete")) {
+        MacroResult result = macro_store_->remove(args[2]);
+        if (result == MacroResult::OK) {
+            out.printf("Deleted macro '%.*s'\n", static_cast<int>(args[2].size()), args[2].data());
+        } else if (result == MacroResult::NOT_FOUND) {
+            out.printf("No macro named '%.*s'\n", static_cast<int>(args[2].size()), args[2].data());
+        } else {
+            out.write("Failed to write the macro table to NVS; macro kept\n");
+        }
         return;
     }
 
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
+    if (args.size() >= 4 && equals_ignore_case(args[1], "save")) {
+        // Check every command now so a typo does not surface halfway through a run
+        std::string_view batch = args[3];
+        while (!batch.empty()) {
+            std::string_view command = next_batch_command(batch);
+            CommandArgs tokens;
+            if (command.empty()) {
+                continue;
+            }
+            if (!tokens.tokenize(command) || tokens.empty()) {
+                out.printf("Invalid command in macro: %.*s\n", static_cast<int>(command.size()), command.data());
+                return;
+            }
+            const CommandTable::Spec* spec = CommandTable::REGISTRY.find(tokens[0]);
+            if (spec == nullptr) {
+                handle_unknown_command(tokens[0], out);
+                return;
+            }
+            if (spec->handler == &CommandInterpreter::handle_run || spec->handler == &CommandInterpreter::handle_macro) {
+                out.write("Macros cannot run or edit other macros.\n");
+                return;
+            }
+        }
 
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
-    } else {
-        printf("Invalid relay: %s\n", args[1].c_str());
-        printf("Valid options: 1, 2, all\n");
+        MacroResult result = macro_store_->save(args[2], args[3]);
+        if (result == MacroResult::OK) {
+            out.printf("Saved macro '%.*s'\n", static_cast<int>(args[2].size()), args[2].data());
+        } else if (result == MacroResult::INVALID) {
+            out.printf("Failed to save macro (name up to %zu chars, body up to %zu)\n",
+                       Macro::MAX_NAME_LEN, Macro::MAX_BODY_LEN);
+        } else if (result == MacroResult::FULL) {
+            out.printf("Failed to save macro (at most %zu macros)\n", MacroStore::MAX_MACROS);
+        } else {
+            out.write("Failed to write the macro table to NVS; macro not saved\n");
+        }
         return;
     }
 
-    if (relay_manager_->toggle(relay_id)) {
-        printf("Successfully toggled %s\n", args[1].c_str());
-    } else {
-        printf("Failed to toggle %s\n", args[1].c_str());
+    if (args.size() >= 2) {
+        out.write("Usage: macro [save <name> \"<cmd>; <cmd>...\" | delete <name>]\n");
+        return;
     }
-}
 
-void CommandInterpreter::handle_relay_status() {
-    if (!relay_manager_) {
-        printf("Relay manager not available (single board variant).\n");
-        printf("This board does not have relay control capabilities.\n");
+    size_t count = macro_store_->count();
+    out.printf("\n=== Command Macros (%zu/%zu) ===\n", count, MacroStore::MAX_MACROS);
+    if (count == 0) {
+        out.write("No macros saved. Use 'macro save <name> \"<cmd>; <cmd>\"'.\n");
         return;
     }
-
-    std::string status = relay_manager_->get_status();
-    printf("\n%s\n", status.c_str());
+    Macro macro;
+    for (size_t i = 0; i < count && macro_store_->get(i, macro); i++) {
+        out.printf("%-15s %s\n", macro.name, macro.body);
+    }
 }
 
-void CommandInterpreter::handle_relay_debug() {
-    if (!relay_manager_) {
-        printf("Relay manager not available (single board variant).\n");
-        printf("This board does not have relay control capabilities.\n");
+void CommandInterpreter::handle_run(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_macro_store(out)) {
+        return;
+    }
+    if (args.size() < 2) {
+        out.write("Usage: run <macro>\n");
         return;
     }
 
-    std::string debug_info = relay_manager_->get_debug_status();
-    printf("\n%s\n", debug_info.c_str());
+    Macro macro;
+    if (!macro_store_->find(args[1], macro)) {
+        out.printf("No macro named '%.*s'\n", static_cast<int>(args[1].size()), args[1].data());
+        return;
+    }
+    run_batch(macro.body, out);
 }
 
-void CommandInterpreter::handle_unknown_command(const std::string& command) {
-    printf("Unknown command: %s\n", command.c_str());
-    printf("Type 'help' for available commands.\n");
+bool CommandInterpreter::require_credential_store(ResponseWriter& out) {
+    if (!credential_store_) {
+        out.write("Saved network store not available.\n");
+        return false;
+    }
+    return true;
 }
 
-void CommandInterpreter::print_network_list(const std::vector<wifi_config::NetworkInfo>& networks) {
-    printf("\n=== Available WiFi Networks ===\n");
-    printf("No. %-32s RSSI  Security\n", "SSID");
-    printf("--- %-32s ----  --------\n", "--------------------------------");
-    
-    for (size_t i = 0; i < networks.size(); ++i) {
-        const auto& network = networks[i];
-        printf("%2zu. %-32s %4d  %s\n", 
-               i + 1, 
-               network.ssid.c_str(), 
-               network.rssi, 
-               auth_mode_to_string(network.auth_mode));
+// Parse dotted-quad IPv4 into esp_ip4_addr_t byte order
+static bool parse_ipv4(std::string_view text, uint32_t& addr) {
+    uint32_t result = 0;
+    for (int octet = 0; octet < 4; octet++) {
+        size_t dot = (octet < 3) ? text.find('.') : text.size();
+        if (dot == std::string_view::npos) {
+            return false;
+        }
+        uint8_t value = 0;
+        if (!parse_integer(text.substr(0, dot), value, uint8_t{0}, uint8_t{255})) {
+            return false;
+        }
+        result |= static_cast<uint32_t>(value) << (8 * octet);
+        text.remove_prefix(std::min(dot + 1, text.size()));
     }
-    printf("\n");
+    addr = result;
+    return true;
 }
 
-const char* CommandInterpreter::auth_mode_to_string(wifi_auth_mode_t auth_mode) {
-    switch (auth_mode) {
-        case WIFI_AUTH_OPEN: return "Open";
-        case WIFI_AUTH_WEP: return "WEP";
-        case WIFI_AUTH_WPA_PSK: return "WPA";
-        case WIFI_AUTH_WPA2_PSK: return "WPA2";
-        case WIFI_AUTH_WPA_WPA2_PSK: return "WPA/WPA2";
-        case WIFI_AUTH_WPA3_PSK: return "WPA3";
-        default: return "Unknown";
-    }
+static void write_ipv4(ResponseWriter& out, uint32_t addr) {
+    out.printf("%u.%u.%u.%u", static_cast<unsigned>(addr & 0xff), static_cast<unsigned>((addr >> 8) & 0xff),
+               static_cast<unsigned>((addr >> 16) & 0xff), static_cast<unsigned>(addr >> 24));
 }
 
-// BLE response generation methods
-std::string CommandInterpreter::generate_help_response() {
-    std::string response = "\n=== Available Commands ===\n";
-    response += "\n--- WiFi Commands ---\n";
-    response += "help, h                    - Show this help message\n";
-    response += "scan, s                    - Scan for available WiFi networks\n";
-    response += "list, l                    - List previously scanned networks\n";
-    response += "connect, c <index>         - Connect to network by index\n";
-    response += "status, st                 - Show WiFi connection status\n";
-    response += "disconnect, d              - Disconnect from current network\n";
-    response += "\n--- BLE Commands ---\n";
-    response += "ble_start, bs              - Start BLE advertising\n";
-    response += "ble_stop, bp               - Stop BLE advertising\n";
-    response += "ble_status, bt             - Show BLE status\n";
-    response += "ble_name, bn <name>        - Set BLE device name\n";
-    response += "ble_scan, bsc [duration]   - Scan for BLE devices\n";
-    response += "ble_debug, bd              - Show BLE debug info\n";
-    response += "\n--- Relay Commands (Dual Relay Board) ---\n";
-    response += "relay_on, ron <relay>      - Turn on relay (1, 2, or all)\n";
-    response += "relay_off, roff <relay>    - Turn off relay (1, 2, or all)\n";
-    response += "relay_toggle, rtog <relay> - Toggle relay (1, 2, or all)\n";
-    response += "relay_status, rst          - Show relay status\n";
-    response += "relay_debug, rd            - Show detailed relay debug info\n\n";
-    response += "Commands available via USB Serial JTAG and BLE\n";
-    return response;
-}
-
-std::string CommandInterpreter::generate_scan_response() {
-    if (!wifi_manager_->scan_networks()) {
-        return "Failed to scan for WiFi networks. Please try again.";
+void CommandInterpreter::handle_wifi_save(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_credential_store(out)) {
+        return;
     }
     
-    const auto& networks = wifi_manager_->get_scanned_networks();
-    if (networks.empty()) {
-        return "No WiFi networks found.";
+    wifi_config::WiFiProfile profile = {};
+    std::string ssid;
+    std::string password;
+    
+    if (args.size() == 1) {
+        // Save the network we are currently joined to
+        if (!wifi_manager_->get_current_credentials(ssid, password)) {
+            out.write("Not connected. Usage: wifi_save [<ssid> <password>] [static <ip> <mask> <gw> [dns]]\n");
+            return;
+        }
+    } else if (args.size() >= 3) {
+        ssid = std::string(args[1]);
+        password = std::string(args[2]);
+    } else {
+        out.write("Usage: wifi_save [<ssid> <password>] [static <ip> <mask> <gw> [dns]]\n");
+        out.write("Use \"\" as the password for open networks.\n");
+        return;
     }
     
-    std::string response = "WiFi scan completed. Found " + std::to_string(networks.size()) + " networks:\n\n";
-    response += format_network_list(networks);
-    response += "\nUse 'connect <index>' to connect to a network.";
-    return response;
-}
-
-std::string CommandInterpreter::generate_list_response() {
-    const auto& networks = wifi_manager_->get_scanned_networks();
-    if (networks.empty()) {
-        return "No networks available. Use 'scan' to search for WiFi networks.";
+    if (ssid.size() >= sizeof(profile.ssid) || password.size() >= sizeof(profile.password)) {
+        out.write("SSID (max 32) or password (max 64) too long.\n");
+        return;
+    }
+    memcpy(profile.ssid, ssid.data(), ssid.size());
+    memcpy(profile.password, password.data(), password.size());
+    
+    if (args.size() >= 4) {
+        bool valid = args.size() >= 7 && equals_ignore_case(args[3], "static") &&
+                     parse_ipv4(args[4], profile.ip) && parse_ipv4(args[5], profile.netmask) &&
+                     parse_ipv4(args[6], profile.gateway) &&
+                     (args.size() < 8 || parse_ipv4(args[7], profile.dns));
+        if (!valid) {
+            out.write("Usage: wifi_save <ssid> <password> static <ip> <mask> <gw> [dns]\n");
+            return;
+        }
+        profile.static_ip = true;
+    }
+    
+    if (!credential_store_->save(profile, 0)) {
+        out.write("Failed to save network.\n");
+        return;
     }
     
-    std::string response = "Previously scanned networks:\n\n";
-    response += format_network_list(networks);
-    response += "\nUse 'connect <index>' to connect to a network.";
-    return response;
+    out.printf("Saved '%s' as the preferred network%s.\n", profile.ssid,
+               profile.static_ip ? " (static IP)" : "");
+    out.write("It will be joined automatically at boot.\n");
 }
 
-std::string CommandInterpreter::generate_connect_response(const std::vector<std::string>& args) {
-    if (args.size() < 2) {
-        return "Usage: connect <index>\nExample: connect 0\nUse 'list' to see available networks.";
+void CommandInterpreter::handle_wifi_profiles(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_credential_store(out)) {
+        return;
     }
     
-    // Parse index manually since exceptions are disabled in embedded environment
-    int index = -1;
-    const std::string& index_str = args[1];
-    bool valid_number = true;
+    size_t count = credential_store_->count();
+    if (count == 0) {
+        out.write("No saved networks. Use 'wifi_save' to add one.\n");
+        return;
+    }
     
-    // Check if string contains only digits
-    for (char c : index_str) {
-        if (!std::isdigit(c)) {
-            valid_number = false;
+    out.write("\n=== Saved WiFi Networks ===\n");
+    out.printf("No. %-32s Ch  Address\n", "SSID");
+    for (size_t i = 0; i < count; i++) {
+        wifi_config::WiFiProfile profile;
+        if (!credential_store_->get(i, profile)) {
             break;
         }
-    }
-    
-    if (valid_number && !index_str.empty()) {
-        index = 0;
-        for (char c : index_str) {
-            index = index * 10 + (c - '0');
+        out.printf("%2zu. %-32s %2u  ", i, profile.ssid, profile.channel);
+        if (profile.static_ip) {
+            out.write("static ");
+            write_ipv4(out, profile.ip);
+        } else if (profile.ip != 0) {
+            out.write("DHCP, last ");
+            write_ipv4(out, profile.ip);
+        } else {
+            out.write("DHCP");
         }
-    } else {
-        return "Invalid network index. Please provide a valid number.";
+        out.write("\n");
     }
-    
-    const auto& networks = wifi_manager_->get_scanned_networks();
-    if (networks.empty()) {
-        return "No networks available. Use 'scan' to search for WiFi networks first.";
+    out.write("\nNetworks are tried in this order at boot.\n");
+}
+
+void CommandInterpreter::handle_wifi_forget(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_credential_store(out)) {
+        return;
     }
     
-    if (index < 0 || index >= static_cast<int>(networks.size())) {
-        return "Network index out of range. Use 'list' to see available networks.";
+    if (args.size() < 2) {
+        out.write("Usage: wifi_forget <index|ssid|all>\n");
+        return;
     }
     
-    const auto& network = networks[index];
-    
-    // For now, we'll try to connect without a password for open networks
-    // In a real implementation, you'd need to handle password input differently for BLE
-    std::string password = "";
-    if (network.auth_mode != WIFI_AUTH_OPEN) {
-        return "Password-protected networks not yet supported via BLE interface.\nPlease use USB Serial JTAG interface for password entry.";
+    if (equals_ignore_case(args[1], "all")) {
+        if (credential_store_->clear()) {
+            out.write("All saved networks removed.\n");
+        } else {
+            out.write("Failed to clear saved networks.\n");
+        }
+        return;
     }
     
-    std::string response = "Connecting to '" + network.ssid + "'...\n";
-    
-    if (wifi_manager_->connect_to_network(network.ssid, password)) {
-        response += "Successfully connected to " + network.ssid + "\n";
-        response += "IP Address: " + wifi_manager_->get_ip_address();
-    } else {
-        response += "Failed to connect to " + network.ssid + ". Please check network availability.";
+    size_t rank = 0;
+    bool found = parse_integer(args[1], rank, size_t{0}, wifi_config::CredentialStore::MAX_PROFILES - 1) &&
+                 rank < credential_store_->count();
+    if (!found) {
+        for (rank = 0; rank < credential_store_->count(); rank++) {
+            wifi_config::WiFiProfile profile;
+            if (credential_store_->get(rank, profile) && args[1] == profile.ssid) {
+                found = true;
+                break;
+            }
+        }
     }
     
-    return response;
+    if (!found) {
+        out.printf("No saved network '%.*s'.\n", static_cast<int>(args[1].size()), args[1].data());
+        return;
+    }
+    if (!credential_store_->remove(rank)) {
+        out.write("Failed to write saved networks to NVS; network kept.\n");
+        return;
+    }
+    out.printf("Removed saved network %.*s.\n", static_cast<int>(args[1].size()), args[1].data());
 }
 
-std::string CommandInterpreter::generate_status_response() {
-    if (wifi_manager_->is_connected()) {
-        std::string response = "WiFi Status: Connected\n";
-        response += "Network: " + wifi_manager_->get_connected_ssid() + "\n";
-        response += "IP Address: " + wifi_manager_->get_ip_address() + "\n";
-        response += "Signal Strength: " + std::to_string(wifi_manager_->get_rssi()) + " dBm";
-        return response;
-    } else {
-        return "WiFi Status: Disconnected\nUse 'scan' and 'connect' to join a network.";
+void CommandInterpreter::handle_hosted_stats(const CommandArgs& args, ResponseWriter& out) {
+    if (args.size() >= 2 && equals_ignore_case(args[1], "reset")) {
+        hosted_link::reset();
+        out.write("Round-trip histograms cleared\n");
+        return;
+    }
+
+    if (args.size() >= 2) {
+        uint32_t probes = 10;
+        if (!equals_ignore_case(args[1], "probe") ||
+            (args.size() >= 3 && !parse_integer(args[2], probes, uint32_t{1}, uint32_t{1000}))) {
+            out.write("Usage: hosted_stats [probe [1-1000]|reset]\n");
+            return;
+        }
+        // Alternate the two so both see the same link load
+        uint32_t wifi_ok = 0;
+        uint32_t hci_ok = 0;
+        for (uint32_t i = 0; i < probes; i++) {
+            int64_t round_trip_us = 0;
+            if (wifi_manager_ && wifi_manager_->probe_rpc(round_trip_us)) {
+                hosted_link::record_round_trip(hosted_link::Interface::WIFI, round_trip_us);
+                wifi_ok++;
+            }
+            if (ble_manager_ && ble_manager_->probe_hci(round_trip_us)) {
+                hosted_link::record_round_trip(hosted_link::Interface::HCI, round_trip_us);
+                hci_ok++;
+            }
+        }
+        out.printf("Probes answered: WiFi RPC %" PRIu32 "/%" PRIu32 ", HCI %" PRIu32 "/%" PRIu32 "\n",
+                   wifi_ok, probes, hci_ok, probes);
+    }
+
+    hosted_link::InterfaceCounters wifi;
+    hosted_link::get_wifi_data_counters(wifi);
+    hosted_link::InterfaceCounters hci{};
+    if (ble_manager_) {
+        ble_manager_->get_hci_counters(hci);
     }
+    hosted_link::write_report(out, wifi, hci);
 }
 
-std::string CommandInterpreter::generate_disconnect_response() {
-    if (!wifi_manager_->is_connected()) {
-        return "WiFi is not connected.";
+void CommandInterpreter::handle_power(const CommandArgs& args, ResponseWriter& out) {
+    if (!power_manager_) {
+        out.write("Power manager not available.\n");
+        return;
     }
-    
-    std::string ssid = wifi_manager_->get_connected_ssid();
-    if (wifi_manager_->disconnect()) {
-        return "Disconnected from " + ssid;
+
+    if (args.size() >= 2) {
+        power::PowerMode mode;
+        if (equals_ignore_case(args[1], "reset")) {
+            power_manager_->reset_stats();
+            out.write("Residency and latency statistics cleared\n");
+            return;
+        }
+        if (!power::PowerManager::parse_mode(args[1], mode)) {
+            out.write("Usage: power [performance|idle|reset]\n");
+            return;
+        }
+        if (!power_manager_->set_mode(mode)) {
+            out.printf("Failed to enter %s mode\n", power::PowerManager::mode_to_string(mode));
+            return;
+        }
+    }
+    power_manager_->write_status(out);
+}
+
+void CommandInterpreter::handle_events(const CommandArgs& args, ResponseWriter& out) {
+    bool enable = false;
+    if (args.size() >= 2) {
+        if (equals_ignore_case(args[1], "on")) {
+            enable = true;
+        } else if (!equals_ignore_case(args[1], "off")) {
+            out.write("Usage: events [on|off]\n");
+            return;
+        }
+    }
+
+    // Only one transport is running this command, so at most one of these accepts it
+    bool client = false;
+    bool enabled = false;
+    if (args.size() >= 2) {
+        client = (ble_manager_ && ble_manager_->set_command_client_events(enable)) ||
+                 (command_server_ && command_server_->set_command_client_events(enable));
+        enabled = enable;
     } else {
-        return "Failed to disconnect from " + ssid;
+        client = (ble_manager_ && ble_manager_->get_command_client_events(enabled)) ||
+                 (command_server_ && command_server_->get_command_client_events(enabled));
     }
+
+    if (client) {
+        out.printf("Push events for this client: %s\n", enabled ? "on" : "off");
+    } else if (args.size() >= 2) {
+        out.write("Push events are only available to BLE and TCP clients.\n");
+        return;
+    }
+    event_bus::write_status(out);
 }
 
-std::string CommandInterpreter::format_network_list(const std::vector<wifi_config::NetworkInfo>& networks) {
-    std::string result;
-    
-    for (size_t i = 0; i < networks.size(); i++) {
-        const auto& network = networks[i];
-        result += "  [" + std::to_string(i) + "] " + network.ssid;
-        result += " (" + std::string(auth_mode_to_string(network.auth_mode));
-        result += ", RSSI: " + std::to_string(network.rssi) + " dBm)\n";
+void CommandInterpreter::handle_net_status(const CommandArgs& args, ResponseWriter& out) {
+    if (!command_server_) {
+        out.write("Network command server not running (disabled in menuconfig or no socket could be opened).\n");
+        return;
     }
-    
-    return result;
+    command_server_->write_status(out);
 }
 
-// BLE response generation methods
-std::string CommandInterpreter::generate_ble_start_response() {
+bool CommandInterpreter::require_ble_manager(ResponseWriter& out) {
     if (!ble_manager_) {
-        return "BLE manager not available.";
+        out.write("BLE manager not available.\n");
+        return false;
+    }
+    return true;
+}
+
+// BLE command handlers
+void CommandInterpreter::handle_ble_start(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
+    out.write("Starting BLE advertising...\n");
     if (ble_manager_->start_advertising()) {
-        return "BLE advertising started successfully.\nDevice name: ESP32-P4-WiFi\nService: Nordic UART Service\nNote: Currently stub implementation.";
+        out.write("BLE advertising started successfully.\n");
+        out.write("Device name: ESP32-P4-WiFi\n");
+        out.write("Service: Nordic UART Service\n");
+        out.write("You can now connect via BLE UART apps.\n");
     } else {
-        return "Failed to start BLE advertising.";
+        out.write("Failed to start BLE advertising.\n");
     }
 }
 
-std::string CommandInterpreter::generate_ble_stop_response() {
-    if (!ble_manager_) {
-        return "BLE manager not available.";
+void CommandInterpreter::handle_ble_stop(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
+    out.write("Stopping BLE advertising...\n");
     if (ble_manager_->stop_advertising()) {
-        return "BLE advertising stopped.";
+        out.write("BLE advertising stopped.\n");
     } else {
-        return "Failed to stop BLE advertising.";
+        out.write("Failed to stop BLE advertising.\n");
     }
 }
 
-std::string CommandInterpreter::generate_ble_status_response() {
-    if (!ble_manager_) {
-        return "BLE manager not available.";
+void CommandInterpreter::handle_ble_status(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
-    std::string response = "=== BLE Status ===\n";
-    response += "Implementation: ESP-Hosted NimBLE via ESP32-C6\n";
-    response += "Architecture: ESP32-P4 + ESP32-C6 coprocessor\n";
-    response += "Initialized: Yes\n";
-    response += "Advertising: " + std::string(ble_manager_->is_connected() ? "Connected" : "Available") + "\n";
-    response += "Connected: " + std::string(ble_manager_->is_connected() ? "Yes" : "No") + "\n";
-    response += "Device Name: ESP32-P4-WiFi\n";
-    response += "Service: Nordic UART Service (NUS)\n";
-    response += "\nConfiguration Status:\n";
-    response += "- ESP32-C6 Coprocessor: Active\n";
-    response += "- VHCI Transport: Active\n";
-    response += "- NimBLE Stack: Running\n";
-    response += "\nUse 'ble_debug' for detailed info.";
-    return response;
-}
-
-std::string CommandInterpreter::generate_ble_name_response(const std::vector<std::string>& args) {
-    if (!ble_manager_) {
-        return "BLE manager not available.";
+    out.write("\n=== BLE Status ===\n");
+    out.write("Implementation: ESP-Hosted NimBLE via ESP32-C6\n");
+    out.write("Architecture: ESP32-P4 + ESP32-C6 coprocessor\n");
+    out.write("Initialized: Yes\n");
+    out.printf("Advertising: %s\n",
+               ble_manager_->connection_count() < ble_serial::BLEManager::MAX_SESSIONS ? "Available" : "Full");
+    out.printf("Connected: %zu/%zu clients\n", ble_manager_->connection_count(),
+               ble_serial::BLEManager::MAX_SESSIONS);
+    out.write("Device Name: ESP32-P4-WiFi\n");
+    out.write("Service: Nordic UART Service (NUS)\n");
+    out.write("\nConfiguration Status:\n");
+    out.write("- ESP32-C6 Coprocessor: Active\n");
+    out.write("- VHCI Transport: Active\n");
+    out.write("- NimBLE Stack: Running\n");
+    out.write("\nUse 'ble_debug' for detailed status info.\n");
+}
+
+void CommandInterpreter::handle_ble_name(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
     if (args.size() < 2) {
-        return "Usage: ble_name <device_name>\nExample: ble_name MyESP32-P4";
+        out.write("Usage: ble_name <device_name>\n");
+        out.write("Example: ble_name \"MyESP32-P4\"\n");
+        return;
     }
     
-    std::string new_name = args[1];
-    return "BLE device name set to: " + new_name + "\nNote: Name change will take effect on next advertising start.";
+    // TODO: Implement name persistence and immediate update if advertising
+    out.printf("BLE device name set to: %.*s\n", static_cast<int>(args[1].size()), args[1].data());
+    out.write("Note: Name change will take effect on next advertising start.\n");
 }
 
-std::string CommandInterpreter::generate_ble_scan_response(const std::vector<std::string>& args) {
-    if (!ble_manager_) {
-        return "BLE manager not available.";
+void CommandInterpreter::handle_ble_scan(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
     int duration = 5; // Default 5 seconds
-    if (args.size() >= 2) {
-        // Parse duration manually since exceptions are disabled
-        const std::string& duration_str = args[1];
-        bool valid_number = true;
-        
-        for (char c : duration_str) {
-            if (!std::isdigit(c)) {
-                valid_number = false;
-                break;
-            }
-        }
-        
-        if (valid_number && !duration_str.empty()) {
-            duration = 0;
-            for (char c : duration_str) {
-                duration = duration * 10 + (c - '0');
-            }
-            if (duration < 1 || duration > 60) {
-                duration = 5;
-            }
-        }
+    if (args.size() >= 2 && !parse_integer(args[1], duration, 1, 60)) {
+        out.write("Invalid duration. Using default 5 seconds.\n");
     }
     
-    std::string response = "Starting BLE scan for " + std::to_string(duration) + " seconds...\n";
+    out.printf("Starting BLE device scan for %d seconds...\n", duration);
     
     if (ble_manager_->start_scan(duration)) {
         int count = ble_manager_->get_scan_result_count();
-        response += "Scan completed. Found " + std::to_string(count) + " devices:\n\n";
+        out.printf("Scan completed. Found %d devices:\n", count);
         
-        for (int i = 0; i < count; i++) {
-            std::string result = ble_manager_->get_scan_result(i);
-            response += "  " + result + "\n";
-        }
+        ble_manager_->write_scan_results(out);
         
         if (count == 0) {
-            response += "No BLE devices found.\n";
+            out.write("No BLE devices found.\n");
         }
-        response += "\nReal BLE scanning via ESP32-C6 coprocessor.";
     } else {
-        response += "Failed to start BLE scan.";
+        out.write("Failed to start BLE scan.\n");
     }
-    
-    return response;
 }
 
-std::string CommandInterpreter::generate_ble_debug_response() {
-    if (!ble_manager_) {
-        return "BLE manager not available.";
+void CommandInterpreter::handle_ble_debug(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
     
-    return ble_manager_->get_debug_status();
+    ble_manager_->write_debug_status(out);
 }
 
-// Relay response generation methods
-std::string CommandInterpreter::generate_relay_on_response(const std::vector<std::string>& args) {
-    if (!relay_manager_) {
-        return "Relay manager not available (single board variant).";
+void CommandInterpreter::handle_ble_link(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
     }
 
-    if (args.size() < 2) {
-        return "Usage: relay_on <relay>\nOptions: 1, 2, all\nExample: relay_on 1";
+    if (args.size() >= 2) {
+        ble_serial::BLEManager::LinkPolicy policy;
+        if (!ble_serial::BLEManager::link_policy_from_string(args[1], policy)) {
+            out.printf("Invalid link policy: %.*s\n", static_cast<int>(args[1].size()), args[1].data());
+            out.write("Valid options: throughput, adaptive, low_power\n");
+            return;
+        }
+        ble_manager_->set_link_policy(policy);
+        out.printf("BLE link policy set to %s\n", ble_serial::BLEManager::link_policy_to_string(policy));
     }
 
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
+    out.write("\n=== BLE Link ===\n");
+    ble_manager_->write_link_status(out);
+}
+
+// Apply one key=value (or bare flag) observer option
+static bool parse_observer_option(std::string_view option, ble_serial::ObserverConfig& config, bool& to_ble) {
+    size_t eq = option.find('=');
+    std::string_view key = option.substr(0, eq);
+    std::string_view value = (eq == std::string_view::npos) ? std::string_view{} : option.substr(eq + 1);
+    ble_serial::ObserverFilter& filter = config.filter;
 
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
+    if (equals_ignore_case(key, "active") && eq == std::string_view::npos) {
+        config.active = true;
+        return true;
+    }
+    if (equals_ignore_case(key, "itvl")) {
+        return parse_integer(value, config.interval_ms, uint16_t{3}, uint16_t{10240});
+    }
+    if (equals_ignore_case(key, "window")) {
+        return parse_integer(value, config.window_ms, uint16_t{3}, uint16_t{10240});
+    }
+    if (equals_ignore_case(key, "rssi")) {
+        return parse_integer(value, filter.min_rssi, int8_t{-127}, int8_t{20});
+    }
+    if (equals_ignore_case(key, "uuid")) {
+        return parse_integer(value, filter.uuid16, uint16_t{1}, uint16_t{0xFFFF}, 16);
+    }
+    if (equals_ignore_case(key, "mfg")) {
+        return parse_integer(value, filter.company_id, int32_t{0}, int32_t{0xFFFF}, 16);
+    }
+    if (equals_ignore_case(key, "name")) {
+        if (value.empty() || value.size() >= sizeof(filter.name_prefix)) {
+            return false;
+        }
+        memcpy(filter.name_prefix, value.data(), value.size());
+        filter.name_prefix[value.size()] = '\0';
+        return true;
+    }
+    if (equals_ignore_case(key, "fmt")) {
+        config.binary = equals_ignore_case(value, "bin");
+        return config.binary || equals_ignore_case(value, "text");
+    }
+    if (equals_ignore_case(key, "to")) {
+        to_ble = equals_ignore_case(value, "ble");
+        return to_ble || equals_ignore_case(value, "serial");
+    }
+    return false;
+}
+
+void CommandInterpreter::handle_ble_observe(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_ble_manager(out)) {
+        return;
+    }
+
+    if (args.size() >= 2 && equals_ignore_case(args[1], "stop")) {
+        if (ble_manager_->stop_observer()) {
+            out.write("BLE observer stopped.\n");
+        } else {
+            out.write("BLE observer is not running.\n");
+        }
+        return;
+    }
+
+    if (args.size() < 2 || !equals_ignore_case(args[1], "start")) {
+        out.write("\n=== BLE Observer ===\n");
+        ble_manager_->write_observer_status(out);
+        out.write("\nUsage: ble_observe start [active] [itvl=<ms>] [window=<ms>] [name=<prefix>]\n");
+        out.write("                         [uuid=<hex>] [mfg=<hex>] [rssi=<dBm>] [fmt=text|bin] [to=serial|ble]\n");
+        out.write("       ble_observe stop\n");
+        return;
+    }
+
+    ble_serial::ObserverConfig config = ble_serial::ObserverConfig::defaults();
+    bool to_ble = false;
+    for (size_t i = 2; i < args.size(); i++) {
+        if (!parse_observer_option(args[i], config, to_ble)) {
+            out.printf("Invalid observer option: %.*s\n", static_cast<int>(args[i].size()), args[i].data());
+            return;
+        }
+    }
+
+    if (to_ble && !ble_manager_->is_connected()) {
+        out.write("No BLE client connected to stream to.\n");
+        return;
+    }
+
+    ble_serial::AdvertObserver::RecordSink sink;
+    if (to_ble) {
+        // The observer is owned by the BLE manager, so the sink cannot outlive it. Started
+        // over BLE, it streams to that client; from another interface, to every subscriber
+        ble_serial::BLEManager* ble = ble_manager_.get();
+        uint16_t conn_handle = ble->command_conn_handle();
+        if (conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+            sink = [ble, conn_handle](const char* data, size_t len) {
+                return ble->send_response(conn_handle, data, len);
+            };
+        } else {
+            sink = [ble](const char* data, size_t len) { return ble->send_response(data, len); };
+        }
     } else {
-        return "Invalid relay: " + args[1] + "\nValid options: 1, 2, all";
+        sink = [](const char* data, size_t len) {
+            bool written = fwrite(data, 1, len, stdout) == len;
+            fflush(stdout);
+            return written;
+        };
     }
 
-    if (relay_manager_->turn_on(relay_id)) {
-        return "Successfully turned on " + args[1];
+    if (ble_manager_->start_observer(config, std::move(sink))) {
+        out.printf("BLE observer streaming %s records to %s. Use 'ble_observe stop' to end.\n",
+                   config.binary ? "binary" : "text", to_ble ? "BLE" : "serial");
     } else {
-        return "Failed to turn on " + args[1];
+        out.write("Failed to start BLE observer (is a scan running?).\n");
     }
 }
 
-std::string CommandInterpreter::generate_relay_off_response(const std::vector<std::string>& args) {
+bool CommandInterpreter::require_relay_manager(ResponseWriter& out) {
     if (!relay_manager_) {
-        return "Relay manager not available (single board variant).";
+        out.write("Relay manager not available (single board variant).\n");
+        out.write("This board does not have relay control capabilities.\n");
+        return false;
+    }
+    return true;
+}
+
+// Relay selection: "all", a relay number, or a list/range such as "1,3-5"
+static bool parse_relay_selection(std::string_view text, uint32_t& mask) {
+    constexpr uint32_t count = relay_control::RelayManager::RELAY_COUNT;
+    if (equals_ignore_case(text, "all")) {
+        mask = relay_control::RelayManager::ALL_RELAYS_MASK;
+        return true;
+    }
+
+    uint32_t selected = 0;
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        size_t dash = item.find('-');
+        uint32_t first = 0;
+        uint32_t last = 0;
+        if (!parse_integer(item.substr(0, dash), first, uint32_t{1}, count)) {
+            return false;
+        }
+        last = first;
+        if (dash != std::string_view::npos &&
+            !parse_integer(item.substr(dash + 1), last, first, count)) {
+            return false;
+        }
+        // Bits first-1 .. last-1
+        selected |= (last == 32 ? UINT32_MAX : (1u << last) - 1) & ~((1u << (first - 1)) - 1);
+        text.remove_prefix(comma == std::string_view::npos ? text.size() : comma + 1);
     }
+    mask = selected;
+    return selected != 0;
+}
 
+bool CommandInterpreter::parse_relay_arg(const CommandArgs& args, const char* command,
+                                         uint32_t& relay_mask, ResponseWriter& out) {
+    constexpr size_t count = relay_control::RelayManager::RELAY_COUNT;
     if (args.size() < 2) {
-        return "Usage: relay_off <relay>\nOptions: 1, 2, all\nExample: relay_off 1";
+        out.printf("Usage: %s <relay>\n", command);
+        out.printf("Relay options: 1-%zu, a list such as 1,3-4, or all\n", count);
+        out.printf("Examples: %s 1, %s all\n", command, command);
+        return false;
     }
 
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
+    std::string_view relay_arg = args[1];
+    if (!parse_relay_selection(relay_arg, relay_mask)) {
+        out.printf("Invalid relay: %.*s\n", static_cast<int>(relay_arg.size()), relay_arg.data());
+        out.printf("Valid options: 1-%zu, a list such as 1,3-4, or all\n", count);
+        return false;
+    }
+    return true;
+}
+
+// Relay command handlers
+void CommandInterpreter::handle_relay_on(const CommandArgs& args, ResponseWriter& out) {
+    uint32_t relay_mask = 0;
+    if (!require_relay_manager(out) || !parse_relay_arg(args, "relay_on", relay_mask, out)) {
+        return;
+    }
 
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
+    if (relay_manager_->turn_on(relay_mask)) {
+        out.printf("Successfully turned on %.*s\n", static_cast<int>(args[1].size()), args[1].data());
     } else {
-        return "Invalid relay: " + args[1] + "\nValid options: 1, 2, all";
+        out.printf("Failed to turn on %.*s\n", static_cast<int>(args[1].size()), args[1].data());
+    }
+}
+
+void CommandInterpreter::handle_relay_off(const CommandArgs& args, ResponseWriter& out) {
+    uint32_t relay_mask = 0;
+    if (!require_relay_manager(out) || !parse_relay_arg(args, "relay_off", relay_mask, out)) {
+        return;
     }
 
-    if (relay_manager_->turn_off(relay_id)) {
-        return "Successfully turned off " + args[1];
+    if (relay_manager_->turn_off(relay_mask)) {
+        out.printf("Successfully turned off %.*s\n", static_cast<int>(args[1].size()), args[1].data());
     } else {
-        return "Failed to turn off " + args[1];
+        out.printf("Failed to turn off %.*s\n", static_cast<int>(args[1].size()), args[1].data());
     }
 }
 
-std::string CommandInterpreter::generate_relay_toggle_response(const std::vector<std::string>& args) {
-    if (!relay_manager_) {
-        return "Relay manager not available (single board variant).";
+void CommandInterpreter::handle_relay_toggle(const CommandArgs& args, ResponseWriter& out) {
+    uint32_t relay_mask = 0;
+    if (!require_relay_manager(out) || !parse_relay_arg(args, "relay_toggle", relay_mask, out)) {
+        return;
     }
 
-    if (args.size() < 2) {
-        return "Usage: relay_toggle <relay>\nOptions: 1, 2, all\nExample: relay_toggle 1";
+    if (relay_manager_->toggle(relay_mask)) {
+        out.printf("Successfully toggled %.*s\n", static_cast<int>(args[1].size()), args[1].data());
+    } else {
+        out.printf("Failed to toggle %.*s\n", static_cast<int>(args[1].size()), args[1].data());
     }
+}
 
-    std::string relay_arg = args[1];
-    std::transform(relay_arg.begin(), relay_arg.end(), relay_arg.begin(), ::tolower);
+// Duration with an optional us/ms/s/m/h suffix (milliseconds if none)
+static bool parse_duration_us(std::string_view text, uint64_t& duration_us,
+                              uint64_t max_us = uint64_t{3600000000}) {
+    uint64_t scale = 1000;
+    if (text.ends_with("us")) {
+        scale = 1;
+        text.remove_suffix(2);
+    } else if (text.ends_with("ms")) {
+        text.remove_suffix(2);
+    } else if (text.ends_with("s")) {
+        scale = 1000000;
+        text.remove_suffix(1);
+    } else if (text.ends_with("m")) {
+        scale = uint64_t{60000000};
+        text.remove_suffix(1);
+    } else if (text.ends_with("h")) {
+        scale = uint64_t{3600000000};
+        text.remove_suffix(1);
+    }
+
+    uint64_t value = 0;
+    if (!parse_integer(text, value, uint64_t{1}, max_us / scale)) {
+        return false;
+    }
+    duration_us = value * scale;
+    return true;
+}
+
+void CommandInterpreter::handle_relay_pulse(const CommandArgs& args, ResponseWriter& out) {
+    uint32_t relay_mask = 0;
+    if (!require_relay_manager(out) || !parse_relay_arg(args, "relay_pulse", relay_mask, out)) {
+        return;
+    }
 
-    relay_control::RelayManager::RelayId relay_id;
-    if (relay_arg == "1") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_1;
-    } else if (relay_arg == "2") {
-        relay_id = relay_control::RelayManager::RelayId::RELAY_2;
-    } else if (relay_arg == "all") {
-        relay_id = relay_control::RelayManager::RelayId::ALL_RELAYS;
+    uint64_t duration_us = 0;
+    if (args.size() < 3 || !parse_duration_us(args[2], duration_us)) {
+        out.write("Usage: relay_pulse <relay> <time>   (time: 500us, 250ms, 2s; up to 1 hour)\n");
+        return;
+    }
+
+    if (relay_manager_->pulse(relay_mask, duration_us)) {
+        out.printf("Pulsing %.*s for %" PRIu64 " us\n", static_cast<int>(args[1].size()), args[1].data(), duration_us);
     } else {
-        return "Invalid relay: " + args[1] + "\nValid options: 1, 2, all";
+        out.printf("Failed to pulse %.*s\n", static_cast<int>(args[1].size()), args[1].data());
+    }
+}
+
+void CommandInterpreter::handle_relay_set(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_relay_manager(out)) {
+        return;
     }
 
-    if (relay_manager_->toggle(relay_id)) {
-        return "Successfully toggled " + args[1];
+    constexpr size_t count = relay_control::RelayManager::RELAY_COUNT;
+    uint32_t mask = 0;
+    uint32_t values = 0;
+    bool valid = args.size() >= 2 && args[1].size() == count;
+    for (size_t i = 0; valid && i < count; i++) {
+        char c = ascii_tolower(args[1][i]);
+        valid = c == '0' || c == '1' || c == 'x';
+        if (c != 'x') {
+            mask |= 1u << i;
+        }
+        if (c == '1') {
+            values |= 1u << i;
+        }
+    }
+    if (!valid || mask == 0) {
+        out.printf("Usage: relay_set <states>   (%zu digits, relay 1 first: 1 = on, 0 = off, x = keep)\n", count);
+        return;
+    }
+
+    if (relay_manager_->set_relays(mask, values)) {
+        relay_manager_->write_status(out);
     } else {
-        return "Failed to toggle " + args[1];
+        out.write("Failed to set relays\n");
     }
 }
 
-std::string CommandInterpreter::generate_relay_status_response() {
-    if (!relay_manager_) {
-        return "Relay manager not available (single board variant).\nThis board does not have relay control capabilities.";
+// Longest schedule delay or period
+static constexpr uint64_t MAX_SCHEDULE_US = uint64_t{7} * 24 * 3600000000;
+
+// Epoch seconds of the next local HH:MM[:SS]; false if malformed or the clock is unset
+static bool parse_time_of_day(std::string_view text, int64_t& wall_time) {
+    uint32_t fields[3] = {0, 0, 0};
+    size_t count = 0;
+    while (count < 3) {
+        size_t colon = text.find(':');
+        std::string_view part = text.substr(0, colon);
+        if (part.size() != 2 || !parse_integer(part, fields[count], uint32_t{0}, count == 0 ? uint32_t{23} : uint32_t{59})) {
+            return false;
+        }
+        count++;
+        if (colon == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(colon + 1);
+    }
+    if (count < 2) {
+        return false;
     }
 
-    return relay_manager_->get_status();
+    time_t now = time(nullptr);
+    if (now < 1672531200) {
+        return false;
+    }
+    struct tm local;
+    localtime_r(&now, &local);
+    local.tm_hour = static_cast<int>(fields[0]);
+    local.tm_min = static_cast<int>(fields[1]);
+    local.tm_sec = static_cast<int>(fields[2]);
+    local.tm_isdst = -1;
+    time_t target = mktime(&local);
+    if (target <= now) {
+        local.tm_mday++;
+        local.tm_isdst = -1;
+        target = mktime(&local);
+    }
+    wall_time = static_cast<int64_t>(target);
+    return true;
 }
 
-std::string CommandInterpreter::generate_relay_debug_response() {
-    if (!relay_manager_) {
-        return "Relay manager not available (single board variant).\nThis board does not have relay control capabilities.";
+bool CommandInterpreter::require_relay_scheduler(ResponseWriter& out) {
+    if (!require_relay_manager(out)) {
+        return false;
+    }
+    if (!relay_scheduler_) {
+        out.write("Relay scheduler not available.\n");
+        return false;
+    }
+    return true;
+}
+
+void CommandInterpreter::handle_relay_schedule(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_relay_scheduler(out)) {
+        return;
+    }
+    if (args.size() == 1) {
+        relay_scheduler_->write_status(out);
+        return;
+    }
+
+    static constexpr const char* USAGE =
+        "Usage: relay_schedule <relay> <on|off|pulse=<time>> [in <time>|at HH:MM[:SS]] [every <time>]\n"
+        "       (times: 500us, 250ms, 2s, 5m, 1h; no suffix = ms)\n";
+
+    uint32_t relay_mask = 0;
+    if (!parse_relay_arg(args, "relay_schedule", relay_mask, out)) {
+        return;
+    }
+
+    relay_control::RelayAction action = {};
+    action.mask = relay_mask;
+    uint64_t value_us = 0;
+    std::string_view operation = args.size() > 2 ? args[2] : std::string_view();
+    if (equals_ignore_case(operation, "on")) {
+        action.values = action.mask;
+    } else if (equals_ignore_case(operation, "off")) {
+        action.values = 0;
+    } else if (operation.starts_with("pulse=") && parse_duration_us(operation.substr(6), value_us)) {
+        action.pulse_us = static_cast<uint32_t>(value_us);
+    } else {
+        out.write(USAGE);
+        return;
+    }
+
+    bool has_trigger = false;
+    for (size_t i = 3; i < args.size(); i += 2) {
+        std::string_view key = args[i];
+        std::string_view value = i + 1 < args.size() ? args[i + 1] : std::string_view();
+        if (equals_ignore_case(key, "in") && !has_trigger && parse_duration_us(value, value_us, MAX_SCHEDULE_US)) {
+            action.delay_ms = static_cast<uint32_t>(value_us / 1000);
+            has_trigger = true;
+        } else if (equals_ignore_case(key, "at") && !has_trigger) {
+            if (!parse_time_of_day(value, action.wall_time)) {
+                out.write("Invalid time of day, or the clock is not set yet (needs SNTP)\n");
+                return;
+            }
+            has_trigger = true;
+        } else if (equals_ignore_case(key, "every") && action.period_ms == 0 &&
+                   parse_duration_us(value, value_us, MAX_SCHEDULE_US) && value_us >= 1000) {
+            action.period_ms = static_cast<uint32_t>(value_us / 1000);
+        } else {
+            out.write(USAGE);
+            return;
+        }
+    }
+    if (!has_trigger) {
+        if (action.period_ms == 0) {
+            out.write(USAGE);
+            return;
+        }
+        // A bare "every" starts one period from now
+        action.delay_ms = action.period_ms;
+    }
+
+    uint16_t id = relay_scheduler_->add(action);
+    if (id == 0) {
+        out.printf("Failed to schedule (at most %zu actions)\n", relay_control::RelayScheduler::MAX_ACTIONS);
+        return;
+    }
+    out.printf("Scheduled action #%u\n", id);
+}
+
+void CommandInterpreter::handle_relay_cancel(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_relay_scheduler(out)) {
+        return;
+    }
+
+    uint32_t id = 0;
+    if (args.size() >= 2 && equals_ignore_case(args[1], "all")) {
+        if (relay_scheduler_->cancel_all()) {
+            out.write("Cancelled all scheduled actions\n");
+        } else {
+            out.write("Relay scheduler not running\n");
+        }
+    } else if (args.size() >= 2 && parse_integer(args[1], id, uint32_t{1}, uint32_t{UINT16_MAX})) {
+        if (relay_scheduler_->cancel(static_cast<uint16_t>(id))) {
+            out.printf("Cancelled action #%" PRIu32 "\n", id);
+        } else {
+            out.printf("No scheduled action #%" PRIu32 "\n", id);
+        }
+    } else {
+        out.write("Usage: relay_cancel <id|all>   (ids from 'relay_schedule')\n");
+    }
+}
+
+void CommandInterpreter::handle_relay_status(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_relay_manager(out)) {
+        return;
     }
 
-    return relay_manager_->get_debug_status();
+    relay_manager_->write_status(out);
+}
+
+void CommandInterpreter::handle_relay_debug(const CommandArgs& args, ResponseWriter& out) {
+    if (!require_relay_manager(out)) {
+        return;
+    }
+
+    relay_manager_->write_debug_status(out);
+}
+
+void CommandInterpreter::handle_unknown_command(std::string_view command, ResponseWriter& out) {
+    out.printf("Unknown command: '%.*s'. Type 'help' for available commands.\n",
+               static_cast<int>(command.size()), command.data());
+}
+
+bool CommandInterpreter::write_network_list(const wifi_config::ScanResults& results, ResponseWriter& out) {
+    out.write("\n=== Available WiFi Networks ===\n");
+    out.printf("No. %-32s RSSI  Ch  Security\n", "SSID");
+    out.printf("--- %-32s ----  --  --------\n", "--------------------------------");
+    
+    // Entries are copied one at a time; a version change means a new scan landed mid-list
+    bool consistent = true;
+    wifi_config::NetworkInfo network;
+    for (size_t i = 0; i < results.count; ++i) {
+        uint32_t version = 0;
+        if (!wifi_manager_->get_scanned_network(i, network, &version)) {
+            consistent = false;
+            break;
+        }
+        consistent = consistent && version == results.version;
+        out.printf("%2zu. %-32s %4d  %2u  %s\n", 
+                   i, 
+                   network.ssid, 
+                   network.rssi, 
+                   network.channel,
+                   auth_mode_to_string(network.auth_mode));
+    }
+    out.write("\n");
+    return consistent;
+}
+
+const char* CommandInterpreter::auth_mode_to_string(wifi_auth_mode_t auth_mode) {
+    switch (auth_mode) {
+        case WIFI_AUTH_OPEN: return "Open";
+        case WIFI_AUTH_WEP: return "WEP";
+        case WIFI_AUTH_WPA_PSK: return "WPA";
+        case WIFI_AUTH_WPA2_PSK: return "WPA2";
+        case WIFI_AUTH_WPA_WPA2_PSK: return "WPA/WPA2";
+        case WIFI_AUTH_WPA3_PSK: return "WPA3";
+        default: return "Unknown";
+    }
 }
 
-} // namespace command_interface
\ No newline at end of file
+} // namespace command_interface
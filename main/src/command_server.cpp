@@ -0,0 +1,440 @@
+#include "command_server.hpp"
+#include "response_writer.hpp"
+#include "perf_stats.hpp"
+#include "hosted_link.hpp"
+#include "event_bus.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+namespace net_command {
+
+static const char* TAG = "CommandServer";
+
+static constexpr char PROMPT[] = "> ";
+
+// A client that stops reading may hold up the server this long per send
+static constexpr int SEND_TIMEOUT_S = 2;
+
+CommandServer::CommandServer(CommandHandler handler)
+    : handler_(std::move(handler)), task_(nullptr), tcp_fd_(-1), udp_fd_(-1), event_rx_fd_(-1), event_tx_fd_(-1),
+      event_port_(0), current_client_(nullptr), clients_{}, client_count_(0), clients_accepted_(0),
+      clients_rejected_(0), commands_(0), datagrams_(0), datagrams_oversize_(0), event_clients_(0), events_pushed_(0), events_dropped_(0) {
+    for (Client& client : clients_) {
+        client.fd = -1;
+    }
+}
+
+CommandServer::~CommandServer() {
+    if (task_) {
+        vTaskDelete(task_);
+    }
+    for (Client& client : clients_) {
+        close_client(client);
+    }
+    if (tcp_fd_ >= 0) {
+        close(tcp_fd_);
+    }
+    if (udp_fd_ >= 0) {
+        close(udp_fd_);
+    }
+    if (event_rx_fd_ >= 0) {
+        close(event_rx_fd_);
+    }
+    if (event_tx_fd_ >= 0) {
+        close(event_tx_fd_);
+    }
+}
+
+int CommandServer::open_socket(int type, uint16_t port) {
+    int fd = socket(AF_INET, type, type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        (type == SOCK_STREAM && listen(fd, 2) != 0)) {
+        ESP_LOGE(TAG, "Failed to bind port %u: errno %d", port, errno);
+        close(fd);
+        return -1;
+    }
+
+    // select() reports readiness; reads must never block the other clients
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+bool CommandServer::open_event_sockets() {
+    event_rx_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    event_tx_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (event_rx_fd_ < 0 || event_tx_fd_ < 0) {
+        ESP_LOGW(TAG, "Failed to create event sockets: errno %d", errno);
+        return false;
+    }
+
+    // Any free loopback port; the bus task sends to whatever was assigned
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_len = sizeof(address);
+    if (bind(event_rx_fd_, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        getsockname(event_rx_fd_, reinterpret_cast<struct sockaddr*>(&address), &address_len) != 0) {
+        ESP_LOGW(TAG, "Failed to bind event socket: errno %d", errno);
+        return false;
+    }
+    event_port_ = ntohs(address.sin_port);
+    fcntl(event_rx_fd_, F_SETFL, fcntl(event_rx_fd_, F_GETFL, 0) | O_NONBLOCK);
+    return event_bus::subscribe(app_event_handler, this);
+}
+
+bool CommandServer::start() {
+    if (task_) {
+        return true;
+    }
+
+    if (CONFIG_NET_CMD_TCP_PORT > 0) {
+        tcp_fd_ = open_socket(SOCK_STREAM, CONFIG_NET_CMD_TCP_PORT);
+    }
+    if (CONFIG_NET_CMD_UDP_PORT > 0) {
+        udp_fd_ = open_socket(SOCK_DGRAM, CONFIG_NET_CMD_UDP_PORT);
+    }
+    if (tcp_fd_ < 0 && udp_fd_ < 0) {
+        ESP_LOGE(TAG, "No command server socket is open");
+        return false;
+    }
+    if (tcp_fd_ >= 0 && !open_event_sockets()) {
+        ESP_LOGW(TAG, "Push events unavailable over TCP");
+        if (event_rx_fd_ >= 0) {
+            close(event_rx_fd_);
+            event_rx_fd_ = -1;
+        }
+        if (event_tx_fd_ >= 0) {
+            close(event_tx_fd_);
+            event_tx_fd_ = -1;
+        }
+    }
+
+    BaseType_t rc = xTaskCreate(server_task, "net_cmd", CONFIG_NET_CMD_STACK_SIZE, this,
+                                hosted_link::task_priority(hosted_link::Interface::WIFI, CONFIG_NET_CMD_PRIORITY),
+                                &task_);
+    if (rc != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create command server task");
+        task_ = nullptr;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Command server listening (TCP %d, UDP %d, up to %u clients)",
+             tcp_fd_ >= 0 ? CONFIG_NET_CMD_TCP_PORT : 0, udp_fd_ >= 0 ? CONFIG_NET_CMD_UDP_PORT : 0,
+             static_cast<unsigned>(MAX_CLIENTS));
+    return true;
+}
+
+void CommandServer::server_task(void* arg) {
+    static_cast<CommandServer*>(arg)->run();
+}
+
+void CommandServer::run() {
+    while (true) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        int max_fd = -1;
+        auto watch = [&](int fd) {
+            if (fd >= 0) {
+                FD_SET(fd, &readable);
+                max_fd = std::max(max_fd, fd);
+            }
+        };
+        watch(tcp_fd_);
+        watch(udp_fd_);
+        watch(event_rx_fd_);
+        for (const Client& client : clients_) {
+            watch(client.fd);
+        }
+
+        // Sleeps until a connection, a datagram or client data arrives
+        int ready = select(max_fd + 1, &readable, nullptr, nullptr, nullptr);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                ESP_LOGW(TAG, "select failed: errno %d", errno);
+                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+            continue;
+        }
+
+        if (tcp_fd_ >= 0 && FD_ISSET(tcp_fd_, &readable)) {
+            accept_client();
+        }
+        if (udp_fd_ >= 0 && FD_ISSET(udp_fd_, &readable)) {
+            handle_datagram();
+        }
+        if (event_rx_fd_ >= 0 && FD_ISSET(event_rx_fd_, &readable)) {
+            forward_events();
+        }
+        for (Client& client : clients_) {
+            if (client.fd >= 0 && FD_ISSET(client.fd, &readable)) {
+                read_client(client);
+            }
+        }
+    }
+}
+
+void CommandServer::accept_client() {
+    struct sockaddr_in peer = {};
+    socklen_t peer_len = sizeof(peer);
+    int fd = accept(tcp_fd_, reinterpret_cast<struct sockaddr*>(&peer), &peer_len);
+    if (fd < 0) {
+        return;
+    }
+
+    auto slot = std::find_if(clients_.begin(), clients_.end(), [](const Client& c) { return c.fd < 0; });
+    if (slot == clients_.end()) {
+        clients_rejected_++;
+        static constexpr char BUSY[] = "Too many clients\n";
+        send(fd, BUSY, sizeof(BUSY) - 1, MSG_DONTWAIT);
+        close(fd);
+        return;
+    }
+
+    // Responses go out per write, not after Nagle's delay
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    // Drop clients that vanished without closing (power loss, roaming)
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enable, sizeof(enable));
+    int keep_idle = 30;
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &keep_idle, sizeof(keep_idle));
+    struct timeval send_timeout = {SEND_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+    slot->fd = fd;
+    slot->address = peer.sin_addr.s_addr;
+    slot->len = 0;
+    slot->overflow = false;
+    slot->events = false;
+    client_count_++;
+    clients_accepted_++;
+
+    char address_text[16];
+    inet_ntoa_r(peer.sin_addr, address_text, sizeof(address_text));
+    ESP_LOGI(TAG, "Client %s connected", address_text);
+    send_all(fd, PROMPT, sizeof(PROMPT) - 1);
+}
+
+void CommandServer::close_client(Client& client) {
+    if (client.fd < 0) {
+        return;
+    }
+    close(client.fd);
+    client.fd = -1;
+    if (client.events) {
+        client.events = false;
+        event_clients_--;
+    }
+    client_count_--;
+}
+
+void CommandServer::read_client(Client& client) {
+    int received = recv(client.fd, rx_, sizeof(rx_), MSG_DONTWAIT);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        ESP_LOGI(TAG, "Client disconnected");
+        close_client(client);
+        return;
+    }
+    int64_t received_us = esp_timer_get_time();
+
+    // Split into lines in bulk; a command may run before the rest of the read is scanned
+    for (int i = 0; i < received && client.fd >= 0; i++) {
+        char c = rx_[i];
+        if (c == '\n') {
+            if (client.overflow) {
+                static constexpr char TOO_LONG[] = "Line too long\n";
+                send_all(client.fd, TOO_LONG, sizeof(TOO_LONG) - 1);
+                send_all(client.fd, PROMPT, sizeof(PROMPT) - 1);
+            } else {
+                size_t len = client.len;
+                if (len > 0 && client.line[len - 1] == '\r') {
+                    len--;
+                }
+                run_line(client, std::string_view(client.line, len), received_us);
+            }
+            client.len = 0;
+            client.overflow = false;
+        } else if (client.len < MAX_LINE_LEN) {
+            client.line[client.len++] = c;
+        } else {
+            client.overflow = true;
+        }
+    }
+}
+
+void CommandServer::run_line(Client& client, std::string_view line, int64_t received_us) {
+    if (!line.empty()) {
+        commands_++;
+        int fd = client.fd;
+        ResponseSink sink = [fd](const char* data, size_t len) { return send_all(fd, data, len); };
+        current_client_ = &client;
+        telemetry::begin_command(telemetry::Source::NETWORK, received_us);
+        handler_(line, sink);
+        telemetry::end_command();
+        current_client_ = nullptr;
+    }
+    if (!send_all(client.fd, PROMPT, sizeof(PROMPT) - 1)) {
+        close_client(client);
+    }
+}
+
+void CommandServer::handle_datagram() {
+    struct sockaddr_in peer = {};
+    socklen_t peer_len = sizeof(peer);
+    int received = recvfrom(udp_fd_, datagram_, sizeof(datagram_), MSG_DONTWAIT,
+                            reinterpret_cast<struct sockaddr*>(&peer), &peer_len);
+    if (received <= 0) {
+        return;
+    }
+    int64_t received_us = esp_timer_get_time();
+    datagrams_++;
+
+    size_t len = static_cast<size_t>(received);
+    while (len > 0 && (datagram_[len - 1] == '\n' || datagram_[len - 1] == '\r')) {
+        len--;
+    }
+    if (static_cast<size_t>(received) > MAX_LINE_LEN) {
+        // recvfrom() truncated it; running the prefix could act on half a command
+        datagrams_oversize_++;
+        static constexpr char TOO_LONG[] = "Line too long\n";
+        sendto(udp_fd_, TOO_LONG, sizeof(TOO_LONG) - 1, MSG_DONTWAIT,
+               reinterpret_cast<struct sockaddr*>(&peer), peer_len);
+        return;
+    }
+    if (len == 0) {
+        return;
+    }
+
+    // Collect the whole reply so it goes back as one datagram
+    size_t reply_len = 0;
+    ResponseSink sink = [this, &reply_len](const char* data, size_t size) {
+        size_t copy = std::min(size, sizeof(udp_reply_) - reply_len);
+        memcpy(udp_reply_ + reply_len, data, copy);
+        reply_len += copy;
+        return copy == size;
+    };
+    telemetry::begin_command(telemetry::Source::NETWORK, received_us);
+    handler_(std::string_view(datagram_, len), sink);
+    telemetry::end_command();
+
+    if (reply_len > 0) {
+        sendto(udp_fd_, udp_reply_, reply_len, MSG_DONTWAIT,
+               reinterpret_cast<struct sockaddr*>(&peer), peer_len);
+    }
+}
+
+bool CommandServer::set_command_client_events(bool enable) {
+    if (xTaskGetCurrentTaskHandle() != task_ || current_client_ == nullptr || event_rx_fd_ < 0) {
+        return false;
+    }
+    if (current_client_->events != enable) {
+        current_client_->events = enable;
+        if (enable) {
+            event_clients_++;
+        } else {
+            event_clients_--;
+        }
+    }
+    return true;
+}
+
+bool CommandServer::get_command_client_events(bool& enabled) const {
+    if (xTaskGetCurrentTaskHandle() != task_ || current_client_ == nullptr || event_rx_fd_ < 0) {
+        return false;
+    }
+    enabled = current_client_->events;
+    return true;
+}
+
+void CommandServer::app_event_handler(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    CommandServer* server = static_cast<CommandServer*>(arg);
+    if (server->event_clients_.load() == 0) {
+        return;
+    }
+    char line[event_bus::MAX_LINE_LEN];
+    size_t len = event_bus::format(id, data, line, sizeof(line));
+    if (len == 0) {
+        return;
+    }
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(server->event_port_);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (sendto(server->event_tx_fd_, line, len, MSG_DONTWAIT, reinterpret_cast<struct sockaddr*>(&address),
+               sizeof(address)) < 0) {
+        server->events_dropped_++;
+    }
+}
+
+void CommandServer::forward_events() {
+    char line[event_bus::MAX_LINE_LEN];
+    int received;
+    while ((received = recv(event_rx_fd_, line, sizeof(line), MSG_DONTWAIT)) > 0) {
+        for (Client& client : clients_) {
+            if (client.fd < 0 || !client.events) {
+                continue;
+            }
+            if (send_all(client.fd, line, static_cast<size_t>(received))) {
+                events_pushed_++;
+            } else {
+                close_client(client);
+            }
+        }
+    }
+}
+
+bool CommandServer::send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        int sent = send(fd, data, len, 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+void CommandServer::write_status(command_interface::ResponseWriter& out) const {
+    out.write("=== Network Command Server ===\n");
+    if (tcp_fd_ >= 0) {
+        out.printf("TCP port: %d (%" PRIu32 "/%u clients)\n", CONFIG_NET_CMD_TCP_PORT,
+                   client_count_.load(), static_cast<unsigned>(MAX_CLIENTS));
+    } else {
+        out.write("TCP: off\n");
+    }
+    if (udp_fd_ >= 0) {
+        out.printf("UDP port: %d\n", CONFIG_NET_CMD_UDP_PORT);
+    } else {
+        out.write("UDP: off\n");
+    }
+    out.printf("Clients accepted: %" PRIu32 ", rejected (full): %" PRIu32 "\n",
+               clients_accepted_.load(), clients_rejected_.load());
+    out.printf("Commands: %" PRIu32 " TCP lines, %" PRIu32 " UDP datagrams (%" PRIu32 " too long)\n",
+               commands_.load(), datagrams_.load(), datagrams_oversize_.load());
+    if (event_rx_fd_ >= 0) {
+        out.printf("Push events: %" PRIu32 " client(s), %" PRIu32 " sent, %" PRIu32 " dropped\n",
+                   event_clients_.load(), events_pushed_.load(), events_dropped_.load());
+    } else {
+        out.write("Push events: off\n");
+    }
+}
+
+} // namespace net_command
@@ -0,0 +1,263 @@
+#include "credential_store.hpp"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "nvs.h"
+#include <algorithm>
+#include <cstring>
+
+namespace wifi_config {
+
+static const char* TAG = "CredentialStore";
+
+static const char* NVS_NAMESPACE = "wifi_prof";
+static const char* NVS_KEY_TABLE = "table";
+
+// Bump when WiFiProfile changes layout; older tables are discarded
+static constexpr uint16_t TABLE_VERSION = 1;
+
+struct StoredTableHeader {
+    uint16_t version;
+    uint16_t count;
+};
+
+CredentialStore::CredentialStore()
+    : profiles_{}, count_(0), previous_{}, previous_count_(0), initialized_(false) {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+CredentialStore::~CredentialStore() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+bool CredentialStore::initialize() {
+    if (initialized_) {
+        return true;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    uint8_t buffer[sizeof(StoredTableHeader) + sizeof(WiFiProfile) * MAX_PROFILES];
+    size_t length = sizeof(buffer);
+    ret = nvs_get_blob(handle, NVS_KEY_TABLE, buffer, &length);
+    nvs_close(handle);
+
+    initialized_ = true;
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGI(TAG, "No saved WiFi networks");
+        return true;
+    }
+    if (ret != ESP_OK || length < sizeof(StoredTableHeader)) {
+        ESP_LOGW(TAG, "Discarding unreadable profile table: %s", esp_err_to_name(ret));
+        return true;
+    }
+
+    StoredTableHeader header;
+    memcpy(&header, buffer, sizeof(header));
+    if (header.version != TABLE_VERSION || header.count > MAX_PROFILES ||
+        length != sizeof(header) + header.count * sizeof(WiFiProfile)) {
+        ESP_LOGW(TAG, "Discarding profile table (version %u, %u entries)", header.version, header.count);
+        return true;
+    }
+
+    memcpy(profiles_.data(), buffer + sizeof(header), header.count * sizeof(WiFiProfile));
+    count_ = header.count;
+    for (size_t i = 0; i < count_; i++) {
+        profiles_[i].ssid[sizeof(profiles_[i].ssid) - 1] = '\0';
+        profiles_[i].password[sizeof(profiles_[i].password) - 1] = '\0';
+    }
+
+    ESP_LOGI(TAG, "Loaded %u saved WiFi network(s)", static_cast<unsigned>(count_));
+    return true;
+}
+
+size_t CredentialStore::count() const {
+    return count_;
+}
+
+bool CredentialStore::get(size_t rank, WiFiProfile& profile) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool found = rank < count_;
+    if (found) {
+        profile = profiles_[rank];
+    }
+    xSemaphoreGive(mutex_);
+    return found;
+}
+
+bool CredentialStore::find(const std::string& ssid, WiFiProfile& profile) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int index = index_of(ssid.c_str());
+    if (index >= 0) {
+        profile = profiles_[index];
+    }
+    xSemaphoreGive(mutex_);
+    return index >= 0;
+}
+
+bool CredentialStore::save(const WiFiProfile& profile, size_t rank) {
+    if (!initialized_ || profile.ssid[0] == '\0') {
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stage();
+
+    // Re-saving a network keeps its learned link parameters unless new ones are given
+    WiFiProfile entry = profile;
+    entry.ssid[sizeof(entry.ssid) - 1] = '\0';
+    entry.password[sizeof(entry.password) - 1] = '\0';
+    int existing = index_of(entry.ssid);
+    if (existing >= 0) {
+        const WiFiProfile& old = profiles_[existing];
+        if (entry.channel == 0) {
+            memcpy(entry.bssid, old.bssid, sizeof(entry.bssid));
+            entry.channel = old.channel;
+            entry.auth_mode = old.auth_mode;
+        }
+        if (!entry.static_ip && !old.static_ip && entry.ip == 0) {
+            entry.ip = old.ip;
+        }
+        for (size_t i = existing; i + 1 < count_; i++) {
+            profiles_[i] = profiles_[i + 1];
+        }
+        count_--;
+    } else if (count_ == MAX_PROFILES) {
+        // Table full: the lowest-ranked network makes room
+        ESP_LOGW(TAG, "Profile table full, dropping %s", profiles_[count_ - 1].ssid);
+        count_--;
+    }
+
+    rank = std::min(rank, count_);
+    for (size_t i = count_; i > rank; i--) {
+        profiles_[i] = profiles_[i - 1];
+    }
+    profiles_[rank] = entry;
+    count_++;
+
+    bool ok = commit();
+    xSemaphoreGive(mutex_);
+
+    if (ok) {
+        ESP_LOGI(TAG, "Saved %s at rank %u", entry.ssid, static_cast<unsigned>(rank));
+    }
+    return ok;
+}
+
+bool CredentialStore::update_link(const std::string& ssid, const uint8_t bssid[6], uint8_t channel,
+                                  uint8_t auth_mode, uint32_t lease_ip) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int index = index_of(ssid.c_str());
+    if (index < 0) {
+        xSemaphoreGive(mutex_);
+        return false;
+    }
+
+    WiFiProfile& entry = profiles_[index];
+    bool changed = memcmp(entry.bssid, bssid, sizeof(entry.bssid)) != 0 ||
+                   entry.channel != channel || entry.auth_mode != auth_mode ||
+                   (!entry.static_ip && entry.ip != lease_ip);
+    if (changed) {
+        // Only write flash when the AP or lease moved; reconnects to the same BSS cost nothing
+        memcpy(entry.bssid, bssid, sizeof(entry.bssid));
+        entry.channel = channel;
+        entry.auth_mode = auth_mode;
+        if (!entry.static_ip) {
+            entry.ip = lease_ip;
+        }
+        persist();
+    }
+    xSemaphoreGive(mutex_);
+    return true;
+}
+
+bool CredentialStore::remove(size_t rank) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (rank >= count_) {
+        xSemaphoreGive(mutex_);
+        return false;
+    }
+
+    stage();
+    for (size_t i = rank; i + 1 < count_; i++) {
+        profiles_[i] = profiles_[i + 1];
+    }
+    count_--;
+    profiles_[count_] = WiFiProfile{};
+
+    bool ok = commit();
+    xSemaphoreGive(mutex_);
+    return ok;
+}
+
+bool CredentialStore::clear() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    stage();
+    count_ = 0;
+    profiles_.fill(WiFiProfile{});
+    bool ok = commit();
+    xSemaphoreGive(mutex_);
+    return ok;
+}
+
+int CredentialStore::index_of(const char* ssid) const {
+    for (size_t i = 0; i < count_; i++) {
+        if (strncmp(profiles_[i].ssid, ssid, sizeof(profiles_[i].ssid)) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Caller holds mutex_; keeps the table as it was before a change
+void CredentialStore::stage() {
+    previous_ = profiles_;
+    previous_count_ = count_;
+}
+
+// Caller holds mutex_; writes the changed table, or restores the staged one so
+// RAM never holds networks that would be gone after a reboot
+bool CredentialStore::commit() {
+    if (persist()) {
+        return true;
+    }
+    profiles_ = previous_;
+    count_ = previous_count_;
+    return false;
+}
+
+// Caller holds mutex_
+bool CredentialStore::persist() {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    uint8_t buffer[sizeof(StoredTableHeader) + sizeof(WiFiProfile) * MAX_PROFILES];
+    StoredTableHeader header = {TABLE_VERSION, static_cast<uint16_t>(count_)};
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), profiles_.data(), count_ * sizeof(WiFiProfile));
+
+    ret = nvs_set_blob(handle, NVS_KEY_TABLE, buffer, sizeof(header) + count_ * sizeof(WiFiProfile));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write profile table: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+} // namespace wifi_config
@@ -0,0 +1,131 @@
+#include "event_bus.hpp"
+#include "response_writer.hpp"
+#include "esp_log.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+namespace event_bus {
+
+ESP_EVENT_DEFINE_BASE(APP_EVENT);
+
+static const char* TAG = "EventBus";
+
+namespace {
+
+constexpr const char* EVENT_NAMES[EVENT_COUNT] = {
+    "wifi_up", "wifi_down", "ble_connected", "ble_disconnected", "ble_scan_done", "relay_changed",
+};
+
+esp_event_loop_handle_t loop = nullptr;
+std::atomic<uint32_t> subscribers{0};
+std::array<std::atomic<uint32_t>, EVENT_COUNT> posted{};
+std::array<std::atomic<uint32_t>, EVENT_COUNT> dropped{};
+
+template <typename T>
+const T& event_data(const void* data) {
+    return *static_cast<const T*>(data);
+}
+
+} // namespace
+
+bool init() {
+    if (loop != nullptr) {
+        return true;
+    }
+
+    esp_event_loop_args_t args = {};
+    args.queue_size = CONFIG_EVENT_BUS_QUEUE_SIZE;
+    args.task_name = "app_evt";
+    args.task_priority = CONFIG_EVENT_BUS_TASK_PRIORITY;
+    args.task_stack_size = CONFIG_EVENT_BUS_STACK_SIZE;
+    args.task_core_id = tskNO_AFFINITY;
+    esp_err_t ret = esp_event_loop_create(&args, &loop);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create event loop: %s", esp_err_to_name(ret));
+        loop = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool post(EventId id, const void* data, size_t size) {
+    size_t index = static_cast<size_t>(id);
+    if (loop == nullptr) {
+        return false;
+    }
+    if (esp_event_post_to(loop, APP_EVENT, static_cast<int32_t>(id), data, size, 0) != ESP_OK) {
+        dropped[index].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    posted[index].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool subscribe(esp_event_handler_t handler, void* arg) {
+    if (loop == nullptr) {
+        ESP_LOGW(TAG, "Event bus not running");
+        return false;
+    }
+    esp_err_t ret = esp_event_handler_instance_register_with(loop, APP_EVENT, ESP_EVENT_ANY_ID, handler, arg,
+                                                             nullptr);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe: %s", esp_err_to_name(ret));
+        return false;
+    }
+    subscribers++;
+    return true;
+}
+
+size_t format(int32_t id, const void* data, char* buffer, size_t size) {
+    int len = 0;
+    switch (static_cast<EventId>(id)) {
+        case EventId::WIFI_UP: {
+            const WifiUpEvent& event = event_data<WifiUpEvent>(data);
+            len = snprintf(buffer, size, "EVT wifi up ip=%" PRIu32 ".%" PRIu32 ".%" PRIu32 ".%" PRIu32 " ssid=%s\n",
+                           event.ip & 0xff, (event.ip >> 8) & 0xff, (event.ip >> 16) & 0xff, event.ip >> 24,
+                           event.ssid);
+            break;
+        }
+        case EventId::WIFI_DOWN:
+            len = snprintf(buffer, size, "EVT wifi down reason=%u\n", event_data<WifiDownEvent>(data).reason);
+            break;
+        case EventId::BLE_CONNECTED: {
+            const BleConnectionEvent& event = event_data<BleConnectionEvent>(data);
+            len = snprintf(buffer, size, "EVT ble connect handle=%u sessions=%u\n", event.conn_handle,
+                           event.sessions);
+            break;
+        }
+        case EventId::BLE_DISCONNECTED: {
+            const BleConnectionEvent& event = event_data<BleConnectionEvent>(data);
+            len = snprintf(buffer, size, "EVT ble disconnect handle=%u reason=0x%02x sessions=%u\n",
+                           event.conn_handle, event.reason, event.sessions);
+            break;
+        }
+        case EventId::BLE_SCAN_DONE:
+            len = snprintf(buffer, size, "EVT ble scan_done devices=%u\n", event_data<BleScanDoneEvent>(data).devices);
+            break;
+        case EventId::RELAY_CHANGED: {
+            const RelayChangedEvent& event = event_data<RelayChangedEvent>(data);
+            len = snprintf(buffer, size, "EVT relay states=0x%02" PRIx32 " changed=0x%02" PRIx32 "\n",
+                           event.states, event.changed);
+            break;
+        }
+        default:
+            return 0;
+    }
+    return len > 0 ? std::min(static_cast<size_t>(len), size - 1) : 0;
+}
+
+void write_status(command_interface::ResponseWriter& out) {
+    out.printf("Event bus: %s, %" PRIu32 " subscriber(s), queue %d\n", loop ? "running" : "off",
+               subscribers.load(), CONFIG_EVENT_BUS_QUEUE_SIZE);
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        out.printf("  %-17s %" PRIu32 " posted, %" PRIu32 " dropped\n", EVENT_NAMES[i], posted[i].load(),
+                   dropped[i].load());
+    }
+}
+
+} // namespace event_bus
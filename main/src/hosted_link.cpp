@@ -0,0 +1,220 @@
+#include "hosted_link.hpp"
+#include "perf_stats.hpp"
+#include "response_writer.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cinttypes>
+
+#if CONFIG_LWIP_STATS
+#include "lwip/stats.h"
+#endif
+
+// Run-time transport settings arrived with the ESP-Hosted 2.x host API
+#if __has_include("esp_hosted_transport_config.h")
+#include "esp_hosted_transport_config.h"
+#define HOSTED_LINK_RUNTIME_CONFIG 1
+#else
+#define HOSTED_LINK_RUNTIME_CONFIG 0
+#endif
+
+namespace hosted_link {
+
+static const char* TAG = "HostedLink";
+
+namespace {
+
+#if CONFIG_HOSTED_LINK_PROFILE_THROUGHPUT
+constexpr const char* PROFILE_NAME = "throughput";
+#elif CONFIG_HOSTED_LINK_PROFILE_ROBUST
+constexpr const char* PROFILE_NAME = "robust";
+#elif CONFIG_HOSTED_LINK_PROFILE_CUSTOM
+constexpr const char* PROFILE_NAME = "custom";
+#else
+constexpr const char* PROFILE_NAME = "component";
+#endif
+
+#if CONFIG_HOSTED_PRIORITY_HCI
+constexpr const char* PRIORITY_NAME = "BLE (HCI) first";
+#elif CONFIG_HOSTED_PRIORITY_WIFI
+constexpr const char* PRIORITY_NAME = "WiFi first";
+#else
+constexpr const char* PRIORITY_NAME = "balanced";
+#endif
+
+constexpr LinkConfig LINK_CONFIG = {
+    PROFILE_NAME,
+    CONFIG_HOSTED_SDIO_CLOCK_KHZ,
+    CONFIG_HOSTED_SDIO_TX_QUEUE_SIZE,
+    CONFIG_HOSTED_SDIO_RX_QUEUE_SIZE,
+};
+
+constexpr const char* INTERFACE_NAMES[] = {"WiFi data", "HCI (BLE)"};
+constexpr const char* PROBE_NAMES[] = {"WiFi RPC", "HCI command"};
+constexpr size_t INTERFACE_COUNT = sizeof(INTERFACE_NAMES) / sizeof(INTERFACE_NAMES[0]);
+
+telemetry::LatencyHistogram round_trips[INTERFACE_COUNT];
+
+// Counters at the previous report, for rates
+portMUX_TYPE rate_lock = portMUX_INITIALIZER_UNLOCKED;
+InterfaceCounters last_counters[INTERFACE_COUNT] = {};
+int64_t last_report_us = 0;
+
+// Per second over the interval, with one decimal for low packet rates
+void write_rate(command_interface::ResponseWriter& out, uint64_t delta, int64_t elapsed_us, const char* unit) {
+    uint64_t per_10s = elapsed_us > 0 ? delta * 10000000 / static_cast<uint64_t>(elapsed_us) : 0;
+    out.printf(" %" PRIu64 ".%" PRIu64 " %s", per_10s / 10, per_10s % 10, unit);
+}
+
+void write_interface(command_interface::ResponseWriter& out, Interface iface, const InterfaceCounters& now,
+                     const InterfaceCounters& before, int64_t elapsed_us) {
+    const char* name = INTERFACE_NAMES[static_cast<size_t>(iface)];
+    if (!now.available) {
+        out.printf("%s: not counted\n", name);
+        return;
+    }
+
+    out.printf("%s:\n", name);
+    out.printf("  TX %" PRIu64 " frames", now.tx_frames);
+    if (now.bytes_known) {
+        out.printf(" (%" PRIu64 " bytes)", now.tx_bytes);
+    }
+    out.printf(", RX %" PRIu64 " frames", now.rx_frames);
+    if (now.bytes_known) {
+        out.printf(" (%" PRIu64 " bytes)", now.rx_bytes);
+    }
+    out.printf(", %" PRIu64 " dropped", now.drops);
+    if (now.retries_known) {
+        out.printf(", %" PRIu64 " retried", now.retries);
+    }
+    out.write("\n");
+
+    if (elapsed_us <= 0 || !before.available) {
+        return;
+    }
+    out.write("  Rate:");
+    write_rate(out, now.tx_frames - before.tx_frames, elapsed_us, "tx frames/s,");
+    write_rate(out, now.rx_frames - before.rx_frames, elapsed_us, "rx frames/s");
+    if (now.bytes_known) {
+        uint64_t tx_bits = (now.tx_bytes - before.tx_bytes) * 8;
+        uint64_t rx_bits = (now.rx_bytes - before.rx_bytes) * 8;
+        out.printf(", %" PRIu64 " kbps tx, %" PRIu64 " kbps rx", tx_bits * 1000 / static_cast<uint64_t>(elapsed_us),
+                   rx_bits * 1000 / static_cast<uint64_t>(elapsed_us));
+    }
+    out.write("\n");
+}
+
+} // namespace
+
+const LinkConfig& link_config() {
+    return LINK_CONFIG;
+}
+
+bool apply_link_config() {
+    const LinkConfig& config = link_config();
+    if (config.sdio_clock_khz == 0 && config.tx_queue_size == 0 && config.rx_queue_size == 0) {
+        return true;
+    }
+
+#if HOSTED_LINK_RUNTIME_CONFIG && CONFIG_ESP_HOSTED_SDIO_HOST_INTERFACE
+    struct esp_hosted_sdio_config sdio = INIT_DEFAULT_HOST_SDIO_CONFIG();
+    if (config.sdio_clock_khz != 0) {
+        sdio.clock_freq_khz = config.sdio_clock_khz;
+    }
+    if (config.tx_queue_size != 0) {
+        sdio.tx_queue_size = config.tx_queue_size;
+    }
+    if (config.rx_queue_size != 0) {
+        sdio.rx_queue_size = config.rx_queue_size;
+    }
+    if (esp_hosted_sdio_set_config(&sdio) != ESP_TRANSPORT_OK) {
+        ESP_LOGE(TAG, "ESP-Hosted rejected the %s SDIO profile", config.profile);
+        return false;
+    }
+    ESP_LOGI(TAG, "SDIO profile %s: %" PRIu32 " kHz, TX queue %" PRIu32 ", RX queue %" PRIu32, config.profile,
+             static_cast<uint32_t>(sdio.clock_freq_khz), static_cast<uint32_t>(sdio.tx_queue_size),
+             static_cast<uint32_t>(sdio.rx_queue_size));
+    return true;
+#else
+    ESP_LOGW(TAG, "This ESP-Hosted version has no run-time SDIO settings; the %s profile is not applied",
+             config.profile);
+    return true;
+#endif
+}
+
+UBaseType_t task_priority(Interface iface, UBaseType_t configured) {
+#if CONFIG_HOSTED_PRIORITY_HCI
+    bool preferred = iface == Interface::HCI;
+#elif CONFIG_HOSTED_PRIORITY_WIFI
+    bool preferred = iface == Interface::WIFI;
+#else
+    bool preferred = false;
+#endif
+    return preferred ? std::min<UBaseType_t>(configured + 1, configMAX_PRIORITIES - 1) : configured;
+}
+
+void get_wifi_data_counters(InterfaceCounters& counters) {
+    counters = InterfaceCounters{};
+#if CONFIG_LWIP_STATS
+    // IP packets on every netif: in this firmware only the WiFi station carries any
+    counters.available = true;
+    counters.tx_frames = lwip_stats.ip.xmit;
+    counters.rx_frames = lwip_stats.ip.recv;
+    counters.drops = lwip_stats.link.drop + lwip_stats.ip.drop + lwip_stats.tcp.drop;
+#endif
+}
+
+void record_round_trip(Interface iface, int64_t round_trip_us) {
+    round_trips[static_cast<size_t>(iface)].record(round_trip_us);
+}
+
+void write_report(command_interface::ResponseWriter& out, const InterfaceCounters& wifi,
+                  const InterfaceCounters& hci) {
+    const LinkConfig& config = link_config();
+    out.write("=== ESP-Hosted Link ===\n");
+#if CONFIG_ESP_HOSTED_SDIO_HOST_INTERFACE
+    out.printf("Transport: SDIO, %d-bit bus, component clock %d kHz, queues TX %d / RX %d\n",
+               CONFIG_ESP_HOSTED_SDIO_BUS_WIDTH, CONFIG_ESP_HOSTED_SDIO_CLOCK_FREQ_KHZ,
+               CONFIG_ESP_HOSTED_SDIO_TX_Q_SIZE, CONFIG_ESP_HOSTED_SDIO_RX_Q_SIZE);
+#endif
+    bool overrides = config.sdio_clock_khz != 0 || config.tx_queue_size != 0 || config.rx_queue_size != 0;
+    out.printf("Profile: %s", config.profile);
+    if (config.sdio_clock_khz != 0) {
+        out.printf(", clock %" PRIu32 " kHz", config.sdio_clock_khz);
+    }
+    if (config.tx_queue_size != 0 || config.rx_queue_size != 0) {
+        out.printf(", queues TX %" PRIu32 " / RX %" PRIu32, config.tx_queue_size, config.rx_queue_size);
+    }
+    out.printf("%s\n", overrides && !HOSTED_LINK_RUNTIME_CONFIG ? " (not applied by this ESP-Hosted version)" : "");
+    out.printf("Priority: %s\n", PRIORITY_NAME);
+
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&rate_lock);
+    InterfaceCounters before[INTERFACE_COUNT] = {last_counters[0], last_counters[1]};
+    int64_t elapsed_us = last_report_us != 0 ? now_us - last_report_us : 0;
+    last_counters[static_cast<size_t>(Interface::WIFI)] = wifi;
+    last_counters[static_cast<size_t>(Interface::HCI)] = hci;
+    last_report_us = now_us;
+    taskEXIT_CRITICAL(&rate_lock);
+
+    if (elapsed_us > 0) {
+        out.printf("\nTraffic (rates over the last %" PRId64 " ms):\n", elapsed_us / 1000);
+    } else {
+        out.write("\nTraffic (rates from the next report on):\n");
+    }
+    write_interface(out, Interface::WIFI, wifi, before[static_cast<size_t>(Interface::WIFI)], elapsed_us);
+    write_interface(out, Interface::HCI, hci, before[static_cast<size_t>(Interface::HCI)], elapsed_us);
+
+    out.write("\nRound trips ('hosted_stats probe' to sample):\n");
+    for (size_t i = 0; i < INTERFACE_COUNT; i++) {
+        round_trips[i].write(out, PROBE_NAMES[i]);
+    }
+}
+
+void reset() {
+    for (telemetry::LatencyHistogram& histogram : round_trips) {
+        histogram.reset();
+    }
+}
+
+} // namespace hosted_link
@@ -0,0 +1,100 @@
+#include "init_graph.hpp"
+#include "boot_stats.hpp"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace system_init {
+
+static const char* TAG = "InitGraph";
+
+InitGraph::InitGraph() : stages_{}, tasks_{}, stage_count_(0), done_(xEventGroupCreate()), failed_(0) {
+}
+
+InitGraph::~InitGraph() {
+    if (done_) {
+        vEventGroupDelete(done_);
+    }
+}
+
+InitGraph::StageId InitGraph::add_stage(const char* name, StageFn fn, uint32_t depends_on, BaseType_t core,
+                                        uint32_t stack_size) {
+    if (stage_count_ >= MAX_STAGES) {
+        ESP_LOGE(TAG, "Too many init stages, dropping %s", name);
+        return MAX_STAGES;
+    }
+
+    StageId id = stage_count_++;
+    // Stages may only wait for earlier ones, so the graph cannot deadlock on a cycle
+    uint32_t earlier = stage_bit(id) - 1;
+    if (depends_on & ~earlier) {
+        ESP_LOGE(TAG, "Stage %s depends on a later stage", name);
+        depends_on &= earlier;
+    }
+    stages_[id] = Stage{name, std::move(fn), depends_on, core, stack_size};
+    return id;
+}
+
+bool InitGraph::run() {
+    if (!done_) {
+        ESP_LOGE(TAG, "Failed to create init event group");
+        return false;
+    }
+
+    for (StageId id = 0; id < stage_count_; id++) {
+        tasks_[id] = StageTask{this, id};
+        BaseType_t rc = xTaskCreatePinnedToCore(stage_task, stages_[id].name, stages_[id].stack_size,
+                                                &tasks_[id], tskIDLE_PRIORITY + 5, nullptr, stages_[id].core);
+        if (rc != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start init stage %s", stages_[id].name);
+            finish_stage(id, false);
+        }
+    }
+
+    uint32_t all = stage_bit(stage_count_) - 1;
+    xEventGroupWaitBits(done_, all, pdFALSE, pdTRUE, portMAX_DELAY);
+    return (failed_.load() & all) == 0;
+}
+
+bool InitGraph::succeeded(StageId id) const {
+    return id < stage_count_ && (failed_.load() & stage_bit(id)) == 0;
+}
+
+void InitGraph::stage_task(void* arg) {
+    const StageTask* task = static_cast<const StageTask*>(arg);
+    task->graph->run_stage(task->id);
+    vTaskDelete(nullptr);
+}
+
+void InitGraph::run_stage(StageId id) {
+    const Stage& stage = stages_[id];
+    if (stage.depends_on != 0) {
+        xEventGroupWaitBits(done_, stage.depends_on, pdFALSE, pdTRUE, portMAX_DELAY);
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    if (failed_.load() & stage.depends_on) {
+        ESP_LOGW(TAG, "Skipping %s: a stage it depends on failed", stage.name);
+        telemetry::record_boot_stage(stage.name, start_us, start_us, xPortGetCoreID(),
+                                     telemetry::BootStageResult::SKIPPED);
+        finish_stage(id, false);
+        return;
+    }
+
+    bool ok = stage.fn();
+    telemetry::record_boot_stage(stage.name, start_us, esp_timer_get_time(), xPortGetCoreID(),
+                                 ok ? telemetry::BootStageResult::OK : telemetry::BootStageResult::FAILED);
+    if (!ok) {
+        ESP_LOGE(TAG, "Init stage %s failed", stage.name);
+    }
+    finish_stage(id, ok);
+}
+
+void InitGraph::finish_stage(StageId id, bool ok) {
+    // Publish the failure before the done bit so dependents see both together
+    if (!ok) {
+        failed_ |= stage_bit(id);
+    }
+    xEventGroupSetBits(done_, stage_bit(id));
+}
+
+} // namespace system_init
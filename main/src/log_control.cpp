@@ -0,0 +1,235 @@
+#include "log_control.hpp"
+#include "command_args.hpp"
+#include "response_writer.hpp"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace logging {
+
+static const char* TAG = "LogControl";
+
+namespace {
+
+constexpr const char* LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug", "verbose"};
+constexpr const char* OUTPUT_NAMES[] = {"console", "ring", "both"};
+
+// Tags listed by `log`; any other tag can still be set by name
+constexpr const char* PROJECT_TAGS[] = {
+    "main", "InitGraph", "RelayManager", "RelayScheduler", "CommandInterpreter", "SerialConsole",
+    "CommandServer", "BLEManager", "BLEObserver", "WiFiManager", "CredentialStore", "MacroStore",
+    "LogControl", "HostedLink", "PowerManager", "EventBus", "wifi", "NimBLE",
+};
+
+std::atomic<LogOutput> current_output{LogOutput::CONSOLE};
+std::atomic<vprintf_like_t> console_vprintf{nullptr};
+
+// Ring of the last ring_size bytes of log text. ring_written counts every
+// byte ever appended, so a position below ring_written - ring_size is gone.
+portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+char* ring = nullptr;
+size_t ring_size = 0;
+uint64_t ring_written = 0;
+uint64_t ring_cleared = 0;   // Nothing below this position is shown
+
+uint64_t oldest_position() {
+    uint64_t oldest = ring_written > ring_size ? ring_written - ring_size : 0;
+    return std::max(oldest, ring_cleared);
+}
+
+void ring_append(const char* data, size_t len) {
+    taskENTER_CRITICAL(&ring_lock);
+    size_t offset = static_cast<size_t>(ring_written % ring_size);
+    size_t first = std::min(len, ring_size - offset);
+    memcpy(ring + offset, data, first);
+    memcpy(ring, data + first, len - first);
+    ring_written += len;
+    taskEXIT_CRITICAL(&ring_lock);
+}
+
+int log_vprintf(const char* format, va_list args) {
+    LogOutput target = current_output.load(std::memory_order_relaxed);
+    if (target != LogOutput::CONSOLE) {
+        char line[LOG_RING_LINE_MAX];
+        va_list ring_args;
+        va_copy(ring_args, args);
+        int len = vsnprintf(line, sizeof(line), format, ring_args);
+        va_end(ring_args);
+        if (len > 0) {
+            size_t used = std::min(static_cast<size_t>(len), sizeof(line) - 1);
+            // Keep cut lines terminated so the next one starts on its own line
+            if (used < static_cast<size_t>(len)) {
+                line[used - 1] = '\n';
+            }
+            ring_append(line, used);
+        }
+        if (target == LogOutput::RING) {
+            return len;
+        }
+    }
+
+    vprintf_like_t console = console_vprintf.load(std::memory_order_relaxed);
+    return console ? console(format, args) : vprintf(format, args);
+}
+
+} // namespace
+
+bool init() {
+#if CONFIG_LOG_RING
+    constexpr size_t size = CONFIG_LOG_RING_BUFFER_SIZE;
+    static_assert(size >= LOG_RING_LINE_MAX, "Log ring must hold at least one line");
+    // Logs are only read on demand, so PSRAM is good enough when there is some
+    char* buffer = static_cast<char*>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM));
+    if (buffer == nullptr) {
+        buffer = static_cast<char*>(heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    }
+    if (buffer == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %zu byte log ring", size);
+        return false;
+    }
+
+    taskENTER_CRITICAL(&ring_lock);
+    ring = buffer;
+    ring_size = size;
+    taskEXIT_CRITICAL(&ring_lock);
+
+#if CONFIG_LOG_RING_ONLY
+    current_output = LogOutput::RING;
+#else
+    current_output = LogOutput::BOTH;
+#endif
+    console_vprintf = esp_log_set_vprintf(log_vprintf);
+#endif
+    return true;
+}
+
+bool set_output(LogOutput output) {
+    if (output != LogOutput::CONSOLE && ring == nullptr) {
+        return false;
+    }
+    current_output = output;
+    return true;
+}
+
+LogOutput output() {
+    return current_output.load();
+}
+
+const char* output_to_string(LogOutput output) {
+    return OUTPUT_NAMES[static_cast<size_t>(output)];
+}
+
+bool parse_level(std::string_view text, esp_log_level_t& level) {
+    for (size_t i = 0; i < std::size(LEVEL_NAMES); i++) {
+        if (command_interface::equals_ignore_case(text, LEVEL_NAMES[i])) {
+            level = static_cast<esp_log_level_t>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* level_to_string(esp_log_level_t level) {
+    size_t index = static_cast<size_t>(level);
+    return index < std::size(LEVEL_NAMES) ? LEVEL_NAMES[index] : "?";
+}
+
+void write_status(command_interface::ResponseWriter& out) {
+    out.printf("Log output: %s\n", output_to_string(output()));
+
+    taskENTER_CRITICAL(&ring_lock);
+    size_t size = ring_size;
+    uint64_t written = ring_written;
+    uint64_t held = written - oldest_position();
+    taskEXIT_CRITICAL(&ring_lock);
+    if (size == 0) {
+        out.write("Log ring: off (CONFIG_LOG_RING is not set)\n");
+    } else {
+        out.printf("Log ring: %" PRIu64 " of %zu bytes held, %" PRIu64 " logged since boot\n", held, size, written);
+    }
+
+    out.printf("Levels (max compiled in: %s):\n", level_to_string(static_cast<esp_log_level_t>(LOG_LOCAL_LEVEL)));
+    for (const char* tag : PROJECT_TAGS) {
+        out.printf("  %-20s %s\n", tag, level_to_string(esp_log_level_get(tag)));
+    }
+}
+
+void dump_ring(command_interface::ResponseWriter& out) {
+    taskENTER_CRITICAL(&ring_lock);
+    uint64_t end = ring_written;
+    uint64_t position = oldest_position();
+    taskEXIT_CRITICAL(&ring_lock);
+    if (ring_size == 0) {
+        out.write("Log ring is off\n");
+        return;
+    }
+
+    // The oldest byte is usually mid-line once the ring has wrapped
+    bool skip_partial = position > ring_cleared;
+    char chunk[128];
+    while (position < end) {
+        taskENTER_CRITICAL(&ring_lock);
+        uint64_t oldest = oldest_position();
+        if (position < oldest) {
+            // Overwritten since the last chunk
+            position = oldest;
+            skip_partial = true;
+        }
+        size_t len = static_cast<size_t>(std::min<uint64_t>(sizeof(chunk), end > position ? end - position : 0));
+        size_t offset = static_cast<size_t>(position % ring_size);
+        size_t first = std::min(len, ring_size - offset);
+        memcpy(chunk, ring + offset, first);
+        memcpy(chunk + first, ring, len - first);
+        taskEXIT_CRITICAL(&ring_lock);
+
+        if (len == 0) {
+            break;
+        }
+        position += len;
+
+        const char* data = chunk;
+        if (skip_partial) {
+            const char* newline = static_cast<const char*>(memchr(chunk, '\n', len));
+            if (newline == nullptr) {
+                continue;
+            }
+            data = newline + 1;
+            len -= static_cast<size_t>(data - chunk);
+            skip_partial = false;
+        }
+        out.write(data, len);
+    }
+}
+
+void clear_ring() {
+    taskENTER_CRITICAL(&ring_lock);
+    ring_cleared = ring_written;
+    taskEXIT_CRITICAL(&ring_lock);
+}
+
+bool RateLimiter::allow(uint32_t period_ms, uint32_t& suppressed) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t next_us = next_us_.load(std::memory_order_relaxed);
+    if (now_us < next_us ||
+        !next_us_.compare_exchange_strong(next_us, now_us + int64_t{period_ms} * 1000, std::memory_order_relaxed)) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+bool Sampler::allow(uint32_t every, uint32_t& skipped) {
+    uint32_t count = count_.fetch_add(1, std::memory_order_relaxed);
+    if (every > 1 && count % every != 0) {
+        return false;
+    }
+    skipped = count == 0 || every <= 1 ? 0 : every - 1;
+    return true;
+}
+
+} // namespace logging
@@ -0,0 +1,187 @@
+#include "macro_store.hpp"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "nvs.h"
+#include <cstddef>
+#include <cstring>
+
+namespace command_interface {
+
+static const char* TAG = "MacroStore";
+
+static const char* NVS_NAMESPACE = "cmd_macro";
+static const char* NVS_KEY_TABLE = "table";
+
+// Only the used part of the table is stored
+size_t MacroStore::stored_size(size_t count) {
+    return offsetof(StoredTable, macros) + count * sizeof(Macro);
+}
+
+MacroStore::MacroStore()
+    : table_{}, initialized_(false) {
+    mutex_ = xSemaphoreCreateMutex();
+}
+
+MacroStore::~MacroStore() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+bool MacroStore::initialize() {
+    if (initialized_) {
+        return true;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    size_t length = sizeof(table_);
+    ret = nvs_get_blob(handle, NVS_KEY_TABLE, &table_, &length);
+    nvs_close(handle);
+
+    initialized_ = true;
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        table_ = StoredTable{};
+        return true;
+    }
+    if (ret != ESP_OK || length < stored_size(0) || table_.version != TABLE_VERSION ||
+        table_.count > MAX_MACROS || length != stored_size(table_.count)) {
+        ESP_LOGW(TAG, "Discarding unreadable macro table: %s", esp_err_to_name(ret));
+        table_ = StoredTable{};
+        return true;
+    }
+
+    for (size_t i = 0; i < table_.count; i++) {
+        table_.macros[i].name[Macro::MAX_NAME_LEN] = '\0';
+        table_.macros[i].body[Macro::MAX_BODY_LEN] = '\0';
+    }
+
+    ESP_LOGI(TAG, "Loaded %u macro(s)", table_.count);
+    return true;
+}
+
+size_t MacroStore::count() const {
+    return table_.count;
+}
+
+bool MacroStore::get(size_t index, Macro& macro) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool found = index < table_.count;
+    if (found) {
+        macro = table_.macros[index];
+    }
+    xSemaphoreGive(mutex_);
+    return found;
+}
+
+bool MacroStore::find(std::string_view name, Macro& macro) const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int index = index_of(name);
+    if (index >= 0) {
+        macro = table_.macros[index];
+    }
+    xSemaphoreGive(mutex_);
+    return index >= 0;
+}
+
+MacroResult MacroStore::save(std::string_view name, std::string_view body) {
+    if (name.empty() || name.size() > Macro::MAX_NAME_LEN || body.size() > Macro::MAX_BODY_LEN) {
+        return MacroResult::INVALID;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int index = index_of(name);
+    bool replacing = index >= 0;
+    if (!replacing) {
+        if (table_.count == MAX_MACROS) {
+            xSemaphoreGive(mutex_);
+            ESP_LOGW(TAG, "Macro table full (%u)", static_cast<unsigned>(MAX_MACROS));
+            return MacroResult::FULL;
+        }
+        index = table_.count++;
+    }
+
+    // Kept until the table is written, to restore on failure
+    Macro& macro = table_.macros[index];
+    Macro previous = macro;
+    macro = Macro{};
+    memcpy(macro.name, name.data(), name.size());
+    memcpy(macro.body, body.data(), body.size());
+
+    bool ok = persist();
+    if (!ok) {
+        macro = previous;
+        if (!replacing) {
+            table_.count--;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return ok ? MacroResult::OK : MacroResult::NVS_FAILED;
+}
+
+MacroResult MacroStore::remove(std::string_view name) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    int index = index_of(name);
+    if (index < 0) {
+        xSemaphoreGive(mutex_);
+        return MacroResult::NOT_FOUND;
+    }
+
+    // The last slot keeps its copy after the shift, so the removed macro is all there is to restore
+    Macro removed = table_.macros[index];
+    for (size_t i = index; i + 1 < table_.count; i++) {
+        table_.macros[i] = table_.macros[i + 1];
+    }
+    table_.count--;
+
+    bool ok = persist();
+    if (!ok) {
+        for (size_t i = table_.count; i > static_cast<size_t>(index); i--) {
+            table_.macros[i] = table_.macros[i - 1];
+        }
+        table_.macros[index] = removed;
+        table_.count++;
+    }
+    xSemaphoreGive(mutex_);
+    return ok ? MacroResult::OK : MacroResult::NVS_FAILED;
+}
+
+int MacroStore::index_of(std::string_view name) const {
+    for (size_t i = 0; i < table_.count; i++) {
+        if (name == table_.macros[i].name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Caller holds mutex_
+bool MacroStore::persist() {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    table_.version = TABLE_VERSION;
+    ret = nvs_set_blob(handle, NVS_KEY_TABLE, &table_, stored_size(table_.count));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write macro table: %s", esp_err_to_name(ret));
+        return false;
+    }
+    return true;
+}
+
+} // namespace command_interface
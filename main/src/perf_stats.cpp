@@ -0,0 +1,159 @@
+#include "perf_stats.hpp"
+#include "response_writer.hpp"
+#include "esp_timer.h"
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+
+namespace telemetry {
+
+namespace {
+
+// Stages timed for every traced command, measured from when it arrived
+enum Stage : size_t {
+    STAGE_DISPATCH,   // Received -> handler starts (queueing, logging, parsing)
+    STAGE_GPIO,       // Handler starts -> first relay edge
+    STAGE_EDGE,       // Received -> first relay edge
+    STAGE_RESPONSE,   // Received -> response handed to the transport
+    STAGE_COUNT
+};
+
+constexpr const char* STAGE_NAMES[STAGE_COUNT] = {"rx->dispatch", "dispatch->gpio", "rx->gpio", "rx->response"};
+constexpr const char* SOURCE_NAMES[] = {"Console", "BLE", "Network"};
+constexpr size_t SOURCE_COUNT = sizeof(SOURCE_NAMES) / sizeof(SOURCE_NAMES[0]);
+
+struct Trace {
+    bool active;
+    Source source;
+    int64_t received_us;
+    int64_t dispatch_us;   // 0 until the first handler starts
+    int64_t edge_us;       // 0 until the first relay write
+};
+
+LatencyHistogram histograms[SOURCE_COUNT][STAGE_COUNT];
+
+// One trace per task
+thread_local Trace current_trace = {};
+
+LatencyHistogram& histogram(Source source, Stage stage) {
+    return histograms[static_cast<size_t>(source)][stage];
+}
+
+} // namespace
+
+void LatencyHistogram::record(int64_t latency_us) {
+    latency_us = std::max<int64_t>(latency_us, 0);
+    size_t bucket = std::min<size_t>(std::bit_width(static_cast<uint64_t>(latency_us)), BUCKETS - 1);
+
+    taskENTER_CRITICAL(&lock_);
+    buckets_[bucket]++;
+    count_++;
+    total_us_ += static_cast<uint64_t>(latency_us);
+    max_us_ = std::max(max_us_, latency_us);
+    taskEXIT_CRITICAL(&lock_);
+}
+
+void LatencyHistogram::reset() {
+    taskENTER_CRITICAL(&lock_);
+    buckets_.fill(0);
+    count_ = 0;
+    total_us_ = 0;
+    max_us_ = 0;
+    taskEXIT_CRITICAL(&lock_);
+}
+
+int64_t LatencyHistogram::percentile_us(const std::array<uint32_t, BUCKETS>& buckets, uint32_t count,
+                                        uint32_t per_mille) {
+    uint64_t target = (static_cast<uint64_t>(count) * per_mille + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return int64_t{1} << i;
+        }
+    }
+    return int64_t{1} << (BUCKETS - 1);
+}
+
+void LatencyHistogram::write(command_interface::ResponseWriter& out, const char* name) const {
+    taskENTER_CRITICAL(&lock_);
+    std::array<uint32_t, BUCKETS> buckets = buckets_;
+    uint32_t count = count_;
+    uint64_t total_us = total_us_;
+    int64_t max_us = max_us_;
+    taskEXIT_CRITICAL(&lock_);
+
+    if (count == 0) {
+        out.printf("  %-15s no samples\n", name);
+        return;
+    }
+
+    out.printf("  %-15s n=%" PRIu32 " avg=%" PRIu64 "us p50<%" PRId64 "us p99<%" PRId64 "us max=%" PRId64 "us\n",
+               name, count, total_us / count, percentile_us(buckets, count, 500),
+               percentile_us(buckets, count, 990), max_us);
+    out.write("   ");
+    for (size_t i = 0; i < BUCKETS; i++) {
+        if (buckets[i] != 0) {
+            out.printf(" <%" PRId64 "us:%" PRIu32, int64_t{1} << i, buckets[i]);
+        }
+    }
+    out.write("\n");
+}
+
+void begin_command(Source source, int64_t received_us) {
+    current_trace = Trace{true, source, received_us, 0, 0};
+}
+
+void mark_dispatch() {
+    Trace& trace = current_trace;
+    if (trace.active && trace.dispatch_us == 0) {
+        trace.dispatch_us = esp_timer_get_time();
+        histogram(trace.source, STAGE_DISPATCH).record(trace.dispatch_us - trace.received_us);
+    }
+}
+
+bool mark_gpio_edge(int64_t edge_us) {
+    Trace& trace = current_trace;
+    if (!trace.active || trace.edge_us != 0) {
+        return false;
+    }
+    trace.edge_us = edge_us;
+    if (trace.dispatch_us != 0) {
+        histogram(trace.source, STAGE_GPIO).record(edge_us - trace.dispatch_us);
+    }
+    histogram(trace.source, STAGE_EDGE).record(edge_us - trace.received_us);
+    return true;
+}
+
+void end_command() {
+    Trace& trace = current_trace;
+    if (trace.active) {
+        histogram(trace.source, STAGE_RESPONSE).record(esp_timer_get_time() - trace.received_us);
+        trace.active = false;
+    }
+}
+
+int64_t command_received_us() {
+    const Trace& trace = current_trace;
+    return trace.active ? trace.received_us : 0;
+}
+
+void write_report(command_interface::ResponseWriter& out) {
+    out.write("=== Command Latency (log2 buckets) ===\n");
+    for (size_t source = 0; source < SOURCE_COUNT; source++) {
+        out.printf("%s:\n", SOURCE_NAMES[source]);
+        for (size_t stage = 0; stage < STAGE_COUNT; stage++) {
+            histograms[source][stage].write(out, STAGE_NAMES[stage]);
+        }
+    }
+}
+
+void reset() {
+    for (auto& stages : histograms) {
+        for (LatencyHistogram& stage : stages) {
+            stage.reset();
+        }
+    }
+}
+
+} // namespace telemetry
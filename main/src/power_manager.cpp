@@ -0,0 +1,341 @@
+#include "power_manager.hpp"
+#include "wifi_manager.hpp"
+#include "ble_manager.hpp"
+#include "command_args.hpp"
+#include "response_writer.hpp"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#if CONFIG_POWER_LIGHT_SLEEP
+#include "driver/gpio.h"
+#include "esp_sleep.h"
+#endif
+#include <algorithm>
+#include <cinttypes>
+
+namespace power {
+
+static const char* TAG = "PowerManager";
+
+PowerManager* PowerManager::instance_ = nullptr;
+
+namespace {
+
+constexpr const char* MODE_NAMES[] = {"performance", "idle"};
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// 32-bit by default, so a residency window longer than ~71 minutes of idle wraps
+using RunTimeCounter = configRUN_TIME_COUNTER_TYPE;
+
+RunTimeCounter idle_run_time(BaseType_t core) {
+    return ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+}
+#endif
+
+} // namespace
+
+PowerManager::PowerManager(std::shared_ptr<wifi_config::WiFiManager> wifi_manager,
+                           std::shared_ptr<ble_serial::BLEManager> ble_manager)
+    : wifi_manager_(std::move(wifi_manager)), ble_manager_(std::move(ble_manager)),
+      mode_(PowerMode::PERFORMANCE), light_sleep_active_(false), latency_tripped_(false),
+#if CONFIG_POWER_ESP_PM
+      cpu_lock_(nullptr), sleep_lock_(nullptr),
+#endif
+      stats_lock_(portMUX_INITIALIZER_UNLOCKED), latency_misses_(0), worst_miss_us_(0),
+      window_start_us_(0), idle_start_{}, sleep_us_(0), sleep_count_(0), gpio_wake_us_(0) {
+}
+
+PowerManager::~PowerManager() {
+    if (instance_ == this) {
+        instance_ = nullptr;
+    }
+#if CONFIG_POWER_ESP_PM
+    if (cpu_lock_) {
+        esp_pm_lock_delete(cpu_lock_);
+    }
+    if (sleep_lock_) {
+        esp_pm_lock_delete(sleep_lock_);
+    }
+#endif
+}
+
+bool PowerManager::initialize() {
+#if CONFIG_POWER_ESP_PM
+    esp_err_t ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "cmd_cpu", &cpu_lock_);
+    if (ret == ESP_OK) {
+        ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "cmd_awake", &sleep_lock_);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create PM locks: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t callbacks = {};
+    callbacks.exit_cb = &PowerManager::light_sleep_exit;
+    callbacks.exit_cb_user_arg = this;
+    ret = esp_pm_light_sleep_register_cbs(&callbacks);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep residency unavailable: %s", esp_err_to_name(ret));
+    }
+#endif
+#endif
+    if (!configure_wakeup()) {
+        return false;
+    }
+
+    instance_ = this;
+    reset_stats();
+#if CONFIG_POWER_BOOT_MODE_IDLE
+    return set_mode(PowerMode::IDLE);
+#else
+    return set_mode(PowerMode::PERFORMANCE);
+#endif
+}
+
+bool PowerManager::set_mode(PowerMode mode) {
+    bool light_sleep = false;
+#if CONFIG_POWER_LIGHT_SLEEP
+    light_sleep = mode == PowerMode::IDLE;
+#endif
+    if (!apply_cpu_settings(mode, light_sleep)) {
+        return false;
+    }
+    latency_tripped_ = false;
+    mode_ = mode;
+    apply_radio_settings(mode);
+    actuation_latency_.reset();
+    ESP_LOGI(TAG, "Power mode %s", mode_to_string(mode));
+    return true;
+}
+
+bool PowerManager::configure_wakeup() {
+#if CONFIG_POWER_LIGHT_SLEEP
+    // DAT1 idles high and the coprocessor pulls it low when it has data for the host
+    constexpr gpio_num_t pin = static_cast<gpio_num_t>(CONFIG_POWER_WAKEUP_GPIO);
+    esp_err_t ret = gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+    if (ret == ESP_OK) {
+        ret = esp_sleep_enable_gpio_wakeup();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set GPIO%d as light sleep wakeup: %s", CONFIG_POWER_WAKEUP_GPIO,
+                 esp_err_to_name(ret));
+        return false;
+    }
+    ESP_LOGI(TAG, "Light sleep wakes on GPIO%d (SDIO interrupt)", CONFIG_POWER_WAKEUP_GPIO);
+#endif
+    return true;
+}
+
+PowerMode PowerManager::get_mode() const {
+    return mode_.load();
+}
+
+bool PowerManager::apply_cpu_settings(PowerMode mode, bool light_sleep) {
+#if CONFIG_POWER_ESP_PM
+    esp_pm_config_t config = {};
+    config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    config.min_freq_mhz = mode == PowerMode::IDLE ? CONFIG_POWER_IDLE_MIN_FREQ_MHZ : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    config.light_sleep_enable = light_sleep;
+    esp_err_t ret = esp_pm_configure(&config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure power management: %s", esp_err_to_name(ret));
+        return false;
+    }
+    light_sleep_active_ = light_sleep;
+    return true;
+#else
+    if (mode == PowerMode::IDLE) {
+        ESP_LOGW(TAG, "esp_pm is not used (CONFIG_POWER_ESP_PM); idle mode only affects the radios");
+    }
+    return true;
+#endif
+}
+
+void PowerManager::apply_radio_settings(PowerMode mode) {
+    bool idle = mode == PowerMode::IDLE;
+    if (wifi_manager_ && !wifi_manager_->set_power_save(idle)) {
+        ESP_LOGW(TAG, "WiFi power save not applied");
+    }
+    if (ble_manager_) {
+        ble_manager_->set_low_power_advertising(idle);
+    }
+}
+
+void PowerManager::note_actuation(int64_t edge_us, int64_t received_us) {
+    PowerManager* manager = instance_;
+    if (manager == nullptr || manager->mode_.load() != PowerMode::IDLE) {
+        return;
+    }
+
+    // If the SDIO interrupt woke the P4 last, the command is what woke it: start at the
+    // wake so the time to resume and parse counts. Each wake is used for one command.
+    taskENTER_CRITICAL(&manager->stats_lock_);
+    int64_t wake_us = manager->gpio_wake_us_;
+    manager->gpio_wake_us_ = 0;
+    taskEXIT_CRITICAL(&manager->stats_lock_);
+    int64_t start_us = (wake_us != 0 && wake_us <= received_us) ? wake_us : received_us;
+
+    int64_t latency_us = edge_us - start_us;
+    manager->actuation_latency_.record(latency_us);
+    if (latency_us > CONFIG_POWER_MAX_ACTUATION_LATENCY_US) {
+        manager->handle_latency_miss(latency_us);
+    }
+}
+
+void PowerManager::handle_latency_miss(int64_t latency_us) {
+    taskENTER_CRITICAL(&stats_lock_);
+    latency_misses_++;
+    worst_miss_us_ = std::max(worst_miss_us_, latency_us);
+    taskEXIT_CRITICAL(&stats_lock_);
+
+    // Only the first miss reconfigures; later ones are just counted
+    if (!light_sleep_active_.load() || latency_tripped_.exchange(true)) {
+        return;
+    }
+    ESP_LOGW(TAG, "Relay switched %" PRId64 " us after waking for its command (bound %d us); light sleep off until 'power idle'",
+             latency_us, CONFIG_POWER_MAX_ACTUATION_LATENCY_US);
+    apply_cpu_settings(PowerMode::IDLE, false);
+}
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+IRAM_ATTR esp_err_t PowerManager::light_sleep_exit(int64_t sleep_time_us, void* arg) {
+    PowerManager* manager = static_cast<PowerManager*>(arg);
+#if CONFIG_POWER_LIGHT_SLEEP
+    bool gpio_wake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+#else
+    bool gpio_wake = false;
+#endif
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL_ISR(&manager->stats_lock_);
+    manager->sleep_us_ += static_cast<uint64_t>(sleep_time_us);
+    manager->sleep_count_++;
+    manager->gpio_wake_us_ = gpio_wake ? now_us : 0;
+    taskEXIT_CRITICAL_ISR(&manager->stats_lock_);
+    return ESP_OK;
+}
+#endif
+
+void PowerManager::reset_stats() {
+    uint64_t idle_now[portNUM_PROCESSORS] = {};
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+        idle_now[core] = idle_run_time(core);
+    }
+#endif
+    taskENTER_CRITICAL(&stats_lock_);
+    window_start_us_ = esp_timer_get_time();
+    std::copy(std::begin(idle_now), std::end(idle_now), idle_start_);
+    sleep_us_ = 0;
+    sleep_count_ = 0;
+    latency_misses_ = 0;
+    worst_miss_us_ = 0;
+    taskEXIT_CRITICAL(&stats_lock_);
+    actuation_latency_.reset();
+}
+
+void PowerManager::write_status(command_interface::ResponseWriter& out) const {
+    PowerMode mode = get_mode();
+    out.printf("Power mode: %s\n", mode_to_string(mode));
+#if CONFIG_POWER_ESP_PM
+    out.printf("CPU: %d MHz max, %d MHz min, light sleep %s\n", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+               mode == PowerMode::IDLE ? CONFIG_POWER_IDLE_MIN_FREQ_MHZ : CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+               light_sleep_active_.load() ? "on"
+               : latency_tripped_.load() ? "off (latency bound missed)" : "off");
+#else
+    out.write("CPU: fixed frequency, no light sleep (CONFIG_POWER_ESP_PM is off)\n");
+#endif
+    wifi_ps_type_t ps = WIFI_PS_NONE;
+    if (wifi_manager_ && wifi_manager_->get_power_save(ps)) {
+        out.printf("WiFi power save: %s\n", ps == WIFI_PS_MIN_MODEM ? "min modem"
+                                           : ps == WIFI_PS_MAX_MODEM ? "max modem" : "off");
+    } else {
+        out.write("WiFi power save: unknown (no answer from the coprocessor)\n");
+    }
+    if (mode == PowerMode::IDLE) {
+        out.printf("BLE advertising: fast for %d s, then slow\n", CONFIG_POWER_ADV_FAST_PERIOD_S);
+    } else {
+        out.write("BLE advertising: fast\n");
+    }
+
+    taskENTER_CRITICAL(&stats_lock_);
+    int64_t window_us = esp_timer_get_time() - window_start_us_;
+    [[maybe_unused]] uint64_t sleep_us = sleep_us_;
+    [[maybe_unused]] uint32_t sleep_count = sleep_count_;
+    uint32_t misses = latency_misses_;
+    int64_t worst_miss_us = worst_miss_us_;
+    [[maybe_unused]] uint64_t idle_start[portNUM_PROCESSORS];
+    std::copy(std::begin(idle_start_), std::end(idle_start_), idle_start);
+    taskEXIT_CRITICAL(&stats_lock_);
+
+    out.printf("\nActuation bound: %d us from wake (or command arrival) to relay edge (idle mode)\n",
+               CONFIG_POWER_MAX_ACTUATION_LATENCY_US);
+    out.printf("Misses: %" PRIu32, misses);
+    if (misses > 0) {
+        out.printf(" (worst %" PRId64 " us)", worst_miss_us);
+    }
+    out.write("\n");
+    actuation_latency_.write(out, "cmd->relay");
+
+    out.printf("\nResidency over the last %" PRId64 " ms:\n", window_us / 1000);
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    uint64_t sleep_per_mille = window_us > 0 ? sleep_us * 1000 / static_cast<uint64_t>(window_us) : 0;
+    out.printf("  Light sleep: %" PRIu64 " ms (%" PRIu64 ".%" PRIu64 "%%) in %" PRIu32 " sleeps",
+               sleep_us / 1000, sleep_per_mille / 10, sleep_per_mille % 10, sleep_count);
+    if (sleep_count > 0) {
+        out.printf(", avg %" PRIu64 " ms", sleep_us / sleep_count / 1000);
+    }
+    out.write("\n");
+#else
+    out.write("  Light sleep: not measured (CONFIG_PM_LIGHT_SLEEP_CALLBACKS)\n");
+#endif
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // Idle task time includes light sleep, so this is the share of time the core had nothing to do
+    out.write("  CPU idle:");
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; core++) {
+        uint64_t idle_us = static_cast<RunTimeCounter>(idle_run_time(core) - static_cast<RunTimeCounter>(idle_start[core]));
+        uint64_t per_mille = window_us > 0 ? std::min<uint64_t>(idle_us * 1000 / static_cast<uint64_t>(window_us), 1000) : 0;
+        out.printf(" core %d %" PRIu64 ".%" PRIu64 "%%", static_cast<int>(core), per_mille / 10, per_mille % 10);
+    }
+    out.write("\n");
+#else
+    out.write("  CPU idle: not measured (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)\n");
+#endif
+}
+
+const char* PowerManager::mode_to_string(PowerMode mode) {
+    return MODE_NAMES[static_cast<size_t>(mode)];
+}
+
+bool PowerManager::parse_mode(std::string_view text, PowerMode& mode) {
+    for (size_t i = 0; i < std::size(MODE_NAMES); i++) {
+        if (command_interface::equals_ignore_case(text, MODE_NAMES[i])) {
+            mode = static_cast<PowerMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+PowerManager::ActivityLock::ActivityLock() {
+#if CONFIG_POWER_ESP_PM
+    PowerManager* manager = instance_;
+    if (manager != nullptr) {
+        esp_pm_lock_acquire(manager->cpu_lock_);
+        esp_pm_lock_acquire(manager->sleep_lock_);
+    }
+#endif
+}
+
+PowerManager::ActivityLock::~ActivityLock() {
+#if CONFIG_POWER_ESP_PM
+    PowerManager* manager = instance_;
+    if (manager != nullptr) {
+        esp_pm_lock_release(manager->sleep_lock_);
+        esp_pm_lock_release(manager->cpu_lock_);
+    }
+#endif
+}
+
+} // namespace power
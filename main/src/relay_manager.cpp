@@ -1,23 +1,85 @@
 #include "relay_manager.hpp"
+#include "response_writer.hpp"
+#include "perf_stats.hpp"
+#include "log_control.hpp"
+#include "power_manager.hpp"
+#include "event_bus.hpp"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "nvs.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include <sstream>
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#if !CONFIG_FREERTOS_UNICORE
+#include "esp_ipc.h"
+#endif
+#include <algorithm>
+#include <bit>
+#include <cinttypes>
+#include <cstddef>
 
 namespace relay_control {
 
 static const char* TAG = "RelayManager";
 
+static const char* NVS_NAMESPACE = "relay_wear";
+static const char* NVS_KEY_TABLE = "switches";
+
+static constexpr uint32_t WEAR_TASK_STACK_SIZE = 3072;
+
+namespace {
+
+// Output write handed to the core that owns the bundle
+struct OutputWrite {
+    RelayManager* manager;
+    uint32_t mask;
+    uint32_t values;
+    uint64_t pulse_us;
+    uint32_t* ended;
+    bool applied;
+    int64_t edge_us;
+    uint32_t outputs;
+    uint32_t changed;
+};
+
+// Calls fn(index) for every set bit of mask
+template <typename Fn>
+void for_each_relay(uint32_t mask, Fn fn) {
+    for (; mask != 0; mask &= mask - 1) {
+        fn(static_cast<size_t>(std::countr_zero(mask)));
+    }
+}
+
+} // namespace
+
 RelayManager::RelayManager()
-    : initialized_(false), relay_1_state_(RelayState::OFF), relay_2_state_(RelayState::OFF),
-      relay_1_switch_count_(0), relay_2_switch_count_(0), total_operations_(0) {
+    : initialized_(false), bundle_(nullptr), bundle_core_(0), pulse_timer_(nullptr),
+      outputs_(0), pulsing_(0), pulse_end_us_{}, switch_count_{}, total_operations_(0), pulse_count_(0),
+      interlock_rejects_(0), lifetime_switches_{}, wear_dirty_(false), wear_saves_(0), wear_task_(nullptr) {
+    pulse_mutex_ = xSemaphoreCreateMutex();
 }
 
 RelayManager::~RelayManager() {
+    if (wear_task_) {
+        vTaskDelete(wear_task_);
+    }
     if (initialized_) {
         // Safety: Turn off all relays before destruction
+        esp_timer_stop(pulse_timer_);
         turn_off_all();
+        if (wear_dirty_) {
+            save_wear();
+        }
+    }
+    if (pulse_timer_) {
+        esp_timer_delete(pulse_timer_);
+    }
+    if (bundle_) {
+        dedic_gpio_del_bundle(bundle_);
+    }
+    if (pulse_mutex_) {
+        vSemaphoreDelete(pulse_mutex_);
     }
 }
 
@@ -27,37 +89,77 @@ bool RelayManager::initialize() {
         return true;
     }
 
-    ESP_LOGI(TAG, "Initializing Relay Manager for dual relay board variant");
-    ESP_LOGI(TAG, "Relay 1: GPIO%d, Relay 2: GPIO%d", RELAY_1_GPIO, RELAY_2_GPIO);
+    ESP_LOGI(TAG, "Initializing Relay Manager for %.*s (%u relays, active %s)",
+             static_cast<int>(RELAY_BOARD.name.size()), RELAY_BOARD.name.data(),
+             static_cast<unsigned>(RELAY_COUNT), RELAY_BOARD.active_low ? "low" : "high");
 
     // Configure GPIO pins for relay control
-    if (!configure_gpio_pin(RELAY_1_GPIO)) {
-        ESP_LOGE(TAG, "Failed to configure Relay 1 GPIO%d", RELAY_1_GPIO);
-        return false;
+    for (size_t i = 0; i < RELAY_COUNT; i++) {
+        if (!configure_gpio_pin(RELAY_BOARD.gpios[i])) {
+            ESP_LOGE(TAG, "Failed to configure Relay %u GPIO%d", static_cast<unsigned>(i + 1), RELAY_BOARD.gpios[i]);
+            return false;
+        }
     }
 
-    if (!configure_gpio_pin(RELAY_2_GPIO)) {
-        ESP_LOGE(TAG, "Failed to configure Relay 2 GPIO%d", RELAY_2_GPIO);
-        return false;
+    esp_err_t ret = ESP_OK;
+    if constexpr (USE_BUNDLE) {
+        // Route every relay through one bundle so they can switch in a single write
+        int gpio_array[RELAY_COUNT];
+        std::copy(RELAY_BOARD.gpios.begin(), RELAY_BOARD.gpios.end(), gpio_array);
+        dedic_gpio_bundle_config_t bundle_config = {};
+        bundle_config.gpio_array = gpio_array;
+        bundle_config.array_size = RELAY_COUNT;
+        bundle_config.flags.out_en = 1;
+
+        ret = dedic_gpio_new_bundle(&bundle_config, &bundle_);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create relay GPIO bundle: %s", esp_err_to_name(ret));
+            bundle_ = nullptr;
+            return false;
+        }
+        bundle_core_ = xPortGetCoreID();
     }
 
-    // Initialize relays to OFF state for safety
-    if (!set_gpio_state(RELAY_1_GPIO, 0) || !set_gpio_state(RELAY_2_GPIO, 0)) {
-        ESP_LOGE(TAG, "Failed to initialize relays to OFF state");
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = pulse_timer_callback;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "relay_pulse";
+    ret = esp_timer_create(&timer_args, &pulse_timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create relay pulse timer: %s", esp_err_to_name(ret));
+        pulse_timer_ = nullptr;
         return false;
     }
 
-    // Initialize state tracking
-    relay_1_state_ = RelayState::OFF;
-    relay_2_state_ = RelayState::OFF;
-    relay_1_switch_count_ = 0;
-    relay_2_switch_count_ = 0;
+    // Initialize relays to OFF state for safety
+    int64_t edge_us = 0;
+    uint32_t outputs = 0;
+    uint32_t changed = 0;
+    apply_outputs(ALL_RELAYS_MASK, 0, 0, nullptr, edge_us, outputs, changed);
+    switch_count_.fill(0);
     total_operations_ = 0;
+    pulse_count_ = 0;
 
     initialized_ = true;
     ESP_LOGI(TAG, "Relay Manager initialized successfully");
-    ESP_LOGI(TAG, "Both relays initialized to OFF state for safety");
-    
+    ESP_LOGI(TAG, "All relays initialized to OFF state for safety");
+
+    return true;
+}
+
+bool RelayManager::start_wear_tracking() {
+    if (!initialized_ || wear_task_) {
+        return wear_task_ != nullptr;
+    }
+
+    load_wear();
+    if (xTaskCreate(wear_task, "relay_wear", WEAR_TASK_STACK_SIZE, this, 1, &wear_task_) != pdPASS) {
+        // Relays still work; lifetime counts just stop being saved
+        ESP_LOGW(TAG, "Failed to create wear counter task");
+        wear_task_ = nullptr;
+        return false;
+    }
     return true;
 }
 
@@ -70,6 +172,8 @@ bool RelayManager::configure_gpio_pin(gpio_num_t gpio_pin) {
         .intr_type = GPIO_INTR_DISABLE
     };
 
+    // Latch the OFF level first so an active-low relay does not click on
+    gpio_set_level(gpio_pin, RELAY_BOARD.active_low ? 1 : 0);
     esp_err_t ret = gpio_config(&gpio_conf);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure GPIO%d: %s", gpio_pin, esp_err_to_name(ret));
@@ -80,189 +184,368 @@ bool RelayManager::configure_gpio_pin(gpio_num_t gpio_pin) {
     return true;
 }
 
-bool RelayManager::set_gpio_state(gpio_num_t gpio_pin, int state) {
-    esp_err_t ret = gpio_set_level(gpio_pin, state);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to set GPIO%d to %d: %s", gpio_pin, state, esp_err_to_name(ret));
+bool RelayManager::apply_outputs(uint32_t mask, uint32_t values, uint64_t pulse_us, uint32_t* ended,
+                                 int64_t& edge_us, uint32_t& outputs, uint32_t& changed) {
+    taskENTER_CRITICAL(&lock_);
+    if (ended) {
+        // Decided under the lock, so a relay set since the timer fired keeps its new state
+        int64_t now_us = esp_timer_get_time();
+        uint32_t due = 0;
+        for_each_relay(pulsing_ & mask, [this, now_us, &due](size_t i) {
+            if (pulse_end_us_[i] <= now_us) {
+                due |= 1u << i;
+            }
+        });
+        mask = due;
+        values = 0;
+        *ended = due;
+    }
+    values &= mask;
+    outputs = (outputs_ & ~mask) | values;
+    if (RELAY_BOARD.interlock_conflicts(outputs)) {
+        interlock_rejects_++;
+        taskEXIT_CRITICAL(&lock_);
         return false;
     }
-
-    ESP_LOGD(TAG, "Set GPIO%d to %s", gpio_pin, state ? "HIGH" : "LOW");
+    edge_us = esp_timer_get_time();
+    if constexpr (USE_BUNDLE) {
+        dedic_gpio_bundle_write(bundle_, mask, RELAY_BOARD.to_levels(values, mask));
+    } else {
+        for_each_relay(mask, [values](size_t i) {
+            gpio_set_level(RELAY_BOARD.gpios[i], ((values >> i) & 1) != RELAY_BOARD.active_low);
+        });
+    }
+    changed = outputs_ ^ outputs;
+    outputs_ = outputs;
+    // A written state overrides a pending pulse end
+    pulsing_ &= ~mask;
+    if (pulse_us) {
+        // Started together with the write, so a later set_relays() always wins
+        int64_t end_us = edge_us + static_cast<int64_t>(pulse_us);
+        pulsing_ |= mask;
+        for_each_relay(mask, [this, end_us](size_t i) { pulse_end_us_[i] = end_us; });
+        total_operations_++;
+        pulse_count_++;
+    }
+    for_each_relay(changed, [this](size_t i) {
+        switch_count_[i]++;
+        lifetime_switches_[i]++;
+    });
+    wear_dirty_ |= changed != 0;
+    taskEXIT_CRITICAL(&lock_);
     return true;
 }
 
-int RelayManager::get_gpio_state(gpio_num_t gpio_pin) const {
-    return gpio_get_level(gpio_pin);
+void RelayManager::apply_outputs_on_core(void* arg) {
+    OutputWrite* write = static_cast<OutputWrite*>(arg);
+    write->applied = write->manager->apply_outputs(write->mask, write->values, write->pulse_us, write->ended,
+                                                   write->edge_us, write->outputs, write->changed);
 }
 
-gpio_num_t RelayManager::relay_id_to_gpio(RelayId relay_id) const {
-    switch (relay_id) {
-        case RelayId::RELAY_1:
-            return RELAY_1_GPIO;
-        case RelayId::RELAY_2:
-            return RELAY_2_GPIO;
-        default:
-            return GPIO_NUM_NC; // Invalid
+bool RelayManager::write_outputs(uint32_t mask, uint32_t values, uint64_t pulse_us, uint32_t* ended) {
+    bool applied = false;
+    int64_t edge_us = 0;
+    uint32_t outputs = 0;
+    uint32_t changed = 0;
+#if !CONFIG_FREERTOS_UNICORE
+    if (USE_BUNDLE && xPortGetCoreID() != bundle_core_) {
+        OutputWrite write = {this, mask, values, pulse_us, ended, false, 0, 0, 0};
+        esp_err_t ret = esp_ipc_call_blocking(bundle_core_, apply_outputs_on_core, &write);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to reach relay core %d: %s", bundle_core_, esp_err_to_name(ret));
+            return false;
+        }
+        applied = write.applied;
+        edge_us = write.edge_us;
+        outputs = write.outputs;
+        changed = write.changed;
+    } else
+#endif
+    {
+        applied = apply_outputs(mask, values, pulse_us, ended, edge_us, outputs, changed);
     }
-}
 
-const char* RelayManager::relay_id_to_string(RelayId relay_id) const {
-    switch (relay_id) {
-        case RelayId::RELAY_1: return "Relay 1";
-        case RelayId::RELAY_2: return "Relay 2";
-        case RelayId::ALL_RELAYS: return "All Relays";
-        default: return "Unknown";
+    if (!applied) {
+        ESP_LOGW(TAG, "Relays 0x%02" PRIx32 " -> 0x%02" PRIx32 " refused: interlocked relays would be on together",
+                 mask, values & mask);
+        return false;
     }
+    if (telemetry::mark_gpio_edge(edge_us)) {
+        power::PowerManager::note_actuation(edge_us, telemetry::command_received_us());
+    }
+    if (changed != 0) {
+        event_bus::post(event_bus::EventId::RELAY_CHANGED, event_bus::RelayChangedEvent{outputs, changed});
+    }
+    return true;
 }
 
-const char* RelayManager::relay_state_to_string(RelayState state) const {
-    return (state == RelayState::ON) ? "ON" : "OFF";
-}
-
-bool RelayManager::set_relay_state(RelayId relay_id, RelayState state) {
+bool RelayManager::set_relays(uint32_t mask, uint32_t values) {
     if (!initialized_) {
         ESP_LOGE(TAG, "Relay Manager not initialized");
         return false;
     }
 
+    mask &= ALL_RELAYS_MASK;
+    if (mask == 0) {
+        ESP_LOGE(TAG, "Invalid relay mask");
+        return false;
+    }
+
+    taskENTER_CRITICAL(&lock_);
     total_operations_++;
+    taskEXIT_CRITICAL(&lock_);
 
-    if (relay_id == RelayId::ALL_RELAYS) {
-        // Control both relays
-        bool success = true;
-        success &= set_relay_state(RelayId::RELAY_1, state);
-        success &= set_relay_state(RelayId::RELAY_2, state);
-        
-        if (success) {
-            ESP_LOGI(TAG, "Set all relays to %s", relay_state_to_string(state));
-        }
-        return success;
+    if (!write_outputs(mask, values)) {
+        return false;
     }
 
-    gpio_num_t gpio_pin = relay_id_to_gpio(relay_id);
-    if (gpio_pin == GPIO_NUM_NC) {
-        ESP_LOGE(TAG, "Invalid relay ID");
+    // Log after switching so console latency never sits between channels
+    LOG_RATE_LIMITED(ESP_LOG_INFO, TAG, CONFIG_LOG_RATE_LIMIT_MS, "Relays 0x%02" PRIx32 " set to 0x%02" PRIx32,
+                     mask, values & mask);
+    return true;
+}
+
+bool RelayManager::pulse(uint32_t mask, uint64_t duration_us) {
+    if (!initialized_) {
+        ESP_LOGE(TAG, "Relay Manager not initialized");
         return false;
     }
 
-    int gpio_level = (state == RelayState::ON) ? 1 : 0;
-    if (!set_gpio_state(gpio_pin, gpio_level)) {
+    mask &= ALL_RELAYS_MASK;
+    if (mask == 0 || duration_us == 0) {
+        ESP_LOGE(TAG, "Invalid relay pulse");
         return false;
     }
 
-    // Update state tracking
-    if (relay_id == RelayId::RELAY_1) {
-        if (relay_1_state_ != state) {
-            relay_1_switch_count_++;
-        }
-        relay_1_state_ = state;
-    } else if (relay_id == RelayId::RELAY_2) {
-        if (relay_2_state_ != state) {
-            relay_2_switch_count_++;
-        }
-        relay_2_state_ = state;
+    if (!write_outputs(mask, mask, duration_us)) {
+        return false;
     }
 
-    ESP_LOGI(TAG, "Set %s to %s (GPIO%d)", 
-             relay_id_to_string(relay_id), relay_state_to_string(state), gpio_pin);
-    
+    rearm_pulse_timer();
+    LOG_RATE_LIMITED(ESP_LOG_INFO, TAG, CONFIG_LOG_RATE_LIMIT_MS, "Relays 0x%02" PRIx32 " pulsed for %" PRIu64 " us",
+                     mask, duration_us);
     return true;
 }
 
-RelayManager::RelayState RelayManager::get_relay_state(RelayId relay_id) const {
-    if (!initialized_) {
-        return RelayState::OFF;
+// Arm the timer for the earliest pending pulse end. Serialized so a command
+// and the timer callback re-arming at once cannot leave a stale deadline.
+void RelayManager::rearm_pulse_timer() {
+    xSemaphoreTake(pulse_mutex_, portMAX_DELAY);
+    int64_t next_end = INT64_MAX;
+    taskENTER_CRITICAL(&lock_);
+    for_each_relay(pulsing_, [this, &next_end](size_t i) { next_end = std::min(next_end, pulse_end_us_[i]); });
+    taskEXIT_CRITICAL(&lock_);
+
+    esp_timer_stop(pulse_timer_);
+    if (next_end != INT64_MAX) {
+        int64_t delay_us = next_end - esp_timer_get_time();
+        esp_timer_start_once(pulse_timer_, static_cast<uint64_t>(std::max<int64_t>(delay_us, 1)));
     }
+    xSemaphoreGive(pulse_mutex_);
+}
+
+void RelayManager::pulse_timer_callback(void* arg) {
+    RelayManager* manager = static_cast<RelayManager*>(arg);
 
-    switch (relay_id) {
-        case RelayId::RELAY_1:
-            return relay_1_state_;
-        case RelayId::RELAY_2:
-            return relay_2_state_;
-        default:
-            return RelayState::OFF;
+    // End every pulse that is due together, in one write
+    uint32_t expired = 0;
+    manager->write_outputs(ALL_RELAYS_MASK, 0, 0, &expired);
+    if (expired) {
+        ESP_LOGD(TAG, "Relay pulse ended (0x%02" PRIx32 ")", expired);
     }
+    manager->rearm_pulse_timer();
+}
+
+uint32_t RelayManager::get_relays() const {
+    taskENTER_CRITICAL(&lock_);
+    uint32_t outputs = outputs_;
+    taskEXIT_CRITICAL(&lock_);
+    return outputs;
+}
+
+bool RelayManager::turn_on(uint32_t mask) {
+    return set_relays(mask, mask);
 }
 
-bool RelayManager::turn_on(RelayId relay_id) {
-    return set_relay_state(relay_id, RelayState::ON);
+bool RelayManager::turn_off(uint32_t mask) {
+    return set_relays(mask, 0);
 }
 
-bool RelayManager::turn_off(RelayId relay_id) {
-    return set_relay_state(relay_id, RelayState::OFF);
+bool RelayManager::toggle(uint32_t mask) {
+    // All relays flip together, each to the opposite of its own state
+    return set_relays(mask, ~get_relays());
+}
+
+bool RelayManager::turn_off_all() {
+    return set_relays(ALL_RELAYS_MASK, 0);
 }
 
-bool RelayManager::toggle(RelayId relay_id) {
+void RelayManager::write_status(command_interface::ResponseWriter& out) const {
     if (!initialized_) {
-        ESP_LOGE(TAG, "Relay Manager not initialized");
-        return false;
+        out.write("Relay Manager: Not initialized\n");
+        return;
     }
 
-    if (relay_id == RelayId::ALL_RELAYS) {
-        // Toggle both relays
-        bool success = true;
-        success &= toggle(RelayId::RELAY_1);
-        success &= toggle(RelayId::RELAY_2);
-        return success;
+    uint32_t outputs = get_relays();
+    out.write("=== Relay Status ===\n");
+    out.printf("Board Variant: %.*s\n", static_cast<int>(RELAY_BOARD.name.size()), RELAY_BOARD.name.data());
+    for (size_t i = 0; i < RELAY_COUNT; i++) {
+        out.printf("Relay %u (GPIO%d): %s\n", static_cast<unsigned>(i + 1), RELAY_BOARD.gpios[i],
+                   (outputs & (1u << i)) ? "ON" : "OFF");
     }
+}
+
+void RelayManager::write_debug_status(command_interface::ResponseWriter& out) const {
+    out.write("=== Relay Debug Status ===\n");
+    out.printf("Board Variant: %.*s (%u relays, active %s)\n",
+               static_cast<int>(RELAY_BOARD.name.size()), RELAY_BOARD.name.data(),
+               static_cast<unsigned>(RELAY_COUNT), RELAY_BOARD.active_low ? "low" : "high");
+    out.printf("Initialized: %s\n", initialized_ ? "Yes" : "No");
+
+    if (initialized_) {
+        uint32_t outputs = get_relays();
+        int64_t now_us = esp_timer_get_time();
+        std::array<int64_t, RELAY_COUNT> pulse_end_us;
+        taskENTER_CRITICAL(&lock_);
+        uint32_t pulsing = pulsing_;
+        pulse_end_us = pulse_end_us_;
+        taskEXIT_CRITICAL(&lock_);
+
+        out.write("\nRelay Configuration:\n");
+        for (size_t i = 0; i < RELAY_COUNT; i++) {
+            out.printf("- Relay %u: GPIO%d = %s", static_cast<unsigned>(i + 1), RELAY_BOARD.gpios[i],
+                       (outputs & (1u << i)) ? "ON" : "OFF");
+            if (pulsing & (1u << i)) {
+                out.printf(" (pulse ends in %lld ms)",
+                           static_cast<long long>(std::max<int64_t>(pulse_end_us[i] - now_us, 0) / 1000));
+            }
+            out.write("\n");
+        }
+        if (USE_BUNDLE) {
+            out.printf("- Bundle: dedicated GPIO on core %d, output latch 0x%02" PRIx32 "\n",
+                       bundle_core_, dedic_gpio_bundle_read_out(bundle_));
+        } else {
+            out.printf("- Outputs: per-pin GPIO writes (more than %d relays)\n", SOC_DEDIC_GPIO_OUT_CHANNELS_NUM);
+        }
+        for (uint32_t group : RELAY_BOARD.interlock_groups) {
+            out.printf("- Interlock group: 0x%02" PRIx32 "\n", group);
+        }
 
-    RelayState current_state = get_relay_state(relay_id);
-    RelayState new_state = (current_state == RelayState::ON) ? RelayState::OFF : RelayState::ON;
-    
-    return set_relay_state(relay_id, new_state);
+        out.write("\nGPIO Pin States:\n");
+        for (gpio_num_t gpio : RELAY_BOARD.gpios) {
+            out.printf("- GPIO%d Level: %d\n", gpio, gpio_get_level(gpio));
+        }
+
+        out.write("\nOperation Statistics:\n");
+        for (size_t i = 0; i < RELAY_COUNT; i++) {
+            out.printf("- Relay %u Switches: %" PRIu32 "\n", static_cast<unsigned>(i + 1), switch_count_[i]);
+        }
+        out.printf("- Pulses: %" PRIu32 "\n", pulse_count_);
+        out.printf("- Interlock Rejects: %" PRIu32 "\n", interlock_rejects_);
+        out.printf("- Total Operations: %" PRIu32 "\n", total_operations_);
+
+        out.write("\nSafety Features:\n");
+        out.write("- Auto-off on destruction: Enabled\n");
+        out.write("- Initialization to OFF: Enabled\n");
+        out.write("- Error logging: Enabled\n");
+    }
 }
 
-bool RelayManager::turn_off_all() {
-    return set_relay_state(RelayId::ALL_RELAYS, RelayState::OFF);
+void RelayManager::wear_task(void* arg) {
+    RelayManager* manager = static_cast<RelayManager*>(arg);
+    while (true) {
+        // Coalesce every switch in the interval into one NVS write
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_RELAY_WEAR_FLUSH_INTERVAL_S * 1000));
+        taskENTER_CRITICAL(&manager->lock_);
+        bool dirty = manager->wear_dirty_;
+        taskEXIT_CRITICAL(&manager->lock_);
+        if (dirty) {
+            manager->save_wear();
+        }
+    }
 }
 
-std::string RelayManager::get_status() const {
-    if (!initialized_) {
-        return "Relay Manager: Not initialized";
+void RelayManager::load_wear() {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Failed to open wear counters: %s", esp_err_to_name(ret));
+        }
+        return;
+    }
+
+    WearTable table = {};
+    size_t length = sizeof(table);
+    ret = nvs_get_blob(handle, NVS_KEY_TABLE, &table, &length);
+    nvs_close(handle);
+
+    size_t header = offsetof(WearTable, switches);
+    if (ret != ESP_OK || length < header || table.version != WEAR_TABLE_VERSION ||
+        length != header + std::min<size_t>(table.count, RELAY_COUNT) * sizeof(uint32_t)) {
+        if (ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Discarding unreadable wear counters: %s", esp_err_to_name(ret));
+        }
+        return;
     }
 
-    std::string status = "=== Relay Status ===\n";
-    status += "Board Variant: Dual Relay Board\n";
-    status += "Relay 1 (GPIO32): " + std::string(relay_state_to_string(relay_1_state_)) + "\n";
-    status += "Relay 2 (GPIO46): " + std::string(relay_state_to_string(relay_2_state_)) + "\n";
-    
-    return status;
+    // A board with a different channel count keeps the counts it shares; switches
+    // made before the restore (boot-time safety writes) are added on top
+    taskENTER_CRITICAL(&lock_);
+    for (size_t i = 0; i < std::min<size_t>(table.count, RELAY_COUNT); i++) {
+        lifetime_switches_[i] += table.switches[i];
+    }
+    taskEXIT_CRITICAL(&lock_);
 }
 
-std::string RelayManager::get_debug_status() const {
-    std::string status = "=== Relay Debug Status ===\n";
-    status += "Board Variant: ESP32-P4 Dual Relay Board\n";
-    status += "Initialized: " + std::string(initialized_ ? "Yes" : "No") + "\n";
-    
-    if (initialized_) {
-        status += "\nRelay Configuration:\n";
-        status += "- Relay 1: GPIO" + std::to_string(RELAY_1_GPIO) + " = " + 
-                  std::string(relay_state_to_string(relay_1_state_)) + "\n";
-        status += "- Relay 2: GPIO" + std::to_string(RELAY_2_GPIO) + " = " + 
-                  std::string(relay_state_to_string(relay_2_state_)) + "\n";
-        
-        status += "\nGPIO Pin States:\n";
-        status += "- GPIO" + std::to_string(RELAY_1_GPIO) + " Level: " + 
-                  std::to_string(get_gpio_state(RELAY_1_GPIO)) + "\n";
-        status += "- GPIO" + std::to_string(RELAY_2_GPIO) + " Level: " + 
-                  std::to_string(get_gpio_state(RELAY_2_GPIO)) + "\n";
-        
-        status += "\nOperation Statistics:\n";
-        status += "- Relay 1 Switches: " + std::to_string(relay_1_switch_count_) + "\n";
-        status += "- Relay 2 Switches: " + std::to_string(relay_2_switch_count_) + "\n";
-        status += "- Total Operations: " + std::to_string(total_operations_) + "\n";
-        
-        status += "\nSafety Features:\n";
-        status += "- Auto-off on destruction: Enabled\n";
-        status += "- Initialization to OFF: Enabled\n";
-        status += "- Error logging: Enabled\n";
-    }
-    
-    return status;
+bool RelayManager::save_wear() {
+    WearTable table = {};
+    table.version = WEAR_TABLE_VERSION;
+    table.count = RELAY_COUNT;
+    taskENTER_CRITICAL(&lock_);
+    table.switches = lifetime_switches_;
+    wear_dirty_ = false;
+    taskEXIT_CRITICAL(&lock_);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, NVS_KEY_TABLE, &table, sizeof(table));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save wear counters: %s", esp_err_to_name(ret));
+        taskENTER_CRITICAL(&lock_);
+        wear_dirty_ = true;
+        taskEXIT_CRITICAL(&lock_);
+        return false;
+    }
+    wear_saves_++;
+    return true;
+}
+
+void RelayManager::write_wear_status(command_interface::ResponseWriter& out) const {
+    taskENTER_CRITICAL(&lock_);
+    std::array<uint32_t, RELAY_COUNT> lifetime = lifetime_switches_;
+    std::array<uint32_t, RELAY_COUNT> boot = switch_count_;
+    bool dirty = wear_dirty_;
+    taskEXIT_CRITICAL(&lock_);
+
+    out.write("=== Relay Wear ===\n");
+    for (size_t i = 0; i < RELAY_COUNT; i++) {
+        out.printf("Relay %u: %" PRIu32 " switches (%" PRIu32 " this boot)\n",
+                   static_cast<unsigned>(i + 1), lifetime[i], boot[i]);
+    }
+    out.printf("Saved to NVS %" PRIu32 " time(s) this boot, every %d s at most%s\n",
+               wear_saves_, CONFIG_RELAY_WEAR_FLUSH_INTERVAL_S, dirty ? " (changes pending)" : "");
 }
 
 bool RelayManager::is_initialized() const {
     return initialized_;
 }
 
-} // namespace relay_control
\ No newline at end of file
+} // namespace relay_control
@@ -0,0 +1,475 @@
+#include "relay_scheduler.hpp"
+#include "response_writer.hpp"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "nvs.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <sys/time.h>
+#include <ctime>
+
+namespace relay_control {
+
+static const char* TAG = "RelayScheduler";
+
+static const char* NVS_NAMESPACE = "relay_sched";
+static const char* NVS_KEY_TABLE = "table";
+
+// How often actions waiting for the wall clock re-check it
+static constexpr uint32_t CLOCK_POLL_MS = 5000;
+
+// Wall-clock one-shots this late are skipped instead of fired
+static constexpr int64_t LATE_LIMIT_US = 2000000;
+
+// NVS writes of the table run here, away from the scheduler task
+static constexpr uint32_t FLUSH_TASK_STACK_SIZE = 3072;
+static constexpr UBaseType_t FLUSH_TASK_PRIORITY = 1;
+
+// Retry interval after a failed NVS write
+static constexpr uint32_t FLUSH_RETRY_MS = 10000;
+
+RelayScheduler::RelayScheduler(std::shared_ptr<RelayManager> relays)
+    : relays_(std::move(relays)), task_(nullptr), flush_task_(nullptr), timer_(nullptr), heap_{}, count_(0),
+      next_id_(1), dirty_(false), stored_{}, status_entries_{}, initialized_(false), runs_(0), skipped_(0),
+      max_lateness_us_(0) {
+    mutex_ = xSemaphoreCreateMutex();
+    status_mutex_ = xSemaphoreCreateMutex();
+}
+
+RelayScheduler::~RelayScheduler() {
+    if (timer_) {
+        esp_timer_stop(timer_);
+        esp_timer_delete(timer_);
+    }
+    if (task_) {
+        vTaskDelete(task_);
+    }
+    if (flush_task_) {
+        vTaskDelete(flush_task_);
+        flush();
+    }
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+    if (status_mutex_) {
+        vSemaphoreDelete(status_mutex_);
+    }
+}
+
+bool RelayScheduler::initialize() {
+    if (initialized_) {
+        return true;
+    }
+    if (!relays_ || !relays_->is_initialized()) {
+        ESP_LOGE(TAG, "Relay manager not available");
+        return false;
+    }
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = timer_callback;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "relay_sched";
+    esp_err_t ret = esp_timer_create(&timer_args, &timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create scheduler timer: %s", esp_err_to_name(ret));
+        timer_ = nullptr;
+        return false;
+    }
+
+    // Exists before load() so a table pruned at boot gets written back
+    if (xTaskCreate(flush_task, "relay_sched_nvs", FLUSH_TASK_STACK_SIZE, this, FLUSH_TASK_PRIORITY,
+                    &flush_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create schedule flush task");
+        flush_task_ = nullptr;
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    load();
+    xSemaphoreGive(mutex_);
+
+    BaseType_t rc = xTaskCreate(scheduler_task, "relay_sched", CONFIG_RELAY_SCHEDULE_STACK_SIZE,
+                                this, CONFIG_RELAY_SCHEDULE_PRIORITY, &task_);
+    if (rc != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create scheduler task");
+        task_ = nullptr;
+        return false;
+    }
+
+    initialized_ = true;
+    ESP_LOGI(TAG, "Relay scheduler started with %u saved action(s)", static_cast<unsigned>(count_));
+    return true;
+}
+
+bool RelayScheduler::clock_valid() {
+    // Anything before 2023 means the clock was never set
+    return time(nullptr) > 1672531200;
+}
+
+// Heap order: the entry due first is at the top
+bool RelayScheduler::later(const Entry& a, const Entry& b) {
+    return a.due_us > b.due_us;
+}
+
+bool RelayScheduler::first_due(const RelayAction& action, int64_t now_us, bool at_boot, int64_t& due_us) const {
+    int64_t period_us = static_cast<int64_t>(action.period_ms) * 1000;
+
+    if (action.wall_time == 0) {
+        if (at_boot) {
+            // The original start was on the previous boot's timeline
+            if (period_us == 0) {
+                return false;
+            }
+            due_us = now_us + period_us;
+        } else {
+            due_us = now_us + static_cast<int64_t>(action.delay_ms) * 1000;
+        }
+        return true;
+    }
+
+    if (!clock_valid()) {
+        due_us = INT64_MAX;
+        return true;
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    int64_t wall_now_us = static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    int64_t delta_us = action.wall_time * 1000000 - wall_now_us;
+    if (delta_us < 0) {
+        if (period_us > 0) {
+            // Next slot in the series
+            delta_us += ((-delta_us + period_us - 1) / period_us) * period_us;
+        } else if (delta_us < -LATE_LIMIT_US) {
+            return false;
+        } else {
+            delta_us = 0;
+        }
+    }
+    due_us = now_us + delta_us;
+    return true;
+}
+
+uint16_t RelayScheduler::add(const RelayAction& action) {
+    if (!initialized_ || (action.mask & RelayManager::ALL_RELAYS_MASK) == 0) {
+        return 0;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (count_ == MAX_ACTIONS) {
+        xSemaphoreGive(mutex_);
+        ESP_LOGW(TAG, "Schedule full (%u actions)", static_cast<unsigned>(MAX_ACTIONS));
+        return 0;
+    }
+
+    Entry entry = {};
+    entry.action = action;
+    if (!first_due(entry.action, esp_timer_get_time(), false, entry.due_us)) {
+        xSemaphoreGive(mutex_);
+        return 0;
+    }
+
+    // Ids are never 0 and never reused while an action holds them
+    bool in_use = true;
+    while (in_use) {
+        entry.action.id = next_id_++;
+        if (next_id_ == 0) {
+            next_id_ = 1;
+        }
+        in_use = std::any_of(heap_.begin(), heap_.begin() + count_,
+                             [&](const Entry& e) { return e.action.id == entry.action.id; });
+    }
+
+    heap_[count_++] = entry;
+    std::push_heap(heap_.begin(), heap_.begin() + count_, later);
+    mark_dirty();
+    uint16_t id = entry.action.id;
+    xSemaphoreGive(mutex_);
+
+    xTaskNotifyGive(task_);
+    return id;
+}
+
+bool RelayScheduler::cancel(uint16_t id) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool found = false;
+    for (size_t i = 0; i < count_; i++) {
+        if (heap_[i].action.id == id) {
+            remove_at(i);
+            found = true;
+            break;
+        }
+    }
+    if (found) {
+        mark_dirty();
+    }
+    xSemaphoreGive(mutex_);
+
+    if (found) {
+        xTaskNotifyGive(task_);
+    }
+    return found;
+}
+
+bool RelayScheduler::cancel_all() {
+    if (!initialized_) {
+        return false;
+    }
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    count_ = 0;
+    mark_dirty();
+    xSemaphoreGive(mutex_);
+
+    xTaskNotifyGive(task_);
+    return true;
+}
+
+void RelayScheduler::remove_at(size_t index) {
+    heap_[index] = heap_[--count_];
+    std::make_heap(heap_.begin(), heap_.begin() + count_, later);
+}
+
+void RelayScheduler::timer_callback(void* arg) {
+    RelayScheduler* scheduler = static_cast<RelayScheduler*>(arg);
+    xTaskNotifyGive(scheduler->task_);
+}
+
+void RelayScheduler::scheduler_task(void* arg) {
+    RelayScheduler* scheduler = static_cast<RelayScheduler*>(arg);
+    bool waiting_for_clock = false;
+
+    while (true) {
+        // Woken by the timer or a schedule change; poll only while the clock is unset
+        ulTaskNotifyTake(pdTRUE, waiting_for_clock ? pdMS_TO_TICKS(CLOCK_POLL_MS) : portMAX_DELAY);
+
+        xSemaphoreTake(scheduler->mutex_, portMAX_DELAY);
+        waiting_for_clock = scheduler->resolve_wall_clock(esp_timer_get_time());
+        scheduler->run_due(esp_timer_get_time());
+        scheduler->arm_timer(esp_timer_get_time());
+        xSemaphoreGive(scheduler->mutex_);
+    }
+}
+
+// Give wall-clock actions a due time once the clock is set; true if any still wait
+bool RelayScheduler::resolve_wall_clock(int64_t now_us) {
+    bool waiting = false;
+    bool removed = false;
+    for (size_t i = 0; i < count_;) {
+        Entry& entry = heap_[i];
+        if (entry.due_us != INT64_MAX) {
+            i++;
+            continue;
+        }
+        if (!first_due(entry.action, now_us, true, entry.due_us)) {
+            ESP_LOGW(TAG, "Skipping action %u: its time has passed", entry.action.id);
+            skipped_++;
+            heap_[i] = heap_[--count_];
+            removed = true;
+            continue;
+        }
+        waiting |= entry.due_us == INT64_MAX;
+        i++;
+    }
+
+    std::make_heap(heap_.begin(), heap_.begin() + count_, later);
+    if (removed) {
+        mark_dirty();
+    }
+    return waiting;
+}
+
+void RelayScheduler::run_due(int64_t now_us) {
+    bool finished = false;
+
+    while (count_ > 0 && heap_[0].due_us <= now_us) {
+        std::pop_heap(heap_.begin(), heap_.begin() + count_, later);
+        Entry& entry = heap_[count_ - 1];
+
+        execute(entry.action);
+        runs_++;
+        max_lateness_us_ = std::max(max_lateness_us_, now_us - entry.due_us);
+
+        if (entry.action.period_ms == 0) {
+            count_--;
+            finished = true;
+            continue;
+        }
+
+        // Stay on the original grid; runs missed while busy are skipped, not bunched
+        int64_t period_us = static_cast<int64_t>(entry.action.period_ms) * 1000;
+        entry.due_us += period_us;
+        if (entry.due_us <= now_us) {
+            int64_t missed = (now_us - entry.due_us) / period_us + 1;
+            entry.due_us += missed * period_us;
+            skipped_ += static_cast<uint32_t>(missed);
+        }
+        std::push_heap(heap_.begin(), heap_.begin() + count_, later);
+    }
+
+    if (finished) {
+        mark_dirty();
+    }
+}
+
+void RelayScheduler::execute(const RelayAction& action) {
+    bool ok = action.pulse_us ? relays_->pulse(action.mask, action.pulse_us)
+                              : relays_->set_relays(action.mask, action.values);
+    if (!ok) {
+        ESP_LOGW(TAG, "Scheduled action %u failed", action.id);
+    }
+}
+
+void RelayScheduler::arm_timer(int64_t now_us) {
+    esp_timer_stop(timer_);
+    if (count_ > 0 && heap_[0].due_us != INT64_MAX) {
+        esp_timer_start_once(timer_, static_cast<uint64_t>(std::max<int64_t>(heap_[0].due_us - now_us, 1)));
+    }
+}
+
+// Caller holds mutex_ (initialize() runs before the task exists)
+void RelayScheduler::load() {
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    size_t length = sizeof(stored_);
+    ret = nvs_get_blob(handle, NVS_KEY_TABLE, &stored_, &length);
+    nvs_close(handle);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return;
+    }
+    size_t header = offsetof(StoredTable, actions);
+    if (ret != ESP_OK || length < header || stored_.version != TABLE_VERSION || stored_.count > MAX_ACTIONS ||
+        length != header + stored_.count * sizeof(RelayAction)) {
+        ESP_LOGW(TAG, "Discarding unreadable schedule: %s", esp_err_to_name(ret));
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    size_t dropped = 0;
+    for (size_t i = 0; i < stored_.count; i++) {
+        Entry entry = {};
+        entry.action = stored_.actions[i];
+        if (!first_due(entry.action, now_us, true, entry.due_us)) {
+            dropped++;
+            continue;
+        }
+        heap_[count_++] = entry;
+        next_id_ = std::max<uint16_t>(next_id_, entry.action.id + 1);
+    }
+    std::make_heap(heap_.begin(), heap_.begin() + count_, later);
+
+    if (dropped > 0) {
+        ESP_LOGW(TAG, "Dropped %u one-shot action(s) from before the reboot", static_cast<unsigned>(dropped));
+        mark_dirty();
+    }
+}
+
+// Caller holds mutex_
+void RelayScheduler::mark_dirty() {
+    dirty_ = true;
+    if (flush_task_) {
+        xTaskNotifyGive(flush_task_);
+    }
+}
+
+void RelayScheduler::flush_task(void* arg) {
+    RelayScheduler* scheduler = static_cast<RelayScheduler*>(arg);
+    bool retry = false;
+    while (true) {
+        // Changes made while a write runs are picked up by the next pass
+        ulTaskNotifyTake(pdTRUE, retry ? pdMS_TO_TICKS(FLUSH_RETRY_MS) : portMAX_DELAY);
+        retry = !scheduler->flush();
+    }
+}
+
+// Flush task only: stored_ is its staging buffer
+bool RelayScheduler::flush() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    if (!dirty_) {
+        xSemaphoreGive(mutex_);
+        return true;
+    }
+    stored_.version = TABLE_VERSION;
+    stored_.count = static_cast<uint16_t>(count_);
+    for (size_t i = 0; i < count_; i++) {
+        stored_.actions[i] = heap_[i].action;
+    }
+    dirty_ = false;
+    xSemaphoreGive(mutex_);
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, NVS_KEY_TABLE, &stored_,
+                           offsetof(StoredTable, actions) + stored_.count * sizeof(RelayAction));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write schedule: %s", esp_err_to_name(ret));
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        dirty_ = true;
+        xSemaphoreGive(mutex_);
+        return false;
+    }
+    return true;
+}
+
+void RelayScheduler::write_status(command_interface::ResponseWriter& out) const {
+    // Printing may block on a slow client, so it works on a copy, never under mutex_
+    xSemaphoreTake(status_mutex_, portMAX_DELAY);
+    std::array<Entry, MAX_ACTIONS>& entries = status_entries_;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    size_t count = count_;
+    std::copy(heap_.begin(), heap_.begin() + count, entries.begin());
+    uint32_t runs = runs_;
+    uint32_t skipped = skipped_;
+    int64_t max_lateness_us = max_lateness_us_;
+    bool dirty = dirty_;
+    xSemaphoreGive(mutex_);
+
+    std::sort(entries.begin(), entries.begin() + count,
+              [](const Entry& a, const Entry& b) { return a.due_us < b.due_us; });
+
+    int64_t now_us = esp_timer_get_time();
+    out.printf("=== Relay Schedule (%zu/%zu) ===\n", count, MAX_ACTIONS);
+    if (count == 0) {
+        out.write("No scheduled actions.\n");
+    }
+    for (size_t i = 0; i < count; i++) {
+        const RelayAction& action = entries[i].action;
+        out.printf("#%-4u ", action.id);
+        for (size_t r = 0; r < RelayManager::RELAY_COUNT; r++) {
+            uint32_t bit = 1u << r;
+            out.write((action.mask & bit) ? ((action.pulse_us || (action.values & bit)) ? "1" : "0") : "x");
+        }
+        if (action.pulse_us) {
+            out.printf(" pulse %" PRIu32 " us", action.pulse_us);
+        }
+        if (entries[i].due_us == INT64_MAX) {
+            out.write(", waiting for clock");
+        } else {
+            out.printf(", next in %lld ms", static_cast<long long>((entries[i].due_us - now_us) / 1000));
+        }
+        if (action.period_ms) {
+            out.printf(", every %" PRIu32 " ms", action.period_ms);
+        }
+        out.write("\n");
+    }
+    out.printf("Runs: %" PRIu32 ", skipped: %" PRIu32 ", worst lateness: %lld us%s\n",
+               runs, skipped, static_cast<long long>(max_lateness_us), dirty ? " (saving to NVS)" : "");
+    xSemaphoreGive(status_mutex_);
+}
+
+} // namespace relay_control
@@ -0,0 +1,81 @@
+#include "response_writer.hpp"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace command_interface {
+
+void ResponseWriter::printf(const char* format, ...) {
+    char buffer[256];
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+
+    if (static_cast<size_t>(len) < sizeof(buffer)) {
+        write(buffer, len);
+        return;
+    }
+
+    // Rare long line: format again into a buffer of the exact size
+    std::string large(len, '\0');
+    va_start(args, format);
+    vsnprintf(large.data(), large.size() + 1, format, args);
+    va_end(args);
+    write(large.data(), large.size());
+}
+
+void SerialResponseWriter::write(const char* data, size_t len) {
+    fwrite(data, 1, len, stdout);
+}
+
+BufferedResponseWriter::BufferedResponseWriter(Sink sink)
+    : sink_(std::move(sink)), used_(0), bytes_sent_(0), failed_(false) {
+}
+
+BufferedResponseWriter::~BufferedResponseWriter() {
+    flush();
+}
+
+void BufferedResponseWriter::write(const char* data, size_t len) {
+    while (len > 0 && !failed_) {
+        size_t count = std::min(len, BUFFER_SIZE - used_);
+        memcpy(buffer_ + used_, data, count);
+        used_ += count;
+        data += count;
+        len -= count;
+
+        if (used_ == BUFFER_SIZE) {
+            flush();
+        }
+    }
+}
+
+bool BufferedResponseWriter::flush() {
+    if (failed_) {
+        return false;
+    }
+    if (used_ == 0) {
+        return true;
+    }
+
+    if (!sink_(buffer_, used_)) {
+        failed_ = true;
+    } else {
+        bytes_sent_ += used_;
+    }
+    used_ = 0;
+    return !failed_;
+}
+
+void StringResponseWriter::write(const char* data, size_t len) {
+    buffer_.append(data, len);
+}
+
+} // namespace command_interface
@@ -0,0 +1,104 @@
+#include "serial_console.hpp"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "driver/usb_serial_jtag.h"
+#include "esp_vfs_dev.h"
+#include "esp_vfs_usb_serial_jtag.h"
+#include "freertos/FreeRTOS.h"
+#include <cstdio>
+
+namespace command_interface {
+
+static const char* TAG = "SerialConsole";
+
+SerialConsole::SerialConsole()
+    : chunk_len_(0), chunk_pos_(0), line_len_(0), echo_len_(0), echo_enabled_(true), skip_lf_(false) {
+}
+
+bool SerialConsole::initialize() {
+    ESP_LOGI(TAG, "Setting up USB Serial JTAG");
+
+    usb_serial_jtag_driver_config_t usb_serial_config = {
+        .tx_buffer_size = CONFIG_CONSOLE_TX_BUFFER_SIZE,
+        .rx_buffer_size = CONFIG_CONSOLE_RX_BUFFER_SIZE,
+    };
+
+    esp_err_t ret = usb_serial_jtag_driver_install(&usb_serial_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install USB Serial JTAG driver: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    // stdout (responses and logs) goes through the driver too; input is read
+    // from the driver directly, so only the TX line ending matters
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    esp_vfs_usb_serial_jtag_use_driver();
+    esp_vfs_dev_uart_port_set_tx_line_endings(0, ESP_LINE_ENDINGS_CRLF);
+    #pragma GCC diagnostic pop
+
+    ESP_LOGI(TAG, "USB Serial JTAG setup complete (rx %d, tx %d bytes)",
+             CONFIG_CONSOLE_RX_BUFFER_SIZE, CONFIG_CONSOLE_TX_BUFFER_SIZE);
+    return true;
+}
+
+void SerialConsole::set_echo(bool echo) {
+    echo_enabled_ = echo;
+}
+
+bool SerialConsole::echo() const {
+    return echo_enabled_;
+}
+
+std::string_view SerialConsole::read_line() {
+    line_len_ = 0;
+    while (!assemble_line()) {
+        flush_echo();
+        // Sleeps in the driver until the RX interrupt delivers data
+        int received = usb_serial_jtag_read_bytes(chunk_, sizeof(chunk_), portMAX_DELAY);
+        chunk_len_ = received > 0 ? static_cast<size_t>(received) : 0;
+        chunk_pos_ = 0;
+    }
+    flush_echo();
+    return std::string_view(line_, line_len_);
+}
+
+bool SerialConsole::assemble_line() {
+    while (chunk_pos_ < chunk_len_) {
+        char c = chunk_[chunk_pos_++];
+        bool lf_after_cr = skip_lf_ && c == '\n';
+        skip_lf_ = false;
+        if (lf_after_cr) {
+            continue;
+        }
+
+        if (c == '\r' || c == '\n') {
+            skip_lf_ = c == '\r';
+            echo_[echo_len_++] = '\n';
+            return true;
+        }
+        if (c == 8 || c == 127) { // Backspace or DEL
+            if (line_len_ > 0) {
+                --line_len_;
+                echo_[echo_len_++] = '\b';
+                echo_[echo_len_++] = ' ';
+                echo_[echo_len_++] = '\b';
+            }
+        } else if (c >= 32 && c < 127 && line_len_ < MAX_LINE_LEN) {
+            // Printable ASCII character
+            line_[line_len_++] = c;
+            echo_[echo_len_++] = c;
+        }
+    }
+    return false;
+}
+
+void SerialConsole::flush_echo() {
+    if (echo_enabled_ && echo_len_ > 0) {
+        fwrite(echo_, 1, echo_len_, stdout);
+        fflush(stdout);
+    }
+    echo_len_ = 0;
+}
+
+} // namespace command_interface
@@ -0,0 +1,286 @@
+#include "sys_stats.hpp"
+#include "response_writer.hpp"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <memory>
+#include <new>
+
+namespace telemetry {
+
+namespace {
+
+struct HeapRegion {
+    const char* name;
+    uint32_t caps;
+};
+
+constexpr HeapRegion HEAP_REGIONS[] = {
+    {"Internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT},
+    {"PSRAM", MALLOC_CAP_SPIRAM},
+};
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+constexpr const char* TASK_STATE_NAMES[] = {"run", "ready", "block", "susp", "del", "?"};
+constexpr size_t MAX_TRACKED_TASKS = 32;
+// Headroom for tasks created between counting and listing them
+constexpr UBaseType_t TASK_LIST_SLACK = 4;
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+using RunTimeCounter = decltype(TaskStatus_t::ulRunTimeCounter);
+
+struct TaskRunTime {
+    TaskHandle_t handle;
+    RunTimeCounter counter;
+};
+
+// Counters at the previous report, so CPU shares cover the time in between
+portMUX_TYPE run_time_lock = portMUX_INITIALIZER_UNLOCKED;
+std::array<TaskRunTime, MAX_TRACKED_TASKS> last_run_times;
+size_t last_run_time_count = 0;
+uint32_t last_total_run_time = 0;
+#endif
+
+#endif // CONFIG_FREERTOS_USE_TRACE_FACILITY
+
+#if CONFIG_CMD_ALLOC_STATS
+
+struct CommandAllocs {
+    std::string_view command;
+    uint32_t calls;
+    uint32_t allocs;
+    int64_t kept;          // Allocations minus frees; negative when a command frees older memory
+    uint64_t bytes;
+    uint32_t max_allocs;   // Most allocations in one call
+};
+
+constexpr size_t MAX_ALLOC_COMMANDS = 64;
+
+portMUX_TYPE alloc_lock = portMUX_INITIALIZER_UNLOCKED;
+std::array<CommandAllocs, MAX_ALLOC_COMMANDS> command_allocs;
+size_t command_alloc_count = 0;
+
+// Tasks inside a scope; while zero the hooks never touch task-local state,
+// which keeps them safe for allocations made before the scheduler starts
+std::atomic<uint32_t> active_scopes{0};
+thread_local uint32_t scope_depth = 0;
+thread_local AllocScope::Counts scope_counts = {};
+
+void record_allocs(std::string_view command, const AllocScope::Counts& counts) {
+    taskENTER_CRITICAL(&alloc_lock);
+    CommandAllocs* entry = nullptr;
+    for (size_t i = 0; i < command_alloc_count; i++) {
+        if (command_allocs[i].command == command) {
+            entry = &command_allocs[i];
+            break;
+        }
+    }
+    if (entry == nullptr && command_alloc_count < MAX_ALLOC_COMMANDS) {
+        entry = &command_allocs[command_alloc_count++];
+        *entry = CommandAllocs{command, 0, 0, 0, 0, 0};
+    }
+    if (entry != nullptr) {
+        entry->calls++;
+        entry->allocs += counts.allocs;
+        entry->kept += static_cast<int64_t>(counts.allocs) - counts.frees;
+        entry->bytes += counts.bytes;
+        entry->max_allocs = std::max(entry->max_allocs, counts.allocs);
+    }
+    taskEXIT_CRITICAL(&alloc_lock);
+}
+
+#endif // CONFIG_CMD_ALLOC_STATS
+
+} // namespace
+
+void write_heap_report(command_interface::ResponseWriter& out) {
+    out.write("=== Heap (bytes) ===\n");
+    out.write("Region       Total      Free   MinFree   Largest  Frag\n");
+    for (const HeapRegion& region : HEAP_REGIONS) {
+        size_t total = heap_caps_get_total_size(region.caps);
+        if (total == 0) {
+            out.printf("%-8s  not present\n", region.name);
+            continue;
+        }
+        size_t free = heap_caps_get_free_size(region.caps);
+        size_t largest = heap_caps_get_largest_free_block(region.caps);
+        // Share of free memory that cannot be handed out as one block
+        unsigned frag = free > 0 ? static_cast<unsigned>(100 - largest * 100 / free) : 0;
+        out.printf("%-8s  %8zu  %8zu  %8zu  %8zu  %3u%%\n", region.name, total, free,
+                   heap_caps_get_minimum_free_size(region.caps), largest, frag);
+    }
+}
+
+void write_task_report(command_interface::ResponseWriter& out) {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + TASK_LIST_SLACK;
+    std::unique_ptr<TaskStatus_t[]> tasks(new (std::nothrow) TaskStatus_t[capacity]);
+    if (!tasks) {
+        out.write("Out of memory listing tasks\n");
+        return;
+    }
+    uint32_t total_run_time = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks.get(), capacity, &total_run_time);
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // Swap each counter for its delta since the last report and keep the new ones
+    taskENTER_CRITICAL(&run_time_lock);
+    uint32_t elapsed = total_run_time - last_total_run_time;
+    std::array<TaskRunTime, MAX_TRACKED_TASKS> previous = last_run_times;
+    size_t previous_count = last_run_time_count;
+    last_total_run_time = total_run_time;
+    last_run_time_count = std::min<size_t>(count, MAX_TRACKED_TASKS);
+    for (size_t i = 0; i < last_run_time_count; i++) {
+        last_run_times[i] = TaskRunTime{tasks[i].xHandle, tasks[i].ulRunTimeCounter};
+    }
+    taskEXIT_CRITICAL(&run_time_lock);
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < previous_count; j++) {
+            if (previous[j].handle == tasks[i].xHandle) {
+                tasks[i].ulRunTimeCounter -= previous[j].counter;
+                break;
+            }
+        }
+    }
+    std::sort(tasks.get(), tasks.get() + count, [](const TaskStatus_t& a, const TaskStatus_t& b) {
+        return a.ulRunTimeCounter > b.ulRunTimeCounter;
+    });
+    out.printf("=== Tasks (%u, CPU over the last %" PRIu32 " ms, %% of one core) ===\n",
+               static_cast<unsigned>(count), elapsed / 1000);
+#else
+    out.printf("=== Tasks (%u) ===\n", static_cast<unsigned>(count));
+#endif
+
+    out.write("Name              Core  Prio  State  StackFree   CPU\n");
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t& task = tasks[i];
+        out.printf("%-16s  ", task.pcTaskName);
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        if (task.xCoreID == tskNO_AFFINITY) {
+            out.write("   -");
+        } else {
+            out.printf("%4d", static_cast<int>(task.xCoreID));
+        }
+#else
+        out.write("   ?");
+#endif
+        out.printf("  %4u  %-5s  %9" PRIu32, static_cast<unsigned>(task.uxCurrentPriority),
+                   TASK_STATE_NAMES[std::min<size_t>(task.eCurrentState, std::size(TASK_STATE_NAMES) - 1)],
+                   static_cast<uint32_t>(task.usStackHighWaterMark));
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+        uint32_t per_mille = elapsed > 0
+            ? static_cast<uint32_t>(static_cast<uint64_t>(task.ulRunTimeCounter) * 1000 / elapsed) : 0;
+        out.printf("  %3" PRIu32 ".%" PRIu32 "%%\n", per_mille / 10, per_mille % 10);
+#else
+        out.write("      -\n");
+#endif
+    }
+#if !CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    out.write("CPU shares need CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS\n");
+#endif
+
+#else
+    out.write("Task list needs CONFIG_FREERTOS_USE_TRACE_FACILITY (enable CONFIG_SYS_STATS_TASKS)\n");
+    out.printf("This task: %s, %u bytes of stack never used\n", pcTaskGetName(nullptr),
+               static_cast<unsigned>(uxTaskGetStackHighWaterMark(nullptr)));
+#endif // CONFIG_FREERTOS_USE_TRACE_FACILITY
+}
+
+#if CONFIG_CMD_ALLOC_STATS
+
+AllocScope::AllocScope(std::string_view command) : command_(command), outer_(scope_counts) {
+    scope_counts = {};
+    if (scope_depth++ == 0) {
+        active_scopes++;
+    }
+}
+
+AllocScope::~AllocScope() {
+    Counts counts = scope_counts;
+    if (--scope_depth == 0) {
+        active_scopes--;
+    }
+    record_allocs(command_, counts);
+    scope_counts = Counts{outer_.allocs + counts.allocs, outer_.frees + counts.frees, outer_.bytes + counts.bytes};
+}
+
+void write_alloc_report(command_interface::ResponseWriter& out) {
+    taskENTER_CRITICAL(&alloc_lock);
+    std::array<CommandAllocs, MAX_ALLOC_COMMANDS> entries = command_allocs;
+    size_t count = command_alloc_count;
+    taskEXIT_CRITICAL(&alloc_lock);
+
+    std::sort(entries.begin(), entries.begin() + count,
+              [](const CommandAllocs& a, const CommandAllocs& b) { return a.allocs > b.allocs; });
+
+    out.write("=== Heap Allocations per Command ===\n");
+    if (count == 0) {
+        out.write("No commands run yet\n");
+        return;
+    }
+    out.write("Command            Calls  Allocs/call  Bytes/call  Max allocs     Kept\n");
+    for (size_t i = 0; i < count; i++) {
+        const CommandAllocs& entry = entries[i];
+        out.printf("%-16.*s  %6" PRIu32 "  %11" PRIu32 "  %10" PRIu64 "  %10" PRIu32 "  %7" PRId64 "\n",
+                   static_cast<int>(entry.command.size()), entry.command.data(), entry.calls,
+                   entry.allocs / entry.calls, entry.bytes / entry.calls, entry.max_allocs, entry.kept);
+    }
+    out.write("Kept: allocations not freed by the command that made them, summed over all calls\n");
+}
+
+void reset_alloc_stats() {
+    taskENTER_CRITICAL(&alloc_lock);
+    command_alloc_count = 0;
+    taskEXIT_CRITICAL(&alloc_lock);
+}
+
+#else
+
+void write_alloc_report(command_interface::ResponseWriter& out) {
+    out.write("Per-command allocation counts are off (enable CONFIG_CMD_ALLOC_STATS)\n");
+}
+
+void reset_alloc_stats() {
+}
+
+#endif // CONFIG_CMD_ALLOC_STATS
+
+} // namespace telemetry
+
+#if CONFIG_CMD_ALLOC_STATS
+
+/*
+ * Heap hooks (CONFIG_HEAP_USE_HOOKS). They run inside every malloc and free,
+ * from any task or ISR and possibly with the flash cache disabled, so they
+ * stay in IRAM and only bump the calling task's counters.
+ */
+
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void* ptr, size_t size, uint32_t caps) {
+    using namespace telemetry;
+    if (ptr == nullptr || active_scopes.load(std::memory_order_relaxed) == 0 || xPortInIsrContext()) {
+        return;
+    }
+    if (scope_depth != 0) {
+        scope_counts.allocs++;
+        scope_counts.bytes += size;
+    }
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void* ptr) {
+    using namespace telemetry;
+    if (ptr == nullptr || active_scopes.load(std::memory_order_relaxed) == 0 || xPortInIsrContext()) {
+        return;
+    }
+    if (scope_depth != 0) {
+        scope_counts.frees++;
+    }
+}
+
+#endif // CONFIG_CMD_ALLOC_STATS
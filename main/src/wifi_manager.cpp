@@ -1,11 +1,17 @@
 #include "wifi_manager.hpp"
+#include "event_bus.hpp"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_netif.h"
 #include "esp_wifi_remote.h"
 #include "esp_mac.h"
-#include "esp_hosted.h"
-#include "nvs_flash.h"
+#include "esp_random.h"
+#include "esp_netif_sntp.h"
+#include "freertos/task.h"
+#include <cinttypes>
+#include <cstdlib>
+#include <ctime>
+#include <cstddef>
 #include <cstring>
 #include <algorithm>
 
@@ -14,11 +20,35 @@ namespace wifi_config {
 static const char* TAG = "WiFiManager";
 
 WiFiManager::WiFiManager() 
-    : initialized_(false), connected_(false), retry_count_(0) {
+    : scan_staging_{}, scanning_(false), scan_started_us_(0),
+      background_scan_timer_(nullptr), background_interval_s_(0),
+      background_dwell_ms_(CONFIG_WIFI_SCAN_DWELL_MAX_MS),
+      initialized_(false), link_state_(LinkState::IDLE),
+      reconnect_timer_(nullptr), failover_rank_(0), attempt_retries_(0), backoff_attempt_(0),
+      reconfigure_pending_(false), backoff_ms_(0), disconnects_(0), reconnect_attempts_(0),
+      reconnects_(0), failovers_(0), last_disconnect_reason_(0), last_ap_{},
+      last_connect_time_ms_(0), last_connect_fast_(false), auto_connecting_(false),
+      static_ip_active_(false), time_sync_started_(false) {
     wifi_event_group_ = xEventGroupCreate();
+    scan_mutex_ = xSemaphoreCreateMutex();
+    connect_mutex_ = xSemaphoreCreateMutex();
 }
 
 WiFiManager::~WiFiManager() {
+    if (background_scan_timer_) {
+        esp_timer_stop(background_scan_timer_);
+        esp_timer_delete(background_scan_timer_);
+    }
+    if (reconnect_timer_) {
+        esp_timer_stop(reconnect_timer_);
+        esp_timer_delete(reconnect_timer_);
+    }
+    if (scan_mutex_) {
+        vSemaphoreDelete(scan_mutex_);
+    }
+    if (connect_mutex_) {
+        vSemaphoreDelete(connect_mutex_);
+    }
     if (wifi_event_group_) {
         vEventGroupDelete(wifi_event_group_);
     }
@@ -32,30 +62,13 @@ bool WiFiManager::initialize() {
     
     ESP_LOGI(TAG, "Initializing WiFi Manager");
     
-    // Initialize NVS
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(ret));
-        return false;
-    }
-    
-    // Initialize ESP-Hosted
-    ret = esp_hosted_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize ESP-Hosted: %s", esp_err_to_name(ret));
-        return false;
-    }
-    
+    // NVS and the ESP-Hosted transport are brought up at boot, shared with BLE
     setup_wifi_stack();
     register_event_handlers();
     
     // Initialize WiFi with default config (will be remapped to remote via esp_wifi_remote)
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ret = esp_wifi_init(&cfg);
+    esp_err_t ret = esp_wifi_init(&cfg);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize WiFi: %s", esp_err_to_name(ret));
         return false;
@@ -65,6 +78,32 @@ bool WiFiManager::initialize() {
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
     
+    const esp_timer_create_args_t timer_args = {
+        .callback = &WiFiManager::background_scan_timer_callback,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "wifi_bg_scan",
+        .skip_unhandled_events = true,
+    };
+    ret = esp_timer_create(&timer_args, &background_scan_timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create background scan timer: %s", esp_err_to_name(ret));
+        background_scan_timer_ = nullptr;
+    }
+    
+    const esp_timer_create_args_t reconnect_args = {
+        .callback = &WiFiManager::reconnect_timer_callback,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "wifi_reconnect",
+        .skip_unhandled_events = true,
+    };
+    ret = esp_timer_create(&reconnect_args, &reconnect_timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create reconnect timer: %s", esp_err_to_name(ret));
+        return false;
+    }
+    
     initialized_ = true;
     ESP_LOGI(TAG, "WiFi Manager initialized successfully");
     return true;
@@ -96,117 +135,547 @@ void WiFiManager::event_handler(void* arg, esp_event_base_t event_base,
                 ESP_LOGI(TAG, "WiFi started");
                 break;
                 
-            case WIFI_EVENT_STA_DISCONNECTED:
-                manager->connected_ = false;
-                manager->connected_ssid_.clear();
-                if (manager->retry_count_ < MAX_RETRY_COUNT) {
-                    esp_wifi_connect();
-                    manager->retry_count_++;
-                    ESP_LOGI(TAG, "Retry to connect to the AP (attempt %d/%d)", 
-                            manager->retry_count_, MAX_RETRY_COUNT);
-                } else {
-                    ESP_LOGI(TAG, "Connect to the AP failed");
-                    xEventGroupSetBits(manager->wifi_event_group_, WIFI_FAIL_BIT);
-                }
+            case WIFI_EVENT_STA_DISCONNECTED: {
+                const wifi_event_sta_disconnected_t* info =
+                    static_cast<const wifi_event_sta_disconnected_t*>(event_data);
+                manager->handle_disconnected(info ? info->reason : static_cast<uint8_t>(WIFI_REASON_UNSPECIFIED));
                 break;
+            }
                 
-            case WIFI_EVENT_SCAN_DONE:
-                ESP_LOGI(TAG, "WiFi scan completed");
-                
-                uint16_t ap_count = 0;
-                esp_wifi_scan_get_ap_num(&ap_count);
-                
-                if (ap_count == 0) {
-                    ESP_LOGI(TAG, "No WiFi networks found");
-                    manager->scanned_networks_.clear();
-                    xEventGroupSetBits(manager->wifi_event_group_, WIFI_SCAN_DONE_BIT);
-                    return;
-                }
-                
-                auto ap_info = std::make_unique<wifi_ap_record_t[]>(ap_count);
-                esp_wifi_scan_get_ap_records(&ap_count, ap_info.get());
-                
-                manager->scanned_networks_.clear();
-                manager->scanned_networks_.reserve(std::min(static_cast<int>(ap_count), MAX_NETWORKS));
+            case WIFI_EVENT_SCAN_DONE: {
+                const wifi_event_sta_scan_done_t* done =
+                    static_cast<const wifi_event_sta_scan_done_t*>(event_data);
+                manager->handle_scan_done(done == nullptr || done->status == 0);
+                break;
+            }
+            
+            case WIFI_EVENT_STA_CONNECTED: {
+                // Remember where the AP lives so the next connect can skip the channel sweep
+                const wifi_event_sta_connected_t* info =
+                    static_cast<const wifi_event_sta_connected_t*>(event_data);
+                xSemaphoreTake(manager->scan_mutex_, portMAX_DELAY);
+                manager->last_ap_ssid_.assign(reinterpret_cast<const char*>(info->ssid),
+                                              strnlen(reinterpret_cast<const char*>(info->ssid),
+                                                      std::min<size_t>(info->ssid_len, sizeof(info->ssid))));
+                memcpy(manager->last_ap_.bssid, info->bssid, sizeof(manager->last_ap_.bssid));
+                manager->last_ap_.channel = info->channel;
+                manager->last_ap_.auth_mode = info->authmode;
+                xSemaphoreGive(manager->scan_mutex_);
+                ESP_LOGI(TAG, "Associated with " MACSTR " on channel %u",
+                         MAC2STR(info->bssid), info->channel);
                 
-                for (int i = 0; i < std::min(static_cast<int>(ap_count), MAX_NETWORKS); i++) {
-                    std::string ssid(reinterpret_cast<const char*>(ap_info[i].ssid));
-                    if (!ssid.empty()) {  // Skip empty SSIDs
-                        manager->scanned_networks_.emplace_back(
-                            ssid, ap_info[i].rssi, ap_info[i].authmode);
-                    }
+                // A static address is already configured, so no GOT_IP wait is needed
+                if (manager->static_ip_active_) {
+                    manager->handle_link_up();
                 }
-                
-                // Sort networks by signal strength (strongest first)
-                std::sort(manager->scanned_networks_.begin(), manager->scanned_networks_.end(),
-                         [](const NetworkInfo& a, const NetworkInfo& b) {
-                             return a.rssi > b.rssi;
-                         });
-                
-                ESP_LOGI(TAG, "Found %d WiFi networks", static_cast<int>(manager->scanned_networks_.size()));
-                xEventGroupSetBits(manager->wifi_event_group_, WIFI_SCAN_DONE_BIT);
                 break;
+            }
         }
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = static_cast<ip_event_got_ip_t*>(event_data);
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
         
-        manager->connected_ = true;
-        manager->retry_count_ = 0;
+        manager->handle_link_up();
+    }
+}
+
+void WiFiManager::publish_link(bool connected, const std::string& ssid) {
+    LinkStatus status = {};
+    status.connected = connected;
+    memcpy(status.ssid, ssid.data(), std::min(ssid.size(), sizeof(status.ssid) - 1));
+    link_status_.store(status);
+}
+
+void WiFiManager::handle_link_up() {
+    // reconnect_ssid_ holds the network being joined, by connect_to_network() or a reconnect
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    std::string ssid = reconnect_ssid_;
+    xSemaphoreGive(scan_mutex_);
+    publish_link(true, ssid);
+    
+    if (link_state_ == LinkState::RECONNECTING) {
+        reconnects_++;
+        ESP_LOGI(TAG, "Reconnected to %s after %" PRIu32 " attempt(s)",
+                 ssid.c_str(), backoff_attempt_ + 1);
+        link_state_ = LinkState::CONNECTED;
+    }
+    backoff_attempt_ = 0;
+    backoff_ms_ = 0;
+    
+    start_time_sync();
+    xEventGroupSetBits(wifi_event_group_, WIFI_CONNECTED_BIT);
+    
+    event_bus::WifiUpEvent event = {};
+    memcpy(event.ssid, ssid.data(), std::min(ssid.size(), sizeof(event.ssid) - 1));
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (netif && esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
+        event.ip = ip_info.ip.addr;
+    }
+    event_bus::post(event_bus::EventId::WIFI_UP, event);
+}
+
+void WiFiManager::start_time_sync() {
+    if (time_sync_started_ || sizeof(CONFIG_WIFI_SNTP_SERVER) <= 1) {
+        return;
+    }
+    time_sync_started_ = true;
+    
+    setenv("TZ", CONFIG_WIFI_TIMEZONE, 1);
+    tzset();
+    
+    // SNTP keeps resyncing on its own across later reconnects
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_WIFI_SNTP_SERVER);
+    esp_err_t ret = esp_netif_sntp_init(&config);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start SNTP: %s", esp_err_to_name(ret));
+        return;
+    }
+    ESP_LOGI(TAG, "SNTP started (%s, TZ=%s)", CONFIG_WIFI_SNTP_SERVER, CONFIG_WIFI_TIMEZONE);
+}
+
+// Runs in the event loop task: decides what to do, the reconnect timer does it
+void WiFiManager::handle_disconnected(uint8_t reason) {
+    bool was_connected = is_connected();
+    publish_link(false, std::string());
+    last_disconnect_reason_ = reason;
+    if (was_connected) {
+        event_bus::post(event_bus::EventId::WIFI_DOWN, event_bus::WifiDownEvent{reason});
+    }
+    
+    LinkState state = link_state_;
+    if (state == LinkState::IDLE || state == LinkState::STOPPED) {
+        // Requested by disconnect() or a connect fallback; do not fight it
+        return;
+    }
+    
+    bool auth_failure = is_auth_failure(reason);
+    
+    if (state == LinkState::CONNECTING) {
+        // Explicit connect: a few spaced retries, then let connect_to_network() decide
+        if (auth_failure || attempt_retries_ >= CONFIG_WIFI_CONNECT_RETRIES) {
+            ESP_LOGW(TAG, "Connect to the AP failed (reason %u)", reason);
+            xEventGroupSetBits(wifi_event_group_, WIFI_FAIL_BIT);
+            return;
+        }
+        attempt_retries_++;
+        ESP_LOGI(TAG, "Retry to connect to the AP (attempt %" PRIu32 "/%d, reason %u)",
+                 attempt_retries_, CONFIG_WIFI_CONNECT_RETRIES, reason);
+        schedule_reconnect(backoff_delay_ms(attempt_retries_ - 1));
+        return;
+    }
+    
+    if (state == LinkState::CONNECTED) {
+        if (was_connected) {
+            disconnects_++;
+        }
+        ESP_LOGW(TAG, "Connection lost (reason %u), reconnecting", reason);
+        link_state_ = LinkState::RECONNECTING;
+        backoff_attempt_ = 0;
+    } else {
+        backoff_attempt_++;
+    }
+    
+    if (auth_failure) {
+        // Rejected credentials will not start working by retrying the same network
+        backoff_attempt_ = CONFIG_WIFI_RECONNECT_FAILOVER_ATTEMPTS;
+    }
+    
+    if (backoff_attempt_ >= CONFIG_WIFI_RECONNECT_FAILOVER_ATTEMPTS) {
+        if (!select_failover_profile()) {
+            if (auth_failure) {
+                ESP_LOGE(TAG, "Authentication rejected and no other saved network, giving up");
+                link_state_ = LinkState::STOPPED;
+                backoff_ms_ = 0;
+                return;
+            }
+            // Only one candidate: keep retrying it, but sweep all channels instead of the pinned BSS
+            reconfigure_pending_ = true;
+        }
+    }
+    
+    schedule_reconnect(backoff_delay_ms(backoff_attempt_));
+}
+
+bool WiFiManager::is_auth_failure(uint8_t reason) {
+    switch (reason) {
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_802_1X_AUTH_FAILED:
+        case WIFI_REASON_NO_AP_FOUND_W_COMPATIBLE_SECURITY:
+        case WIFI_REASON_NO_AP_FOUND_IN_AUTHMODE_THRESHOLD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t WiFiManager::backoff_delay_ms(uint32_t attempt) {
+    uint64_t delay = static_cast<uint64_t>(CONFIG_WIFI_RECONNECT_BASE_MS) << std::min<uint32_t>(attempt, 16);
+    delay = std::min<uint64_t>(delay, CONFIG_WIFI_RECONNECT_MAX_MS);
+    
+    // Equal jitter: half fixed, half random, so devices sharing an AP do not retry in lockstep
+    uint32_t half = static_cast<uint32_t>(delay / 2);
+    return half + esp_random() % (half + 1);
+}
+
+void WiFiManager::schedule_reconnect(uint32_t delay_ms) {
+    backoff_ms_ = delay_ms;
+    esp_timer_stop(reconnect_timer_);
+    esp_err_t ret = esp_timer_start_once(reconnect_timer_, static_cast<uint64_t>(delay_ms) * 1000);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to schedule reconnect: %s", esp_err_to_name(ret));
+    }
+}
+
+bool WiFiManager::select_failover_profile() {
+    if (!credentials_) {
+        return false;
+    }
+    
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    std::string current = reconnect_ssid_;
+    xSemaphoreGive(scan_mutex_);
+    
+    // Walk the saved networks in rank order, starting after the one that keeps failing
+    size_t count = credentials_->count();
+    for (size_t i = 1; i <= count; i++) {
+        size_t rank = (failover_rank_ + i) % count;
+        WiFiProfile profile;
+        if (!credentials_->get(rank, profile) || current == profile.ssid) {
+            continue;
+        }
+        
+        xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+        reconnect_ssid_ = profile.ssid;
+        reconnect_password_ = profile.password;
+        xSemaphoreGive(scan_mutex_);
         
-        // SSID will be set during connection process
-        // connected_ssid_ is already set in connect_to_network()
+        failover_rank_ = rank;
+        backoff_attempt_ = 0;
+        reconfigure_pending_ = true;
+        failovers_++;
+        ESP_LOGW(TAG, "Failing over from %s to saved network %u (%s)",
+                 current.c_str(), static_cast<unsigned>(rank), profile.ssid);
+        return true;
+    }
+    return false;
+}
+
+void WiFiManager::reconnect_timer_callback(void* arg) {
+    WiFiManager* manager = static_cast<WiFiManager*>(arg);
+    
+    LinkState state = manager->link_state_;
+    if (state != LinkState::CONNECTING && state != LinkState::RECONNECTING) {
+        return;
+    }
+    
+    if (state == LinkState::RECONNECTING) {
+        manager->reconnect_attempts_++;
         
-        xEventGroupSetBits(manager->wifi_event_group_, WIFI_CONNECTED_BIT);
+        if (manager->reconfigure_pending_.exchange(false)) {
+            xSemaphoreTake(manager->scan_mutex_, portMAX_DELAY);
+            std::string ssid = manager->reconnect_ssid_;
+            std::string password = manager->reconnect_password_;
+            xSemaphoreGive(manager->scan_mutex_);
+            
+            WiFiProfile profile;
+            bool saved = manager->credentials_ && manager->credentials_->find(ssid, profile);
+            manager->apply_ip_config((saved && profile.static_ip) ? &profile : nullptr);
+            if (manager->configure_station(ssid, password, nullptr) != ESP_OK) {
+                manager->schedule_reconnect(backoff_delay_ms(++manager->backoff_attempt_));
+                return;
+            }
+        }
+        ESP_LOGI(TAG, "Reconnect attempt %" PRIu32, manager->backoff_attempt_ + 1);
+    }
+    
+    // Non-blocking: the outcome arrives as STA_CONNECTED/GOT_IP or another STA_DISCONNECTED
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect failed: %s", esp_err_to_name(ret));
+        if (state == LinkState::RECONNECTING) {
+            manager->schedule_reconnect(backoff_delay_ms(++manager->backoff_attempt_));
+        } else {
+            xEventGroupSetBits(manager->wifi_event_group_, WIFI_FAIL_BIT);
+        }
     }
 }
 
-bool WiFiManager::scan_networks() {
-    if (!initialized_) {
-        ESP_LOGE(TAG, "WiFiManager not initialized");
-        return false;
+void WiFiManager::begin_recovery() {
+    if (!credentials_ || credentials_->count() == 0) {
+        return;
+    }
+    
+    WiFiProfile profile;
+    if (!credentials_->get(0, profile)) {
+        return;
+    }
+    
+    // Nothing answered at boot: keep cycling through the saved networks in the background
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    reconnect_ssid_ = profile.ssid;
+    reconnect_password_ = profile.password;
+    xSemaphoreGive(scan_mutex_);
+    
+    failover_rank_ = 0;
+    backoff_attempt_ = 0;
+    reconfigure_pending_ = true;
+    link_state_ = LinkState::RECONNECTING;
+    schedule_reconnect(backoff_delay_ms(CONFIG_WIFI_RECONNECT_FAILOVER_ATTEMPTS));
+}
+
+// Runs in the event loop task, the only writer of scan_table_
+void WiFiManager::handle_scan_done(bool success) {
+    std::vector<NetworkInfo> networks;
+    
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    std::string filter_ssid;
+    filter_ssid.swap(scan_filter_ssid_);
+    xSemaphoreGive(scan_mutex_);
+    
+    // A targeted scan only refreshes its own SSID; carry the rest of the cache over
+    if (success && !filter_ssid.empty()) {
+        for (size_t i = 0; i < scan_staging_.count; i++) {
+            if (filter_ssid != scan_staging_.networks[i].ssid) {
+                networks.push_back(scan_staging_.networks[i]);
+            }
+        }
+    }
+    
+    uint16_t ap_count = 0;
+    if (success) {
+        esp_wifi_scan_get_ap_num(&ap_count);
+    }
+    
+    if (ap_count > 0) {
+        auto ap_info = std::make_unique<wifi_ap_record_t[]>(ap_count);
+        esp_wifi_scan_get_ap_records(&ap_count, ap_info.get());
+        
+        networks.reserve(networks.size() + ap_count);
+        for (int i = 0; i < ap_count; i++) {
+            const char* raw_ssid = reinterpret_cast<const char*>(ap_info[i].ssid);
+            std::string_view ssid(raw_ssid, strnlen(raw_ssid, sizeof(ap_info[i].ssid)));
+            if (!ssid.empty()) {  // Skip empty SSIDs
+                networks.emplace_back(ssid, ap_info[i].rssi, ap_info[i].authmode,
+                                      ap_info[i].bssid, ap_info[i].primary);
+            }
+        }
+        
+        // Sort networks by signal strength (strongest first) and keep the best MAX_NETWORKS
+        std::sort(networks.begin(), networks.end(),
+                  [](const NetworkInfo& a, const NetworkInfo& b) {
+                      return a.rssi > b.rssi;
+                  });
+        if (networks.size() > MAX_NETWORKS) {
+            networks.erase(networks.begin() + MAX_NETWORKS, networks.end());
+        }
+    }
+    
+    size_t count = networks.size();
+    if (success) {
+        // Build the new table off to the side, then publish it in one step
+        std::copy(networks.begin(), networks.end(), scan_staging_.networks.begin());
+        scan_staging_.count = count;
+        scan_staging_.timestamp_us = esp_timer_get_time();
+        scan_table_.store(scan_staging_);
+    }
+    
+    ScanCallback callback;
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    callback.swap(scan_callback_);
+    xSemaphoreGive(scan_mutex_);
+    
+    scanning_ = false;
+    
+    if (success) {
+        ESP_LOGI(TAG, "WiFi scan completed: %d networks", static_cast<int>(count));
+    } else {
+        ESP_LOGW(TAG, "WiFi scan failed or was aborted");
+    }
+    
+    if (callback) {
+        callback(success, count);
+    }
+}
+
+bool WiFiManager::begin_scan(const std::string& ssid, uint8_t channel, uint32_t dwell_max_ms,
+                             ScanCallback on_done) {
+    int64_t now = esp_timer_get_time();
+    
+    bool expected = false;
+    if (!scanning_.compare_exchange_strong(expected, true)) {
+        if (now - scan_started_us_ < static_cast<int64_t>(CONFIG_WIFI_SCAN_TIMEOUT_MS) * 1000) {
+            ESP_LOGW(TAG, "WiFi scan already in progress");
+            return false;
+        }
+        // The completion event was lost; abandon the old scan and start over
+        ESP_LOGW(TAG, "Previous WiFi scan never completed, restarting");
+        esp_wifi_scan_stop();
     }
+    scan_started_us_ = now;
     
-    ESP_LOGI(TAG, "Starting WiFi scan");
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    scan_callback_ = std::move(on_done);
+    scan_filter_ssid_ = ssid;
+    xSemaphoreGive(scan_mutex_);
     
-    // Clear previous scan results
-    scanned_networks_.clear();
+    // Directed probe requests also find hidden networks by name
+    uint8_t ssid_buf[33] = {};
+    memcpy(ssid_buf, ssid.data(), std::min(ssid.size(), sizeof(ssid_buf) - 1));
     
-    // Clear event bits
-    xEventGroupClearBits(wifi_event_group_, WIFI_SCAN_DONE_BIT);
+    wifi_scan_config_t scan_config = {};
+    scan_config.ssid = ssid.empty() ? nullptr : ssid_buf;
+    scan_config.channel = channel;
+    scan_config.show_hidden = !ssid.empty();
+    scan_config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    scan_config.scan_time.active.min = std::min<uint32_t>(CONFIG_WIFI_SCAN_DWELL_MIN_MS, dwell_max_ms);
+    scan_config.scan_time.active.max = dwell_max_ms;
+    scan_config.home_chan_dwell_time = CONFIG_WIFI_SCAN_HOME_DWELL_MS;
     
-    esp_err_t ret = esp_wifi_scan_start(nullptr, false);
+    ESP_LOGI(TAG, "Starting WiFi scan (dwell %" PRIu32 "-%" PRIu32 " ms)",
+             scan_config.scan_time.active.min, scan_config.scan_time.active.max);
+    
+    // Non-blocking: results arrive with WIFI_EVENT_SCAN_DONE
+    esp_err_t ret = esp_wifi_scan_start(&scan_config, false);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start WiFi scan: %s", esp_err_to_name(ret));
+        xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+        scan_callback_ = nullptr;
+        scan_filter_ssid_.clear();
+        xSemaphoreGive(scan_mutex_);
+        scanning_ = false;
         return false;
     }
     
-    // Wait for scan to complete
-    EventBits_t bits = xEventGroupWaitBits(wifi_event_group_, WIFI_SCAN_DONE_BIT,
-                                          pdFALSE, pdFALSE, 
-                                          pdMS_TO_TICKS(10000)); // 10 second timeout
-    
-    if (!(bits & WIFI_SCAN_DONE_BIT)) {
-        ESP_LOGE(TAG, "WiFi scan timeout");
+    return true;
+}
+
+bool WiFiManager::start_scan(ScanCallback on_done) {
+    if (!initialized_) {
+        ESP_LOGE(TAG, "WiFiManager not initialized");
         return false;
     }
     
-    return true;
+    return begin_scan(std::string(), 0, CONFIG_WIFI_SCAN_DWELL_MAX_MS, std::move(on_done));
 }
 
-bool WiFiManager::connect_to_network(const std::string& ssid, const std::string& password) {
+bool WiFiManager::start_targeted_scan(const std::string& ssid, uint8_t channel, ScanCallback on_done) {
     if (!initialized_) {
         ESP_LOGE(TAG, "WiFiManager not initialized");
         return false;
     }
     
-    if (ssid.empty()) {
-        ESP_LOGE(TAG, "SSID cannot be empty");
+    if (ssid.empty() || ssid.size() > 32) {
+        ESP_LOGE(TAG, "Invalid SSID for targeted scan");
         return false;
     }
     
-    ESP_LOGI(TAG, "Connecting to network: %s", ssid.c_str());
+    ESP_LOGI(TAG, "Targeted scan for %s on %s", ssid.c_str(), channel ? "one channel" : "all channels");
+    return begin_scan(ssid, channel, CONFIG_WIFI_SCAN_DWELL_MAX_MS, std::move(on_done));
+}
+
+bool WiFiManager::is_scanning() const {
+    return scanning_;
+}
+
+bool WiFiManager::start_background_scan(uint32_t interval_s, uint32_t dwell_ms) {
+    if (!initialized_ || !background_scan_timer_) {
+        ESP_LOGE(TAG, "Background scan not available");
+        return false;
+    }
+    
+    if (interval_s == 0) {
+        return false;
+    }
+    
+    background_interval_s_ = interval_s;
+    background_dwell_ms_ = (dwell_ms > 0) ? dwell_ms : CONFIG_WIFI_SCAN_DWELL_MAX_MS;
+    
+    esp_timer_stop(background_scan_timer_);
+    esp_err_t ret = esp_timer_start_periodic(background_scan_timer_,
+                                             static_cast<uint64_t>(interval_s) * 1000000ULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start background scan timer: %s", esp_err_to_name(ret));
+        background_interval_s_ = 0;
+        return false;
+    }
+    
+    ESP_LOGI(TAG, "Background scan every %" PRIu32 " s (dwell %" PRIu32 " ms)",
+             background_interval_s_, background_dwell_ms_);
+    
+    // Refresh right away rather than waiting a full interval
+    if (!scanning_ && link_state_ != LinkState::CONNECTING) {
+        begin_scan(std::string(), 0, background_dwell_ms_, nullptr);
+    }
+    return true;
+}
+
+void WiFiManager::stop_background_scan() {
+    if (background_scan_timer_) {
+        esp_timer_stop(background_scan_timer_);
+    }
+    background_interval_s_ = 0;
+    ESP_LOGI(TAG, "Background scan stopped");
+}
+
+bool WiFiManager::is_background_scan_active() const {
+    return background_interval_s_ > 0;
+}
+
+uint32_t WiFiManager::get_background_scan_interval() const {
+    return background_interval_s_;
+}
+
+void WiFiManager::background_scan_timer_callback(void* arg) {
+    WiFiManager* manager = static_cast<WiFiManager*>(arg);
     
+    // Never compete with a connection attempt or an ongoing scan for the radio
+    if (manager->link_state_ == LinkState::CONNECTING ||
+        manager->link_state_ == LinkState::RECONNECTING || manager->scanning_) {
+        return;
+    }
+    manager->begin_scan(std::string(), 0, manager->background_dwell_ms_, nullptr);
+}
+
+bool WiFiManager::find_ap_hint(const std::string& ssid, ApHint& hint) const {
+#if CONFIG_WIFI_FAST_CONNECT
+    bool found = false;
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    if (last_ap_ssid_ == ssid && last_ap_.channel != 0) {
+        hint = last_ap_;
+        found = true;
+    }
+    xSemaphoreGive(scan_mutex_);
+    
+    // Results are sorted by RSSI, so the first match is the strongest BSS
+    NetworkInfo network;
+    for (size_t i = 0; !found && get_scanned_network(i, network); i++) {
+        if (ssid == network.ssid && network.channel != 0) {
+            memcpy(hint.bssid, network.bssid, sizeof(hint.bssid));
+            hint.channel = network.channel;
+            hint.auth_mode = network.auth_mode;
+            found = true;
+        }
+    }
+    
+    // Fall back to where a saved network was last joined (survives reboots)
+    WiFiProfile profile;
+    if (!found && credentials_ && credentials_->find(ssid, profile) && profile.channel != 0) {
+        memcpy(hint.bssid, profile.bssid, sizeof(hint.bssid));
+        hint.channel = profile.channel;
+        hint.auth_mode = static_cast<wifi_auth_mode_t>(profile.auth_mode);
+        found = true;
+    }
+    return found;
+#else
+    return false;
+#endif
+}
+
+esp_err_t WiFiManager::configure_station(const std::string& ssid, const std::string& password,
+                                         const ApHint* hint) {
     wifi_config_t wifi_config = {};
     
     // Copy SSID
@@ -222,32 +691,160 @@ bool WiFiManager::connect_to_network(const std::string& ssid, const std::string&
     wifi_config.sta.pmf_cfg.capable = true;
     wifi_config.sta.pmf_cfg.required = false;
     
-    // Reset retry count and store SSID for later use
-    retry_count_ = 0;
-    connected_ssid_ = ssid;
+    if (hint) {
+        // Directed connect: probe only the known channel and accept only the known BSS
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, hint->bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = hint->channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.threshold.authmode = hint->auth_mode;
+    } else {
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
     
-    // Clear event bits
+    esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set station config: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+bool WiFiManager::attempt_connect(const std::string& ssid, const std::string& password,
+                                  const ApHint* hint, TickType_t timeout) {
+    // Reset retry count and clear event bits
+    attempt_retries_ = 0;
     xEventGroupClearBits(wifi_event_group_, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
     
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_connect());
+    if (configure_station(ssid, password, hint) != ESP_OK) {
+        return false;
+    }
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start connection: %s", esp_err_to_name(ret));
+        return false;
+    }
     
     // Wait for connection result
     EventBits_t bits = xEventGroupWaitBits(wifi_event_group_,
                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                                          pdFALSE, pdFALSE, 
-                                          pdMS_TO_TICKS(30000)); // 30 second timeout
+                                          pdFALSE, pdFALSE, timeout);
+    
+    // A timed-out attempt may still have a retry queued
+    esp_timer_stop(reconnect_timer_);
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+bool WiFiManager::connect_to_network(const std::string& ssid, const std::string& password) {
+    if (!initialized_) {
+        ESP_LOGE(TAG, "WiFiManager not initialized");
+        return false;
+    }
+    
+    if (ssid.empty()) {
+        ESP_LOGE(TAG, "SSID cannot be empty");
+        return false;
+    }
     
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "Connected successfully to %s", ssid.c_str());
+    xSemaphoreTake(connect_mutex_, portMAX_DELAY);
+    bool connected = connect_locked(ssid, password);
+    xSemaphoreGive(connect_mutex_);
+    return connected;
+}
+
+bool WiFiManager::connect_locked(const std::string& ssid, const std::string& password) {
+    ESP_LOGI(TAG, "Connecting to network: %s", ssid.c_str());
+    
+    WiFiProfile profile;
+    bool saved = credentials_ && credentials_->find(ssid, profile);
+    apply_ip_config((saved && profile.static_ip) ? &profile : nullptr);
+    
+    // An explicit connect supersedes any background reconnect in progress
+    esp_timer_stop(reconnect_timer_);
+    backoff_ms_ = 0;
+    
+    // A running scan would hold the radio off-channel; background scans pause until we are done
+    link_state_ = LinkState::CONNECTING;
+    if (scanning_) {
+        esp_wifi_scan_stop();
+        scanning_ = false;
+    }
+    
+    // Target of this attempt; also what a later reconnect rejoins
+    xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+    reconnect_ssid_ = ssid;
+    reconnect_password_ = password;
+    xSemaphoreGive(scan_mutex_);
+    int64_t start_us = esp_timer_get_time();
+    
+    bool connected = false;
+    bool fast = false;
+    ApHint hint;
+    if (find_ap_hint(ssid, hint)) {
+        ESP_LOGI(TAG, "Fast connect to " MACSTR " on channel %u", MAC2STR(hint.bssid), hint.channel);
+        fast = attempt_connect(ssid, password, &hint, pdMS_TO_TICKS(CONFIG_WIFI_FAST_CONNECT_TIMEOUT_MS));
+        connected = fast;
+        
+        if (!connected) {
+            // The AP moved channel or BSS; stop the directed retries and sweep instead
+            ESP_LOGW(TAG, "Directed connect failed, falling back to full scan");
+            link_state_ = LinkState::IDLE;
+            esp_wifi_disconnect();
+            vTaskDelay(pdMS_TO_TICKS(100));
+            link_state_ = LinkState::CONNECTING;
+        }
+    }
+    
+    if (!connected) {
+        connected = attempt_connect(ssid, password, nullptr, pdMS_TO_TICKS(30000)); // 30 second timeout
+    }
+    
+    if (connected) {
+        // From here on a lost link is recovered in the background
+        failover_rank_ = 0;
+        if (saved) {
+            WiFiProfile entry;
+            for (size_t rank = 0; credentials_->get(rank, entry); rank++) {
+                if (ssid == entry.ssid) {
+                    failover_rank_ = rank;
+                    break;
+                }
+            }
+        }
+        link_state_ = LinkState::CONNECTED;
+        
+        last_connect_time_ms_ = static_cast<uint32_t>((esp_timer_get_time() - start_us) / 1000);
+        last_connect_fast_ = fast;
+        ESP_LOGI(TAG, "Connected successfully to %s in %" PRIu32 " ms (%s)", ssid.c_str(),
+                 last_connect_time_ms_, fast ? "fast connect" : "full scan");
+        
+        if (saved) {
+            xSemaphoreTake(scan_mutex_, portMAX_DELAY);
+            ApHint joined = last_ap_;
+            xSemaphoreGive(scan_mutex_);
+            
+            esp_netif_ip_info_t ip_info = {};
+            esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+            if (netif) {
+                esp_netif_get_ip_info(netif, &ip_info);
+            }
+            credentials_->update_link(ssid, joined.bssid, joined.channel,
+                                      static_cast<uint8_t>(joined.auth_mode), ip_info.ip.addr);
+        }
         return true;
-    } else if (bits & WIFI_FAIL_BIT) {
+    }
+    
+    // Stop the driver from retrying on its own after we have given up
+    link_state_ = LinkState::IDLE;
+    esp_wifi_disconnect();
+    
+    EventBits_t bits = xEventGroupGetBits(wifi_event_group_);
+    if (bits & WIFI_FAIL_BIT) {
         ESP_LOGE(TAG, "Failed to connect to %s", ssid.c_str());
-        return false;
     } else {
         ESP_LOGE(TAG, "Connection timeout for %s", ssid.c_str());
-        return false;
     }
+    return false;
 }
 
 bool WiFiManager::disconnect() {
@@ -257,31 +854,110 @@ bool WiFiManager::disconnect() {
     }
     
     ESP_LOGI(TAG, "Disconnecting from WiFi");
+    
+    // A requested disconnect must not trigger the reconnect logic
+    link_state_ = LinkState::IDLE;
+    esp_timer_stop(reconnect_timer_);
+    backoff_ms_ = 0;
+    
     esp_err_t ret = esp_wifi_disconnect();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to disconnect: %s", esp_err_to_name(ret));
         return false;
     }
     
-    connected_ = false;
-    connected_ssid_.clear();
+    publish_link(false, std::string());
+    return true;
+}
+
+ScanResults WiFiManager::get_scan_results() const {
+    ScanResults results;
+    
+    // count and timestamp must come from the same snapshot
+    uint32_t version;
+    do {
+        version = scan_table_.load_bytes(offsetof(ScanTable, count), &results.count, sizeof(results.count));
+    } while (scan_table_.load_bytes(offsetof(ScanTable, timestamp_us), &results.timestamp_us,
+                                    sizeof(results.timestamp_us)) != version);
+    results.version = version;
+    results.in_progress = scanning_;
+    return results;
+}
+
+bool WiFiManager::get_scanned_network(size_t index, NetworkInfo& network, uint32_t* version) const {
+    if (index >= MAX_NETWORKS) {
+        return false;
+    }
+    
+    const size_t offset = offsetof(ScanTable, networks) + index * sizeof(NetworkInfo);
+    while (true) {
+        size_t count;
+        uint32_t count_version = scan_table_.load_bytes(offsetof(ScanTable, count), &count, sizeof(count));
+        if (index >= count) {
+            return false;
+        }
+        uint32_t entry_version = scan_table_.load_bytes(offset, &network, sizeof(network));
+        if (entry_version == count_version) {
+            if (version) {
+                *version = entry_version;
+            }
+            return true;
+        }
+    }
+}
+
+LinkStatus WiFiManager::get_link_status() const {
+    return link_status_.load();
+}
+
+bool WiFiManager::probe_rpc(int64_t& round_trip_us) const {
+    if (!initialized_) {
+        return false;
+    }
+    // Answered by the coprocessor, so the time is the link plus its RPC task
+    wifi_mode_t mode;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = esp_wifi_get_mode(&mode);
+    round_trip_us = esp_timer_get_time() - start_us;
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "WiFi RPC probe failed: %s", esp_err_to_name(ret));
+        return false;
+    }
     return true;
 }
 
-const std::vector<NetworkInfo>& WiFiManager::get_scanned_networks() const {
-    return scanned_networks_;
+bool WiFiManager::set_power_save(bool enable) {
+    if (!initialized_) {
+        return false;
+    }
+    esp_err_t ret = esp_wifi_set_ps(enable ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set WiFi power save: %s", esp_err_to_name(ret));
+        return false;
+    }
+    ESP_LOGI(TAG, "WiFi power save %s", enable ? "min modem" : "off");
+    return true;
+}
+
+bool WiFiManager::get_power_save(wifi_ps_type_t& type) const {
+    if (!initialized_) {
+        return false;
+    }
+    return esp_wifi_get_ps(&type) == ESP_OK;
 }
 
 bool WiFiManager::is_connected() const {
-    return connected_;
+    bool connected;
+    link_status_.load_bytes(offsetof(LinkStatus, connected), &connected, sizeof(connected));
+    return connected;
 }
 
 std::string WiFiManager::get_connected_ssid() const {
-    return connected_ssid_;
+    return get_link_status().ssid;
 }
 
 std::string WiFiManager::get_ip_address() const {
-    if (!connected_) {
+    if (!is_connected()) {
         return "";
     }
     
@@ -296,8 +972,16 @@ std::string WiFiManager::get_ip_address() const {
     return "";
 }
 
+uint32_t WiFiManager::get_last_connect_time_ms() const {
+    return last_connect_time_ms_;
+}
+
+bool WiFiManager::was_last_connect_fast() const {
+    return last_connect_fast_;
+}
+
 int8_t WiFiManager::get_rssi() const {
-    if (!connected_) {
+    if (!is_connected()) {
         return 0;
     }
     
@@ -309,6 +993,144 @@ int8_t WiFiManager::get_rssi() const {
     return 0;
 }
 
+void WiFiManager::apply_ip_config(const WiFiProfile* profile) {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (!netif) {
+        return;
+    }
+    
+    if (profile) {
+        // Static address: skip DHCP entirely
+        esp_netif_dhcpc_stop(netif);
+        esp_netif_ip_info_t ip_info = {};
+        ip_info.ip.addr = profile->ip;
+        ip_info.netmask.addr = profile->netmask;
+        ip_info.gw.addr = profile->gateway;
+        esp_err_t ret = esp_netif_set_ip_info(netif, &ip_info);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to set static IP: %s", esp_err_to_name(ret));
+            esp_netif_dhcpc_start(netif);
+            static_ip_active_ = false;
+            return;
+        }
+        if (profile->dns != 0) {
+            esp_netif_dns_info_t dns = {};
+            dns.ip.u_addr.ip4.addr = profile->dns;
+            dns.ip.type = ESP_IPADDR_TYPE_V4;
+            esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+        }
+        static_ip_active_ = true;
+        ESP_LOGI(TAG, "Using static IP " IPSTR, IP2STR(&ip_info.ip));
+    } else if (static_ip_active_) {
+        esp_netif_dhcpc_start(netif);
+        static_ip_active_ = false;
+    }
+}
+
+void WiFiManager::set_credential_store(std::shared_ptr<CredentialStore> store) {
+    credentials_ = store;
+}
+
+bool WiFiManager::start_auto_connect() {
+    if (!initialized_ || !credentials_ || credentials_->count() == 0) {
+        ESP_LOGI(TAG, "No saved networks, skipping auto-connect");
+        return false;
+    }
+    
+    bool expected = false;
+    if (!auto_connecting_.compare_exchange_strong(expected, true)) {
+        return false;
+    }
+    
+    BaseType_t ret = xTaskCreate(&WiFiManager::auto_connect_task, "wifi_auto",
+                                 CONFIG_WIFI_AUTO_CONNECT_STACK_SIZE, this,
+                                 CONFIG_WIFI_AUTO_CONNECT_PRIORITY, nullptr);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create auto-connect task");
+        auto_connecting_ = false;
+        return false;
+    }
+    return true;
+}
+
+bool WiFiManager::is_auto_connecting() const {
+    return auto_connecting_;
+}
+
+void WiFiManager::auto_connect_task(void* arg) {
+    WiFiManager* manager = static_cast<WiFiManager*>(arg);
+    
+    for (size_t rank = 0; rank < manager->credentials_->count(); rank++) {
+        // The operator may have connected by hand in the meantime
+        if (manager->is_connected()) {
+            break;
+        }
+        
+        WiFiProfile profile;
+        if (!manager->credentials_->get(rank, profile)) {
+            break;
+        }
+        
+        ESP_LOGI(TAG, "Auto-connect: trying saved network %u (%s)",
+                 static_cast<unsigned>(rank), profile.ssid);
+        if (manager->connect_to_network(profile.ssid, profile.password)) {
+            break;
+        }
+    }
+    
+    if (!manager->is_connected() && manager->link_state_ == LinkState::IDLE) {
+        ESP_LOGW(TAG, "Auto-connect: no saved network reachable, retrying in the background");
+        manager->begin_recovery();
+    }
+    
+    manager->auto_connecting_ = false;
+    vTaskDelete(nullptr);
+}
+
+WiFiManager::LinkState WiFiManager::get_link_state() const {
+    return link_state_;
+}
+
+WiFiManager::ReconnectStats WiFiManager::get_reconnect_stats() const {
+    ReconnectStats stats;
+    stats.state = link_state_;
+    stats.disconnects = disconnects_;
+    stats.reconnect_attempts = reconnect_attempts_;
+    stats.reconnects = reconnects_;
+    stats.failovers = failovers_;
+    stats.last_reason = last_disconnect_reason_;
+    stats.backoff_ms = stats.state == LinkState::RECONNECTING ? backoff_ms_.load() : 0;
+    return stats;
+}
+
+const char* WiFiManager::link_state_to_string(LinkState state) {
+    switch (state) {
+        case LinkState::IDLE: return "Idle";
+        case LinkState::CONNECTING: return "Connecting";
+        case LinkState::CONNECTED: return "Connected";
+        case LinkState::RECONNECTING: return "Reconnecting";
+        case LinkState::STOPPED: return "Stopped";
+        default: return "Unknown";
+    }
+}
+
+bool WiFiManager::get_current_credentials(std::string& ssid, std::string& password) const {
+    if (!is_connected()) {
+        return false;
+    }
+    
+    wifi_config_t wifi_config = {};
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) != ESP_OK) {
+        return false;
+    }
+    
+    const char* raw_ssid = reinterpret_cast<const char*>(wifi_config.sta.ssid);
+    const char* raw_password = reinterpret_cast<const char*>(wifi_config.sta.password);
+    ssid.assign(raw_ssid, strnlen(raw_ssid, sizeof(wifi_config.sta.ssid)));
+    password.assign(raw_password, strnlen(raw_password, sizeof(wifi_config.sta.password)));
+    return true;
+}
+
 const char* WiFiManager::auth_mode_to_string(wifi_auth_mode_t auth_mode) const {
     switch (auth_mode) {
         case WIFI_AUTH_OPEN: return "Open";
@@ -0,0 +1,226 @@
+# SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: CC0-1.0
+"""Command path benchmarks, driven over USB Serial JTAG and BLE NUS.
+
+Each test runs `bench` commands on the device and reads the `BENCH {...}`
+result lines. All results are written to BENCH_JSON (default
+bench_results.json). If BENCH_BASELINE names the results of an earlier build,
+every metric is compared against it and the run fails when one is worse by
+more than BENCH_TOLERANCE (default 0.2 = 20%).
+
+BLE tests need `bleak` and BENCH_BLE_NAME set to the advertised device name;
+they are skipped otherwise.
+"""
+import asyncio
+import json
+import logging
+import os
+import re
+import time
+from typing import Any, Dict, List, Optional
+
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+
+BENCH_RE = re.compile(rb'BENCH (\{[^\r\n]*\})')
+READY_RE = re.compile(rb'Ready:\s+(\d+)\.(\d) ms after boot')
+
+NUS_RX_UUID = '6e400002-b5a3-f393-e0a9-e50e24dcca9e'
+NUS_TX_UUID = '6e400003-b5a3-f393-e0a9-e50e24dcca9e'
+
+NOTIFY_SIZES = (20, 64, 128, 244, 512)
+NOTIFY_BYTES = 16384
+ECHO_ROUNDS = 20
+DISPATCH_LINES = ('help', 'relay_on 1', 'status', 'ble_link throughput', 'not_a_command')
+COMMAND_LINES = ('status', 'list', 'help', 'perf', 'ble_debug', 'relay_status')
+
+# Metric name suffixes where a larger value is better; everything else is a cost
+HIGHER_IS_BETTER = ('kbps', 'stack_free_min')
+# Informational fields that are never compared
+NOT_COMPARED = ('mtu', 'heap_leaked')
+
+_results: Dict[str, Dict[str, Any]] = {}
+_regressions: List[str] = []
+
+
+def _load_baseline() -> Dict[str, Dict[str, Any]]:
+    path = os.environ.get('BENCH_BASELINE')
+    if not path:
+        return {}
+    with open(path, encoding='utf-8') as baseline:
+        return json.load(baseline)
+
+
+_baseline = _load_baseline()
+_tolerance = float(os.environ.get('BENCH_TOLERANCE', '0.2'))
+
+
+def record(name: str, metrics: Dict[str, Any]) -> None:
+    """Store one result and compare its numeric metrics with the baseline."""
+    _results[name] = metrics
+    logging.info('%s: %s', name, json.dumps(metrics, sort_keys=True))
+
+    previous = _baseline.get(name, {})
+    for key, value in metrics.items():
+        old = previous.get(key)
+        if key in NOT_COMPARED or not isinstance(value, (int, float)) or not isinstance(old, (int, float)) or old <= 0:
+            continue
+        if key.endswith(HIGHER_IS_BETTER):
+            worse = value < old * (1 - _tolerance)
+        else:
+            worse = value > old * (1 + _tolerance)
+        if worse:
+            _regressions.append(f'{name}.{key}: {old} -> {value}')
+
+
+@pytest.fixture(scope='module', autouse=True)
+def bench_report() -> Any:
+    yield
+    path = os.environ.get('BENCH_JSON', 'bench_results.json')
+    with open(path, 'w', encoding='utf-8') as report:
+        json.dump(_results, report, indent=2, sort_keys=True)
+    logging.info('Benchmark results written to %s', path)
+
+
+def assert_no_regressions() -> None:
+    failures = list(_regressions)
+    _regressions.clear()
+    assert not failures, 'Regressions against baseline:\n' + '\n'.join(failures)
+
+
+# USB Serial JTAG
+
+def usb_ready(dut: IdfDut) -> None:
+    dut.expect_exact("Type 'help' for available commands", timeout=60)
+    # No echo or prompt, so only command output comes back
+    dut.write('console raw\n')
+    dut.expect_exact('USB console mode: raw', timeout=5)
+
+
+def usb_bench(dut: IdfDut, line: str, timeout: float = 30) -> Dict[str, Any]:
+    dut.write(line + '\n')
+    match = dut.expect(BENCH_RE, timeout=timeout)
+    return dict(json.loads(match.group(1)))
+
+
+@pytest.mark.esp32p4
+@pytest.mark.generic
+def test_bench_usb(dut: IdfDut) -> None:
+    usb_ready(dut)
+
+    dut.write('boot_stats\n')
+    ready = dut.expect(READY_RE, timeout=5)
+    record('boot', {'ready_ms': int(ready.group(1)) + int(ready.group(2)) / 10})
+
+    for size in NOTIFY_SIZES:
+        result = usb_bench(dut, f'bench notify {size} {NOTIFY_BYTES}')
+        record(f'usb.notify.{size}', {'kbps': result['kbps'], 'us': result['us']})
+
+    round_trips = []
+    device_us = []
+    for i in range(ECHO_ROUNDS):
+        start = time.perf_counter()
+        result = usb_bench(dut, f'bench echo {i}')
+        round_trips.append((time.perf_counter() - start) * 1e6)
+        device_us.append(result['device_us'])
+    record('usb.echo', {'rtt_us_median': sorted(round_trips)[len(round_trips) // 2],
+                        'device_us_median': sorted(device_us)[len(device_us) // 2]})
+
+    for line in DISPATCH_LINES:
+        result = usb_bench(dut, f'bench dispatch "{line}" 1000')
+        record(f'dispatch.{line}', {key: result[key] for key in result if key.endswith('_avg') or key.endswith('_min')})
+
+    for line in COMMAND_LINES:
+        result = usb_bench(dut, f'bench cmd "{line}" 5', timeout=60)
+        record(f'cmd.{line}', {'us_avg': result['us_avg'], 'heap_peak': result['heap_peak'],
+                               'heap_leaked': result['heap_leaked'], 'stack_free_min': result['stack_free_min']})
+
+    assert_no_regressions()
+
+
+# BLE Nordic UART Service
+
+class NusClient:
+    """Minimal NUS client: writes command lines and collects notifications."""
+
+    def __init__(self, name: str) -> None:
+        self.name = name
+        self.client: Any = None
+        self.rx = bytearray()
+        self.event = asyncio.Event()
+
+    async def __aenter__(self) -> 'NusClient':
+        from bleak import BleakClient, BleakScanner
+
+        device = await BleakScanner.find_device_by_name(self.name, timeout=20)
+        if device is None:
+            pytest.skip(f'BLE device {self.name} not found')
+        self.client = BleakClient(device)
+        await self.client.connect()
+        await self.client.start_notify(NUS_TX_UUID, self._on_notify)
+        return self
+
+    async def __aexit__(self, *exc: Any) -> None:
+        await self.client.disconnect()
+
+    def _on_notify(self, _: Any, data: bytearray) -> None:
+        self.rx += data
+        self.event.set()
+
+    async def bench(self, line: str, timeout: float = 30) -> Dict[str, Any]:
+        self.rx.clear()
+        payload = (line + '\n').encode()
+        # The device joins writes that fill a whole ATT payload
+        chunk = max(self.client.mtu_size - 3, 20)
+        for offset in range(0, len(payload), chunk):
+            await self.client.write_gatt_char(NUS_RX_UUID, payload[offset:offset + chunk], response=False)
+
+        deadline = time.monotonic() + timeout
+        while True:
+            match: Optional[re.Match] = BENCH_RE.search(self.rx)
+            if match:
+                return dict(json.loads(match.group(1)))
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                raise TimeoutError(f'No BENCH result for {line!r}')
+            self.event.clear()
+            try:
+                await asyncio.wait_for(self.event.wait(), remaining)
+            except asyncio.TimeoutError:
+                pass
+
+
+async def run_ble_benchmarks(name: str) -> None:
+    async with NusClient(name) as nus:
+        record('ble.link', {'mtu': nus.client.mtu_size})
+        for size in NOTIFY_SIZES:
+            if size > nus.client.mtu_size - 3:
+                continue
+            start = time.perf_counter()
+            result = await nus.bench(f'bench notify {size} {NOTIFY_BYTES}', timeout=60)
+            host_us = (time.perf_counter() - start) * 1e6
+            record(f'ble.notify.{size}', {'kbps': result['kbps'], 'host_kbps': int(result['bytes'] * 8e3 / host_us)})
+
+        round_trips = []
+        for i in range(ECHO_ROUNDS):
+            start = time.perf_counter()
+            await nus.bench(f'bench echo {i}')
+            round_trips.append((time.perf_counter() - start) * 1e6)
+        record('ble.echo', {'rtt_us_median': sorted(round_trips)[len(round_trips) // 2]})
+
+        for line in COMMAND_LINES:
+            result = await nus.bench(f'bench cmd "{line}" 5', timeout=60)
+            record(f'ble.cmd.{line}', {'us_avg': result['us_avg'], 'heap_peak': result['heap_peak']})
+
+
+@pytest.mark.esp32p4
+@pytest.mark.generic
+def test_bench_ble(dut: IdfDut) -> None:
+    name = os.environ.get('BENCH_BLE_NAME')
+    if not name:
+        pytest.skip('Set BENCH_BLE_NAME to run the BLE benchmarks')
+    pytest.importorskip('bleak')
+
+    dut.expect_exact("Type 'help' for available commands", timeout=60)
+    asyncio.run(run_ble_benchmarks(name))
+    assert_no_regressions()